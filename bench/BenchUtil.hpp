@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <dirent.h>
+
+// Monotonic nanoseconds
+static inline uint64_t benchNow()
+{
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Best of @repeats timings of @body run @iterations times, in ns per iteration. The best run is the one least
+// disturbed by the rest of the machine, which keeps results comparable between commits.
+template <typename Body>
+static double benchBest(int repeats, long iterations, Body body)
+{
+	double best = 1e30;
+	for (int r = 0; r < repeats; r++)
+	{
+		uint64_t start = benchNow();
+		for (long i = 0; i < iterations; i++)
+			body();
+		best = std::min(best, (double) (benchNow() - start) / iterations);
+	}
+	return best;
+}
+
+// Makes the compiler assume @value is read and memory written, so a timed body that is inlined can neither be
+// dropped nor hoisted out of the loop
+template <typename T>
+static inline void benchKeep(const T& value)
+{
+	asm volatile("" : : "g"(value) : "memory");
+}
+
+// SIMD path the oscpack sources were built with
+static inline const char* benchSimd()
+{
+#if defined(OSC_NO_SIMD)
+	return "none";
+#elif defined(__AVX2__)
+	return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+	return "sse2";
+#else
+	return "none";
+#endif
+}
+
+struct BenchFile {
+	std::string name;
+	std::string data;
+};
+
+// Every file of @dir, sorted by name
+static inline std::vector<BenchFile> benchLoadDir(const std::string& dir)
+{
+	std::vector<BenchFile> files;
+	DIR* d = opendir(dir.c_str());
+	if (!d)
+		return files;
+	while (struct dirent* entry = readdir(d))
+	{
+		if (entry->d_name[0] == '.')
+			continue;
+		FILE* file = std::fopen((dir + "/" + entry->d_name).c_str(), "rb");
+		if (!file)
+			continue;
+		BenchFile f;
+		f.name = entry->d_name;
+		char buffer[4096];
+		size_t n;
+		while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+			f.data.append(buffer, n);
+		std::fclose(file);
+		files.push_back(f);
+	}
+	closedir(d);
+	std::sort(files.begin(), files.end(), [](const BenchFile& a, const BenchFile& b) { return a.name < b.name; });
+	return files;
+}
+
+// Values that don't need escaping: names of files, benchmarks and cases
+static inline void benchJsonString(const char* key, const std::string& value, bool last = false)
+{
+	std::printf("\"%s\": \"%s\"%s", key, value.c_str(), last ? "" : ", ");
+}
+
+static inline void benchJsonInteger(const char* key, long long value, bool last = false)
+{
+	std::printf("\"%s\": %lld%s", key, value, last ? "" : ", ");
+}
+
+static inline void benchJsonNumber(const char* key, double value, bool last = false)
+{
+	std::printf("\"%s\": %.2f%s", key, value, last ? "" : ", ");
+}
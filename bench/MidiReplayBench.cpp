@@ -0,0 +1,135 @@
+// MIDI events PushMap handles per second, offline against the stub Rack SDK in rack/: a session of encoder turns,
+// alone and mixed with key presses and buttons, replayed as fast as possible into a PushMap with 1 to 8 knobs mapped.
+// Only the time spent handling the replayed messages counts, as shown in the module's menu. No Push is connected.
+// JSON on stdout.
+#include "BenchUtil.hpp"
+// PushMap is only defined in its translation unit, the bench is built with it instead of PushMap.o
+#include "../src/PushMap.cpp"
+
+#define REPLAY_BENCH_REPEATS		3
+#define REPLAY_BENCH_SAMPLE_RATE	48000
+// Messages of the session, a few dozen fast replay chunks
+#define REPLAY_BENCH_EVENTS			(64 * MIDI_REPLAY_FAST_CHUNK)
+// Encoders of the Push, CC 71 to 78
+#define REPLAY_BENCH_FIRST_KNOB		71
+
+// The module whose params are mapped
+struct BenchTarget : Module {
+	BenchTarget()
+	{
+		config(MAX_CHANNELS, 0, 0, 0);
+		for (int i = 0; i < MAX_CHANNELS; i++)
+			configParam(i, 0.f, 10.f, 5.f);
+	}
+};
+
+static void addEvent(MidiSession& session, int status, int note, int value)
+{
+	MidiSession::Event event;
+	event.block = session.events.size() / 4;
+	event.bytes[0] = (uint8_t) (status << 4);
+	event.bytes[1] = (uint8_t) note;
+	event.bytes[2] = (uint8_t) value;
+	session.events.push_back(event);
+}
+
+// @mixed: one message in eight is a key press with shift held, shift or play, the others turn the mapped knobs
+static MidiSession makeSession(int mapped, bool mixed)
+{
+	MidiSession session;
+	session.sampleRate = REPLAY_BENCH_SAMPLE_RATE;
+	std::srand(1);
+	while (session.events.size() < REPLAY_BENCH_EVENTS)
+	{
+		int kind = mixed ? std::rand() % 8 : 0;
+		if (kind == 1)
+		{
+			addEvent(session, 0xb, SHIFT, 127);
+		}
+		else if (kind == 2)
+		{
+			int note = BASE_NOTE + std::rand() % NOTES;
+			addEvent(session, 0x9, note, 100);
+			addEvent(session, 0x8, note, 0);
+		}
+		else if (kind == 3)
+		{
+			addEvent(session, 0xb, PLAY, 127);
+			addEvent(session, 0xb, PLAY, 0);
+		}
+		else
+		{
+			// Relative encoder, up to 3 steps either way
+			int steps = 1 + std::rand() % 3;
+			addEvent(session, 0xb, REPLAY_BENCH_FIRST_KNOB + std::rand() % mapped, (std::rand() & 1) ? steps : 128 - steps);
+		}
+	}
+	return session;
+}
+
+struct ReplayResult {
+	double eventsPerSecond;
+	long events;
+};
+
+static ReplayResult runReplay(int mapped, bool mixed)
+{
+	BenchTarget* target = new BenchTarget;
+	PushMap* module = new PushMap;
+	APP->engine->addModule(target);
+	APP->engine->addModule(module);
+	for (int id = 0; id < mapped; id++)
+	{
+		module->ccs[0][id] = REPLAY_BENCH_FIRST_KNOB + id;
+		module->learnParam(id, target->id, id);
+	}
+
+	Module::ProcessArgs args;
+	args.sampleRate = REPLAY_BENCH_SAMPLE_RATE;
+	args.sampleTime = 1.f / REPLAY_BENCH_SAMPLE_RATE;
+	MidiSession session = makeSession(mapped, mixed);
+	module->midiReplay.load(session);
+	module->midiReplay.start(true);
+	while (module->midiReplay.isPlaying())
+		module->process(args);
+
+	ReplayResult result;
+	result.eventsPerSecond = module->midiReplay.eventsPerSecond();
+	result.events = (long) module->midiReplay.fastEvents;
+	APP->engine->removeModule(module);
+	APP->engine->removeModule(target);
+	delete module;
+	delete target;
+	return result;
+}
+
+int main()
+{
+	std::printf("{");
+	benchJsonString("benchmark", "pushmap-midi-replay");
+	benchJsonInteger("chunk", MIDI_REPLAY_FAST_CHUNK);
+	std::printf("\"runs\": [\n");
+	const int mappedCounts[] = { 1, MAX_CHANNELS };
+	for (int i = 0; i < 2; i++)
+	{
+		for (bool mixed : { false, true })
+		{
+			ReplayResult best = { 0, 0 };
+			for (int r = 0; r < REPLAY_BENCH_REPEATS; r++)
+			{
+				ReplayResult result = runReplay(mappedCounts[i], mixed);
+				if (result.eventsPerSecond > best.eventsPerSecond)
+					best = result;
+			}
+			std::printf("\t{");
+			benchJsonInteger("mapped", mappedCounts[i]);
+			benchJsonString("traffic", mixed ? "knobs, keys and buttons" : "knobs");
+			benchJsonInteger("events", best.events);
+			benchJsonNumber("eventsPerSecond", best.eventsPerSecond);
+			benchJsonNumber("nsPerEvent", best.eventsPerSecond > 0 ? 1e9 / best.eventsPerSecond : 0, true);
+			std::printf("}%s\n", (i < 1 || !mixed) ? "," : "");
+		}
+	}
+	std::printf("]}\n");
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Cost of OSControlMap::process() per sample, offline against the stub Rack SDK in rack/: 1 to 256 channels mapped to
+// the params of another module, idle and with every channel receiving a message per slew block. Messages go through
+// the route table and the Rx coalescer as on the OSC thread, between blocks of samples, and are timed apart.
+// JSON on stdout.
+#include "BenchUtil.hpp"
+#include "../src/plugin.hpp"
+#include "../src/OSControlMap.hpp"
+#include "../src/OSCBaseListener.hpp"
+
+#define CONTROL_BENCH_REPEATS		3
+#define CONTROL_BENCH_SAMPLE_RATE	48000
+// Samples of each run
+#define CONTROL_BENCH_SAMPLES		(2 * CONTROL_BENCH_SAMPLE_RATE)
+
+// The module whose params are mapped
+struct BenchTarget : Module {
+	BenchTarget()
+	{
+		config(MAX_CHANNELS, 0, 0, 0);
+		for (int i = 0; i < MAX_CHANNELS; i++)
+			configParam(i, 0.f, 10.f, 0.f);
+	}
+};
+
+struct ControlResult {
+	double nsPerSample;
+	double nsPerMessage;
+	long paramWrites;
+};
+
+// @busy: every mapped channel gets a new value once per slew block
+static ControlResult runControl(int mapped, bool busy)
+{
+	BenchTarget* target = new BenchTarget;
+	OSControlMap* module = new OSControlMap;
+	APP->engine->addModule(target);
+	APP->engine->addModule(module);
+	for (int id = 0; id < mapped; id++)
+	{
+		module->ccs[id] = id;
+		module->learnParam(id, target->id, id);
+	}
+	// The widget's step() publishes the mappings to process()
+	module->ProcessOscActions();
+	OSCRxMsgRouter router;
+	router.addModule(module);
+
+	// Two values per channel, sent in turn so every block moves the params
+	std::vector<std::string> packets;
+	for (int id = 0; id < mapped; id++)
+	{
+		for (float value : { 0.25f, 0.75f })
+		{
+			char buffer[64];
+			osc::OutboundPacketStream message(buffer, sizeof(buffer));
+			message << osc::BeginMessage(module->oscAddress(id).c_str()) << value << osc::EndMessage;
+			packets.push_back(std::string(message.Data(), message.Size()));
+		}
+	}
+
+	Module::ProcessArgs args;
+	args.sampleRate = CONTROL_BENCH_SAMPLE_RATE;
+	args.sampleTime = 1.f / CONTROL_BENCH_SAMPLE_RATE;
+	IpEndpointName remote;
+	uint64_t processNs = 0;
+	uint64_t routeNs = 0;
+	long messages = 0;
+	for (int sample = 0; sample < CONTROL_BENCH_SAMPLES; sample += OSC_SLEW_DIVISION)
+	{
+		if (busy)
+		{
+			int parity = (sample / OSC_SLEW_DIVISION) & 1;
+			uint64_t start = benchNow();
+			for (int id = 0; id < mapped; id++)
+			{
+				const std::string& packet = packets[2 * id + parity];
+				router.ProcessPacket(packet.data(), (int) packet.size(), remote);
+			}
+			routeNs += benchNow() - start;
+			messages += mapped;
+		}
+		uint64_t start = benchNow();
+		for (int i = 0; i < OSC_SLEW_DIVISION; i++)
+			module->process(args);
+		processNs += benchNow() - start;
+	}
+
+	ControlResult result;
+	result.nsPerSample = (double) processNs / CONTROL_BENCH_SAMPLES;
+	result.nsPerMessage = messages ? (double) routeNs / messages : 0.0;
+	result.paramWrites = module->rxCoalescer.appliedCount.load();
+	router.removeModule(module);
+	APP->engine->removeModule(module);
+	APP->engine->removeModule(target);
+	delete module;
+	delete target;
+	return result;
+}
+
+int main()
+{
+	std::printf("{");
+	benchJsonString("benchmark", "oscontrolmap-process");
+	benchJsonInteger("sampleRate", CONTROL_BENCH_SAMPLE_RATE);
+	std::printf("\"runs\": [\n");
+	const int mappedCounts[] = { 1, 16, 64, MAX_CHANNELS };
+	for (int i = 0; i < 4; i++)
+	{
+		for (bool busy : { false, true })
+		{
+			ControlResult best = { 1e30, 0.0, 0 };
+			for (int r = 0; r < CONTROL_BENCH_REPEATS; r++)
+			{
+				ControlResult result = runControl(mappedCounts[i], busy);
+				if (result.nsPerSample < best.nsPerSample)
+					best = result;
+			}
+			std::printf("\t{");
+			benchJsonInteger("mapped", mappedCounts[i]);
+			benchJsonString("traffic", busy ? "every block" : "idle");
+			benchJsonInteger("valuesApplied", best.paramWrites);
+			benchJsonNumber("routeNsPerMessage", best.nsPerMessage);
+			benchJsonNumber("nsPerSample", best.nsPerSample);
+			// Share of the time budget of one sample
+			benchJsonNumber("dspLoadPercent", best.nsPerSample * CONTROL_BENCH_SAMPLE_RATE * 1e-7, true);
+			std::printf("}%s\n", (i < 3 || !busy) ? "," : "");
+		}
+	}
+	std::printf("]}\n");
+	return 0;
+}
@@ -0,0 +1,82 @@
+// Cost of the non-throwing OSC parser on each packet of a corpus, walked the way the plugin's router does it:
+// bundles are descended into, every message is parsed and its arguments read as doubles.
+// `ParseBench [corpus directory]`, the seed corpus of the fuzz target by default. JSON on stdout.
+#include "BenchUtil.hpp"
+#include "osc/OscPacketListener.h"
+#include "osc/OscReceivedElements.h"
+#include "ip/IpEndpointName.h"
+
+// Repeats of each timing, the best one is kept
+#define PARSE_BENCH_REPEATS		7
+#define PARSE_BENCH_ITERATIONS	200000
+
+struct ParseWalker : osc::OscPacketViewListener {
+	double sum = 0.0;
+	int messages = 0;
+	int malformed = 0;
+
+	void ProcessMessage(const osc::MessageView& message, const IpEndpointName& remoteEndpoint) override
+	{
+		messages++;
+		osc::ArgumentCursor args(message);
+		osc::ArgumentView arg;
+		double value;
+		while (args.Next(arg))
+		{
+			if (arg.AsDouble(value) == osc::PARSE_OK)
+				sum += value;
+		}
+	}
+
+	void ProcessMalformed(osc::ParseStatus status, const IpEndpointName& remoteEndpoint) override
+	{
+		malformed++;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	std::string corpus = (argc > 1) ? argv[1] : "../tests/corpus/parse";
+	std::vector<BenchFile> packets = benchLoadDir(corpus);
+	if (packets.empty())
+	{
+		std::fprintf(stderr, "ParseBench: no packets in %s\n", corpus.c_str());
+		return 1;
+	}
+
+	IpEndpointName remote;
+	ParseWalker walker;
+	double totalNs = 0.0;
+	size_t totalBytes = 0;
+	std::printf("{");
+	benchJsonString("benchmark", "parse");
+	benchJsonString("simd", benchSimd());
+	std::printf("\"packets\": [\n");
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		const std::string& data = packets[i].data;
+		double ns = benchBest(PARSE_BENCH_REPEATS, PARSE_BENCH_ITERATIONS, [&] {
+			walker.ProcessPacket(data.data(), (int) data.size(), remote);
+		});
+		// Once more to count what the packet holds
+		ParseWalker counter;
+		counter.ProcessPacket(data.data(), (int) data.size(), remote);
+		totalNs += ns;
+		totalBytes += data.size();
+
+		std::printf("\t{");
+		benchJsonString("name", packets[i].name);
+		benchJsonInteger("bytes", data.size());
+		benchJsonInteger("messages", counter.messages);
+		benchJsonInteger("malformed", counter.malformed);
+		benchJsonNumber("nsPerPacket", ns);
+		benchJsonNumber("mbPerSecond", data.size() * 1e3 / ns, true);
+		std::printf("}%s\n", (i + 1 < packets.size()) ? "," : "");
+	}
+	std::printf("], ");
+	benchJsonNumber("corpusNsPerPacket", totalNs / packets.size());
+	benchJsonNumber("corpusMbPerSecond", totalBytes * 1e3 / totalNs, true);
+	std::printf("}\n");
+	// Keeps the walk from being optimized out
+	return walker.sum == 12345.678 ? 2 : 0;
+}
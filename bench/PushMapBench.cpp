@@ -0,0 +1,127 @@
+// Cost of PushMap::process() per sample, offline against the stub Rack SDK in rack/: 1 to 8 knobs mapped to the params
+// of another module, at the usual sample rates, idle and with every mapped knob turning at a few MIDI message rates.
+// The MIDI messages are queued between samples the way Rack's MIDI driver queues them, and drained by process() at its
+// update rate. No Push is connected. JSON on stdout.
+#include "BenchUtil.hpp"
+// PushMap is only defined in its translation unit, the bench is built with it instead of PushMap.o
+#include "../src/PushMap.cpp"
+
+#define PUSH_BENCH_REPEATS		3
+// Seconds of audio of each run
+#define PUSH_BENCH_SECONDS		2
+// Encoders of the Push, CC 71 to 78
+#define PUSH_BENCH_FIRST_KNOB	71
+// Steps before a knob turns the other way, enough to sweep most of the param's range
+#define PUSH_BENCH_SWEEP_STEPS	160
+
+// The module whose params are mapped
+struct BenchTarget : Module {
+	BenchTarget()
+	{
+		config(MAX_CHANNELS, 0, 0, 0);
+		for (int i = 0; i < MAX_CHANNELS; i++)
+			configParam(i, 0.f, 10.f, 0.f);
+	}
+};
+
+struct PushResult {
+	double nsPerSample;
+	long midiMessages;
+};
+
+// @messageRate: messages per second each mapped knob sends, sweeping up and down, 0 for none
+static PushResult runPush(float sampleRate, int mapped, int messageRate)
+{
+	BenchTarget* target = new BenchTarget;
+	PushMap* module = new PushMap;
+	APP->engine->addModule(target);
+	APP->engine->addModule(module);
+	for (int id = 0; id < mapped; id++)
+	{
+		module->ccs[0][id] = PUSH_BENCH_FIRST_KNOB + id;
+		module->learnParam(id, target->id, id);
+	}
+
+	Module::ProcessArgs args;
+	args.sampleRate = sampleRate;
+	args.sampleTime = 1.f / sampleRate;
+	int samples = (int) sampleRate * PUSH_BENCH_SECONDS;
+	// Samples between two steps of the knobs, all of the run when idle
+	int stepSamples = messageRate > 0 ? std::max(1, (int) std::lround(sampleRate / messageRate)) : samples;
+	uint64_t processNs = 0;
+	long messages = 0;
+	for (int sample = 0; sample < samples; sample += stepSamples)
+	{
+		if (messageRate > 0)
+		{
+			for (int id = 0; id < mapped; id++)
+			{
+				midi::Message message;
+				message.setStatus(0xb);
+				message.setNote(PUSH_BENCH_FIRST_KNOB + id);
+				// Relative encoder: 1 up, 127 down
+				message.setValue(((sample / stepSamples / PUSH_BENCH_SWEEP_STEPS) & 1) ? 127 : 1);
+				module->midiInput.onMessage(message);
+				messages++;
+			}
+		}
+		int n = std::min(stepSamples, samples - sample);
+		uint64_t start = benchNow();
+		for (int i = 0; i < n; i++)
+			module->process(args);
+		processNs += benchNow() - start;
+	}
+
+	PushResult result;
+	result.nsPerSample = (double) processNs / samples;
+	result.midiMessages = messages;
+	APP->engine->removeModule(module);
+	APP->engine->removeModule(target);
+	delete module;
+	delete target;
+	return result;
+}
+
+int main()
+{
+	std::printf("{");
+	benchJsonString("benchmark", "pushmap-process");
+	benchJsonInteger("seconds", PUSH_BENCH_SECONDS);
+	std::printf("\"runs\": [\n");
+	const float sampleRates[] = { 44100.f, 48000.f, 96000.f, 192000.f };
+	const int mappedCounts[] = { 1, 4, MAX_CHANNELS };
+	// Messages per second and knob: idle, a slow turn, a fast spin, and a flood
+	const int messageRates[] = { 0, 50, 400, 1000 };
+	bool first = true;
+	for (float sampleRate : sampleRates)
+	{
+		for (int mapped : mappedCounts)
+		{
+			for (int messageRate : messageRates)
+			{
+				PushResult best = { 1e30, 0 };
+				for (int r = 0; r < PUSH_BENCH_REPEATS; r++)
+				{
+					PushResult result = runPush(sampleRate, mapped, messageRate);
+					if (result.nsPerSample < best.nsPerSample)
+						best = result;
+				}
+				std::printf("%s\t{", first ? "" : ",\n");
+				first = false;
+				benchJsonInteger("sampleRate", (long long) sampleRate);
+				benchJsonInteger("mapped", mapped);
+				benchJsonString("traffic", messageRate > 0 ? "knobs turning" : "idle");
+				benchJsonInteger("messageRate", messageRate);
+				// Per knob, as sent: the step is a whole number of samples
+				benchJsonNumber("messagesPerSecond", (double) best.midiMessages / mapped / PUSH_BENCH_SECONDS);
+				benchJsonInteger("midiMessages", best.midiMessages);
+				benchJsonNumber("nsPerSample", best.nsPerSample);
+				// Share of the time budget of one sample
+				benchJsonNumber("dspLoadPercent", best.nsPerSample * sampleRate * 1e-7, true);
+				std::printf("}");
+			}
+		}
+	}
+	std::printf("\n]}\n");
+	return 0;
+}
@@ -0,0 +1,96 @@
+// FindStr4End(), the SIMD scan against the scalar word loop: on the address patterns, type tags and string arguments
+// of a corpus, as the parser calls it (the end is the end of the message), and on synthetic addresses of each length.
+// `Str4Bench [corpus directory]`, the seed corpus of the fuzz target by default. JSON on stdout.
+#include "BenchUtil.hpp"
+#include "osc/OscPacketListener.h"
+#include "osc/OscReceivedElements.h"
+#include "osc/OscStr4.h"
+#include "ip/IpEndpointName.h"
+
+#define STR4_BENCH_REPEATS		7
+#define STR4_BENCH_ITERATIONS	1000000
+// Synthetic addresses, up to this many bytes with their padding
+#define STR4_BENCH_MAX_LENGTH	128
+
+// A str4 at the start of @data, which runs to the end of its message
+struct Str4Case {
+	std::string data;
+};
+
+struct Str4Collector : osc::OscPacketViewListener {
+	std::vector<Str4Case> cases;
+
+	void add(const char* p, const char* end)
+	{
+		cases.push_back(Str4Case { std::string(p, end - p) });
+	}
+
+	void ProcessMessage(const osc::MessageView& message, const IpEndpointName& remoteEndpoint) override
+	{
+		if (message.addressPattern.size)
+			add(message.addressPattern.data, message.end);
+		if (message.typeTags.size)
+			add(message.typeTags.data - 1, message.end);
+		osc::ArgumentCursor args(message);
+		osc::ArgumentView arg;
+		while (args.Next(arg))
+		{
+			if (arg.typeTag == osc::STRING_TYPE_TAG || arg.typeTag == osc::SYMBOL_TYPE_TAG)
+				add(arg.data, message.end);
+		}
+	}
+};
+
+template <typename Find>
+static double timeCases(const std::vector<Str4Case>& cases, long iterations, Find find)
+{
+	return benchBest(STR4_BENCH_REPEATS, iterations, [&] {
+		for (const Str4Case& c : cases)
+			benchKeep(find(c.data.data(), c.data.data() + c.data.size()));
+	});
+}
+
+static void printTimes(const std::vector<Str4Case>& cases, long iterations)
+{
+	double scalar = timeCases(cases, iterations, osc::FindStr4EndScalar);
+	double simd = timeCases(cases, iterations, [](const char* p, const char* end) { return osc::FindStr4End(p, end); });
+	benchJsonNumber("scalarNs", scalar / cases.size());
+	benchJsonNumber("simdNs", simd / cases.size());
+	benchJsonNumber("speedup", scalar / simd, true);
+}
+
+int main(int argc, char** argv)
+{
+	std::string corpus = (argc > 1) ? argv[1] : "../tests/corpus/parse";
+	Str4Collector collector;
+	for (const BenchFile& packet : benchLoadDir(corpus))
+		collector.ProcessPacket(packet.data.data(), (int) packet.data.size(), IpEndpointName());
+	if (collector.cases.empty())
+	{
+		std::fprintf(stderr, "Str4Bench: no strings in %s\n", corpus.c_str());
+		return 1;
+	}
+
+	std::printf("{");
+	benchJsonString("benchmark", "str4");
+	benchJsonString("simd", benchSimd());
+	std::printf("\"corpus\": {");
+	benchJsonInteger("strings", collector.cases.size());
+	printTimes(collector.cases, STR4_BENCH_ITERATIONS / collector.cases.size());
+	std::printf("},\n\"addresses\": [\n");
+	for (int length = 4; length <= STR4_BENCH_MAX_LENGTH; length += 4)
+	{
+		// "/aaa...", its padding and a float argument after it
+		std::string address(length, '\0');
+		address[0] = '/';
+		for (int i = 1; i < length - 4; i++)
+			address[i] = 'a' + i % 26;
+		std::vector<Str4Case> cases(1, Str4Case { address + std::string(",f\0\0\0\0\0\0", 8) });
+		std::printf("\t{");
+		benchJsonInteger("bytes", length);
+		printTimes(cases, STR4_BENCH_ITERATIONS);
+		std::printf("}%s\n", (length + 4 <= STR4_BENCH_MAX_LENGTH) ? "," : "");
+	}
+	std::printf("]}\n");
+	return 0;
+}
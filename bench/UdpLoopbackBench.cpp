@@ -0,0 +1,161 @@
+// Receive throughput of SocketReceiveMultiplexer over loopback UDP, one to many sockets. Built twice by the Makefile:
+// UdpLoopbackBench with the epoll and recvmmsg loop (Linux), UdpLoopbackBench-select with OSCPACK_USE_SELECT.
+// The sender keeps a bounded number of packets in flight, so the socket buffers never overflow and every packet
+// sent is received: the time measured is the multiplexer's, not the kernel dropping datagrams. JSON on stdout.
+#include "BenchUtil.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <ctime>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "osc/OscOutboundPacketStream.h"
+#include "ip/UdpSocket.h"
+#include "ip/PacketListener.h"
+
+#define UDP_BENCH_REPEATS		3
+#define UDP_BENCH_PACKETS		200000
+// Packets sent but not yet received, well below what the default socket buffer holds
+#define UDP_BENCH_IN_FLIGHT		64
+// A sender waiting longer than this for the receiver gives up, packets were lost
+#define UDP_BENCH_STALL_MS		2000
+
+static const char* multiplexer()
+{
+#if defined(__linux__) && !defined(OSCPACK_USE_SELECT)
+	return "epoll";
+#else
+	return "select";
+#endif
+}
+
+// A local UDP port nothing is bound to. UdpSocket::LocalEndpointFor() can't tell the port of a socket bound to any
+// port: on Linux the disconnect it ends with releases that port.
+static int freePort()
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(address);
+	bind(fd, (struct sockaddr*) &address, sizeof(address));
+	getsockname(fd, (struct sockaddr*) &address, &length);
+	close(fd);
+	return ntohs(address.sin_port);
+}
+
+struct CountingListener : PacketListener {
+	std::atomic<long> received;
+	long total = 0;
+	uint64_t end = 0;
+
+	CountingListener() : received(0) {}
+
+	void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override
+	{
+		if (received.fetch_add(1, std::memory_order_release) + 1 == total)
+			end = benchNow();
+	}
+};
+
+// CPU time of the calling thread, in ns
+static uint64_t threadCpuNow()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+	return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+struct LoopbackResult {
+	double nsPerPacket;
+	// CPU time the receiving thread spent per packet, waiting in the multiplexer excluded
+	double cpuNsPerPacket;
+	long lost;
+};
+
+// @sockets receive sockets on one multiplexer, the sender cycles through them
+static LoopbackResult runLoopback(int sockets, long packets)
+{
+	SocketReceiveMultiplexer mux;
+	CountingListener listener;
+	listener.total = packets;
+	std::vector<std::unique_ptr<UdpReceiveSocket>> receivers;
+	std::vector<std::unique_ptr<UdpTransmitSocket>> transmitters;
+	for (int i = 0; i < sockets; i++)
+	{
+		int port = freePort();
+		receivers.emplace_back(new UdpReceiveSocket(IpEndpointName("127.0.0.1", port)));
+		transmitters.emplace_back(new UdpTransmitSocket(IpEndpointName("127.0.0.1", port)));
+		mux.AttachSocketListener(receivers.back().get(), &listener);
+	}
+
+	char buffer[64];
+	osc::OutboundPacketStream message(buffer, sizeof(buffer));
+	message << osc::BeginMessage("/bench/param/12") << 0.5f << osc::EndMessage;
+
+	uint64_t start = benchNow();
+	long lost = 0;
+	std::thread sender([&] {
+		for (long sent = 0; sent < packets; sent++)
+		{
+			uint64_t waitStart = benchNow();
+			while (sent - listener.received.load(std::memory_order_acquire) >= UDP_BENCH_IN_FLIGHT)
+			{
+				if (benchNow() - waitStart > UDP_BENCH_STALL_MS * 1000000ull)
+				{
+					lost = packets - listener.received.load();
+					mux.AsynchronousBreak();
+					return;
+				}
+				std::this_thread::yield();
+			}
+			transmitters[sent % sockets]->Send(message.Data(), message.Size());
+		}
+		while (listener.received.load(std::memory_order_acquire) < packets)
+			std::this_thread::yield();
+		mux.AsynchronousBreak();
+	});
+	uint64_t cpuStart = threadCpuNow();
+	mux.Run();
+	uint64_t cpu = threadCpuNow() - cpuStart;
+	sender.join();
+
+	for (int i = 0; i < sockets; i++)
+		mux.DetachSocketListener(receivers[i].get(), &listener);
+	return LoopbackResult { lost ? 0.0 : (double) (listener.end - start) / packets, (double) cpu / packets, lost };
+}
+
+int main()
+{
+	std::printf("{");
+	benchJsonString("benchmark", "udp-loopback");
+	benchJsonString("multiplexer", multiplexer());
+	benchJsonInteger("packets", UDP_BENCH_PACKETS);
+	std::printf("\"sockets\": [\n");
+	const int socketCounts[] = { 1, 4, 16 };
+	for (int i = 0; i < 3; i++)
+	{
+		LoopbackResult best = { 1e30, 0.0, 0 };
+		for (int r = 0; r < UDP_BENCH_REPEATS; r++)
+		{
+			LoopbackResult result = runLoopback(socketCounts[i], UDP_BENCH_PACKETS);
+			if (result.lost)
+			{
+				std::fprintf(stderr, "UdpLoopbackBench: %ld packets lost with %d sockets\n", result.lost, socketCounts[i]);
+				return 1;
+			}
+			if (result.nsPerPacket < best.nsPerPacket)
+				best = result;
+		}
+		std::printf("\t{");
+		benchJsonInteger("sockets", socketCounts[i]);
+		benchJsonNumber("nsPerPacket", best.nsPerPacket);
+		benchJsonNumber("receiverCpuNsPerPacket", best.cpuNsPerPacket);
+		benchJsonNumber("packetsPerSecond", 1e9 / best.nsPerPacket, true);
+		std::printf("}%s\n", (i < 2) ? "," : "");
+	}
+	std::printf("]}\n");
+	return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+// libusb without any device: the Push display never opens.
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#define LIBUSB_CALL
+#define LIBUSB_HOTPLUG_MATCH_ANY -1
+
+struct libusb_context;
+struct libusb_device;
+struct libusb_device_handle;
+
+enum libusb_error {
+	LIBUSB_SUCCESS = 0,
+	LIBUSB_ERROR_IO = -1,
+	LIBUSB_ERROR_INVALID_PARAM = -2,
+	LIBUSB_ERROR_ACCESS = -3,
+	LIBUSB_ERROR_NO_DEVICE = -4,
+	LIBUSB_ERROR_NOT_FOUND = -5,
+	LIBUSB_ERROR_BUSY = -6,
+	LIBUSB_ERROR_TIMEOUT = -7,
+	LIBUSB_ERROR_OVERFLOW = -8,
+	LIBUSB_ERROR_PIPE = -9,
+	LIBUSB_ERROR_INTERRUPTED = -10,
+	LIBUSB_ERROR_NO_MEM = -11,
+	LIBUSB_ERROR_NOT_SUPPORTED = -12,
+	LIBUSB_ERROR_OTHER = -99
+};
+enum libusb_capability { LIBUSB_CAP_HAS_CAPABILITY = 0, LIBUSB_CAP_HAS_HOTPLUG = 1 };
+typedef int libusb_hotplug_callback_handle;
+typedef enum { LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED = 1, LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT = 2 } libusb_hotplug_event;
+typedef enum { LIBUSB_HOTPLUG_NO_FLAGS = 0, LIBUSB_HOTPLUG_ENUMERATE = 1 } libusb_hotplug_flag;
+typedef int (*libusb_hotplug_callback_fn)(libusb_context*, libusb_device*, libusb_hotplug_event, void*);
+
+struct libusb_device_descriptor {
+	uint8_t bLength, bDescriptorType;
+	uint16_t bcdUSB;
+	uint8_t bDeviceClass, bDeviceSubClass, bDeviceProtocol, bMaxPacketSize0;
+	uint16_t idVendor, idProduct, bcdDevice;
+	uint8_t iManufacturer, iProduct, iSerialNumber, bNumConfigurations;
+};
+
+inline int libusb_init(libusb_context** context) { *context = nullptr; return LIBUSB_SUCCESS; }
+inline void libusb_exit(libusb_context*) {}
+inline const char* libusb_error_name(int) { return "LIBUSB_ERROR_NO_DEVICE"; }
+inline int libusb_has_capability(unsigned int) { return 0; }
+inline ssize_t libusb_get_device_list(libusb_context*, libusb_device*** list) { static libusb_device* none[1] = { nullptr }; *list = none; return 0; }
+inline void libusb_free_device_list(libusb_device**, int) {}
+inline int libusb_get_device_descriptor(libusb_device*, libusb_device_descriptor*) { return LIBUSB_ERROR_NO_DEVICE; }
+inline uint8_t libusb_get_bus_number(libusb_device*) { return 0; }
+inline int libusb_get_port_numbers(libusb_device*, uint8_t*, int) { return 0; }
+inline int libusb_open(libusb_device*, libusb_device_handle**) { return LIBUSB_ERROR_NO_DEVICE; }
+inline void libusb_close(libusb_device_handle*) {}
+inline libusb_device* libusb_get_device(libusb_device_handle*) { return nullptr; }
+inline int libusb_get_string_descriptor_ascii(libusb_device_handle*, uint8_t, unsigned char*, int) { return LIBUSB_ERROR_NO_DEVICE; }
+inline int libusb_claim_interface(libusb_device_handle*, int) { return LIBUSB_ERROR_NO_DEVICE; }
+inline int libusb_release_interface(libusb_device_handle*, int) { return LIBUSB_ERROR_NO_DEVICE; }
+inline int libusb_bulk_transfer(libusb_device_handle*, unsigned char, unsigned char*, int, int*, unsigned int) { return LIBUSB_ERROR_NO_DEVICE; }
+inline int libusb_hotplug_register_callback(libusb_context*, int, int, int, int, int, libusb_hotplug_callback_fn, void*, libusb_hotplug_callback_handle*) { return LIBUSB_ERROR_NOT_SUPPORTED; }
+inline void libusb_hotplug_deregister_callback(libusb_context*, libusb_hotplug_callback_handle) {}
+inline int libusb_handle_events_timeout_completed(libusb_context*, timeval*, int*) { return LIBUSB_SUCCESS; }
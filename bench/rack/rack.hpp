@@ -0,0 +1,608 @@
+#pragma once
+// The part of the Rack v1 SDK the plugin uses, enough to build its modules without Rack and run process() offline.
+// Engine, params and MIDI behave like Rack's; drawing, menus, JSON and the window are no-ops.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#define DEBUG(...) ((void) 0)
+#define INFO(...) ((void) 0)
+#define WARN(...) ((void) 0)
+
+// Jansson: nothing is stored, every lookup misses
+typedef struct json_t json_t;
+inline json_t* json_object() { return nullptr; }
+inline json_t* json_array() { return nullptr; }
+inline json_t* json_integer(long long) { return nullptr; }
+inline json_t* json_real(double) { return nullptr; }
+inline json_t* json_string(const char*) { return nullptr; }
+inline json_t* json_boolean(bool) { return nullptr; }
+inline int json_object_set_new(json_t*, const char*, json_t*) { return 0; }
+inline json_t* json_object_get(const json_t*, const char*) { return nullptr; }
+inline int json_array_append_new(json_t*, json_t*) { return 0; }
+inline json_t* json_array_get(const json_t*, size_t) { return nullptr; }
+inline size_t json_array_size(const json_t*) { return 0; }
+inline long long json_integer_value(const json_t*) { return 0; }
+inline double json_real_value(const json_t*) { return 0.0; }
+inline double json_number_value(const json_t*) { return 0.0; }
+inline const char* json_string_value(const json_t*) { return nullptr; }
+inline bool json_is_true(const json_t*) { return false; }
+inline bool json_is_string(const json_t*) { return false; }
+inline char* json_dumps(const json_t*, size_t) { return nullptr; }
+inline void json_decref(json_t*) {}
+inline int json_dump_file(const json_t*, const char*, size_t) { return -1; }
+#define JSON_INDENT(n) (n)
+#define JSON_COMPACT 0x20
+#define json_array_foreach(array, index, value) \
+	for (index = 0; index < json_array_size(array) && (value = json_array_get(array, index)); index++)
+
+// NanoVG and OpenGL
+struct NVGcontext;
+struct NVGcolor { float r, g, b, a; };
+inline NVGcolor nvgRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { return NVGcolor { r / 255.f, g / 255.f, b / 255.f, a / 255.f }; }
+inline NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b) { return nvgRGBA(r, g, b, 255); }
+inline void nvgBeginPath(NVGcontext*) {}
+inline void nvgClosePath(NVGcontext*) {}
+inline void nvgRoundedRect(NVGcontext*, float, float, float, float, float) {}
+inline void nvgRect(NVGcontext*, float, float, float, float) {}
+inline void nvgArc(NVGcontext*, float, float, float, float, float, int) {}
+inline void nvgMoveTo(NVGcontext*, float, float) {}
+inline void nvgLineTo(NVGcontext*, float, float) {}
+inline void nvgFillColor(NVGcontext*, NVGcolor) {}
+inline void nvgFill(NVGcontext*) {}
+inline void nvgStrokeColor(NVGcontext*, NVGcolor) {}
+inline void nvgStrokeWidth(NVGcontext*, float) {}
+inline void nvgStroke(NVGcontext*) {}
+inline void nvgFontSize(NVGcontext*, float) {}
+inline void nvgTextAlign(NVGcontext*, int) {}
+inline float nvgText(NVGcontext*, float x, float, const char*, const char*) { return x; }
+inline void nvgSave(NVGcontext*) {}
+inline void nvgRestore(NVGcontext*) {}
+inline void nvgBeginFrame(NVGcontext*, float, float, float) {}
+inline void nvgEndFrame(NVGcontext*) {}
+enum { NVG_ALIGN_LEFT = 1, NVG_ALIGN_CENTER = 2, NVG_ALIGN_RIGHT = 4, NVG_ALIGN_TOP = 8, NVG_ALIGN_MIDDLE = 16, NVG_ALIGN_BOTTOM = 32, NVG_CCW = 1, NVG_CW = 2 };
+#define GL_COLOR_BUFFER_BIT 0x4000
+#define GL_STENCIL_BUFFER_BIT 0x0400
+#define GL_RGB 0x1907
+#define GL_UNSIGNED_SHORT_5_6_5 0x8363
+inline void glViewport(int, int, int, int) {}
+inline void glClearColor(float, float, float, float) {}
+inline void glClear(unsigned int) {}
+inline void glReadPixels(int, int, int, int, unsigned int, unsigned int, void*) {}
+enum { GLFW_RELEASE = 0, GLFW_PRESS = 1, GLFW_MOUSE_BUTTON_LEFT = 0, GLFW_MOUSE_BUTTON_RIGHT = 1 };
+
+#define CHECKMARK(x) ((x) ? "✔" : "")
+#define RIGHT_ARROW "\xe2\x96\xb8"
+
+
+namespace rack {
+
+struct Model;
+struct Plugin;
+
+template <typename T>
+T clamp(T x, T a, T b)
+{
+	return std::min(std::max(x, a), b);
+}
+
+inline float rescale(float x, float xMin, float xMax, float yMin, float yMax)
+{
+	return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin);
+}
+
+namespace string {
+inline std::string f(const char* format, ...)
+{
+	char buffer[1024];
+	va_list args;
+	va_start(args, format);
+	std::vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	return buffer;
+}
+}
+
+// Files the plugin writes land in the working directory
+namespace asset {
+inline std::string plugin(Plugin*, std::string path) { return path; }
+inline std::string user(std::string path) { return path; }
+}
+
+namespace system {
+inline double getTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline void createDirectory(const std::string&) {}
+}
+
+namespace math {
+struct Vec {
+	float x = 0.f, y = 0.f;
+	Vec() {}
+	Vec(float x, float y) : x(x), y(y) {}
+};
+struct Rect {
+	Vec pos, size;
+	Vec getBottomLeft() const { return Vec(pos.x, pos.y + size.y); }
+};
+}
+using math::Vec;
+using math::Rect;
+inline Vec mm2px(Vec v) { return v; }
+
+namespace dsp {
+// No spectrum: the output stays at zero
+struct RealFFT {
+	size_t len;
+	RealFFT(size_t len) : len(len) {}
+	void rfft(const float*, float* output) { std::fill(output, output + len, 0.f); }
+};
+struct ExponentialFilter {
+	float out = 0.f;
+	float lambda = 0.f;
+	void reset() { out = 0.f; }
+	void setLambda(float lambda) { this->lambda = lambda; }
+	float process(float deltaTime, float in)
+	{
+		out += (in - out) * lambda * deltaTime;
+		return out;
+	}
+};
+struct ClockDivider {
+	uint32_t clock = 0;
+	uint32_t division = 1;
+	void reset() { clock = 0; }
+	void setDivision(uint32_t division) { this->division = division; }
+	uint32_t getDivision() { return division; }
+	uint32_t getClock() { return clock; }
+	bool process()
+	{
+		if (++clock >= division) {
+			clock = 0;
+			return true;
+		}
+		return false;
+	}
+};
+struct SlewLimiter {
+	float out = 0.f;
+	void setRiseFall(float, float) {}
+	float process(float, float in) { return out = in; }
+};
+template <typename T, size_t S>
+struct RingBuffer {
+	T data[S];
+	size_t start = 0, end = 0;
+	void push(T t) { data[end++ % S] = t; }
+	T shift() { return data[start++ % S]; }
+	bool empty() const { return start == end; }
+	size_t size() const { return end - start; }
+	void clear() { start = end = 0; }
+};
+}
+
+// Scalar float_4, same results as Rack's SSE one
+namespace simd {
+struct float_4 {
+	float s[4];
+	float_4() {}
+	float_4(float x) { for (int i = 0; i < 4; i++) s[i] = x; }
+	static float_4 load(const float* p) { float_4 r; for (int i = 0; i < 4; i++) r.s[i] = p[i]; return r; }
+	void store(float* p) const { for (int i = 0; i < 4; i++) p[i] = s[i]; }
+	float& operator[](int i) { return s[i]; }
+};
+inline float_4 operator+(float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] += b.s[i]; return a; }
+inline float_4 operator-(float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] -= b.s[i]; return a; }
+inline float_4 operator*(float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] *= b.s[i]; return a; }
+inline float_4 fabs(float_4 a) { for (int i = 0; i < 4; i++) a.s[i] = std::fabs(a.s[i]); return a; }
+inline float_4 clamp(float_4 a, float_4 lo, float_4 hi) { for (int i = 0; i < 4; i++) a.s[i] = std::min(std::max(a.s[i], lo.s[i]), hi.s[i]); return a; }
+inline float_4 operator>=(float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] = a.s[i] >= b.s[i] ? 1.f : 0.f; return a; }
+inline float_4 operator<(float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] = a.s[i] < b.s[i] ? 1.f : 0.f; return a; }
+inline float_4 operator!=(float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] = a.s[i] != b.s[i] ? 1.f : 0.f; return a; }
+inline int movemask(float_4 a) { int m = 0; for (int i = 0; i < 4; i++) if (a.s[i] != 0.f) m |= 1 << i; return m; }
+inline float_4 ifelse(float_4 m, float_4 a, float_4 b) { for (int i = 0; i < 4; i++) a.s[i] = m.s[i] != 0.f ? a.s[i] : b.s[i]; return a; }
+}
+
+namespace engine {
+struct Module;
+
+struct Param {
+	float value = 0.f;
+	float getValue() { return value; }
+	void setValue(float value) { this->value = value; }
+};
+
+struct Input {
+	float voltages[16] = {};
+	int channels = 0;
+	float getVoltage(int channel = 0) { return voltages[channel]; }
+	bool isConnected() { return channels > 0; }
+	int getChannels() { return channels; }
+	const float* getVoltages(int firstChannel = 0) const { return &voltages[firstChannel]; }
+};
+
+struct Output {
+	float voltages[16] = {};
+	void setVoltage(float voltage, int channel = 0) { voltages[channel] = voltage; }
+	float getVoltage(int channel = 0) { return voltages[channel]; }
+};
+
+struct ParamQuantity {
+	Module* module = nullptr;
+	int paramId = 0;
+	float minValue = 0.f;
+	float maxValue = 1.f;
+	float defaultValue = 0.f;
+	std::string label;
+	std::string unit;
+
+	virtual ~ParamQuantity() {}
+	virtual float getValue();
+	virtual void setValue(float value);
+	virtual float getMinValue() { return minValue; }
+	virtual float getMaxValue() { return maxValue; }
+	virtual bool isBounded() { return std::isfinite(minValue) && std::isfinite(maxValue); }
+	virtual float getScaledValue() { return rescale(getValue(), getMinValue(), getMaxValue(), 0.f, 1.f); }
+	virtual void setScaledValue(float value) { setValue(rescale(value, 0.f, 1.f, getMinValue(), getMaxValue())); }
+	virtual std::string getDisplayValueString() { return string::f("%g", getValue()); }
+};
+
+struct Module {
+	// Set by Engine::addModule()
+	int id = -1;
+	std::vector<Param> params;
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
+	std::vector<ParamQuantity*> paramQuantities;
+
+	struct ProcessArgs {
+		float sampleRate;
+		float sampleTime;
+	};
+
+	virtual ~Module()
+	{
+		for (ParamQuantity* paramQuantity : paramQuantities)
+			delete paramQuantity;
+	}
+
+	void config(int numParams, int numInputs, int numOutputs, int numLights = 0)
+	{
+		params.resize(numParams);
+		inputs.resize(numInputs);
+		outputs.resize(numOutputs);
+		paramQuantities.resize(numParams, nullptr);
+	}
+
+	template <class TParamQuantity = ParamQuantity>
+	void configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string label = "", std::string unit = "",
+		float displayBase = 0.f, float displayMultiplier = 1.f, float displayOffset = 0.f)
+	{
+		delete paramQuantities[paramId];
+		ParamQuantity* q = new TParamQuantity;
+		q->module = this;
+		q->paramId = paramId;
+		q->minValue = minValue;
+		q->maxValue = maxValue;
+		q->defaultValue = defaultValue;
+		q->label = label;
+		q->unit = unit;
+		paramQuantities[paramId] = q;
+		params[paramId].value = defaultValue;
+	}
+
+	virtual void process(const ProcessArgs& args) {}
+	virtual void onReset() {}
+	virtual void onSampleRateChange() {}
+	virtual json_t* dataToJson() { return nullptr; }
+	virtual void dataFromJson(json_t* rootJ) {}
+};
+
+inline float ParamQuantity::getValue() { return module ? module->params[paramId].getValue() : 0.f; }
+inline void ParamQuantity::setValue(float value)
+{
+	if (module)
+		module->params[paramId].setValue(clamp(value, getMinValue(), getMaxValue()));
+}
+
+struct ParamHandle {
+	int moduleId = -1;
+	int paramId = 0;
+	Module* module = nullptr;
+	std::string text;
+	NVGcolor color;
+};
+
+struct Engine {
+	float sampleRate = 48000.f;
+	std::map<int, Module*> modules;
+	std::vector<ParamHandle*> paramHandles;
+
+	// Gives the module the next free ID, as Rack does when one is added to the rack
+	void addModule(Module* module)
+	{
+		module->id = modules.empty() ? 1 : modules.rbegin()->first + 1;
+		modules[module->id] = module;
+	}
+	void removeModule(Module* module) { modules.erase(module->id); }
+	Module* getModule(int moduleId)
+	{
+		auto it = modules.find(moduleId);
+		return (it != modules.end()) ? it->second : nullptr;
+	}
+	float getSampleRate() { return sampleRate; }
+
+	void addParamHandle(ParamHandle* paramHandle) { paramHandles.push_back(paramHandle); }
+	void removeParamHandle(ParamHandle* paramHandle)
+	{
+		paramHandles.erase(std::remove(paramHandles.begin(), paramHandles.end(), paramHandle), paramHandles.end());
+	}
+	ParamHandle* getParamHandle(int moduleId, int paramId)
+	{
+		for (ParamHandle* paramHandle : paramHandles) {
+			if (paramHandle->moduleId == moduleId && paramHandle->paramId == paramId)
+				return paramHandle;
+		}
+		return nullptr;
+	}
+	// With @overwrite the param is taken from any other handle mapping it
+	void updateParamHandle(ParamHandle* paramHandle, int moduleId, int paramId, bool overwrite = true)
+	{
+		if (overwrite && moduleId >= 0) {
+			ParamHandle* old = getParamHandle(moduleId, paramId);
+			if (old && old != paramHandle) {
+				old->moduleId = -1;
+				old->module = nullptr;
+			}
+		}
+		paramHandle->moduleId = moduleId;
+		paramHandle->paramId = paramId;
+		paramHandle->module = getModule(moduleId);
+	}
+};
+}
+using engine::Module;
+using engine::ParamQuantity;
+using engine::ParamHandle;
+
+namespace midi {
+struct Message {
+	uint8_t bytes[3] = {};
+	int64_t frame = -1;
+	uint8_t getChannel() const { return bytes[0] & 0xf; }
+	void setChannel(uint8_t channel) { bytes[0] = (bytes[0] & 0xf0) | (channel & 0xf); }
+	uint8_t getStatus() const { return bytes[0] >> 4; }
+	void setStatus(uint8_t status) { bytes[0] = (bytes[0] & 0xf) | (status << 4); }
+	uint8_t getNote() const { return bytes[1]; }
+	void setNote(uint8_t note) { bytes[1] = note & 0x7f; }
+	uint8_t getValue() const { return bytes[2]; }
+	void setValue(uint8_t value) { bytes[2] = value & 0x7f; }
+};
+
+// No MIDI devices
+struct Port {
+	int deviceId = -1;
+	std::vector<int> getDeviceIds() { return std::vector<int>(); }
+	std::string getDeviceName(int) { return ""; }
+	int getDeviceId() { return deviceId; }
+	void setDeviceId(int deviceId) { this->deviceId = deviceId; }
+	void reset() { deviceId = -1; }
+	json_t* toJson() { return nullptr; }
+	void fromJson(json_t*) {}
+};
+
+struct Output : Port {
+	// Messages sent, nothing else is kept
+	long sent = 0;
+	void sendMessage(Message) { sent++; }
+};
+
+// Messages are queued with onMessage(), as Rack's MIDI driver does
+struct InputQueue : Port {
+	std::queue<Message> queue;
+	void onMessage(Message message) { queue.push(message); }
+	bool shift(Message* message)
+	{
+		if (queue.empty())
+			return false;
+		*message = queue.front();
+		queue.pop();
+		return true;
+	}
+};
+}
+
+namespace event {
+struct Base {
+	void consume(void*) const {}
+	void stopPropagating() const {}
+};
+struct Button : Base { int action, button, mods; };
+struct Select : Base {};
+struct Deselect : Base {};
+struct Action : Base {};
+struct Change : Base {};
+}
+
+namespace widget {
+struct Widget {
+	Rect box;
+	bool visible = true;
+	struct DrawArgs { NVGcontext* vg; };
+	virtual ~Widget() {}
+	virtual void step() {}
+	virtual void draw(const DrawArgs&) {}
+	virtual void onButton(const event::Button&) {}
+	virtual void onSelect(const event::Select&) {}
+	virtual void onDeselect(const event::Deselect&) {}
+	virtual void onAction(const event::Action&) {}
+	void addChild(Widget*) {}
+	template <class T>
+	T* getAncestorOfType() { return nullptr; }
+};
+struct OpaqueWidget : Widget {};
+struct FramebufferWidget : Widget {
+	bool dirty = true;
+	virtual void drawFramebuffer() {}
+};
+}
+using widget::Widget;
+using widget::OpaqueWidget;
+using widget::FramebufferWidget;
+
+namespace ui {
+struct Menu : Widget {};
+struct MenuItem : Widget {
+	std::string text, rightText;
+	virtual Menu* createChildMenu() { return nullptr; }
+};
+struct MenuLabel : Widget { std::string text; };
+struct MenuSeparator : Widget {};
+struct MenuOverlay : Widget { void requestDelete() {} };
+struct ScrollWidget : Widget {
+	Widget* container = nullptr;
+	void scrollTo(Rect) {}
+};
+struct TextField : OpaqueWidget { std::string text, placeholder; };
+}
+using namespace ui;
+
+namespace app {
+struct LedDisplayChoice : OpaqueWidget {
+	std::string text;
+	NVGcolor color, bgColor;
+};
+struct LedDisplaySeparator : Widget {};
+struct ParamWidget : Widget { ParamQuantity* paramQuantity = nullptr; };
+struct ModuleWidget : OpaqueWidget {
+	Module* module = nullptr;
+	Model* model = nullptr;
+	void setModule(Module* module) { this->module = module; }
+	void setPanel(void*) {}
+	void addParam(ParamWidget*) {}
+	void addInput(Widget*) {}
+	void addOutput(Widget*) {}
+	virtual void appendContextMenu(Menu*) {}
+};
+struct MidiWidget : Widget {
+	Widget* channelChoice = nullptr;
+	void setMidiPort(midi::Port*) {}
+};
+struct RackWidget {
+	ParamWidget* touchedParam = nullptr;
+	ModuleWidget* getModule(int) { return nullptr; }
+};
+struct Scene { RackWidget* rack; };
+struct CKSS : ParamWidget {};
+struct PJ301MPort : Widget {};
+struct ScrewSilver : Widget {};
+}
+using namespace app;
+
+struct Window {
+	NVGcontext* vg = nullptr;
+	void* loadSvg(std::string) { return nullptr; }
+	bool isFrameOverdue() { return false; }
+};
+
+struct EventState {
+	Widget* selectedWidget = nullptr;
+	void setSelected(Widget* widget) { selectedWidget = widget; }
+};
+
+struct Context {
+	engine::Engine* engine;
+	app::Scene* scene;
+	Window* window;
+	EventState* event;
+};
+
+inline Context* contextGet()
+{
+	static engine::Engine engine;
+	static app::RackWidget rack;
+	static app::Scene scene { &rack };
+	static Window window;
+	static EventState event;
+	static Context context { &engine, &scene, &window, &event };
+	return &context;
+}
+#define APP rack::contextGet()
+
+struct Model {
+	std::string slug;
+	std::string name;
+	virtual ~Model() {}
+	virtual Module* createModule() = 0;
+};
+
+struct Plugin {
+	std::string version;
+	std::vector<Model*> models;
+	void addModel(Model* model) { models.push_back(model); }
+};
+
+template <class TModule, class TModuleWidget>
+Model* createModel(std::string slug)
+{
+	struct TModel : Model {
+		Module* createModule() override { return new TModule; }
+	};
+	Model* model = new TModel;
+	model->slug = slug;
+	model->name = slug;
+	return model;
+}
+
+template <class TWidget>
+TWidget* createWidget(Vec pos)
+{
+	TWidget* widget = new TWidget;
+	widget->box.pos = pos;
+	return widget;
+}
+
+template <class TParamWidget>
+TParamWidget* createParam(Vec pos, Module* module, int paramId)
+{
+	TParamWidget* widget = createWidget<TParamWidget>(pos);
+	if (module)
+		widget->paramQuantity = module->paramQuantities[paramId];
+	return widget;
+}
+
+template <class TPortWidget>
+TPortWidget* createInputCentered(Vec pos, Module*, int)
+{
+	return createWidget<TPortWidget>(pos);
+}
+
+template <class TPortWidget>
+TPortWidget* createOutputCentered(Vec pos, Module*, int)
+{
+	return createWidget<TPortWidget>(pos);
+}
+
+template <class TMenuItem>
+TMenuItem* createMenuItem(std::string text, std::string rightText = "")
+{
+	TMenuItem* item = new TMenuItem;
+	item->text = text;
+	item->rightText = rightText;
+	return item;
+}
+
+static const float RACK_GRID_WIDTH = 15.f;
+static const float RACK_GRID_HEIGHT = 380.f;
+
+}
@@ -0,0 +1,2 @@
+#pragma once
+// TextField is part of rack.hpp
@@ -37,6 +37,7 @@
 #include "IpEndpointName.h"
 
 #include <cstdio>
+#include <cstring>
 
 #include "NetworkingUtils.h"
 
@@ -47,9 +48,75 @@ unsigned long IpEndpointName::GetHostByName( const char *s )
 }
 
 
+void IpEndpointName::Resolve( const char *s )
+{
+	// Only IPv6 literals contain a colon, anything else resolves as IPv4
+	// first so existing IPv4 setups behave exactly as before.
+	if( std::strchr( s, ':' ) == 0 ){
+		address = GetHostByName( s );
+		if( address != 0 )
+			return;
+	}
+
+	unsigned char a6[16];
+	if( ::GetHostByName6( s, a6 ) )
+		SetIpv6Address( a6 );
+}
+
+
+void IpEndpointName::SetIpv6Address( const unsigned char ipv6Address_[16] )
+{
+	static const unsigned char mappedPrefix[12] = { 0,0,0,0, 0,0,0,0, 0,0,0xFF,0xFF };
+
+	if( std::memcmp( ipv6Address_, mappedPrefix, 12 ) == 0 ){
+		family = IPV4;
+		address = ((unsigned long)ipv6Address_[12] << 24) | ((unsigned long)ipv6Address_[13] << 16)
+				| ((unsigned long)ipv6Address_[14] << 8) | (unsigned long)ipv6Address_[15];
+	}else{
+		family = IPV6;
+		address = 0;
+		std::memcpy( address6, ipv6Address_, 16 );
+	}
+}
+
+
+static void Ipv6AddressAsString( char *s, const unsigned char *a )
+{
+	// RFC 5952: lower case, no leading zeros, longest run of two or more
+	// zero groups (the first one on a tie) written as ::
+	int groups[8];
+	for( int i = 0; i < 8; ++i )
+		groups[i] = (a[i * 2] << 8) | a[i * 2 + 1];
+
+	int bestStart = -1, bestLength = 1;
+	for( int i = 0; i < 8; ){
+		int j = i;
+		while( j < 8 && groups[j] == 0 )
+			++j;
+		if( j - i > bestLength ){
+			bestStart = i;
+			bestLength = j - i;
+		}
+		i = (j > i) ? j : i + 1;
+	}
+
+	for( int i = 0; i < 8; ++i ){
+		if( i == bestStart ){
+			s += std::sprintf( s, "::" );
+			i += bestLength - 1;
+			continue;
+		}
+		s += std::sprintf( s, (i > 0 && i != bestStart + bestLength) ? ":%x" : "%x", groups[i] );
+	}
+	*s = '\0';
+}
+
+
 void IpEndpointName::AddressAsString( char *s ) const
 {
-	if( address == ANY_ADDRESS ){
+	if( family == IPV6 ){
+		Ipv6AddressAsString( s, address6 );
+	}else if( address == ANY_ADDRESS ){
 		std::sprintf( s, "<any>" );
 	}else{
 		std::sprintf( s, "%d.%d.%d.%d",
@@ -63,6 +130,17 @@ void IpEndpointName::AddressAsString( char *s ) const
 
 void IpEndpointName::AddressAndPortAsString( char *s ) const
 {
+	if( family == IPV6 ){
+		*s++ = '[';
+		Ipv6AddressAsString( s, address6 );
+		s += std::strlen( s );
+		if( port == ANY_PORT )
+			std::sprintf( s, "]:<any>" );
+		else
+			std::sprintf( s, "]:%d", port );
+		return;
+	}
+
 	if( port == ANY_PORT ){
 		if( address == ANY_ADDRESS ){
 			std::sprintf( s, "<any>:<any>" );
@@ -40,39 +40,72 @@
 
 class IpEndpointName{
     static unsigned long GetHostByName( const char *s );
+    void Resolve( const char *s );
 public:
     static const unsigned long ANY_ADDRESS = 0xFFFFFFFF;
     static const int ANY_PORT = -1;
 
+    enum Family { IPV4, IPV6 };
+
     IpEndpointName()
-		: address( ANY_ADDRESS ), port( ANY_PORT ) {}
+		: family( IPV4 ), address( ANY_ADDRESS ), port( ANY_PORT ) {}
     IpEndpointName( int port_ ) 
-		: address( ANY_ADDRESS ), port( port_ ) {}
+		: family( IPV4 ), address( ANY_ADDRESS ), port( port_ ) {}
     IpEndpointName( unsigned long ipAddress_, int port_ ) 
-		: address( ipAddress_ ), port( port_ ) {}
+		: family( IPV4 ), address( ipAddress_ ), port( port_ ) {}
+    // Resolves host names and parses IPv4 and IPv6 literals. Names with
+    // both kinds of address resolve to IPv4.
     IpEndpointName( const char *addressName, int port_=ANY_PORT )
-		: address( GetHostByName( addressName ) )
-		, port( port_ ) {}
+		: family( IPV4 ), address( 0 ), port( port_ )
+		{ Resolve( addressName ); }
     IpEndpointName( int addressA, int addressB, int addressC, int addressD, int port_=ANY_PORT )
-		: address( ( (addressA << 24) | (addressB << 16) | (addressC << 8) | addressD ) )
+		: family( IPV4 )
+		, address( ( (addressA << 24) | (addressB << 16) | (addressC << 8) | addressD ) )
 		, port( port_ ) {}
+    // IPv6 address in network byte order. IPv4-mapped addresses
+    // (::ffff:a.b.c.d) are stored as plain IPv4.
+    IpEndpointName( const unsigned char ipv6Address_[16], int port_ )
+		: port( port_ )
+		{ SetIpv6Address( ipv6Address_ ); }
 
-	// address and port are maintained in host byte order here
+    void SetIpv6Address( const unsigned char ipv6Address_[16] );
+
+    Family family;
+	// address and port are maintained in host byte order here.
+	// address is only meaningful for IPV4 endpoints.
     unsigned long address;
+	// network byte order, only meaningful for IPV6 endpoints.
+    unsigned char address6[16];
     int port;
 
-    bool IsMulticastAddress() const { return ((address >> 24) & 0xFF) >= 224 && ((address >> 24) & 0xFF) <= 239; }
+    bool IsIpv6() const { return family == IPV6; }
+
+    bool IsMulticastAddress() const
+    {
+        if( family == IPV6 )
+            return address6[0] == 0xFF;
+        return ((address >> 24) & 0xFF) >= 224 && ((address >> 24) & 0xFF) <= 239;
+    }
 
-	enum { ADDRESS_STRING_LENGTH=17 };
+	// IPv6 addresses are written without brackets, with their port as [address]:port.
+	enum { ADDRESS_STRING_LENGTH=46 };
 	void AddressAsString( char *s ) const;
 
-	enum { ADDRESS_AND_PORT_STRING_LENGTH=23};
+	enum { ADDRESS_AND_PORT_STRING_LENGTH=55 };
 	void AddressAndPortAsString( char *s ) const;
 };
 
 inline bool operator==( const IpEndpointName& lhs, const IpEndpointName& rhs )
 {	
-	return (lhs.address == rhs.address && lhs.port == rhs.port );
+	if( lhs.family != rhs.family || lhs.port != rhs.port )
+		return false;
+	if( lhs.family == IpEndpointName::IPV6 ){
+		for( int i = 0; i < 16; ++i )
+			if( lhs.address6[i] != rhs.address6[i] )
+				return false;
+		return true;
+	}
+	return lhs.address == rhs.address;
 }
 
 inline bool operator!=( const IpEndpointName& lhs, const IpEndpointName& rhs )
@@ -52,5 +52,10 @@ public:
 // return ip address of host name in host byte order
 unsigned long GetHostByName( const char *name );
 
+// look up the IPv6 address of a host name, or parse an IPv6 literal.
+// @address6 is written in network byte order. returns false if the host
+// has no IPv6 address.
+bool GetHostByName6( const char *name, unsigned char address6[16] );
+
 
 #endif /* INCLUDED_OSCPACK_NETWORKINGUTILS_H */
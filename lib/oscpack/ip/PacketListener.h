@@ -37,9 +37,28 @@
 #ifndef INCLUDED_OSCPACK_PACKETLISTENER_H
 #define INCLUDED_OSCPACK_PACKETLISTENER_H
 
+#include <chrono>
+
 
 class IpEndpointName;
 
+// Monotonic time in nanoseconds, the clock packet receive times are taken on.
+inline unsigned long long PacketClockNow()
+{
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// Time the packet being processed was read from its socket. The socket
+// layer sets it right after reading, so listeners may use it from within
+// ProcessPacket(). Per receiving thread, 0 until something was received.
+inline unsigned long long& PacketReceiveTime()
+{
+    static thread_local unsigned long long receiveTime = 0;
+    return receiveTime;
+}
+
+
 class PacketListener{
 public:
     virtual ~PacketListener() {}
@@ -0,0 +1,138 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however,
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_SOCKETADDRESS_H
+#define INCLUDED_OSCPACK_SOCKETADDRESS_H
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#include <cstring>
+
+#include "IpEndpointName.h"
+
+
+// Conversions between IpEndpointName and sockaddr_storage, shared by the
+// posix and win32 socket implementations.
+//
+// Sockets are created AF_INET6 and dual-stack where the system allows it
+// (define OSCPACK_NO_IPV6 to always use AF_INET). IPv4 peers then appear as
+// IPv4-mapped IPv6 addresses, which are converted back to plain IPv4
+// endpoints so the rest of the library keeps seeing 32 bit addresses.
+
+
+// Fills @sockAddr for a socket of address family @socketFamily and returns
+// its length. IPv4 endpoints are written as IPv4-mapped addresses for
+// AF_INET6 sockets. Returns 0 for an IPv6 endpoint and an AF_INET socket.
+inline socklen_t SockaddrFromIpEndpointName( struct sockaddr_storage& sockAddr,
+        const IpEndpointName& endpoint, int socketFamily )
+{
+    unsigned short port = (endpoint.port == IpEndpointName::ANY_PORT)
+            ? 0 : htons( (unsigned short)endpoint.port );
+
+    if( socketFamily == AF_INET ){
+        if( endpoint.family == IpEndpointName::IPV6 )
+            return 0;
+
+        struct sockaddr_in *a = reinterpret_cast<struct sockaddr_in*>( &sockAddr );
+        std::memset( a, 0, sizeof(*a) );
+        a->sin_family = AF_INET;
+        a->sin_addr.s_addr = (endpoint.address == IpEndpointName::ANY_ADDRESS)
+                ? INADDR_ANY : htonl( endpoint.address );
+        a->sin_port = port;
+        return (socklen_t)sizeof(*a);
+    }
+
+    struct sockaddr_in6 *a = reinterpret_cast<struct sockaddr_in6*>( &sockAddr );
+    std::memset( a, 0, sizeof(*a) );
+    a->sin6_family = AF_INET6;
+    a->sin6_port = port;
+    if( endpoint.family == IpEndpointName::IPV6 ){
+        std::memcpy( &a->sin6_addr, endpoint.address6, 16 );
+    }else if( endpoint.address != IpEndpointName::ANY_ADDRESS ){
+        // ANY stays ::, which covers IPv4 as well on a dual-stack socket
+        unsigned char *b = reinterpret_cast<unsigned char*>( &a->sin6_addr );
+        b[10] = 0xFF;
+        b[11] = 0xFF;
+        b[12] = (unsigned char)(endpoint.address >> 24);
+        b[13] = (unsigned char)(endpoint.address >> 16);
+        b[14] = (unsigned char)(endpoint.address >> 8);
+        b[15] = (unsigned char)endpoint.address;
+    }
+    return (socklen_t)sizeof(*a);
+}
+
+
+// Called for every received packet. IPv4 and IPv4-mapped senders, the
+// common case, are decoded straight into the 32 bit address.
+inline void IpEndpointNameFromSockaddr( IpEndpointName& endpoint,
+        const struct sockaddr_storage& sockAddr )
+{
+    if( sockAddr.ss_family == AF_INET6 ){
+        const struct sockaddr_in6 *a = reinterpret_cast<const struct sockaddr_in6*>( &sockAddr );
+        const unsigned char *b = reinterpret_cast<const unsigned char*>( &a->sin6_addr );
+        static const unsigned char mappedPrefix[12] = { 0,0,0,0, 0,0,0,0, 0,0,0xFF,0xFF };
+        static const unsigned char anyAddress[16] = { 0 };
+
+        endpoint.port = (a->sin6_port == 0) ? IpEndpointName::ANY_PORT : ntohs( a->sin6_port );
+        if( std::memcmp( b, mappedPrefix, 12 ) == 0 ){
+            endpoint.family = IpEndpointName::IPV4;
+            endpoint.address = ((unsigned long)b[12] << 24) | ((unsigned long)b[13] << 16)
+                    | ((unsigned long)b[14] << 8) | (unsigned long)b[15];
+        }else if( std::memcmp( b, anyAddress, 16 ) == 0 ){
+            endpoint.family = IpEndpointName::IPV4;
+            endpoint.address = IpEndpointName::ANY_ADDRESS;
+        }else{
+            endpoint.family = IpEndpointName::IPV6;
+            endpoint.address = 0;
+            std::memcpy( endpoint.address6, b, 16 );
+        }
+    }else{
+        const struct sockaddr_in *a = reinterpret_cast<const struct sockaddr_in*>( &sockAddr );
+        endpoint.family = IpEndpointName::IPV4;
+        endpoint.address = (a->sin_addr.s_addr == INADDR_ANY)
+                ? IpEndpointName::ANY_ADDRESS : ntohl( a->sin_addr.s_addr );
+        endpoint.port = (a->sin_port == 0) ? IpEndpointName::ANY_PORT : ntohs( a->sin_port );
+    }
+}
+
+#endif /* INCLUDED_OSCPACK_SOCKETADDRESS_H */
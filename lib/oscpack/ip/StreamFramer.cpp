@@ -0,0 +1,199 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "StreamFramer.h"
+
+#include <cassert>
+
+#include "PacketListener.h"
+#include "IpEndpointName.h"
+
+
+// SLIP special characters
+static const unsigned char SLIP_END = 0xC0;
+static const unsigned char SLIP_ESC = 0xDB;
+static const unsigned char SLIP_ESC_END = 0xDC;
+static const unsigned char SLIP_ESC_ESC = 0xDD;
+
+
+static std::size_t RoundUpPowerOfTwo( std::size_t x )
+{
+    std::size_t result = 1;
+    while( result < x )
+        result <<= 1;
+    return result;
+}
+
+
+StreamFramer::StreamFramer( StreamFraming framing, std::size_t capacity )
+    : framing_( framing )
+    , capacity_( RoundUpPowerOfTwo( capacity ) )
+    , read_( 0 )
+    , write_( 0 )
+    , scan_( 0 )
+{
+    mask_ = capacity_ - 1;
+    ring_ = new char[ capacity_ ];
+    scratch_ = new char[ capacity_ ];
+}
+
+
+StreamFramer::~StreamFramer()
+{
+    delete [] ring_;
+    delete [] scratch_;
+}
+
+
+void StreamFramer::Reset()
+{
+    read_ = write_ = scan_ = 0;
+}
+
+
+char *StreamFramer::WritePointer( std::size_t& available )
+{
+    std::size_t free = capacity_ - (write_ - read_);
+    std::size_t offset = write_ & mask_;
+    std::size_t contiguous = capacity_ - offset;
+    available = (free < contiguous) ? free : contiguous;
+    return ring_ + offset;
+}
+
+
+void StreamFramer::CommitWrite( std::size_t size )
+{
+    assert( size <= capacity_ - (write_ - read_) );
+    write_ += size;
+}
+
+
+bool StreamFramer::Dispatch( PacketListener *listener, const IpEndpointName& remoteEndpoint )
+{
+    bool ok = (framing_ == SLIP_FRAMING)
+            ? DispatchSlip( listener, remoteEndpoint )
+            : DispatchLengthPrefixed( listener, remoteEndpoint );
+    if( !ok )
+        Reset();
+    return ok;
+}
+
+
+bool StreamFramer::DispatchLengthPrefixed( PacketListener *listener, const IpEndpointName& remoteEndpoint )
+{
+    while( write_ - read_ >= 4 ){
+        std::size_t size =
+                ((std::size_t)(unsigned char)At( read_ ) << 24)
+                | ((std::size_t)(unsigned char)At( read_ + 1 ) << 16)
+                | ((std::size_t)(unsigned char)At( read_ + 2 ) << 8)
+                | (std::size_t)(unsigned char)At( read_ + 3 );
+
+        // OSC packets are a multiple of 4 bytes and must fit the ring along with their prefix
+        if( size == 0 || (size & 0x03) != 0 || size > capacity_ - 4 )
+            return false;
+
+        if( write_ - read_ < 4 + size )
+            break; // wait for the rest of the packet
+
+        std::size_t start = (read_ + 4) & mask_;
+        const char *packet;
+        if( start + size <= capacity_ ){
+            packet = ring_ + start;
+        }else{
+            std::size_t head = capacity_ - start;
+            std::memcpy( scratch_, ring_ + start, head );
+            std::memcpy( scratch_ + head, ring_, size - head );
+            packet = scratch_;
+        }
+
+        listener->ProcessPacket( packet, (int)size, remoteEndpoint );
+        read_ += 4 + size;
+    }
+
+    scan_ = read_;
+    return true;
+}
+
+
+bool StreamFramer::DispatchSlip( PacketListener *listener, const IpEndpointName& remoteEndpoint )
+{
+    for(;;){
+        // find the next END
+        while( scan_ != write_ && (unsigned char)At( scan_ ) != SLIP_END )
+            ++scan_;
+
+        if( scan_ == write_ ){
+            // a full ring without END can never complete
+            return (write_ - read_) < capacity_;
+        }
+
+        std::size_t frameEnd = scan_;
+        ++scan_;
+
+        std::size_t start = read_ & mask_;
+        std::size_t length = frameEnd - read_;
+
+        // decode in place when the frame is contiguous, the output is never longer than the input
+        char *out = (start + length <= capacity_) ? ring_ + start : scratch_;
+        std::size_t size = 0;
+        bool valid = true;
+        for( std::size_t i = read_; i != frameEnd; ++i ){
+            unsigned char c = (unsigned char)At( i );
+            if( c == SLIP_ESC ){
+                if( ++i == frameEnd ){
+                    valid = false;
+                    break;
+                }
+                c = (unsigned char)At( i );
+                if( c == SLIP_ESC_END )
+                    c = SLIP_END;
+                else if( c == SLIP_ESC_ESC )
+                    c = SLIP_ESC;
+                else{
+                    valid = false;
+                    break;
+                }
+            }
+            out[ size++ ] = (char)c;
+        }
+
+        read_ = scan_;
+
+        // empty frames come from the leading END of double-END encoding, invalid ones are dropped
+        if( valid && size > 0 )
+            listener->ProcessPacket( out, (int)size, remoteEndpoint );
+    }
+}
@@ -0,0 +1,97 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_STREAMFRAMER_H
+#define INCLUDED_OSCPACK_STREAMFRAMER_H
+
+#include <cstring> // size_t
+
+
+class PacketListener;
+class IpEndpointName;
+
+
+// Packet framing used on stream transports (TCP).
+// SLIP_FRAMING is the OSC 1.1 double-END SLIP encoding (RFC 1055),
+// LENGTH_PREFIX_FRAMING is the OSC 1.0 int32 big-endian size prefix.
+enum StreamFraming{
+    SLIP_FRAMING,
+    LENGTH_PREFIX_FRAMING
+};
+
+
+// StreamFramer splits a byte stream into packets.
+// Bytes are received straight into a ring buffer (see WritePointer() and
+// CommitWrite()), and packets that don't wrap around the end of the ring are
+// handed to the listener in place, without copying.
+
+class StreamFramer{
+public:
+    // capacity is rounded up to a power of two and bounds the packet size.
+    StreamFramer( StreamFraming framing, std::size_t capacity=65536 );
+    ~StreamFramer();
+
+    StreamFraming Framing() const { return framing_; }
+
+    // Contiguous free space at the write position. available is 0 when
+    // the ring is full.
+    char *WritePointer( std::size_t& available );
+    void CommitWrite( std::size_t size );
+
+    // Hand every complete packet to listener. Returns false if the stream
+    // is corrupt (a packet larger than the ring or a bad length prefix), in
+    // which case the ring has been cleared and the connection should be dropped.
+    bool Dispatch( PacketListener *listener, const IpEndpointName& remoteEndpoint );
+
+    void Reset();
+
+private:
+    StreamFraming framing_;
+    char *ring_;
+    char *scratch_; // for packets that wrap around the end of the ring
+    std::size_t capacity_;
+    std::size_t mask_;
+    std::size_t read_;  // monotonic, index with & mask_
+    std::size_t write_;
+    std::size_t scan_;  // SLIP: first byte not yet searched for END
+
+    char At( std::size_t position ) const { return ring_[ position & mask_ ]; }
+
+    bool DispatchLengthPrefixed( PacketListener *listener, const IpEndpointName& remoteEndpoint );
+    bool DispatchSlip( PacketListener *listener, const IpEndpointName& remoteEndpoint );
+};
+
+#endif /* INCLUDED_OSCPACK_STREAMFRAMER_H */
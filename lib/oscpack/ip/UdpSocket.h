@@ -84,9 +84,15 @@ class UdpSocket{
     
 public:
 
+	// Address families a socket serves. A DUAL_STACK socket is an IPv6
+	// socket that also takes IPv4 peers, or an IPv4 one where IPv6 isn't
+	// available. IPV4_ONLY is for IPv4 multicast on platforms that don't
+	// take IPv4 group membership on IPv6 sockets (macOS, the BSDs).
+	enum Family { DUAL_STACK, IPV4_ONLY };
+
 	// Ctor throws std::runtime_error if there's a problem
 	// initializing the socket.
-	UdpSocket();
+	UdpSocket( Family family = DUAL_STACK );
 	virtual ~UdpSocket();
 
 	// Enable broadcast addresses (e.g. x.x.x.255)
@@ -102,6 +108,28 @@ public:
 	// operating systems.
 	void SetAllowReuse( bool allowReuse );
 
+	// Sets SO_REUSEPORT where the platform has it, so that sockets of
+	// several processes can bind the same port. On Linux each unicast
+	// datagram is then delivered to only one of them, multicast and
+	// broadcast datagrams are delivered to all of them. No-op on Win32,
+	// where SetAllowReuse() is enough.
+	void SetReusePort( bool reusePort );
+
+	// Join an IPv4 multicast group (IP_ADD_MEMBERSHIP) on the interface
+	// with the given address, or the default interface for ANY_ADDRESS.
+	// Throws std::runtime_error if the group can't be joined.
+	void JoinMulticastGroup( unsigned long groupAddress,
+			unsigned long interfaceAddress = IpEndpointName::ANY_ADDRESS );
+	void LeaveMulticastGroup( unsigned long groupAddress,
+			unsigned long interfaceAddress = IpEndpointName::ANY_ADDRESS );
+
+	// Join an IPv4 or IPv6 multicast group. IPv6 groups are joined
+	// (IPV6_JOIN_GROUP) on the interface with the given index, 0 for the
+	// default one, and need a DUAL_STACK socket. IPv4 groups are joined on
+	// the default interface, portably only on an IPV4_ONLY socket.
+	void JoinMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex = 0 );
+	void LeaveMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex = 0 );
+
 
 	// The socket is created in an unbound, unconnected state
 	// such a socket can only be used to send to an arbitrary
@@ -145,6 +173,18 @@ class UdpReceiveSocket : public UdpSocket{
 public:
 	UdpReceiveSocket( const IpEndpointName& localEndpoint )
 		{ Bind( localEndpoint ); }
+
+	// @allowReuse : share the port with other sockets and processes, see
+	// SetAllowReuse() and SetReusePort(). Set before binding.
+	UdpReceiveSocket( const IpEndpointName& localEndpoint, bool allowReuse, Family family = DUAL_STACK )
+		: UdpSocket( family )
+		{
+			if( allowReuse ){
+				SetAllowReuse( true );
+				SetReusePort( true );
+			}
+			Bind( localEndpoint );
+		}
 };
 
 
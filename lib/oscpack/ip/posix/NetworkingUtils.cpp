@@ -62,3 +62,20 @@ unsigned long GetHostByName( const char *name )
 
     return result;
 }
+
+
+bool GetHostByName6( const char *name, unsigned char address6[16] )
+{
+    struct addrinfo hints;
+    std::memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *info = 0;
+    if( getaddrinfo( name, 0, &hints, &info ) != 0 || info == 0 )
+        return false;
+
+    std::memcpy( address6, &((struct sockaddr_in6*)info->ai_addr)->sin6_addr, 16 );
+    freeaddrinfo( info );
+    return true;
+}
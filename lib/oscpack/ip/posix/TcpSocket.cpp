@@ -0,0 +1,264 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "../TcpSocket.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h> // for sockaddr_in
+#include <poll.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <cstring> // for memset
+#include <stdexcept>
+#include <vector>
+
+#include "../PacketListener.h"
+#include "../SocketAddress.h"
+
+
+class TcpListeningReceiveSocket::Implementation{
+	struct Connection{
+		int socket;
+		IpEndpointName remoteEndpoint;
+		StreamFramer *framer;
+	};
+
+	PacketListener *listener_;
+	StreamFraming framing_;
+	int maxConnections_;
+
+	int listenSocket_;
+	std::vector< Connection > connections_;
+
+	volatile bool break_;
+	int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
+
+	void CloseConnection( std::size_t index )
+	{
+		close( connections_[index].socket );
+		delete connections_[index].framer;
+		connections_.erase( connections_.begin() + index );
+	}
+
+	void AcceptConnection()
+	{
+		struct sockaddr_storage fromAddr;
+		socklen_t fromAddrLen = sizeof(fromAddr);
+		int s = accept( listenSocket_, (struct sockaddr *)&fromAddr, &fromAddrLen );
+		if( s < 0 )
+			return;
+
+		if( (int)connections_.size() >= maxConnections_ ){
+			close( s );
+			return;
+		}
+
+		Connection c;
+		c.socket = s;
+		IpEndpointNameFromSockaddr( c.remoteEndpoint, fromAddr );
+		c.framer = new StreamFramer( framing_ );
+		connections_.push_back( c );
+	}
+
+	// returns false when the connection must be closed
+	bool ReceiveFrom( Connection& c )
+	{
+		std::size_t available;
+		char *data = c.framer->WritePointer( available );
+		if( available == 0 )
+			return false; // can't happen unless Dispatch() failed to make progress
+
+		ssize_t result = recv( c.socket, data, available, 0 );
+		if( result <= 0 )
+			return result < 0 && (errno == EINTR || errno == EAGAIN);
+
+		c.framer->CommitWrite( (std::size_t)result );
+		PacketReceiveTime() = PacketClockNow();
+		return c.framer->Dispatch( listener_, c.remoteEndpoint );
+	}
+
+public:
+	Implementation( const IpEndpointName& localEndpoint, PacketListener *listener,
+			StreamFraming framing, int maxConnections )
+		: listener_( listener )
+		, framing_( framing )
+		, maxConnections_( maxConnections )
+		, listenSocket_( -1 )
+		, break_( false )
+	{
+		if( pipe(breakPipe_) != 0 )
+			throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+
+		int family = AF_INET;
+#ifndef OSCPACK_NO_IPV6
+		// dual-stack listener, accepts IPv4 and IPv6 clients
+		if( (listenSocket_ = socket( AF_INET6, SOCK_STREAM, 0 )) != -1 ){
+			int v6Only = 0;
+			if( setsockopt( listenSocket_, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only) ) == 0 ){
+				family = AF_INET6;
+			}else{
+				close( listenSocket_ );
+				listenSocket_ = -1;
+			}
+		}
+#endif
+		if( listenSocket_ == -1 && (listenSocket_ = socket( AF_INET, SOCK_STREAM, 0 )) == -1 ){
+			close( breakPipe_[0] );
+			close( breakPipe_[1] );
+			throw std::runtime_error("unable to create tcp socket\n");
+		}
+
+		int reuseAddr = 1;
+		setsockopt( listenSocket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr) );
+
+		struct sockaddr_storage bindSockAddr;
+		socklen_t bindLength = SockaddrFromIpEndpointName( bindSockAddr, localEndpoint, family );
+
+		if( bindLength == 0
+				|| bind( listenSocket_, (struct sockaddr *)&bindSockAddr, bindLength ) < 0
+				|| listen( listenSocket_, maxConnections_ ) < 0 ){
+			close( listenSocket_ );
+			close( breakPipe_[0] );
+			close( breakPipe_[1] );
+			throw std::runtime_error("unable to bind tcp socket\n");
+		}
+	}
+
+	~Implementation()
+	{
+		while( !connections_.empty() )
+			CloseConnection( connections_.size() - 1 );
+		close( listenSocket_ );
+		close( breakPipe_[0] );
+		close( breakPipe_[1] );
+	}
+
+	void Run()
+	{
+		break_ = false;
+
+		std::vector< struct pollfd > fds;
+
+		while( !break_ ){
+			// [0] break pipe, [1] listening socket, then one per connection
+			fds.resize( 2 + connections_.size() );
+			fds[0].fd = breakPipe_[0];
+			fds[1].fd = listenSocket_;
+			for( std::size_t i = 0; i < connections_.size(); ++i )
+				fds[2 + i].fd = connections_[i].socket;
+			for( std::size_t i = 0; i < fds.size(); ++i ){
+				fds[i].events = POLLIN;
+				fds[i].revents = 0;
+			}
+
+			if( poll( &fds[0], fds.size(), -1 ) < 0 ){
+				if( break_ ){
+					break;
+				}else if( errno == EINTR ){
+					continue;
+				}else{
+					throw std::runtime_error("poll failed\n");
+				}
+			}
+
+			if( fds[0].revents & POLLIN ){
+				// clear pending data from the asynchronous break pipe
+				char c;
+				read( breakPipe_[0], &c, 1 );
+			}
+
+			if( break_ )
+				break;
+
+			// walk backwards so closing a connection doesn't shift the ones still to visit
+			for( std::size_t i = connections_.size(); i-- > 0; ){
+				if( fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR) ){
+					if( !ReceiveFrom( connections_[i] ) )
+						CloseConnection( i );
+					if( break_ )
+						break;
+				}
+			}
+
+			if( fds[1].revents & POLLIN )
+				AcceptConnection();
+		}
+	}
+
+	void Break()
+	{
+		break_ = true;
+	}
+
+	void AsynchronousBreak()
+	{
+		break_ = true;
+
+		// Send a termination message to the asynchronous break pipe, so poll() will return
+		write( breakPipe_[1], "!", 1 );
+	}
+};
+
+
+TcpListeningReceiveSocket::TcpListeningReceiveSocket( const IpEndpointName& localEndpoint,
+		PacketListener *listener, StreamFraming framing, int maxConnections )
+{
+	impl_ = new Implementation( localEndpoint, listener, framing, maxConnections );
+}
+
+TcpListeningReceiveSocket::~TcpListeningReceiveSocket()
+{
+	delete impl_;
+}
+
+void TcpListeningReceiveSocket::Run()
+{
+	impl_->Run();
+}
+
+void TcpListeningReceiveSocket::Break()
+{
+	impl_->Break();
+}
+
+void TcpListeningReceiveSocket::AsynchronousBreak()
+{
+	impl_->AsynchronousBreak();
+}
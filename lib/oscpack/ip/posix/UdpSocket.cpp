@@ -59,6 +59,15 @@
 
 #include "../PacketListener.h"
 #include "../TimerListener.h"
+#include "../SocketAddress.h"
+
+
+// On Linux the multiplexer waits with epoll and drains sockets with
+// recvmmsg. Define OSCPACK_USE_SELECT to force the portable select() loop.
+#if defined(__linux__) && !defined(OSCPACK_USE_SELECT)
+#define OSCPACK_USE_EPOLL 1
+#include <sys/epoll.h>
+#endif
 
 
 #if defined(__APPLE__) && !defined(_SOCKLEN_T)
@@ -67,57 +76,53 @@ typedef ssize_t socklen_t;
 #endif
 
 
-static void SockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEndpointName& endpoint )
-{
-    std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
-    sockAddr.sin_family = AF_INET;
-
-	sockAddr.sin_addr.s_addr = 
-		(endpoint.address == IpEndpointName::ANY_ADDRESS)
-		? INADDR_ANY
-		: htonl( endpoint.address );
-
-	sockAddr.sin_port =
-		(endpoint.port == IpEndpointName::ANY_PORT)
-		? 0
-		: htons( endpoint.port );
-}
-
-
-static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sockAddr )
-{
-	return IpEndpointName( 
-		(sockAddr.sin_addr.s_addr == INADDR_ANY) 
-			? IpEndpointName::ANY_ADDRESS 
-			: ntohl( sockAddr.sin_addr.s_addr ),
-		(sockAddr.sin_port == 0)
-			? IpEndpointName::ANY_PORT
-			: ntohs( sockAddr.sin_port )
-		);
-}
-
-
 class UdpSocket::Implementation{
 	bool isBound_;
 	bool isConnected_;
 
 	int socket_;
-	struct sockaddr_in connectedAddr_;
-	struct sockaddr_in sendToAddr_;
+	// AF_INET6 (dual-stack) or AF_INET
+	int family_;
+	struct sockaddr_storage connectedAddr_;
+	socklen_t connectedAddrLength_;
+	// SendTo() only converts the destination when it changes
+	IpEndpointName sendToEndpoint_;
+	struct sockaddr_storage sendToAddr_;
+	socklen_t sendToAddrLength_;
+
+	socklen_t ToSockaddr( struct sockaddr_storage& sockAddr, const IpEndpointName& endpoint, const char *what ) const
+	{
+		socklen_t length = SockaddrFromIpEndpointName( sockAddr, endpoint, family_ );
+		if( length == 0 )
+			throw std::runtime_error( what );
+		return length;
+	}
 
 public:
 
-	Implementation()
+	Implementation( UdpSocket::Family family )
 		: isBound_( false )
 		, isConnected_( false )
 		, socket_( -1 )
+		, family_( AF_INET )
+		, connectedAddrLength_( 0 )
+		, sendToAddrLength_( 0 )
 	{
-		if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == -1 ){
+#ifndef OSCPACK_NO_IPV6
+		// one dual-stack socket serves IPv4 and IPv6 peers
+		if( family == UdpSocket::DUAL_STACK && (socket_ = socket( AF_INET6, SOCK_DGRAM, 0 )) != -1 ){
+			int v6Only = 0;
+			if( setsockopt( socket_, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only) ) == 0 ){
+				family_ = AF_INET6;
+			}else{
+				close( socket_ );
+				socket_ = -1;
+			}
+		}
+#endif
+		if( socket_ == -1 && (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == -1 ){
             throw std::runtime_error("unable to create udp socket\n");
         }
-
-		std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
-        sendToAddr_.sin_family = AF_INET;
 	}
 
 	~Implementation()
@@ -143,22 +148,87 @@ public:
 #endif
 	}
 
+	void SetReusePort( bool reusePort )
+	{
+#ifdef SO_REUSEPORT
+		int reuse = (reusePort) ? 1 : 0; // int on posix
+		setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+#else
+		(void) reusePort;
+#endif
+	}
+
+	// IPv4 options are accepted on dual-stack sockets by Linux and Win32,
+	// macOS and the BSDs only take them on an IPV4_ONLY socket
+	bool SetMulticastMembership( int option, unsigned long groupAddress, unsigned long interfaceAddress )
+	{
+		struct ip_mreq membership;
+		std::memset( &membership, 0, sizeof(membership) );
+		membership.imr_multiaddr.s_addr = htonl( groupAddress );
+		membership.imr_interface.s_addr =
+			(interfaceAddress == IpEndpointName::ANY_ADDRESS)
+			? INADDR_ANY
+			: htonl( interfaceAddress );
+		return setsockopt(socket_, IPPROTO_IP, option, &membership, sizeof(membership)) == 0;
+	}
+
+	void JoinMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+	{
+		if( !SetMulticastMembership( IP_ADD_MEMBERSHIP, groupAddress, interfaceAddress ) ){
+			if( family_ == AF_INET6 )
+				throw std::runtime_error("unable to join IPv4 multicast group on a dual-stack socket, use an IPV4_ONLY socket\n");
+			throw std::runtime_error("unable to join multicast group\n");
+		}
+	}
+
+	void LeaveMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+	{
+		SetMulticastMembership( IP_DROP_MEMBERSHIP, groupAddress, interfaceAddress );
+	}
+
+	bool SetMulticastMembership6( int option, const IpEndpointName& group, unsigned int interfaceIndex )
+	{
+		if( family_ != AF_INET6 )
+			return false;
+		struct ipv6_mreq membership;
+		std::memset( &membership, 0, sizeof(membership) );
+		std::memcpy( &membership.ipv6mr_multiaddr, group.address6, 16 );
+		membership.ipv6mr_interface = interfaceIndex;
+		return setsockopt(socket_, IPPROTO_IPV6, option, &membership, sizeof(membership)) == 0;
+	}
+
+	void JoinMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+	{
+		if( !group.IsIpv6() )
+			JoinMulticastGroup( group.address, IpEndpointName::ANY_ADDRESS );
+		else if( !SetMulticastMembership6( IPV6_JOIN_GROUP, group, interfaceIndex ) )
+			throw std::runtime_error("unable to join multicast group\n");
+	}
+
+	void LeaveMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+	{
+		if( !group.IsIpv6() )
+			LeaveMulticastGroup( group.address, IpEndpointName::ANY_ADDRESS );
+		else
+			SetMulticastMembership6( IPV6_LEAVE_GROUP, group, interfaceIndex );
+	}
+
 	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 	{
 		assert( isBound_ );
 
 		// first connect the socket to the remote server
         
-        struct sockaddr_in connectSockAddr;
-		SockaddrFromIpEndpointName( connectSockAddr, remoteEndpoint );
+        struct sockaddr_storage connectSockAddr;
+		socklen_t connectLength = ToSockaddr( connectSockAddr, remoteEndpoint, "unable to connect udp socket\n" );
        
-        if (connect(socket_, (struct sockaddr *)&connectSockAddr, sizeof(connectSockAddr)) < 0) {
+        if (connect(socket_, (struct sockaddr *)&connectSockAddr, connectLength) < 0) {
             throw std::runtime_error("unable to connect udp socket\n");
         }
 
         // get the address
 
-        struct sockaddr_in sockAddr;
+        struct sockaddr_storage sockAddr;
         std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
         socklen_t length = sizeof(sockAddr);
         if (getsockname(socket_, (struct sockaddr *)&sockAddr, &length) < 0) {
@@ -168,31 +238,35 @@ public:
 		if( isConnected_ ){
 			// reconnect to the connected address
 			
-			if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+			if (connect(socket_, (struct sockaddr *)&connectedAddr_, connectedAddrLength_) < 0) {
 				throw std::runtime_error("unable to connect udp socket\n");
 			}
 
 		}else{
 			// unconnect from the remote address
 		
-			struct sockaddr_in unconnectSockAddr;
+			struct sockaddr_storage unconnectSockAddr;
 			std::memset( (char *)&unconnectSockAddr, 0, sizeof(unconnectSockAddr ) );
-			unconnectSockAddr.sin_family = AF_UNSPEC;
+			unconnectSockAddr.ss_family = AF_UNSPEC;
 			// address fields are zero
-			int connectResult = connect(socket_, (struct sockaddr *)&unconnectSockAddr, sizeof(unconnectSockAddr));
+			socklen_t unconnectLength = (family_ == AF_INET6)
+					? (socklen_t)sizeof(struct sockaddr_in6) : (socklen_t)sizeof(struct sockaddr_in);
+			int connectResult = connect(socket_, (struct sockaddr *)&unconnectSockAddr, unconnectLength);
 			if ( connectResult < 0 && errno != EAFNOSUPPORT ) {
 				throw std::runtime_error("unable to un-connect udp socket\n");
 			}
 		}
 
-		return IpEndpointNameFromSockaddr( sockAddr );
+		IpEndpointName result;
+		IpEndpointNameFromSockaddr( result, sockAddr );
+		return result;
 	}
 
 	void Connect( const IpEndpointName& remoteEndpoint )
 	{
-		SockaddrFromIpEndpointName( connectedAddr_, remoteEndpoint );
+		connectedAddrLength_ = ToSockaddr( connectedAddr_, remoteEndpoint, "unable to connect udp socket\n" );
        
-        if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+        if (connect(socket_, (struct sockaddr *)&connectedAddr_, connectedAddrLength_) < 0) {
             throw std::runtime_error("unable to connect udp socket\n");
         }
 
@@ -208,18 +282,22 @@ public:
 
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
 	{
-		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
-        sendToAddr_.sin_port = htons( remoteEndpoint.port );
+		if( sendToAddrLength_ == 0 || remoteEndpoint != sendToEndpoint_ ){
+			sendToAddrLength_ = SockaddrFromIpEndpointName( sendToAddr_, remoteEndpoint, family_ );
+			sendToEndpoint_ = remoteEndpoint;
+			if( sendToAddrLength_ == 0 )
+				return; // IPv6 destination, IPv4 only socket
+		}
 
-        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sendToAddrLength_ );
 	}
 
 	void Bind( const IpEndpointName& localEndpoint )
 	{
-		struct sockaddr_in bindSockAddr;
-		SockaddrFromIpEndpointName( bindSockAddr, localEndpoint );
+		struct sockaddr_storage bindSockAddr;
+		socklen_t bindLength = ToSockaddr( bindSockAddr, localEndpoint, "unable to bind udp socket\n" );
 
-        if (bind(socket_, (struct sockaddr *)&bindSockAddr, sizeof(bindSockAddr)) < 0) {
+        if (bind(socket_, (struct sockaddr *)&bindSockAddr, bindLength) < 0) {
             throw std::runtime_error("unable to bind udp socket\n");
         }
 
@@ -232,7 +310,7 @@ public:
 	{
 		assert( isBound_ );
 
-		struct sockaddr_in fromAddr;
+		struct sockaddr_storage fromAddr;
         socklen_t fromAddrLen = sizeof(fromAddr);
              	 
         ssize_t result = recvfrom(socket_, data, size, 0,
@@ -240,8 +318,7 @@ public:
 		if( result < 0 )
 			return 0;
 
-		remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
-		remoteEndpoint.port = ntohs(fromAddr.sin_port);
+		IpEndpointNameFromSockaddr( remoteEndpoint, fromAddr );
 
 		return (std::size_t)result;
 	}
@@ -249,9 +326,9 @@ public:
 	int Socket() { return socket_; }
 };
 
-UdpSocket::UdpSocket()
+UdpSocket::UdpSocket( Family family )
 {
-	impl_ = new Implementation();
+	impl_ = new Implementation( family );
 }
 
 UdpSocket::~UdpSocket()
@@ -269,6 +346,31 @@ void UdpSocket::SetAllowReuse( bool allowReuse )
     impl_->SetAllowReuse( allowReuse );
 }
 
+void UdpSocket::SetReusePort( bool reusePort )
+{
+    impl_->SetReusePort( reusePort );
+}
+
+void UdpSocket::JoinMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+{
+    impl_->JoinMulticastGroup( groupAddress, interfaceAddress );
+}
+
+void UdpSocket::LeaveMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+{
+    impl_->LeaveMulticastGroup( groupAddress, interfaceAddress );
+}
+
+void UdpSocket::JoinMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+{
+    impl_->JoinMulticastEndpoint( group, interfaceIndex );
+}
+
+void UdpSocket::LeaveMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+{
+    impl_->LeaveMulticastEndpoint( group, interfaceIndex );
+}
+
 IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 {
 	return impl_->LocalEndpointFor( remoteEndpoint );
@@ -340,6 +442,23 @@ class SocketReceiveMultiplexer::Implementation{
 	volatile bool break_;
 	int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
 
+	enum { MAX_BUFFER_SIZE = 4098 };
+
+#ifdef OSCPACK_USE_EPOLL
+	// number of datagrams drained from one socket per recvmmsg() call
+	enum { RECEIVE_BATCH_SIZE = 32, MAX_EPOLL_EVENTS = 16 };
+
+	int epollFd_;
+
+	// receive slab, allocated once and reused by every Run() iteration
+	std::vector<char> slab_;
+	std::vector<struct mmsghdr> msgs_;
+	std::vector<struct iovec> iovecs_;
+	std::vector<struct sockaddr_storage> fromAddrs_;
+#else
+	std::vector<char> slab_;
+#endif
+
 	double GetCurrentTimeMs() const
 	{
 		struct timeval t;
@@ -354,10 +473,29 @@ public:
 	{
 		if( pipe(breakPipe_) != 0 )
 			throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+
+#ifdef OSCPACK_USE_EPOLL
+		epollFd_ = epoll_create1( EPOLL_CLOEXEC );
+		if( epollFd_ == -1 ){
+			close( breakPipe_[0] );
+			close( breakPipe_[1] );
+			throw std::runtime_error( "creation of epoll instance failed\n" );
+		}
+
+		slab_.resize( RECEIVE_BATCH_SIZE * MAX_BUFFER_SIZE );
+		msgs_.resize( RECEIVE_BATCH_SIZE );
+		iovecs_.resize( RECEIVE_BATCH_SIZE );
+		fromAddrs_.resize( RECEIVE_BATCH_SIZE );
+#else
+		slab_.resize( MAX_BUFFER_SIZE );
+#endif
 	}
 
     ~Implementation()
 	{
+#ifdef OSCPACK_USE_EPOLL
+		close( epollFd_ );
+#endif
 		close( breakPipe_[0] );
 		close( breakPipe_[1] );
 	}
@@ -405,125 +543,248 @@ public:
     void Run()
 	{
 		break_ = false;
-        char *data = 0;
-        
-        try{
-            
-            // configure the master fd_set for select()
-
-            fd_set masterfds, tempfds;
-            FD_ZERO( &masterfds );
-            FD_ZERO( &tempfds );
-            
-            // in addition to listening to the inbound sockets we
-            // also listen to the asynchronous break pipe, so that AsynchronousBreak()
-            // can break us out of select() from another thread.
-            FD_SET( breakPipe_[0], &masterfds );
-            int fdmax = breakPipe_[0];		
-
-            for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
-                    i != socketListeners_.end(); ++i ){
-
-                if( fdmax < i->second->impl_->Socket() )
-                    fdmax = i->second->impl_->Socket();
-                FD_SET( i->second->impl_->Socket(), &masterfds );
-            }
-
-
-            // configure the timer queue
-            double currentTimeMs = GetCurrentTimeMs();
-
-            // expiry time ms, listener
-            std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
-            for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-                    i != timerListeners_.end(); ++i )
-                timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
-            std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
-
-            const int MAX_BUFFER_SIZE = 4098;
-            data = new char[ MAX_BUFFER_SIZE ];
-            IpEndpointName remoteEndpoint;
-
-            struct timeval timeout;
-
-            while( !break_ ){
-                tempfds = masterfds;
-
-                struct timeval *timeoutPtr = 0;
-                if( !timerQueue_.empty() ){
-                    double timeoutMs = timerQueue_.front().first - GetCurrentTimeMs();
-                    if( timeoutMs < 0 )
-                        timeoutMs = 0;
-                
-                    long timoutSecondsPart = (long)(timeoutMs * .001);
-                    timeout.tv_sec = (time_t)timoutSecondsPart;
-                    // 1000000 microseconds in a second
-                    timeout.tv_usec = (suseconds_t)((timeoutMs - (timoutSecondsPart * 1000)) * 1000);
-                    timeoutPtr = &timeout;
-                }
-
-                if( select( fdmax + 1, &tempfds, 0, 0, timeoutPtr ) < 0 ){
-                    if( break_ ){
-                        break;
-                    }else if( errno == EINTR ){
-                        // on returning an error, select() doesn't clear tempfds.
-                        // so tempfds would remain all set, which would cause read( breakPipe_[0]...
-                        // below to block indefinitely. therefore if select returns EINTR we restart
-                        // the while() loop instead of continuing on to below.
-                        continue;
-                    }else{
-                        throw std::runtime_error("select failed\n");
-                    }
-                }
-
-                if( FD_ISSET( breakPipe_[0], &tempfds ) ){
-                    // clear pending data from the asynchronous break pipe
-                    char c;
-                    read( breakPipe_[0], &c, 1 );
-                }
-                
-                if( break_ )
-                    break;
-
-                for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
-                        i != socketListeners_.end(); ++i ){
-
-                    if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
-
-                        std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-                        if( size > 0 ){
-                            i->first->ProcessPacket( data, (int)size, remoteEndpoint );
-                            if( break_ )
-                                break;
-                        }
-                    }
-                }
-
-                // execute any expired timers
-                currentTimeMs = GetCurrentTimeMs();
-                bool resort = false;
-                for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-                        i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
-
-                    i->second.listener->TimerExpired();
-                    if( break_ )
-                        break;
-
-                    i->first += i->second.periodMs;
-                    resort = true;
-                }
-                if( resort )
-                    std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
-            }
-
-            delete [] data;
-        }catch(...){
-            if( data )
-                delete [] data;
-            throw;
-        }
+
+		// configure the timer queue
+		double currentTimeMs = GetCurrentTimeMs();
+
+		// expiry time ms, listener
+		std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
+		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				i != timerListeners_.end(); ++i )
+			timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
+		std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+
+#ifdef OSCPACK_USE_EPOLL
+		RunEpoll( timerQueue_ );
+#else
+		RunSelect( timerQueue_ );
+#endif
+	}
+
+private:
+	typedef std::vector< std::pair< double, AttachedTimerListener > > TimerQueue;
+
+	// milliseconds until the next timer is due, or -1 if no timers are attached
+	double NextTimeoutMs( const TimerQueue& timerQueue ) const
+	{
+		if( timerQueue.empty() )
+			return -1.;
+
+		double timeoutMs = timerQueue.front().first - GetCurrentTimeMs();
+		if( timeoutMs < 0 )
+			timeoutMs = 0;
+		return timeoutMs;
+	}
+
+	void RunExpiredTimers( TimerQueue& timerQueue )
+	{
+		// execute any expired timers
+		double currentTimeMs = GetCurrentTimeMs();
+		bool resort = false;
+		for( TimerQueue::iterator i = timerQueue.begin();
+				i != timerQueue.end() && i->first <= currentTimeMs; ++i ){
+
+			i->second.listener->TimerExpired();
+			if( break_ )
+				break;
+
+			i->first += i->second.periodMs;
+			resort = true;
+		}
+		if( resort )
+			std::sort( timerQueue.begin(), timerQueue.end(), CompareScheduledTimerCalls );
 	}
 
+#ifdef OSCPACK_USE_EPOLL
+	void RunEpoll( TimerQueue& timerQueue )
+	{
+		// the break pipe is registered with a null pointer, sockets with their
+		// index into socketListeners_ offset by one.
+		struct epoll_event ev;
+		std::memset( &ev, 0, sizeof(ev) );
+		ev.events = EPOLLIN;
+		ev.data.u64 = 0;
+		if( epoll_ctl( epollFd_, EPOLL_CTL_ADD, breakPipe_[0], &ev ) < 0 )
+			throw std::runtime_error("epoll_ctl failed\n");
+
+		for( std::size_t i = 0; i < socketListeners_.size(); ++i ){
+			ev.data.u64 = i + 1;
+			if( epoll_ctl( epollFd_, EPOLL_CTL_ADD, socketListeners_[i].second->impl_->Socket(), &ev ) < 0 ){
+				UnregisterEpoll( i );
+				throw std::runtime_error("epoll_ctl failed\n");
+			}
+		}
+
+		for( std::size_t i = 0; i < RECEIVE_BATCH_SIZE; ++i ){
+			iovecs_[i].iov_base = &slab_[ i * MAX_BUFFER_SIZE ];
+			iovecs_[i].iov_len = MAX_BUFFER_SIZE;
+		}
+
+		struct epoll_event events[ MAX_EPOLL_EVENTS ];
+
+		try{
+			while( !break_ ){
+				double timeoutMs = NextTimeoutMs( timerQueue );
+				int timeout = (timeoutMs < 0) ? -1 : (int)std::ceil( timeoutMs );
+
+				int n = epoll_wait( epollFd_, events, MAX_EPOLL_EVENTS, timeout );
+				if( n < 0 ){
+					if( break_ ){
+						break;
+					}else if( errno == EINTR ){
+						continue;
+					}else{
+						throw std::runtime_error("epoll_wait failed\n");
+					}
+				}
+
+				for( int e = 0; e < n && !break_; ++e ){
+					if( events[e].data.u64 == 0 ){
+						// clear pending data from the asynchronous break pipe
+						char c;
+						read( breakPipe_[0], &c, 1 );
+						continue;
+					}
+
+					std::pair< PacketListener*, UdpSocket* >& entry = socketListeners_[ events[e].data.u64 - 1 ];
+					DrainSocket( entry.second->impl_->Socket(), entry.first );
+				}
+
+				if( break_ )
+					break;
+
+				RunExpiredTimers( timerQueue );
+			}
+		}catch(...){
+			UnregisterEpoll( socketListeners_.size() );
+			throw;
+		}
+
+		UnregisterEpoll( socketListeners_.size() );
+	}
+
+	void UnregisterEpoll( std::size_t socketCount )
+	{
+		epoll_ctl( epollFd_, EPOLL_CTL_DEL, breakPipe_[0], 0 );
+		for( std::size_t i = 0; i < socketCount; ++i )
+			epoll_ctl( epollFd_, EPOLL_CTL_DEL, socketListeners_[i].second->impl_->Socket(), 0 );
+	}
+
+	// Read up to RECEIVE_BATCH_SIZE datagrams in one syscall and hand them to
+	// the listener. epoll is level triggered, so anything left over wakes us
+	// again on the next wait and other sockets get their turn in between.
+	void DrainSocket( int fd, PacketListener *listener )
+	{
+		for( std::size_t i = 0; i < RECEIVE_BATCH_SIZE; ++i ){
+			std::memset( &msgs_[i], 0, sizeof(msgs_[i]) );
+			msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+			msgs_[i].msg_hdr.msg_iovlen = 1;
+			msgs_[i].msg_hdr.msg_name = &fromAddrs_[i];
+			msgs_[i].msg_hdr.msg_namelen = sizeof(fromAddrs_[i]);
+		}
+
+		int count = recvmmsg( fd, &msgs_[0], RECEIVE_BATCH_SIZE, MSG_DONTWAIT, 0 );
+		if( count <= 0 )
+			return;
+		PacketReceiveTime() = PacketClockNow();
+
+		IpEndpointName remoteEndpoint;
+		for( int i = 0; i < count; ++i ){
+			if( msgs_[i].msg_len == 0 )
+				continue;
+
+			IpEndpointNameFromSockaddr( remoteEndpoint, fromAddrs_[i] );
+
+			listener->ProcessPacket( &slab_[ i * MAX_BUFFER_SIZE ], (int)msgs_[i].msg_len, remoteEndpoint );
+			if( break_ )
+				break;
+		}
+	}
+#else
+	void RunSelect( TimerQueue& timerQueue )
+	{
+		// configure the master fd_set for select()
+
+		fd_set masterfds, tempfds;
+		FD_ZERO( &masterfds );
+		FD_ZERO( &tempfds );
+
+		// in addition to listening to the inbound sockets we
+		// also listen to the asynchronous break pipe, so that AsynchronousBreak()
+		// can break us out of select() from another thread.
+		FD_SET( breakPipe_[0], &masterfds );
+		int fdmax = breakPipe_[0];
+
+		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+				i != socketListeners_.end(); ++i ){
+
+			if( fdmax < i->second->impl_->Socket() )
+				fdmax = i->second->impl_->Socket();
+			FD_SET( i->second->impl_->Socket(), &masterfds );
+		}
+
+		char *data = &slab_[0];
+		IpEndpointName remoteEndpoint;
+
+		struct timeval timeout;
+
+		while( !break_ ){
+			tempfds = masterfds;
+
+			struct timeval *timeoutPtr = 0;
+			double timeoutMs = NextTimeoutMs( timerQueue );
+			if( timeoutMs >= 0 ){
+				long timoutSecondsPart = (long)(timeoutMs * .001);
+				timeout.tv_sec = (time_t)timoutSecondsPart;
+				// 1000000 microseconds in a second
+				timeout.tv_usec = (suseconds_t)((timeoutMs - (timoutSecondsPart * 1000)) * 1000);
+				timeoutPtr = &timeout;
+			}
+
+			if( select( fdmax + 1, &tempfds, 0, 0, timeoutPtr ) < 0 ){
+				if( break_ ){
+					break;
+				}else if( errno == EINTR ){
+					// on returning an error, select() doesn't clear tempfds.
+					// so tempfds would remain all set, which would cause read( breakPipe_[0]...
+					// below to block indefinitely. therefore if select returns EINTR we restart
+					// the while() loop instead of continuing on to below.
+					continue;
+				}else{
+					throw std::runtime_error("select failed\n");
+				}
+			}
+
+			if( FD_ISSET( breakPipe_[0], &tempfds ) ){
+				// clear pending data from the asynchronous break pipe
+				char c;
+				read( breakPipe_[0], &c, 1 );
+			}
+
+			if( break_ )
+				break;
+
+			for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+					i != socketListeners_.end(); ++i ){
+
+				if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
+
+					std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
+					if( size > 0 ){
+						PacketReceiveTime() = PacketClockNow();
+						i->first->ProcessPacket( data, (int)size, remoteEndpoint );
+						if( break_ )
+							break;
+					}
+				}
+			}
+
+			RunExpiredTimers( timerQueue );
+		}
+	}
+#endif
+
+public:
     void Break()
 	{
 		break_ = true;
@@ -37,6 +37,7 @@
 #include "../NetworkingUtils.h"
 
 #include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <ws2tcpip.h>   // for getaddrinfo
 #include <windows.h>
 
 #include <cstring>
@@ -57,7 +58,7 @@ NetworkInitializer::NetworkInitializer()
 
         // initialize winsock
 	    WSAData wsaData;
-	    int nCode = WSAStartup(MAKEWORD(1, 1), &wsaData);
+	    int nCode = WSAStartup(MAKEWORD(2, 2), &wsaData);
 	    if( nCode != 0 ){
 	        //std::cout << "WSAStartup() failed with error code " << nCode << "\n";
         }else{
@@ -93,3 +94,22 @@ unsigned long GetHostByName( const char *name )
 
     return result;
 }
+
+
+bool GetHostByName6( const char *name, unsigned char address6[16] )
+{
+    NetworkInitializer networkInitializer;
+
+    struct addrinfo hints;
+    std::memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *info = 0;
+    if( getaddrinfo( name, 0, &hints, &info ) != 0 || info == 0 )
+        return false;
+
+    std::memcpy( address6, &((struct sockaddr_in6*)info->ai_addr)->sin6_addr, 16 );
+    freeaddrinfo( info );
+    return true;
+}
@@ -0,0 +1,247 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+#include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <windows.h>
+
+#include <cstring> // for memset
+#include <stdexcept>
+#include <vector>
+
+#include "../TcpSocket.h" // usually I'd include the module header first
+                          // but this is causing conflicts with BCB4 due to
+                          // std::size_t usage.
+
+#include "../NetworkingUtils.h"
+#include "../PacketListener.h"
+#include "../SocketAddress.h"
+
+
+typedef int socklen_t;
+
+
+class TcpListeningReceiveSocket::Implementation{
+    NetworkInitializer networkInitializer_;
+
+	struct Connection{
+		SOCKET socket;
+		HANDLE event;
+		IpEndpointName remoteEndpoint;
+		StreamFramer *framer;
+	};
+
+	PacketListener *listener_;
+	StreamFraming framing_;
+	int maxConnections_;
+
+	SOCKET listenSocket_;
+	HANDLE listenEvent_;
+	std::vector< Connection > connections_;
+
+	volatile bool break_;
+	HANDLE breakEvent_;
+
+	void CloseConnection( std::size_t index )
+	{
+		WSAEventSelect( connections_[index].socket, connections_[index].event, 0 );
+		CloseHandle( connections_[index].event );
+		closesocket( connections_[index].socket );
+		delete connections_[index].framer;
+		connections_.erase( connections_.begin() + index );
+	}
+
+	void AcceptConnection()
+	{
+		struct sockaddr_storage fromAddr;
+		socklen_t fromAddrLen = sizeof(fromAddr);
+		SOCKET s = accept( listenSocket_, (struct sockaddr *)&fromAddr, &fromAddrLen );
+		if( s == INVALID_SOCKET )
+			return;
+
+		if( (int)connections_.size() >= maxConnections_ ){
+			closesocket( s );
+			return;
+		}
+
+		Connection c;
+		c.socket = s;
+		c.event = CreateEvent( NULL, FALSE, FALSE, NULL );
+		WSAEventSelect( s, c.event, FD_READ | FD_CLOSE ); // makes the socket non-blocking
+		IpEndpointNameFromSockaddr( c.remoteEndpoint, fromAddr );
+		c.framer = new StreamFramer( framing_ );
+		connections_.push_back( c );
+	}
+
+	// returns false when the connection must be closed
+	bool ReceiveFrom( Connection& c )
+	{
+		std::size_t available;
+		char *data = c.framer->WritePointer( available );
+		if( available == 0 )
+			return false; // can't happen unless Dispatch() failed to make progress
+
+		int result = recv( c.socket, data, (int)available, 0 );
+		if( result == SOCKET_ERROR )
+			return WSAGetLastError() == WSAEWOULDBLOCK;
+		if( result == 0 )
+			return false;
+
+		c.framer->CommitWrite( (std::size_t)result );
+		PacketReceiveTime() = PacketClockNow();
+		return c.framer->Dispatch( listener_, c.remoteEndpoint );
+	}
+
+public:
+	Implementation( const IpEndpointName& localEndpoint, PacketListener *listener,
+			StreamFraming framing, int maxConnections )
+		: listener_( listener )
+		, framing_( framing )
+		, maxConnections_( maxConnections )
+		, listenSocket_( INVALID_SOCKET )
+		, break_( false )
+	{
+		int family = AF_INET;
+#ifndef OSCPACK_NO_IPV6
+		// dual-stack listener, accepts IPv4 and IPv6 clients
+		if( (listenSocket_ = socket( AF_INET6, SOCK_STREAM, 0 )) != INVALID_SOCKET ){
+			DWORD v6Only = 0;
+			if( setsockopt( listenSocket_, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6Only, sizeof(v6Only) ) == 0 ){
+				family = AF_INET6;
+			}else{
+				closesocket( listenSocket_ );
+				listenSocket_ = INVALID_SOCKET;
+			}
+		}
+#endif
+		if( listenSocket_ == INVALID_SOCKET && (listenSocket_ = socket( AF_INET, SOCK_STREAM, 0 )) == INVALID_SOCKET ){
+			throw std::runtime_error("unable to create tcp socket\n");
+		}
+
+		struct sockaddr_storage bindSockAddr;
+		socklen_t bindLength = SockaddrFromIpEndpointName( bindSockAddr, localEndpoint, family );
+
+		if( bindLength == 0
+				|| bind( listenSocket_, (struct sockaddr *)&bindSockAddr, bindLength ) == SOCKET_ERROR
+				|| listen( listenSocket_, maxConnections_ ) == SOCKET_ERROR ){
+			closesocket( listenSocket_ );
+			throw std::runtime_error("unable to bind tcp socket\n");
+		}
+
+		listenEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+		WSAEventSelect( listenSocket_, listenEvent_, FD_ACCEPT );
+		breakEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+	}
+
+	~Implementation()
+	{
+		while( !connections_.empty() )
+			CloseConnection( connections_.size() - 1 );
+		WSAEventSelect( listenSocket_, listenEvent_, 0 );
+		CloseHandle( listenEvent_ );
+		closesocket( listenSocket_ );
+		CloseHandle( breakEvent_ );
+	}
+
+	void Run()
+	{
+		break_ = false;
+
+		std::vector< HANDLE > events;
+
+		while( !break_ ){
+			// [0] break event, [1] listening socket, then one per connection
+			events.resize( 2 + connections_.size() );
+			events[0] = breakEvent_;
+			events[1] = listenEvent_;
+			for( std::size_t i = 0; i < connections_.size(); ++i )
+				events[2 + i] = connections_[i].event;
+
+			DWORD waitResult = WaitForMultipleObjects( (DWORD)events.size(), &events[0], FALSE, INFINITE );
+			if( break_ )
+				break;
+			if( waitResult == WAIT_FAILED )
+				throw std::runtime_error("WaitForMultipleObjects failed\n");
+
+			int signalled = (int)(waitResult - WAIT_OBJECT_0);
+			if( signalled == 1 ){
+				AcceptConnection();
+			}else if( signalled >= 2 ){
+				std::size_t i = (std::size_t)(signalled - 2);
+				if( !ReceiveFrom( connections_[i] ) )
+					CloseConnection( i );
+			}
+		}
+	}
+
+	void Break()
+	{
+		break_ = true;
+	}
+
+	void AsynchronousBreak()
+	{
+		break_ = true;
+		SetEvent( breakEvent_ );
+	}
+};
+
+
+TcpListeningReceiveSocket::TcpListeningReceiveSocket( const IpEndpointName& localEndpoint,
+		PacketListener *listener, StreamFraming framing, int maxConnections )
+{
+	impl_ = new Implementation( localEndpoint, listener, framing, maxConnections );
+}
+
+TcpListeningReceiveSocket::~TcpListeningReceiveSocket()
+{
+	delete impl_;
+}
+
+void TcpListeningReceiveSocket::Run()
+{
+	impl_->Run();
+}
+
+void TcpListeningReceiveSocket::Break()
+{
+	impl_->Break();
+}
+
+void TcpListeningReceiveSocket::AsynchronousBreak()
+{
+	impl_->AsynchronousBreak();
+}
@@ -36,6 +36,7 @@
 */
 
 #include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <ws2tcpip.h>   // for ip_mreq
 #include <windows.h>
 #include <mmsystem.h>   // for timeGetTime()
 
@@ -55,42 +56,13 @@
 
 #include "../NetworkingUtils.h"
 #include "../PacketListener.h"
+#include "../SocketAddress.h"
 #include "../TimerListener.h"
 
 
 typedef int socklen_t;
 
 
-static void SockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEndpointName& endpoint )
-{
-    std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
-    sockAddr.sin_family = AF_INET;
-
-	sockAddr.sin_addr.s_addr = 
-		(endpoint.address == IpEndpointName::ANY_ADDRESS)
-		? INADDR_ANY
-		: htonl( endpoint.address );
-
-	sockAddr.sin_port =
-		(endpoint.port == IpEndpointName::ANY_PORT)
-		? (short)0
-		: htons( (short)endpoint.port );
-}
-
-
-static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sockAddr )
-{
-	return IpEndpointName( 
-		(sockAddr.sin_addr.s_addr == INADDR_ANY) 
-			? IpEndpointName::ANY_ADDRESS 
-			: ntohl( sockAddr.sin_addr.s_addr ),
-		(sockAddr.sin_port == 0)
-			? IpEndpointName::ANY_PORT
-			: ntohs( sockAddr.sin_port )
-		);
-}
-
-
 class UdpSocket::Implementation{
     NetworkInitializer networkInitializer_;
 
@@ -98,22 +70,48 @@ class UdpSocket::Implementation{
 	bool isConnected_;
 
 	SOCKET socket_;
-	struct sockaddr_in connectedAddr_;
-	struct sockaddr_in sendToAddr_;
+	// AF_INET6 (dual-stack) or AF_INET
+	int family_;
+	struct sockaddr_storage connectedAddr_;
+	socklen_t connectedAddrLength_;
+	// SendTo() only converts the destination when it changes
+	IpEndpointName sendToEndpoint_;
+	struct sockaddr_storage sendToAddr_;
+	socklen_t sendToAddrLength_;
+
+	socklen_t ToSockaddr( struct sockaddr_storage& sockAddr, const IpEndpointName& endpoint, const char *what ) const
+	{
+		socklen_t length = SockaddrFromIpEndpointName( sockAddr, endpoint, family_ );
+		if( length == 0 )
+			throw std::runtime_error( what );
+		return length;
+	}
 
 public:
 
-	Implementation()
+	Implementation( UdpSocket::Family family )
 		: isBound_( false )
 		, isConnected_( false )
 		, socket_( INVALID_SOCKET )
+		, family_( AF_INET )
+		, connectedAddrLength_( 0 )
+		, sendToAddrLength_( 0 )
 	{
-		if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == INVALID_SOCKET ){
+#ifndef OSCPACK_NO_IPV6
+		// one dual-stack socket serves IPv4 and IPv6 peers (Vista and later)
+		if( family == UdpSocket::DUAL_STACK && (socket_ = socket( AF_INET6, SOCK_DGRAM, 0 )) != INVALID_SOCKET ){
+			DWORD v6Only = 0;
+			if( setsockopt( socket_, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6Only, sizeof(v6Only) ) == 0 ){
+				family_ = AF_INET6;
+			}else{
+				closesocket( socket_ );
+				socket_ = INVALID_SOCKET;
+			}
+		}
+#endif
+		if( socket_ == INVALID_SOCKET && (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == INVALID_SOCKET ){
             throw std::runtime_error("unable to create udp socket\n");
         }
-
-		std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
-        sendToAddr_.sin_family = AF_INET;
 	}
 
 	~Implementation()
@@ -137,22 +135,78 @@ public:
 		setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
 	}
 
+	void SetReusePort( bool reusePort )
+	{
+		(void) reusePort; // SO_REUSEADDR already shares the port on Win32
+	}
+
+	// IPv4 options are accepted on dual-stack sockets by Linux and Win32
+	bool SetMulticastMembership( int option, unsigned long groupAddress, unsigned long interfaceAddress )
+	{
+		struct ip_mreq membership;
+		std::memset( &membership, 0, sizeof(membership) );
+		membership.imr_multiaddr.s_addr = htonl( groupAddress );
+		membership.imr_interface.s_addr =
+			(interfaceAddress == IpEndpointName::ANY_ADDRESS)
+			? INADDR_ANY
+			: htonl( interfaceAddress );
+		return setsockopt(socket_, IPPROTO_IP, option, (const char*)&membership, sizeof(membership)) == 0;
+	}
+
+	void JoinMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+	{
+		if( !SetMulticastMembership( IP_ADD_MEMBERSHIP, groupAddress, interfaceAddress ) )
+			throw std::runtime_error("unable to join multicast group\n");
+	}
+
+	void LeaveMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+	{
+		SetMulticastMembership( IP_DROP_MEMBERSHIP, groupAddress, interfaceAddress );
+	}
+
+	bool SetMulticastMembership6( int option, const IpEndpointName& group, unsigned int interfaceIndex )
+	{
+		if( family_ != AF_INET6 )
+			return false;
+		struct ipv6_mreq membership;
+		std::memset( &membership, 0, sizeof(membership) );
+		std::memcpy( &membership.ipv6mr_multiaddr, group.address6, 16 );
+		membership.ipv6mr_interface = interfaceIndex;
+		return setsockopt(socket_, IPPROTO_IPV6, option, (const char*)&membership, sizeof(membership)) == 0;
+	}
+
+	void JoinMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+	{
+		if( !group.IsIpv6() )
+			JoinMulticastGroup( group.address, IpEndpointName::ANY_ADDRESS );
+		else if( !SetMulticastMembership6( IPV6_ADD_MEMBERSHIP, group, interfaceIndex ) )
+			throw std::runtime_error("unable to join multicast group\n");
+	}
+
+	void LeaveMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+	{
+		if( !group.IsIpv6() )
+			LeaveMulticastGroup( group.address, IpEndpointName::ANY_ADDRESS );
+		else
+			SetMulticastMembership6( IPV6_DROP_MEMBERSHIP, group, interfaceIndex );
+	}
+
 	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 	{
 		assert( isBound_ );
 
 		// first connect the socket to the remote server
         
-        struct sockaddr_in connectSockAddr;
-		SockaddrFromIpEndpointName( connectSockAddr, remoteEndpoint );
+        struct sockaddr_storage connectSockAddr;
+		socklen_t connectLength = ToSockaddr( connectSockAddr, remoteEndpoint, "unable to connect udp socket\n" );
        
-        if (connect(socket_, (struct sockaddr *)&connectSockAddr, sizeof(connectSockAddr)) < 0) {
+        if (connect(socket_, (struct sockaddr *)&connectSockAddr, connectLength) < 0) {
             throw std::runtime_error("unable to connect udp socket\n");
         }
 
         // get the address
 
-        struct sockaddr_in sockAddr;
+        struct sockaddr_storage sockAddr;
         std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
         socklen_t length = sizeof(sockAddr);
         if (getsockname(socket_, (struct sockaddr *)&sockAddr, &length) < 0) {
@@ -162,30 +216,32 @@ public:
 		if( isConnected_ ){
 			// reconnect to the connected address
 			
-			if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+			if (connect(socket_, (struct sockaddr *)&connectedAddr_, connectedAddrLength_) < 0) {
 				throw std::runtime_error("unable to connect udp socket\n");
 			}
 
 		}else{
 			// unconnect from the remote address
 		
-			struct sockaddr_in unconnectSockAddr;
-			SockaddrFromIpEndpointName( unconnectSockAddr, IpEndpointName() );
+			struct sockaddr_storage unconnectSockAddr;
+			socklen_t unconnectLength = SockaddrFromIpEndpointName( unconnectSockAddr, IpEndpointName(), family_ );
 
-			if( connect(socket_, (struct sockaddr *)&unconnectSockAddr, sizeof(unconnectSockAddr)) < 0 
+			if( connect(socket_, (struct sockaddr *)&unconnectSockAddr, unconnectLength) < 0 
 					&& WSAGetLastError() != WSAEADDRNOTAVAIL ){
 				throw std::runtime_error("unable to un-connect udp socket\n");
 			}
 		}
 
-		return IpEndpointNameFromSockaddr( sockAddr );
+		IpEndpointName result;
+		IpEndpointNameFromSockaddr( result, sockAddr );
+		return result;
 	}
 
 	void Connect( const IpEndpointName& remoteEndpoint )
 	{
-		SockaddrFromIpEndpointName( connectedAddr_, remoteEndpoint );
+		connectedAddrLength_ = ToSockaddr( connectedAddr_, remoteEndpoint, "unable to connect udp socket\n" );
        
-        if (connect(socket_, (struct sockaddr *)&connectedAddr_, sizeof(connectedAddr_)) < 0) {
+        if (connect(socket_, (struct sockaddr *)&connectedAddr_, connectedAddrLength_) < 0) {
             throw std::runtime_error("unable to connect udp socket\n");
         }
 
@@ -201,18 +257,22 @@ public:
 
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
 	{
-		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
-        sendToAddr_.sin_port = htons( (short)remoteEndpoint.port );
+		if( sendToAddrLength_ == 0 || remoteEndpoint != sendToEndpoint_ ){
+			sendToAddrLength_ = SockaddrFromIpEndpointName( sendToAddr_, remoteEndpoint, family_ );
+			sendToEndpoint_ = remoteEndpoint;
+			if( sendToAddrLength_ == 0 )
+				return; // IPv6 destination, IPv4 only socket
+		}
 
-        sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+        sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr_, sendToAddrLength_ );
 	}
 
 	void Bind( const IpEndpointName& localEndpoint )
 	{
-		struct sockaddr_in bindSockAddr;
-		SockaddrFromIpEndpointName( bindSockAddr, localEndpoint );
+		struct sockaddr_storage bindSockAddr;
+		socklen_t bindLength = ToSockaddr( bindSockAddr, localEndpoint, "unable to bind udp socket\n" );
 
-        if (bind(socket_, (struct sockaddr *)&bindSockAddr, sizeof(bindSockAddr)) < 0) {
+        if (bind(socket_, (struct sockaddr *)&bindSockAddr, bindLength) < 0) {
             throw std::runtime_error("unable to bind udp socket\n");
         }
 
@@ -225,7 +285,7 @@ public:
 	{
 		assert( isBound_ );
 
-		struct sockaddr_in fromAddr;
+		struct sockaddr_storage fromAddr;
         socklen_t fromAddrLen = sizeof(fromAddr);
              	 
         int result = recvfrom(socket_, data, (int)size, 0,
@@ -233,8 +293,7 @@ public:
 		if( result < 0 )
 			return 0;
 
-		remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
-		remoteEndpoint.port = ntohs(fromAddr.sin_port);
+		IpEndpointNameFromSockaddr( remoteEndpoint, fromAddr );
 
 		return result;
 	}
@@ -242,9 +301,9 @@ public:
 	SOCKET& Socket() { return socket_; }
 };
 
-UdpSocket::UdpSocket()
+UdpSocket::UdpSocket( Family family )
 {
-	impl_ = new Implementation();
+	impl_ = new Implementation( family );
 }
 
 UdpSocket::~UdpSocket()
@@ -262,6 +321,31 @@ void UdpSocket::SetAllowReuse( bool allowReuse )
     impl_->SetAllowReuse( allowReuse );
 }
 
+void UdpSocket::SetReusePort( bool reusePort )
+{
+    impl_->SetReusePort( reusePort );
+}
+
+void UdpSocket::JoinMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+{
+    impl_->JoinMulticastGroup( groupAddress, interfaceAddress );
+}
+
+void UdpSocket::LeaveMulticastGroup( unsigned long groupAddress, unsigned long interfaceAddress )
+{
+    impl_->LeaveMulticastGroup( groupAddress, interfaceAddress );
+}
+
+void UdpSocket::JoinMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+{
+    impl_->JoinMulticastEndpoint( group, interfaceIndex );
+}
+
+void UdpSocket::LeaveMulticastEndpoint( const IpEndpointName& group, unsigned int interfaceIndex )
+{
+    impl_->LeaveMulticastEndpoint( group, interfaceIndex );
+}
+
 IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 {
 	return impl_->LocalEndpointFor( remoteEndpoint );
@@ -453,6 +537,7 @@ public:
 				for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size(); ++i ){
 					std::size_t size = socketListeners_[i].second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
 					if( size > 0 ){
+						PacketReceiveTime() = PacketClockNow();
 						socketListeners_[i].first->ProcessPacket( data, (int)size, remoteEndpoint );
 						if( break_ )
 							break;
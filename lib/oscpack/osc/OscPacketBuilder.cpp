@@ -0,0 +1,260 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#include "OscPacketBuilder.h"
+
+#include "OscHostEndianness.h"
+
+
+namespace osc{
+
+static const uint32 NO_BUFFER = 0xFFFFFFFFu;
+
+
+static inline std::size_t RoundUp4( std::size_t x )
+{
+    return (x + 3) & ~((std::size_t)0x03);
+}
+
+
+static void FromUInt32( char *p, uint32 x )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    union{
+        osc::uint32 i;
+        char c[4];
+    } u;
+
+    u.i = x;
+
+    p[3] = u.c[0];
+    p[2] = u.c[1];
+    p[1] = u.c[2];
+    p[0] = u.c[3];
+#else
+    std::memcpy( p, &x, 4 );
+#endif
+}
+
+
+static void FromUInt64( char *p, uint64 x )
+{
+    FromUInt32( p, (uint32)(x >> 32) );
+    FromUInt32( p + 4, (uint32)x );
+}
+
+//------------------------------------------------------------------------------
+
+PacketPool::PacketPool( std::size_t bufferCount, std::size_t bufferSize )
+    : bufferCount_( bufferCount )
+    , bufferSize_( RoundUp4( bufferSize ) )
+    , storage_( new char[ bufferCount * RoundUp4( bufferSize ) ] )
+    , next_( new std::atomic<uint32>[ bufferCount ] )
+    , head_( bufferCount > 0 ? 0 : NO_BUFFER )
+{
+    for( std::size_t i = 0; i < bufferCount; ++i )
+        next_[i].store( (i + 1 < bufferCount) ? (uint32)(i + 1) : NO_BUFFER, std::memory_order_relaxed );
+}
+
+
+PacketPool::~PacketPool()
+{
+    delete [] next_;
+    delete [] storage_;
+}
+
+
+char *PacketPool::Acquire()
+{
+    uint64 head = head_.load( std::memory_order_acquire );
+    for(;;){
+        uint32 index = (uint32)head;
+        if( index == NO_BUFFER )
+            return 0;
+
+        uint64 fresh = ((((head >> 32) + 1) & 0xFFFFFFFFu) << 32)
+                | next_[index].load( std::memory_order_relaxed );
+        if( head_.compare_exchange_weak( head, fresh,
+                std::memory_order_acq_rel, std::memory_order_acquire ) )
+            return storage_ + index * bufferSize_;
+    }
+}
+
+
+void PacketPool::Release( char *buffer )
+{
+    if( !buffer )
+        return;
+
+    uint32 index = (uint32)((buffer - storage_) / bufferSize_);
+    uint64 head = head_.load( std::memory_order_relaxed );
+    uint64 fresh;
+    do{
+        next_[index].store( (uint32)head, std::memory_order_relaxed );
+        fresh = ((((head >> 32) + 1) & 0xFFFFFFFFu) << 32) | index;
+    }while( !head_.compare_exchange_weak( head, fresh,
+            std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+//------------------------------------------------------------------------------
+
+bool MessageHeader::Set( const char *addressPattern, const char *typeTags )
+{
+    Clear();
+
+    std::size_t argumentBytes = 0;
+    for( const char *t = typeTags; *t; ++t ){
+        switch( *t ){
+            case TRUE_TYPE_TAG:
+            case FALSE_TYPE_TAG:
+            case NIL_TYPE_TAG:
+            case INFINITUM_TYPE_TAG:
+                break;
+
+            case INT32_TYPE_TAG:
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+                argumentBytes += 4;
+                break;
+
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+                argumentBytes += 8;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    std::size_t addressSize = RoundUp4( std::strlen( addressPattern ) + 1 );
+    std::size_t typeTagsSize = RoundUp4( std::strlen( typeTags ) + 2 ); // ',' and NUL
+    bytes_.assign( addressSize + typeTagsSize, '\0' );
+    std::memcpy( &bytes_[0], addressPattern, std::strlen( addressPattern ) );
+    bytes_[ addressSize ] = ',';
+    std::memcpy( &bytes_[ addressSize + 1 ], typeTags, std::strlen( typeTags ) );
+    argumentBytes_ = argumentBytes;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+BundleBuilder::BundleBuilder( PacketPool& pool, PacketSink& sink, uint64 timeTag )
+    : pool_( pool )
+    , sink_( sink )
+    , timeTag_( timeTag )
+    , buffer_( 0 )
+    , size_( 0 )
+    , packetsSent_( 0 )
+{
+}
+
+
+char *BundleBuilder::AddMessage( const MessageHeader& header )
+{
+    std::size_t elementSize = 4 + header.MessageSize();
+    if( header.IsEmpty() || 16 + elementSize > pool_.BufferSize() )
+        return 0;
+
+    if( AddWouldSplit( header ) )
+        Flush();
+
+    if( !buffer_ ){
+        buffer_ = pool_.Acquire();
+        if( !buffer_ )
+            return 0;
+        std::memcpy( buffer_, "#bundle", 8 );
+        FromUInt64( buffer_ + 8, timeTag_ );
+        size_ = 16;
+    }
+
+    char *p = buffer_ + size_;
+    FromUInt32( p, (uint32)header.MessageSize() );
+    std::memcpy( p + 4, header.Data(), header.Size() );
+    size_ += elementSize;
+    return p + 4 + header.Size();
+}
+
+
+void BundleBuilder::Flush()
+{
+    if( !buffer_ )
+        return;
+
+    if( !sink_.SendPacket( buffer_, size_ ) )
+        pool_.Release( buffer_ );
+    buffer_ = 0;
+    size_ = 0;
+    ++packetsSent_;
+}
+
+//------------------------------------------------------------------------------
+
+char *WriteInt32( char *p, int32 value )
+{
+    FromUInt32( p, (uint32)value );
+    return p + 4;
+}
+
+
+char *WriteFloat( char *p, float value )
+{
+    uint32 bits;
+    std::memcpy( &bits, &value, 4 );
+    FromUInt32( p, bits );
+    return p + 4;
+}
+
+
+char *WriteInt64( char *p, int64 value )
+{
+    FromUInt64( p, (uint64)value );
+    return p + 8;
+}
+
+
+char *WriteDouble( char *p, double value )
+{
+    uint64 bits;
+    std::memcpy( &bits, &value, 8 );
+    FromUInt64( p, bits );
+    return p + 8;
+}
+
+} // namespace osc
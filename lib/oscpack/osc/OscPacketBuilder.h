@@ -0,0 +1,161 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCPACKETBUILDER_H
+#define INCLUDED_OSCPACK_OSCPACKETBUILDER_H
+
+#include <atomic>
+#include <cstring> // size_t
+#include <vector>
+
+#include "OscTypes.h"
+
+
+namespace osc{
+
+// Largest UDP payload that fits a 1500 byte Ethernet MTU without fragmenting.
+#ifndef OSC_MTU_PAYLOAD_SIZE
+#define OSC_MTU_PAYLOAD_SIZE 1472
+#endif
+
+
+// Fixed set of equally sized packet buffers, all allocated up front.
+// Acquire() and Release() are lock-free and may be called from any thread,
+// so a buffer filled on one thread can be sent and returned by another.
+class PacketPool{
+public:
+    PacketPool( std::size_t bufferCount, std::size_t bufferSize=OSC_MTU_PAYLOAD_SIZE );
+    ~PacketPool();
+
+    // Returns 0 when every buffer is in use.
+    char *Acquire();
+    void Release( char *buffer );
+
+    std::size_t BufferSize() const { return bufferSize_; }
+    std::size_t BufferCount() const { return bufferCount_; }
+
+private:
+    PacketPool( const PacketPool& ); // no copying
+    PacketPool& operator=( const PacketPool& );
+
+    std::size_t bufferCount_;
+    std::size_t bufferSize_;
+    char *storage_;
+    std::atomic<uint32> *next_;
+    // Free list head: index of the first free buffer in the low word and
+    // a change counter in the high word, which defeats ABA on pop.
+    std::atomic<uint64> head_;
+};
+
+
+// Address pattern and type tags of a message encoded once, so repeated
+// sends only write the argument bytes. Only fixed size arguments are
+// supported: i f c r m h t d T F N I.
+class MessageHeader{
+public:
+    MessageHeader() : argumentBytes_( 0 ) {}
+
+    // Returns false (and leaves the header empty) for unsupported type tags.
+    bool Set( const char *addressPattern, const char *typeTags );
+    void Clear() { bytes_.clear(); argumentBytes_ = 0; }
+
+    bool IsEmpty() const { return bytes_.empty(); }
+    const char *Data() const { return bytes_.empty() ? 0 : &bytes_[0]; }
+    std::size_t Size() const { return bytes_.size(); }
+    std::size_t ArgumentBytes() const { return argumentBytes_; }
+    // Encoded message size without the bundle element size prefix.
+    std::size_t MessageSize() const { return bytes_.size() + argumentBytes_; }
+
+private:
+    std::vector<char> bytes_;
+    std::size_t argumentBytes_;
+};
+
+
+// Receives finished packets from a BundleBuilder.
+class PacketSink{
+public:
+    virtual ~PacketSink() {}
+
+    // Return true to keep @buffer; it must then be handed back with
+    // PacketPool::Release() once sent. Return false and the builder
+    // releases it as soon as this returns.
+    virtual bool SendPacket( char *buffer, std::size_t size ) = 0;
+};
+
+
+// Packs messages into bundles inside pool buffers. When a message would
+// overflow the current buffer the bundle is closed, passed to the sink and
+// a new one is started in a fresh buffer. Never allocates and never throws.
+class BundleBuilder{
+public:
+    BundleBuilder( PacketPool& pool, PacketSink& sink, uint64 timeTag=1 ); // 1 == immediately
+    ~BundleBuilder() { Flush(); }
+
+    // Copies the header and returns where its ArgumentBytes() argument
+    // bytes go, to be filled with the Write*() helpers below. Returns 0 if
+    // the pool is exhausted or the message could never fit in a buffer.
+    char *AddMessage( const MessageHeader& header );
+
+    // True if adding @header would close and send the current bundle first.
+    bool AddWouldSplit( const MessageHeader& header ) const
+        { return buffer_ != 0 && size_ + 4 + header.MessageSize() > pool_.BufferSize(); }
+
+    // Send the open bundle, if any.
+    void Flush();
+
+    uint32 PacketsSent() const { return packetsSent_; }
+
+private:
+    PacketPool& pool_;
+    PacketSink& sink_;
+    uint64 timeTag_;
+    char *buffer_;
+    std::size_t size_;
+    uint32 packetsSent_;
+};
+
+
+// Big endian argument writers, each returns the position after the value.
+char *WriteInt32( char *p, int32 value );
+char *WriteFloat( char *p, float value );
+char *WriteInt64( char *p, int64 value );
+char *WriteDouble( char *p, double value );
+
+} // namespace osc
+
+
+#endif /* INCLUDED_OSCPACK_OSCPACKETBUILDER_H */
@@ -74,6 +74,64 @@ public:
     }
 };
 
+
+// Deepest bundle nesting OscPacketViewListener will descend into.
+#ifndef OSC_MAX_BUNDLE_DEPTH
+#define OSC_MAX_BUNDLE_DEPTH 8
+#endif
+
+// Exception-free listener. Packets are parsed with ParseMessage() and
+// ParseBundle() and handed over as views into the receive buffer. Malformed
+// elements are reported through ProcessMalformed() and the rest of the
+// packet is still delivered.
+class OscPacketViewListener : public PacketListener{
+protected:
+    virtual void ProcessMessage( const osc::MessageView& m,
+				const IpEndpointName& remoteEndpoint ) = 0;
+
+    virtual void ProcessMalformed( osc::ParseStatus status,
+				const IpEndpointName& remoteEndpoint )
+    {
+        (void) status; // suppress unused parameter warnings
+        (void) remoteEndpoint;
+    }
+
+    void ProcessElement( const char *data, osc_bundle_element_size_t size,
+				const IpEndpointName& remoteEndpoint, int depth )
+    {
+        if( size > 0 && data[0] == '#' ){
+            BundleView b;
+            ParseStatus status = ( depth < OSC_MAX_BUNDLE_DEPTH )
+                    ? ParseBundle( data, size, b ) : PARSE_BUNDLE_TOO_DEEP;
+            if( status != PARSE_OK ){
+                ProcessMalformed( status, remoteEndpoint );
+                return;
+            }
+
+            // ignore bundle time tag for now
+
+            const char *p = b.elements;
+            Span element;
+            while( NextBundleElement( p, b.end, element ) )
+                ProcessElement( element.data, (osc_bundle_element_size_t)element.size, remoteEndpoint, depth + 1 );
+        }else{
+            MessageView m;
+            ParseStatus status = ParseMessage( data, size, m );
+            if( status != PARSE_OK )
+                ProcessMalformed( status, remoteEndpoint );
+            else
+                ProcessMessage( m, remoteEndpoint );
+        }
+    }
+
+public:
+	virtual void ProcessPacket( const char *data, int size,
+			const IpEndpointName& remoteEndpoint ) override
+    {
+        ProcessElement( data, (osc_bundle_element_size_t)size, remoteEndpoint, 0 );
+    }
+};
+
 } // namespace osc
 
 #endif /* INCLUDED_OSCPACK_OSCPACKETLISTENER_H */
@@ -35,51 +35,31 @@
 	above license is reproduced.
 */
 #include "OscReceivedElements.h"
+#include "OscStr4.h"
 
 #include "OscHostEndianness.h"
 
 #include <cstddef> // ptrdiff_t
 
-namespace osc{
-
-
-// return the first 4 byte boundary after the end of a str4
-// be careful about calling this version if you don't know whether
-// the string is terminated correctly.
-static inline const char* FindStr4End( const char *p )
-{
-	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
-		return p + 4;
-
-    p += 3;
-
-    while( *p )
-        p += 4;
+// Entries in the per thread type tag layout cache. Must be a power of two.
+#ifndef OSC_LAYOUT_CACHE_SIZE
+#define OSC_LAYOUT_CACHE_SIZE 64
+#endif
+// Longest type tag string the layout cache keeps.
+#define OSC_LAYOUT_CACHE_MAX_TAGS 28
 
-    return p + 1;
-}
+namespace osc{
 
 
-// return the first 4 byte boundary after the end of a str4
-// returns 0 if p == end or if the string is unterminated
-static inline const char* FindStr4End( const char *p, const char *end )
+static inline unsigned int PopCount( uint32 x )
 {
-    if( p >= end )
-        return 0;
-
-	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
-		return p + 4;
-
-    p += 3;
-    end -= 1;
-
-    while( p < end && *p )
-        p += 4;
-
-    if( *p )
-        return 0;
-    else
-        return p + 1;
+#if defined(_MSC_VER)
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (unsigned int)((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#else
+    return (unsigned int)__builtin_popcount( x );
+#endif
 }
 
 
@@ -179,6 +159,459 @@ static inline uint64 ToUInt64( const char *p )
 
 //------------------------------------------------------------------------------
 
+static const char *parseStatusStrings_[ NUM_PARSE_STATUSES ] = {
+    "ok",
+    "invalid element size",
+    "zero length elements not permitted",
+    "element size must be multiple of four",
+    "unterminated address pattern",
+    "type tags not present",
+    "type tags were not terminated before end of message",
+    "unknown type tag",
+    "arguments exceed message size",
+    "unterminated string argument",
+    "invalid blob size",
+    "array end without matching array begin",
+    "array was not terminated before end of message (expected ']' end of array tag)",
+    "packet too short for bundle",
+    "bad bundle address pattern",
+    "bundle element size must be multiple of four",
+    "packet too short for bundle element",
+    "bundles nested too deeply",
+    "missing argument",
+    "wrong argument type"
+};
+
+
+const char *ParseStatusString( ParseStatus status )
+{
+    if( status < 0 || status >= NUM_PARSE_STATUSES )
+        return "unknown parse status";
+    return parseStatusStrings_[ status ];
+}
+
+
+// Walk every type tag and check that its argument fits before end.
+static ParseStatus ValidateArguments( const char *typeTag, const char *argument, const char *end )
+{
+    unsigned int arrayLevel = 0;
+
+    do{
+        switch( *typeTag ){
+            case TRUE_TYPE_TAG:
+            case FALSE_TYPE_TAG:
+            case NIL_TYPE_TAG:
+            case INFINITUM_TYPE_TAG:
+                // zero length
+                break;
+
+            //    [ Indicates the beginning of an array. The tags following are for
+            //        data in the Array until a close brace tag is reached.
+            //    ] Indicates the end of an array.
+            case ARRAY_BEGIN_TYPE_TAG:
+                ++arrayLevel;
+                // (zero length argument data)
+                break;
+
+            case ARRAY_END_TYPE_TAG:
+                if( arrayLevel == 0 )
+                    return PARSE_UNMATCHED_ARRAY_END;
+                --arrayLevel;
+                // (zero length argument data)
+                break;
+
+            case INT32_TYPE_TAG:
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+
+                if( end - argument < 4 )
+                    return PARSE_ARGUMENTS_EXCEED_SIZE;
+                argument += 4;
+                break;
+
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+
+                if( end - argument < 8 )
+                    return PARSE_ARGUMENTS_EXCEED_SIZE;
+                argument += 8;
+                break;
+
+            case STRING_TYPE_TAG:
+            case SYMBOL_TYPE_TAG:
+
+                if( argument == end )
+                    return PARSE_ARGUMENTS_EXCEED_SIZE;
+                argument = FindStr4End( argument, end );
+                if( argument == 0 )
+                    return PARSE_UNTERMINATED_STRING;
+                break;
+
+            case BLOB_TYPE_TAG:
+                {
+                    if( end - argument < osc::OSC_SIZEOF_INT32 )
+                        return PARSE_ARGUMENTS_EXCEED_SIZE;
+
+                    // treat blob size as an unsigned int for the purposes of this calculation
+                    uint32 blobSize = ToUInt32( argument );
+                    if( !IsValidElementSizeValue( (osc_bundle_element_size_t)blobSize ) )
+                        return PARSE_INVALID_BLOB_SIZE;
+                    argument += osc::OSC_SIZEOF_INT32;
+                    if( (std::ptrdiff_t)RoundUp4( blobSize ) > end - argument )
+                        return PARSE_ARGUMENTS_EXCEED_SIZE;
+                    argument += RoundUp4( blobSize );
+                }
+                break;
+
+            default:
+                return PARSE_UNKNOWN_TYPE_TAG;
+        }
+
+    }while( *++typeTag != '\0' );
+
+    if( arrayLevel != 0 )
+        return PARSE_UNTERMINATED_ARRAY;
+
+    return PARSE_OK;
+}
+
+
+// Argument bytes of a type tag string made only of fixed size tags.
+// Returns false as soon as a string, blob, array or unknown tag shows up;
+// ValidateArguments() handles those.
+static bool FixedArgumentBytes( const char *tags, std::size_t length, uint32& bytes )
+{
+    uint32 count4 = 0;
+    uint32 count8 = 0;
+    std::size_t i = 0;
+
+#if defined(OSC_USE_SSE2)
+    for( ; length - i >= 16; i += 16 ){
+        __m128i v = _mm_loadu_si128( (const __m128i*)(tags + i) );
+        __m128i four = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( INT32_TYPE_TAG ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( FLOAT_TYPE_TAG ) ) ),
+                _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( CHAR_TYPE_TAG ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( RGBA_COLOR_TYPE_TAG ) ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( MIDI_MESSAGE_TYPE_TAG ) ) ) );
+        __m128i eight = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( INT64_TYPE_TAG ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( TIME_TAG_TYPE_TAG ) ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( DOUBLE_TYPE_TAG ) ) );
+        __m128i none = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( TRUE_TYPE_TAG ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( FALSE_TYPE_TAG ) ) ),
+                _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( NIL_TYPE_TAG ) ),
+                _mm_cmpeq_epi8( v, _mm_set1_epi8( INFINITUM_TYPE_TAG ) ) ) );
+        uint32 mask4 = (uint32)_mm_movemask_epi8( four );
+        uint32 mask8 = (uint32)_mm_movemask_epi8( eight );
+        if( (mask4 | mask8 | (uint32)_mm_movemask_epi8( none )) != 0xFFFFu )
+            return false;
+        count4 += PopCount( mask4 );
+        count8 += PopCount( mask8 );
+    }
+#endif
+
+    for( ; i < length; ++i ){
+        switch( tags[i] ){
+            case TRUE_TYPE_TAG:
+            case FALSE_TYPE_TAG:
+            case NIL_TYPE_TAG:
+            case INFINITUM_TYPE_TAG:
+                break;
+
+            case INT32_TYPE_TAG:
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+                ++count4;
+                break;
+
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+                ++count8;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    // length < 2^31 so this can't wrap for any message that fits in memory.
+    bytes = count4 * 4 + count8 * 8;
+    return true;
+}
+
+
+struct LayoutCacheEntry{
+    uint32 tagsLength;
+    uint32 argumentBytes;
+    char tags[ OSC_LAYOUT_CACHE_MAX_TAGS ];
+};
+
+// Per thread, so concurrent receive threads never share entries.
+static thread_local LayoutCacheEntry layoutCache_[ OSC_LAYOUT_CACHE_SIZE ];
+
+
+// Pick the cache entry from the address length and its last, NUL padded, word.
+static inline uint32 LayoutCacheSlot( const Span& addressPattern, const char *typeTagsBegin )
+{
+    uint32 h = ToUInt32( typeTagsBegin - 5 ) ^ ((uint32)addressPattern.size * 0x9E3779B1u);
+    return (h ^ (h >> 16)) & (OSC_LAYOUT_CACHE_SIZE - 1);
+}
+
+
+ParseStatus ParseMessage( const char *message, osc_bundle_element_size_t size, MessageView& view )
+{
+    if( !IsValidElementSizeValue(size) )
+        return PARSE_INVALID_SIZE;
+
+    if( size == 0 )
+        return PARSE_ZERO_LENGTH;
+
+    if( !IsMultipleOf4(size) )
+        return PARSE_SIZE_NOT_MULTIPLE_OF_4;
+
+    const char *end = message + size;
+
+    const char *typeTagsBegin = FindStr4End( message, end );
+    if( typeTagsBegin == 0 ){
+        // address pattern was not terminated before end
+        return PARSE_UNTERMINATED_ADDRESS;
+    }
+
+    // FindStr4End() guarantees a NUL before typeTagsBegin.
+    view.addressPattern = Span( message,
+            static_cast<const char*>(std::memchr( message, '\0', typeTagsBegin - message )) - message );
+    view.typeTags = Span();
+    view.arguments = 0;
+    view.end = end;
+
+    if( typeTagsBegin == end ){
+        // message consists of only the address pattern - no arguments or type tags.
+        return PARSE_OK;
+    }
+
+    if( *typeTagsBegin != ',' )
+        return PARSE_MISSING_TYPE_TAGS;
+
+    if( *(typeTagsBegin + 1) == '\0' ){
+        // zero length type tags
+        return PARSE_OK;
+    }
+
+    // check that all arguments are present and well formed
+
+    const char *arguments = FindStr4End( typeTagsBegin, end );
+    if( arguments == 0 )
+        return PARSE_UNTERMINATED_TYPE_TAGS;
+
+    ++typeTagsBegin; // advance past initial ','
+
+    std::size_t tagsLength = static_cast<const char*>(std::memchr( typeTagsBegin, '\0', arguments - typeTagsBegin )) - typeTagsBegin;
+
+    // Identical layouts from the same address reuse the cached argument size.
+    // The entry is only picked by the address; the tags themselves are compared.
+    LayoutCacheEntry& cached = layoutCache_[ LayoutCacheSlot( view.addressPattern, typeTagsBegin ) ];
+    uint32 argumentBytes;
+    if( cached.tagsLength == tagsLength
+            && std::memcmp( cached.tags, typeTagsBegin, tagsLength ) == 0 ){
+        argumentBytes = cached.argumentBytes;
+        if( argumentBytes > (uint32)(end - arguments) )
+            return PARSE_ARGUMENTS_EXCEED_SIZE;
+    }else if( FixedArgumentBytes( typeTagsBegin, tagsLength, argumentBytes ) ){
+        if( argumentBytes > (uint32)(end - arguments) )
+            return PARSE_ARGUMENTS_EXCEED_SIZE;
+        if( tagsLength <= OSC_LAYOUT_CACHE_MAX_TAGS ){
+            cached.tagsLength = (uint32)tagsLength;
+            cached.argumentBytes = argumentBytes;
+            std::memcpy( cached.tags, typeTagsBegin, tagsLength );
+        }
+    }else{
+        ParseStatus status = ValidateArguments( typeTagsBegin, arguments, end );
+        if( status != PARSE_OK )
+            return status;
+    }
+
+    view.typeTags = Span( typeTagsBegin, tagsLength );
+    view.arguments = arguments;
+
+    // These invariants should be guaranteed by the above code.
+    // we depend on them in the implementation of ArgumentCount()
+#ifndef NDEBUG
+    assert( tagsLength <= (std::size_t)OSC_INT32_MAX );
+#endif
+    return PARSE_OK;
+}
+
+
+ParseStatus ParseBundle( const char *bundle, osc_bundle_element_size_t size, BundleView& view )
+{
+    if( !IsValidElementSizeValue(size) )
+        return PARSE_INVALID_SIZE;
+
+    if( size < 16 )
+        return PARSE_BUNDLE_TOO_SHORT;
+
+    if( !IsMultipleOf4(size) )
+        return PARSE_SIZE_NOT_MULTIPLE_OF_4;
+
+    if( std::memcmp( bundle, "#bundle", 8 ) != 0 )
+        return PARSE_BAD_BUNDLE_ADDRESS;
+
+    const char *end = bundle + size;
+    const char *p = bundle + 16;
+    uint32 elementCount = 0;
+
+    while( p < end ){
+        if( end - p < osc::OSC_SIZEOF_INT32 )
+            return PARSE_BUNDLE_TOO_SHORT;
+
+        // treat element size as an unsigned int for the purposes of this calculation
+        uint32 elementSize = ToUInt32( p );
+        if( (elementSize & ((uint32)0x03)) != 0 )
+            return PARSE_BAD_ELEMENT_SIZE;
+
+        p += osc::OSC_SIZEOF_INT32;
+        if( (std::ptrdiff_t)elementSize > end - p )
+            return PARSE_ELEMENT_EXCEEDS_BUNDLE;
+        p += elementSize;
+
+        ++elementCount;
+    }
+
+    view.timeTag = ToUInt64( bundle + 8 );
+    view.elements = bundle + 16;
+    view.end = end;
+    view.elementCount = elementCount;
+    return PARSE_OK;
+}
+
+
+bool ArgumentCursor::Next( ArgumentView& argument )
+{
+    if( typeTag_ == typeTagsEnd_ )
+        return false;
+
+    argument.typeTag = *typeTag_++;
+    argument.data = argument_;
+
+    // ParseMessage() has already checked that every argument fits.
+    switch( argument.typeTag ){
+        case INT32_TYPE_TAG:
+        case FLOAT_TYPE_TAG:
+        case CHAR_TYPE_TAG:
+        case RGBA_COLOR_TYPE_TAG:
+        case MIDI_MESSAGE_TYPE_TAG:
+            argument_ += 4;
+            break;
+
+        case INT64_TYPE_TAG:
+        case TIME_TAG_TYPE_TAG:
+        case DOUBLE_TYPE_TAG:
+            argument_ += 8;
+            break;
+
+        case STRING_TYPE_TAG:
+        case SYMBOL_TYPE_TAG:
+            argument_ = FindStr4End( argument_ );
+            break;
+
+        case BLOB_TYPE_TAG:
+            argument_ += osc::OSC_SIZEOF_INT32 + RoundUp4( ToUInt32( argument_ ) );
+            break;
+
+        default:
+            // zero length
+            break;
+    }
+    return true;
+}
+
+
+ParseStatus ArgumentView::AsFloat( float& value ) const
+{
+    switch( typeTag ){
+        case FLOAT_TYPE_TAG:
+            {
+                union{
+                    uint32 i;
+                    float f;
+                } u;
+                u.i = ToUInt32( data );
+                value = u.f;
+            }
+            return PARSE_OK;
+        case TRUE_TYPE_TAG:
+            value = 1.0f;
+            return PARSE_OK;
+        case FALSE_TYPE_TAG:
+            value = 0.0f;
+            return PARSE_OK;
+        case INT32_TYPE_TAG:
+            value = static_cast<float>(ToInt32( data ));
+            return PARSE_OK;
+        default:
+            return PARSE_WRONG_ARGUMENT_TYPE;
+    }
+}
+
+
+ParseStatus ArgumentView::AsInt32( int32& value ) const
+{
+    if( typeTag == INT32_TYPE_TAG ){
+        value = ToInt32( data );
+        return PARSE_OK;
+    }else if( typeTag == FLOAT_TYPE_TAG ){ // Do conversion for touchOSC's limited values
+        float f;
+        AsFloat( f );
+        value = static_cast<int32>(f);
+        return PARSE_OK;
+    }
+    return PARSE_WRONG_ARGUMENT_TYPE;
+}
+
+
+ParseStatus ArgumentView::AsDouble( double& value ) const
+{
+    switch( typeTag ){
+        case DOUBLE_TYPE_TAG:
+            {
+                union{
+                    uint64 i;
+                    double d;
+                } u;
+                u.i = ToUInt64( data );
+                value = u.d;
+            }
+            return PARSE_OK;
+        case INT64_TYPE_TAG:
+            value = static_cast<double>(ToInt64( data ));
+            return PARSE_OK;
+        default:
+            {
+                float f;
+                ParseStatus status = AsFloat( f );
+                if( status == PARSE_OK )
+                    value = (typeTag == INT32_TYPE_TAG) ? static_cast<double>(ToInt32( data )) : f;
+                return status;
+            }
+    }
+}
+
+
+ParseStatus ArgumentView::AsString( Span& value ) const
+{
+    if( typeTag != STRING_TYPE_TAG && typeTag != SYMBOL_TYPE_TAG )
+        return PARSE_WRONG_ARGUMENT_TYPE;
+    value = Span( data, std::strlen( data ) );
+    return PARSE_OK;
+}
+
+//------------------------------------------------------------------------------
+
 bool ReceivedPacket::IsBundle() const
 {
     return (Size() > 0 && Contents()[0] == '#');
@@ -594,140 +1027,20 @@ uint32 ReceivedMessage::AddressPatternAsUInt32() const
 
 void ReceivedMessage::Init( const char *message, osc_bundle_element_size_t size )
 {
-    if( !IsValidElementSizeValue(size) )
-        throw MalformedMessageException( "invalid message size" );
-
-    if( size == 0 )
-        throw MalformedMessageException( "zero length messages not permitted" );
-
-    if( !IsMultipleOf4(size) )
-        throw MalformedMessageException( "message size must be multiple of four" );
-
-    const char *end = message + size;
-
-    typeTagsBegin_ = FindStr4End( addressPattern_, end );
-    if( typeTagsBegin_ == 0 ){
-        // address pattern was not terminated before end
-        throw MalformedMessageException( "unterminated address pattern" );
-    }
+    MessageView view;
+    ParseStatus status = ParseMessage( message, size, view );
+    if( status != PARSE_OK )
+        throw MalformedMessageException( ParseStatusString( status ) );
 
-    if( typeTagsBegin_ == end ){
-        // message consists of only the address pattern - no arguments or type tags.
+    if( view.typeTags.size == 0 ){
+        // no arguments or type tags.
         typeTagsBegin_ = 0;
         typeTagsEnd_ = 0;
         arguments_ = 0;
-            
     }else{
-        if( *typeTagsBegin_ != ',' )
-            throw MalformedMessageException( "type tags not present" );
-
-        if( *(typeTagsBegin_ + 1) == '\0' ){
-            // zero length type tags
-            typeTagsBegin_ = 0;
-            typeTagsEnd_ = 0;
-            arguments_ = 0;
-
-        }else{
-            // check that all arguments are present and well formed
-                
-            arguments_ = FindStr4End( typeTagsBegin_, end );
-            if( arguments_ == 0 ){
-                throw MalformedMessageException( "type tags were not terminated before end of message" );
-            }
-
-            ++typeTagsBegin_; // advance past initial ','
-            
-            const char *typeTag = typeTagsBegin_;
-            const char *argument = arguments_;
-            unsigned int arrayLevel = 0;
-                        
-            do{
-                switch( *typeTag ){
-                    case TRUE_TYPE_TAG:
-                    case FALSE_TYPE_TAG:
-                    case NIL_TYPE_TAG:
-                    case INFINITUM_TYPE_TAG:
-                        // zero length
-                        break;
-
-                    //    [ Indicates the beginning of an array. The tags following are for
-                    //        data in the Array until a close brace tag is reached.
-                    //    ] Indicates the end of an array.
-                    case ARRAY_BEGIN_TYPE_TAG:
-                        ++arrayLevel;
-                        // (zero length argument data)
-                        break;
-
-                    case ARRAY_END_TYPE_TAG:
-                        --arrayLevel;
-                        // (zero length argument data)
-                        break;
-
-                    case INT32_TYPE_TAG:
-                    case FLOAT_TYPE_TAG:
-                    case CHAR_TYPE_TAG:
-                    case RGBA_COLOR_TYPE_TAG:
-                    case MIDI_MESSAGE_TYPE_TAG:
-
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        argument += 4;
-                        if( argument > end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        break;
-
-                    case INT64_TYPE_TAG:
-                    case TIME_TAG_TYPE_TAG:
-                    case DOUBLE_TYPE_TAG:
-
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        argument += 8;
-                        if( argument > end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        break;
-
-                    case STRING_TYPE_TAG: 
-                    case SYMBOL_TYPE_TAG:
-                    
-                        if( argument == end )
-                            throw MalformedMessageException( "arguments exceed message size" );
-                        argument = FindStr4End( argument, end );
-                        if( argument == 0 )
-                            throw MalformedMessageException( "unterminated string argument" );
-                        break;
-
-                    case BLOB_TYPE_TAG:
-                        {
-                            if( argument + osc::OSC_SIZEOF_INT32 > end )
-                                MalformedMessageException( "arguments exceed message size" );
-                                
-                            // treat blob size as an unsigned int for the purposes of this calculation
-                            uint32 blobSize = ToUInt32( argument );
-                            argument = argument + osc::OSC_SIZEOF_INT32 + RoundUp4( blobSize );
-                            if( argument > end )
-                                MalformedMessageException( "arguments exceed message size" );
-                        }
-                        break;
-                        
-                    default:
-                        throw MalformedMessageException( "unknown type tag" );
-                }
-
-            }while( *++typeTag != '\0' );
-            typeTagsEnd_ = typeTag;
-
-            if( arrayLevel !=  0 )
-                throw MalformedMessageException( "array was not terminated before end of message (expected ']' end of array tag)" );
-        }
-
-        // These invariants should be guaranteed by the above code.
-        // we depend on them in the implementation of ArgumentCount()
-#ifndef NDEBUG
-        std::ptrdiff_t argumentCount = typeTagsEnd_ - typeTagsBegin_;
-        assert( argumentCount >= 0 );
-        assert( argumentCount <= OSC_INT32_MAX );
-#endif
+        typeTagsBegin_ = view.typeTags.data;
+        typeTagsEnd_ = view.typeTags.data + view.typeTags.size;
+        arguments_ = view.arguments;
     }
 }
 
@@ -749,50 +1062,14 @@ ReceivedBundle::ReceivedBundle( const ReceivedBundleElement& bundleElement )
 
 void ReceivedBundle::Init( const char *bundle, osc_bundle_element_size_t size )
 {
-
-    if( !IsValidElementSizeValue(size) )
-        throw MalformedBundleException( "invalid bundle size" );
-
-    if( size < 16 )
-        throw MalformedBundleException( "packet too short for bundle" );
-
-    if( !IsMultipleOf4(size) )
-        throw MalformedBundleException( "bundle size must be multiple of four" );
-
-    if( bundle[0] != '#'
-        || bundle[1] != 'b'
-        || bundle[2] != 'u'
-        || bundle[3] != 'n'
-        || bundle[4] != 'd'
-        || bundle[5] != 'l'
-        || bundle[6] != 'e'
-        || bundle[7] != '\0' )
-            throw MalformedBundleException( "bad bundle address pattern" );    
-
-    end_ = bundle + size;
+    BundleView view;
+    ParseStatus status = ParseBundle( bundle, size, view );
+    if( status != PARSE_OK )
+        throw MalformedBundleException( ParseStatusString( status ) );
 
     timeTag_ = bundle + 8;
-
-    const char *p = timeTag_ + 8;
-        
-    while( p < end_ ){
-        if( p + osc::OSC_SIZEOF_INT32 > end_ )
-            throw MalformedBundleException( "packet too short for elementSize" );
-
-        // treat element size as an unsigned int for the purposes of this calculation
-        uint32 elementSize = ToUInt32( p );
-        if( (elementSize & ((uint32)0x03)) != 0 )
-            throw MalformedBundleException( "bundle element size must be multiple of four" );
-
-        p += osc::OSC_SIZEOF_INT32 + elementSize;
-        if( p > end_ )
-            throw MalformedBundleException( "packet too short for bundle element" );
-
-        ++elementCount_;
-    }
-
-    if( p != end_ )
-        throw MalformedBundleException( "bundle contents " );
+    end_ = view.end;
+    elementCount_ = view.elementCount;
 }
 
 
@@ -85,6 +85,128 @@ public:
 };
 
 
+//------------------------------------------------------------------------------
+// Non-throwing parser.
+//
+// ParseMessage() and ParseBundle() validate an element without throwing and
+// return views pointing into the caller's buffer. Nothing is copied, so the
+// views are only valid as long as that buffer is. The throwing classes below
+// are thin wrappers over these functions.
+
+enum ParseStatus{
+    PARSE_OK = 0,
+    PARSE_INVALID_SIZE,
+    PARSE_ZERO_LENGTH,
+    PARSE_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_UNTERMINATED_ADDRESS,
+    PARSE_MISSING_TYPE_TAGS,
+    PARSE_UNTERMINATED_TYPE_TAGS,
+    PARSE_UNKNOWN_TYPE_TAG,
+    PARSE_ARGUMENTS_EXCEED_SIZE,
+    PARSE_UNTERMINATED_STRING,
+    PARSE_INVALID_BLOB_SIZE,
+    PARSE_UNMATCHED_ARRAY_END,
+    PARSE_UNTERMINATED_ARRAY,
+    PARSE_BUNDLE_TOO_SHORT,
+    PARSE_BAD_BUNDLE_ADDRESS,
+    PARSE_BAD_ELEMENT_SIZE,
+    PARSE_ELEMENT_EXCEEDS_BUNDLE,
+    PARSE_BUNDLE_TOO_DEEP,
+    PARSE_MISSING_ARGUMENT,
+    PARSE_WRONG_ARGUMENT_TYPE,
+    NUM_PARSE_STATUSES
+};
+
+const char *ParseStatusString( ParseStatus status );
+
+
+// A run of bytes inside the receive buffer, not NUL terminated by contract.
+struct Span{
+    const char *data;
+    std::size_t size;
+
+    Span() : data( 0 ), size( 0 ) {}
+    Span( const char *data_, std::size_t size_ ) : data( data_ ), size( size_ ) {}
+
+    bool Equals( const char *s, std::size_t n ) const
+        { return size == n && (n == 0 || std::memcmp( data, s, n ) == 0); }
+};
+
+
+struct MessageView{
+    // Address pattern without its terminating NUL. Empty for SuperCollider
+    // integer address patterns.
+    Span addressPattern;
+    // Type tags without the leading ','. Empty when there are no arguments.
+    Span typeTags;
+    const char *arguments;
+    const char *end;
+
+    uint32 ArgumentCount() const { return static_cast<uint32>(typeTags.size); }
+};
+
+ParseStatus ParseMessage( const char *message, osc_bundle_element_size_t size, MessageView& view );
+
+
+struct ArgumentView{
+    char typeTag;
+    const char *data;
+
+    // Same conversions as the matching ReceivedMessageArgument methods.
+    ParseStatus AsFloat( float& value ) const;
+    ParseStatus AsInt32( int32& value ) const;
+    // Any numeric or boolean argument, without losing the precision of
+    // doubles and 64 bit integers.
+    ParseStatus AsDouble( double& value ) const;
+    ParseStatus AsString( Span& value ) const;
+};
+
+
+// Walks the arguments of a message returned by ParseMessage().
+class ArgumentCursor{
+public:
+    explicit ArgumentCursor( const MessageView& message )
+        : typeTag_( message.typeTags.data )
+        , typeTagsEnd_( message.typeTags.data + message.typeTags.size )
+        , argument_( message.arguments ) {}
+
+    // Returns false once every argument has been visited.
+    bool Next( ArgumentView& argument );
+
+private:
+    const char *typeTag_;
+    const char *typeTagsEnd_;
+    const char *argument_;
+};
+
+
+struct BundleView{
+    uint64 timeTag;
+    // First element size field.
+    const char *elements;
+    const char *end;
+    uint32 elementCount;
+};
+
+ParseStatus ParseBundle( const char *bundle, osc_bundle_element_size_t size, BundleView& view );
+
+// Yields the next element of a bundle returned by ParseBundle() and advances
+// @p. Returns false at the end of the bundle.
+inline bool NextBundleElement( const char*& p, const char *end, Span& element )
+{
+    if( p >= end )
+        return false;
+
+    uint32 elementSize = (static_cast<uint32>(static_cast<unsigned char>(p[0])) << 24)
+            | (static_cast<uint32>(static_cast<unsigned char>(p[1])) << 16)
+            | (static_cast<uint32>(static_cast<unsigned char>(p[2])) << 8)
+            | static_cast<uint32>(static_cast<unsigned char>(p[3]));
+    element = Span( p + osc::OSC_SIZEOF_INT32, elementSize );
+    p += osc::OSC_SIZEOF_INT32 + elementSize;
+    return true;
+}
+
+
 class ReceivedPacket{
 public:
     // Although the OSC spec is not entirely clear on this, we only support
@@ -0,0 +1,167 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCSTR4_H
+#define INCLUDED_OSCPACK_OSCSTR4_H
+
+// Scanning for the end of OSC strings (str4: NUL terminated, padded with
+// NULs to a multiple of 4 bytes). Internal to oscpack, shared by the parser
+// and its tests and benchmarks.
+
+#include "OscTypes.h"
+
+#if defined(__AVX2__) && !defined(OSC_NO_SIMD)
+#define OSC_USE_AVX2
+#endif
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(OSC_NO_SIMD)
+#define OSC_USE_SSE2
+#endif
+
+#if defined(OSC_USE_AVX2)
+#include <immintrin.h>
+#elif defined(OSC_USE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace osc{
+
+
+static inline unsigned int CountTrailingZeros( uint32 x )
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward( &index, x );
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz( x );
+#endif
+}
+
+
+// return the first 4 byte boundary after the end of a str4
+// be careful about calling this version if you don't know whether
+// the string is terminated correctly.
+static inline const char* FindStr4End( const char *p )
+{
+	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
+		return p + 4;
+
+    p += 3;
+
+    while( *p )
+        p += 4;
+
+    return p + 1;
+}
+
+
+// first 4 byte boundary after the first word whose last byte is NUL,
+// 0 if there is none before end. end - p must be a multiple of 4.
+static inline const char* FindStr4EndWords( const char *p, const char *end )
+{
+    if( p >= end )
+        return 0;
+
+    p += 3;
+    end -= 1;
+
+    while( p < end && *p )
+        p += 4;
+
+    if( *p )
+        return 0;
+    else
+        return p + 1;
+}
+
+
+// FindStr4End() one word at a time, the reference the SIMD version is
+// tested against.
+static inline const char* FindStr4EndScalar( const char *p, const char *end )
+{
+    if( p >= end )
+        return 0;
+
+	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
+		return p + 4;
+
+    return FindStr4EndWords( p, end );
+}
+
+
+// return the first 4 byte boundary after the end of a str4
+// returns 0 if p == end or if the string is unterminated
+// only the last byte of each 4 byte word is tested, so with SIMD available
+// 16 (or 32) bytes are scanned at once by masking those lanes.
+static inline const char* FindStr4End( const char *p, const char *end )
+{
+    if( p >= end )
+        return 0;
+
+	if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
+		return p + 4;
+
+#if defined(OSC_USE_AVX2)
+    const __m256i zero32 = _mm256_setzero_si256();
+    while( end - p >= 32 ){
+        uint32 mask = (uint32)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)p ), zero32 ) ) & 0x88888888u;
+        if( mask )
+            return p + CountTrailingZeros( mask ) + 1;
+        p += 32;
+    }
+#endif
+#if defined(OSC_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    while( end - p >= 16 ){
+        uint32 mask = (uint32)_mm_movemask_epi8(
+                _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)p ), zero ) ) & 0x8888u;
+        if( mask )
+            return p + CountTrailingZeros( mask ) + 1;
+        p += 16;
+    }
+#endif
+
+    return FindStr4EndWords( p, end );
+}
+
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCSTR4_H */
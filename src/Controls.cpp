@@ -1,5 +1,11 @@
 #include "Controls.hpp"
 
+void LED::count(){
+	if (!stats) return;
+	PushStats::add(stats->engine.midiOut, 1);
+	PushStats::add(stats->engine.ledOut, 1);
+}
+
 void LED::lightOn(int color){
 	midi::Message msg;
 	msg.setNote(note);
@@ -7,15 +13,17 @@ void LED::lightOn(int color){
 	msg.setChannel(1);
 	msg.setStatus(on_status);
 	out->sendMessage(msg);
+	count();
 }
 
-void LED::lightOff(){
+void LED::lightOff(bool counted){
 	midi::Message msg;
 	msg.setNote(note);
 	msg.setValue(0);
 	msg.setChannel(1);
 	msg.setStatus(off_status);
 	out->sendMessage(msg);
+	if (counted) count();
 }	
 
 PushKey::PushKey(midi::Output * out_, int note_) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "plugin.hpp"
+#include "PushStats.hpp"
 
 class LED {
 
@@ -10,9 +11,15 @@ public:
 	int on_status;
 	int off_status;
 	midi::Output * out;
+	// Counts the messages sent, if set.
+	PushStats * stats = NULL;
 
 	void lightOn(int color);
-	void lightOff();
+	// @counted false leaves @stats alone, for threads other than the engine one.
+	void lightOff(bool counted = true);
+
+private:
+	void count();
 };
 
 class PushKey : public LED {
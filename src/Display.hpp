@@ -1,14 +1,17 @@
 #include "PushMap.hpp"
+#include "PushTransport.hpp"
+#include "PushDisplayLink.hpp"
+#include "PushFrameScheduler.hpp"
+#include "PushMonitor.hpp"
+#include "PushStats.hpp"
+#include "Trace.hpp"
 
 struct Push2Display : FramebufferWidget {
 
-	unsigned char frame_header[16] = {
-          0xFF, 0xCC, 0xAA, 0x88,
-          0x00, 0x00, 0x00, 0x00,
-          0x00, 0x00, 0x00, 0x00,
-          0x00, 0x00, 0x00, 0x00 };
-
-	libusb_device_handle *device_handle;
+	// Opens the device in the background. libusb by default, a FakePushTransport to run without the hardware.
+	PushDisplayLink link;
+	// Rendered frames, sent by the scheduler shared with the other displays
+	PushFrameQueue frames;
 
 public:
 
@@ -25,46 +28,87 @@ public:
   	int * ccs;
   	int skip = 0;
 
-  	int open() {
-
-	    int result = libusb_init(NULL);
+  	// Counters of the module, NULL without one. The HUD replaces the param page while shown.
+  	PushStats * stats = nullptr;
+  	PushStatsRates rates;
+  	// Input monitor of the module, NULL without one. It draws the frames itself while it has the display.
+  	PushMonitor * monitor = nullptr;
+
+	// Starts the link thread and joins the frame scheduler. Not done in the constructor, the module browser
+	// creates displays too.
+	void start() {
+		frames.stats = stats;
+		link.start();
+		PushFrameScheduler::instance().add(&frames);
+	}
 
-	    if (result != 0)
-	    {
-	      	return NULL;
-	    }
+	// Leaves the scheduler and closes the device. Called by the module before it goes, with the counters.
+	void stop() {
+		PushFrameScheduler::instance().remove(&frames);
+		link.stop();
+	}
 
-		device_handle = libusb_open_device_with_vid_pid(NULL, ABLETON_VENDOR_ID, PUSH2_PRODUCT_ID);
+	// Lock-free, the link opens or closes the device in the background.
+	void setEnabled(bool enabled) {
+		link.setWanted(enabled);
+	}
 
-		if (device_handle == NULL)
-		{
-        	//DEBUG("%s", "Could not initilialize usblib");
-	      	return NULL;
-	    }
+	PushTransport * transport() {
+		return link.getTransport();
+	}
 
-		if ((result = libusb_claim_interface(device_handle, 0)) < 0)
-		{
-			libusb_close(device_handle);
-			device_handle = NULL;
-		}
-		else
-		{
-        	DEBUG("%s", "Display Connected");
-  			display_connected = true;
-		}
+	// Takes ownership of @transport_, which is opened in the background if the display is enabled.
+	void setTransport(PushTransport * transport_) {
+		// The scheduler may be sending on the old one
+		bool scheduled = PushFrameScheduler::instance().remove(&frames);
+		link.setTransport(transport_);
+		if (scheduled)
+			PushFrameScheduler::instance().add(&frames);
+	}
 
-    }
+	void drawHudColumn(NVGcontext * vg, float x, const char * title, const std::string * lines, int count) {
+		nvgFontSize(vg, 17.f);
+		nvgTextAlign(vg, NVG_ALIGN_LEFT|NVG_ALIGN_MIDDLE);
+		nvgFillColor(vg, nvgRGBA(255,255,255,200));
+		nvgText(vg, x, 16, title, NULL);
+		nvgFontSize(vg, 15.f);
+		nvgFillColor(vg, nvgRGBA(255,255,255,120));
+		for (int i = 0; i < count; i++)
+			nvgText(vg, x, 42 + 22 * i, lines[i].c_str(), NULL);
+	}
 
-    void close() {
-    	display_connected = false;
-	    if (device_handle) {
-	        libusb_release_interface(device_handle, 0);
-	        libusb_close(device_handle);
-			device_handle = NULL;
-	    }
+	// Performance page: engine, display and USB columns, rates over the last second.
+	void drawHud(NVGcontext * vg) {
+		rates.update(*stats);
+
+		std::string engine[5] = {
+			string::f("process  %.2f us, peak %.1f us", rates.processMeanNs / 1e3, rates.processPeakNs / 1e3),
+			string::f("load  %.1f %%", rates.processLoad * 100.0),
+			string::f("MIDI in  %.0f /s", rates.midiIn),
+			string::f("MIDI out  %.0f /s", rates.midiOut),
+			string::f("LEDs  %.0f /s", rates.ledOut),
+		};
+		std::string frames[3] = {
+			string::f("rendered  %.1f /s", rates.framesRendered),
+			string::f("sent  %.1f /s", rates.framesSent),
+			string::f("dropped  %.1f /s", rates.framesDropped),
+		};
+		std::string usb[4] = {
+			string::f("frame  %.2f ms, peak %.2f ms", rates.sendMeanNs / 1e6, rates.sendPeakNs / 1e6),
+			string::f("transfer  %.0f us", rates.transferMeanNs / 1e3),
+			string::f("errors  %llu", (unsigned long long) rates.usbErrors),
+			string::f("last  %s", rates.lastUsbError ? libusb_error_name(rates.lastUsbError) : "-"),
+		};
+		drawHudColumn(vg, 21, "ENGINE", engine, 5);
+		drawHudColumn(vg, 341, "DISPLAY", frames, 3);
+		drawHudColumn(vg, 661, "USB", usb, 4);
 	}
 
 	void draw(NVGcontext * vg) {
+		if (stats && stats->hudVisible) {
+			drawHud(vg);
+			return;
+		}
 		if (len == nullptr) return;
 		int l = *len - 1;
 		for (int i = 0; i < l; i ++) {
@@ -113,15 +157,15 @@ public:
 	}
 
 	void setLabelsAndValues(int * len, ParamHandle ** paramHandles, float * values, int * ccs) {
+		TRACE_SCOPE("setLabelsAndValues");
 		this->len = len;
 		this->paramHandles = paramHandles;
 		this->values = values;
 		this->ccs = ccs;
 	}
 
-	Push2Display() {
+	Push2Display() : link(new LibusbPushTransport()), frames(&link) {
 		display_connected = false;
-		device_handle = NULL;
 		len = nullptr;
 		image = (unsigned char*) malloc(PUSH2_DISPLAY_IMAGE_BUFFER_SIZE);
 		//image = (t_uint8*) sysmem_newptrclear(PUSH2_DISPLAY_IMAGE_BUFFER_SIZE);//(unsigned char*)malloc(960*160*4);
@@ -129,33 +173,7 @@ public:
 
 	~Push2Display() {
 		//printf("Delete push\n");
-		if (display_connected) close();
-	}
-
-	void sendDisplay(unsigned char* imageDisplay) {
-		int actual_length;
-
-		if (device_handle == nullptr) {
-			if (display_connected){
-				//printf("no device\n");
-				display_connected = false;
-			} 
-		}else{ //print one frame
-
-			if (!display_connected){
-				//printf("Push connected\n");
-				display_connected = true;
-			}
-
-			int result = libusb_bulk_transfer(device_handle, PUSH2_BULK_EP_OUT, frame_header, sizeof(frame_header), &actual_length, PUSH2_TRANSFER_TIMEOUT);
-
-			if (result != 0)
-				return;
-
-			for (int i = 0; i < 160; i++)
-				libusb_bulk_transfer(device_handle, PUSH2_BULK_EP_OUT, &imageDisplay[(159 - i)*1920], 2048, &actual_length, PUSH2_TRANSFER_TIMEOUT);
-
-		}
+		stop();
 	}
 
 	void drawFramebuffer() override {
@@ -170,37 +188,49 @@ public:
 			return;
 	    skip = 0;
 		//if (module->divider.process()) {
+		display_connected = link.isOpen();
+		if (monitor && monitor->isDrawing())
+			return;
 
 	    if (display_connected) {
 
 	    	nvgSave(vg);
-			glViewport(0, 0, 960, 160);
-		    glClearColor(0, 0, 0, 0);
-		    glClear(GL_COLOR_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+		    {
+		    	TRACE_SCOPE("Push render");
+				glViewport(0, 0, 960, 160);
+			    glClearColor(0, 0, 0, 0);
+			    glClear(GL_COLOR_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
 
-	    	nvgBeginFrame(vg, 960,  160, 1);
+		    	nvgBeginFrame(vg, 960,  160, 1);
 
-		    draw(vg);
+			    draw(vg);
 
-		    nvgEndFrame(vg);
+			    nvgEndFrame(vg);
+		    }
+		    if (stats)
+		    	PushStats::add(stats->display.framesRendered, 1);
 
-		    glReadPixels(0, 0, 960, 160, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, image); 
+		    {
+		    	TRACE_SCOPE("readback");
+			    glReadPixels(0, 0, 960, 160, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, image); 
+		    }
 
-		    for (int i = 0; i < 80*960; i ++){
-		      image[i * 4] ^= 0xE7;
-		      image[i * 4 + 1] ^= 0xF3;
-		      image[i * 4 + 2] ^= 0xE7;
-		      image[i * 4 + 3] ^= 0xFF;
+		    {
+		    	TRACE_SCOPE("XOR");
+			    for (int i = 0; i < 80*960; i ++){
+			      image[i * 4] ^= 0xE7;
+			      image[i * 4 + 1] ^= 0xF3;
+			      image[i * 4 + 2] ^= 0xE7;
+			      image[i * 4 + 3] ^= 0xFF;
+			    }
 		    }
 	    	
 	    	nvgRestore(vg);
 	    }
 
 	    if (display_connected) {
-		    if (APP->window->isFrameOverdue())
-				return;
-
-	    	sendDisplay(image);
+	    	frames.submit(image);
+	    	PushFrameScheduler::instance().notify();
 	    }
 
 
@@ -0,0 +1,340 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../lib/oscpack/ip/PacketListener.h"
+
+// Events one recording holds, 16 bytes each in memory.
+#define MIDI_SESSION_MAX_EVENTS		(1 << 20)
+// Events a fast replay feeds per MIDI block.
+#define MIDI_REPLAY_FAST_CHUNK		4096
+// File format, see MidiSession::save().
+#define MIDI_SESSION_MAGIC			"PMMIDI\r\n"
+#define MIDI_SESSION_VERSION		1
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// A recorded MIDI stream: each message with the MIDI block it was processed in, counted from the start of the
+// recording. A module handles MIDI once every few samples, the block rate depends on the sample rate.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct MidiSession {
+	struct Event {
+		uint64_t block;
+		uint8_t bytes[3];
+	};
+
+	float sampleRate = 0.f;
+	std::vector<Event> events;
+
+	// Little-endian:
+	//   8 bytes magic, u32 version, f32 sample rate, u64 event count,
+	//   then per event u64 block and the 3 message bytes, 11 bytes.
+	bool save(const std::string& path) const
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		std::vector<uint8_t> out;
+		out.reserve(24 + events.size() * 11);
+		out.insert(out.end(), MIDI_SESSION_MAGIC, MIDI_SESSION_MAGIC + 8);
+		put(out, MIDI_SESSION_VERSION, 4);
+		uint32_t rateBits;
+		std::memcpy(&rateBits, &sampleRate, 4);
+		put(out, rateBits, 4);
+		put(out, events.size(), 8);
+		for (const Event& e : events)
+		{
+			put(out, e.block, 8);
+			out.insert(out.end(), e.bytes, e.bytes + 3);
+		}
+		bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+		fclose(file);
+		return ok;
+	}
+
+	bool load(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+		std::vector<uint8_t> in;
+		uint8_t buffer[65536];
+		size_t n;
+		while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			in.insert(in.end(), buffer, buffer + n);
+		fclose(file);
+
+		if (in.size() < 24 || std::memcmp(in.data(), MIDI_SESSION_MAGIC, 8) != 0 || get(&in[8], 4) != MIDI_SESSION_VERSION)
+			return false;
+		uint32_t rateBits = (uint32_t) get(&in[12], 4);
+		uint64_t count = get(&in[16], 8);
+		if (count > (in.size() - 24) / 11)
+			return false;
+		std::memcpy(&sampleRate, &rateBits, 4);
+		events.resize(count);
+		const uint8_t* p = &in[24];
+		for (uint64_t i = 0; i < count; i++, p += 11)
+		{
+			events[i].block = get(p, 8);
+			std::memcpy(events[i].bytes, p + 8, 3);
+		}
+		return true;
+	}
+
+private:
+	static void put(std::vector<uint8_t>& out, uint64_t value, int size)
+	{
+		for (int i = 0; i < size; i++)
+			out.push_back((uint8_t) (value >> (8 * i)));
+	}
+
+	static uint64_t get(const uint8_t* p, int size)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < size; i++)
+			value |= (uint64_t) p[i] << (8 * i);
+		return value;
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Records the MIDI a module processes.
+// The engine thread appends to a buffer allocated up front, so recording never allocates, locks or touches a
+// file. The UI thread starts, stops and takes the recording.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct MidiSessionRecorder {
+	// Messages lost because the buffer was full.
+	std::atomic<uint32_t> overflowCount;
+
+	MidiSessionRecorder()
+	{
+		recording = false;
+		writing = false;
+		restart = false;
+		count = 0;
+		overflowCount = 0;
+	}
+
+	// UI thread.
+	void start(float sampleRate)
+	{
+		if (recording)
+			return;
+		// A write that saw the previous recording must be over before the count is reset
+		while (writing)
+			std::this_thread::yield();
+		if (events.empty())
+			events.resize(MIDI_SESSION_MAX_EVENTS);
+		this->sampleRate = sampleRate;
+		count = 0;
+		overflowCount = 0;
+		restart = true;
+		recording.store(true, std::memory_order_release);
+	}
+
+	// UI thread. Moves what was recorded to @session.
+	void stop(MidiSession& session)
+	{
+		recording = false;
+		uint32_t n = count.load(std::memory_order_acquire);
+		session.sampleRate = sampleRate;
+		session.events.assign(events.begin(), events.begin() + n);
+	}
+
+	bool isRecording() const
+	{
+		return recording.load(std::memory_order_relaxed);
+	}
+
+	uint32_t size() const
+	{
+		return count.load(std::memory_order_relaxed);
+	}
+
+	// Engine thread, after each MIDI block.
+	void advance()
+	{
+		if (recording.load(std::memory_order_relaxed))
+			syncStart();
+		block++;
+	}
+
+	// Engine thread.
+	void record(const midi::Message& msg)
+	{
+		if (!recording.load(std::memory_order_relaxed))
+			return;
+		writing = true;
+		if (recording)
+		{
+			syncStart();
+			uint32_t n = count.load(std::memory_order_relaxed);
+			if (n < MIDI_SESSION_MAX_EVENTS)
+			{
+				events[n].block = block - startBlock;
+				std::memcpy(events[n].bytes, msg.bytes, 3);
+				count.store(n + 1, std::memory_order_release);
+			}
+			else
+			{
+				overflowCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		writing = false;
+	}
+
+private:
+	std::atomic<bool> recording;
+	// Engine thread is inside record(). Sequentially consistent with @recording, see start().
+	std::atomic<bool> writing;
+	// Set by start(), the engine thread takes the block the recording starts at.
+	std::atomic<bool> restart;
+	std::atomic<uint32_t> count;
+	std::vector<MidiSession::Event> events;
+	float sampleRate = 0.f;
+	// Engine thread only. MIDI blocks so far, and the block of the recording's start.
+	uint64_t block = 0;
+	uint64_t startBlock = 0;
+
+	void syncStart()
+	{
+		if (restart.load(std::memory_order_relaxed) && restart.exchange(false, std::memory_order_acquire))
+			startBlock = block;
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Feeds a recorded session back to a module.
+// In real time each message is handed out in the block it was recorded in, so a replay from the same state
+// takes the same path through the module every time. Fast mode ignores the timing and hands out up to
+// MIDI_REPLAY_FAST_CHUNK messages per MIDI block to measure how many events per second the module handles.
+// The UI thread loads and starts, the engine thread plays.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct MidiSessionReplay {
+	// Fast mode: messages handed out and the time the module took for them.
+	std::atomic<uint64_t> fastEvents;
+	std::atomic<uint64_t> fastNs;
+
+	MidiSessionReplay()
+	{
+		state = IDLE;
+		playing = false;
+		fastEvents = 0;
+		fastNs = 0;
+	}
+
+	// UI thread. Stops a running replay and takes @session over.
+	void load(MidiSession& session_)
+	{
+		stop();
+		while (playing)
+			std::this_thread::yield();
+		session.sampleRate = session_.sampleRate;
+		session.events.swap(session_.events);
+	}
+
+	// UI thread. Only while idle, the engine thread reads the session while playing.
+	void start(bool fast)
+	{
+		if (isPlaying() || session.events.empty())
+			return;
+		while (playing)
+			std::this_thread::yield();
+		position = 0;
+		block = 0;
+		fastEvents = 0;
+		fastNs = 0;
+		state.store(fast ? FAST : REAL_TIME, std::memory_order_release);
+	}
+
+	void stop()
+	{
+		state = IDLE;
+	}
+
+	bool isPlaying() const
+	{
+		return state.load(std::memory_order_acquire) != IDLE;
+	}
+
+	bool isFast() const
+	{
+		return state.load(std::memory_order_relaxed) == FAST;
+	}
+
+	size_t size() const
+	{
+		return session.events.size();
+	}
+
+	// Messages per second the module processed in fast mode.
+	double eventsPerSecond() const
+	{
+		uint64_t ns = fastNs.load(std::memory_order_relaxed);
+		return ns > 0 ? fastEvents.load(std::memory_order_relaxed) * 1e9 / ns : 0.0;
+	}
+
+	// Engine thread, after each MIDI block.
+	void advance()
+	{
+		if (state.load(std::memory_order_relaxed) == REAL_TIME)
+			block++;
+	}
+
+	// Engine thread. Calls @process(msg) for each message due in this MIDI block.
+	template <typename F>
+	void play(F process)
+	{
+		if (state.load(std::memory_order_relaxed) == IDLE)
+			return;
+		playing = true;
+		int mode = state;
+		if (mode == IDLE)
+		{
+			playing = false;
+			return;
+		}
+		size_t end = session.events.size();
+		if (mode == FAST)
+			end = std::min(end, position + MIDI_REPLAY_FAST_CHUNK);
+
+		uint64_t startNs = (mode == FAST) ? PacketClockNow() : 0;
+		size_t first = position;
+		midi::Message msg;
+		while (position < end && (mode == FAST || session.events[position].block <= block))
+		{
+			std::memcpy(msg.bytes, session.events[position].bytes, 3);
+			process(msg);
+			position++;
+		}
+		if (mode == FAST)
+		{
+			fastNs.fetch_add(PacketClockNow() - startNs, std::memory_order_relaxed);
+			fastEvents.fetch_add(position - first, std::memory_order_relaxed);
+		}
+		if (position >= session.events.size())
+			state = IDLE;
+		playing = false;
+	}
+
+private:
+	enum {
+		IDLE,
+		REAL_TIME,
+		FAST
+	};
+	std::atomic<int> state;
+	// Engine thread is inside play(). Sequentially consistent with @state, see load().
+	std::atomic<bool> playing;
+	MidiSession session;
+	// Engine thread while playing.
+	size_t position = 0;
+	uint64_t block = 0;
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Longest address OSC learn can capture, including the terminator.
+#define OSC_LEARN_ADDRESS_MAX	256
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Interned OSC addresses.
+// Each distinct address gets a small integer ID while the table is built. find() turns an incoming address
+// into its ID with one hash and one compare, from there on routes are matched on IDs.
+// Built on one thread, read only afterwards.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCAddressTable {
+	// ID of @address, added if it is new.
+	int intern(const std::string& address)
+	{
+		int id = find(address.data(), address.size());
+		if (id >= 0)
+			return id;
+		id = (int) addresses.size();
+		addresses.push_back(address);
+		hashes.push_back(hashOf(address.data(), address.size()));
+		if (addresses.size() * 2 > buckets.size())
+			rehash();
+		else
+			insert(id);
+		return id;
+	}
+
+	// ID of the address, -1 if unknown.
+	int find(const char* data, size_t size) const
+	{
+		if (buckets.empty())
+			return -1;
+		uint32_t hash = hashOf(data, size);
+		size_t mask = buckets.size() - 1;
+		for (size_t i = hash & mask; ; i = (i + 1) & mask)
+		{
+			int id = buckets[i];
+			if (id < 0)
+				return -1;
+			if (hashes[id] == hash && addresses[id].size() == size && std::memcmp(addresses[id].data(), data, size) == 0)
+				return id;
+		}
+	}
+
+	const std::string& address(int id) const
+	{
+		return addresses[id];
+	}
+
+	int size() const
+	{
+		return (int) addresses.size();
+	}
+
+private:
+	std::vector<std::string> addresses;
+	std::vector<uint32_t> hashes;
+	// Open addressing, -1 when empty. Power of two size, at most half full.
+	std::vector<int> buckets;
+
+	// FNV-1a
+	static uint32_t hashOf(const char* data, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= (uint8_t) data[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	void insert(int id)
+	{
+		size_t mask = buckets.size() - 1;
+		size_t i = hashes[id] & mask;
+		while (buckets[i] >= 0)
+			i = (i + 1) & mask;
+		buckets[i] = id;
+	}
+
+	void rehash()
+	{
+		size_t count = 16;
+		while (count < addresses.size() * 2)
+			count *= 2;
+		buckets.assign(count, -1);
+		for (int id = 0; id < (int) addresses.size(); id++)
+			insert(id);
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// OSC learn mailbox of one module.
+// While armed, the first unknown address the receiving thread sees is copied in and handed to the UI thread.
+// One receiving thread and one UI thread. Lock-free, nothing is allocated on the receiving thread.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCAddressLearn {
+	OSCAddressLearn()
+	{
+		state = IDLE;
+	}
+
+	// UI thread. Start or stop waiting for an address. A learned address not taken yet is kept.
+	void arm(bool armed)
+	{
+		int current = state.load(std::memory_order_relaxed);
+		if (armed && current == IDLE)
+			state.compare_exchange_strong(current, ARMED);
+		else if (!armed && current == ARMED)
+			state.compare_exchange_strong(current, IDLE);
+	}
+
+	// Receiving thread. Returns true if the address was captured.
+	bool offer(const char* data, size_t size)
+	{
+		if (state.load(std::memory_order_relaxed) != ARMED || size >= OSC_LEARN_ADDRESS_MAX)
+			return false;
+		int expected = ARMED;
+		if (!state.compare_exchange_strong(expected, WRITING, std::memory_order_acquire))
+			return false;
+		std::memcpy(address, data, size);
+		address[size] = 0;
+		state.store(READY, std::memory_order_release);
+		return true;
+	}
+
+	// UI thread. Moves a captured address to @learned, false if there is none.
+	bool take(std::string& learned)
+	{
+		if (state.load(std::memory_order_acquire) != READY)
+			return false;
+		learned = address;
+		state.store(IDLE, std::memory_order_release);
+		return true;
+	}
+
+private:
+	enum {
+		IDLE,
+		ARMED,
+		// Receiving thread is copying the address
+		WRITING,
+		READY
+	};
+	std::atomic<int> state;
+	char address[OSC_LEARN_ADDRESS_MAX];
+};
@@ -1,11 +1,21 @@
 #include <mutex>
+#include <atomic>
 #include <map>
 #include <vector>
 #include "../lib/oscpack/osc/OscOutboundPacketStream.h"
 #include "../lib/oscpack/ip/UdpSocket.h"
+#include "../lib/oscpack/ip/TcpSocket.h"
 #include "../lib/oscpack/osc/OscReceivedElements.h"
 #include "../lib/oscpack/osc/OscPacketListener.h"
+#include "OSCAddressTable.hpp"
+#include "Trace.hpp"
 #include <thread>
+#include <condition_variable>
+#include <chrono>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
@@ -78,7 +88,45 @@ struct TSOSCPortInfo {
 	}
 };
 
+// Socket options of a UDP Rx port.
+struct OscRxOptions {
+	// Share the port with other sockets and Rack processes on this host (SO_REUSEADDR / SO_REUSEPORT).
+	// Only honoured by the module that opens the port.
+	bool sharePort = false;
+	// IPv4 or IPv6 multicast group to join, none if it is not a multicast address.
+	IpEndpointName multicastGroup;
+
+	// Socket family for the port. An IPv4 group needs an IPv4 socket on macOS and the BSDs, which then takes no
+	// IPv6 senders, everything else gets a dual-stack socket. Decided by the module that opens the port.
+	UdpSocket::Family family() const
+	{
+		return (multicastGroup.IsMulticastAddress() && !multicastGroup.IsIpv6()) ? UdpSocket::IPV4_ONLY : UdpSocket::DUAL_STACK;
+	}
 
+	// Parse a dotted IPv4 (224.0.0.0 - 239.255.255.255) or an IPv6 (ff00::/8) multicast address.
+	static bool parseMulticastGroup(const std::string& text, IpEndpointName& group)
+	{
+		if (text.find(':') != std::string::npos)
+		{
+			// Literal only, never a DNS lookup
+			if (text.find_first_not_of("0123456789abcdefABCDEF:.") != std::string::npos)
+				return false;
+			IpEndpointName parsed(text.c_str());
+			if (!parsed.IsIpv6() || !parsed.IsMulticastAddress())
+				return false;
+			group = parsed;
+			return true;
+		}
+		unsigned int a, b, c, d;
+		char extra;
+		if (sscanf(text.c_str(), "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4)
+			return false;
+		if (a < 224 || a > 239 || b > 255 || c > 255 || d > 255)
+			return false;
+		group = IpEndpointName((unsigned long) ((a << 24) | (b << 16) | (c << 8) | d), IpEndpointName::ANY_PORT);
+		return true;
+	}
+};
 
 
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
@@ -89,10 +137,27 @@ struct TSOSCPortInfo {
 // So type <T> should be oscCV or TSSequencerBase if we allow sequencers to share the same ports...
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 template<class T>
-class OSCBaseMsgRouter : public osc::OscPacketListener {
+class OSCBaseMsgRouter : public osc::OscPacketViewListener {
 public:
 
-	OSControlMap* module;
+	// One subscribed address: messages for it go to slot @slot of @module.
+	struct Route {
+		std::string address;
+		T* module;
+		int slot;
+		// Set when the table is published
+		int addressId;
+	};
+	// Immutable snapshot of every subscriber's routes.
+	struct RouteTable {
+		// Every subscribed address, interned.
+		OSCAddressTable addresses;
+		// Sorted by address ID. The routes of address ID i are [firstRoute[i], firstRoute[i + 1]).
+		std::vector<Route> routes;
+		std::vector<int> firstRoute;
+		// Subscribed modules.
+		std::vector<T*> modules;
+	};
 
 	// Modules that are registered for messages.
 	typename std::vector<T*> modules;
@@ -110,7 +175,12 @@ public:
 		modules.push_back(oscModule);
 		return;
 	}
-	// Add a module to the list.
+	virtual ~OSCBaseMsgRouter()
+	{
+		delete routeTable.load();
+	}
+	// Add a module to the list. Writers (this, removeModule() and refreshRoutes()) are not real-time safe,
+	// see publishRoutes(): call them from the UI thread, never from process().
 	void addModule(T* oscModule)
 	{
 		std::lock_guard<std::mutex> lock(mutModule);
@@ -118,9 +188,11 @@ public:
 		{
 			modules.push_back(oscModule);
 		}
+		publishRoutes();
 		return;
 	}
 	// Remove a module.
+	// Once this returns the receiving thread no longer holds any reference to the module.
 	void removeModule(T* oscModule)
 	{
 		std::lock_guard<std::mutex> lock(mutModule);
@@ -130,8 +202,77 @@ public:
 			// Remove reference but don't delete the reference.
 			modules.erase(it);
 		}
+		publishRoutes();
 		return;
 	}
+	// Rebuild the route table after a module changed its mappings.
+	void refreshRoutes()
+	{
+		std::lock_guard<std::mutex> lock(mutModule);
+		publishRoutes();
+	}
+protected:
+	// Current route table. Replaced as a whole, never modified in place.
+	std::atomic<RouteTable*> routeTable{NULL};
+	// Odd while the receiving thread is reading a table.
+	std::atomic<uint32_t> readerSeq{0};
+	// Number of malformed packets or elements dropped.
+	std::atomic<uint32_t> malformedCount{0};
+
+	// Malformed input is dropped without unwinding the receive loop. Only log on powers of two so a bad sender can't flood the log.
+	void ProcessMalformed(osc::ParseStatus status, const IpEndpointName& remoteEndpoint) override
+	{
+		uint32_t n = ++malformedCount;
+		if ((n & (n - 1)) == 0)
+		{
+			char address[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+			remoteEndpoint.AddressAndPortAsString(address);
+			DEBUG("OSCBaseMsgRouter - Dropped malformed OSC from %s: %s (%u dropped so far).", address, osc::ParseStatusString(status), n);
+		}
+	}
+
+	// Add the routes of one module to @routes.
+	virtual void collectRoutes(T* oscModule, std::vector<Route>& routes) = 0;
+
+	// Swap in a fresh table and free the old one after the reader has let go of it.
+	// Must hold mutModule. Non-RT writers only: it allocates and yields until the receiving thread is out of the old
+	// table, so a writer on the engine thread would stall the audio behind a packet being dispatched.
+	void publishRoutes()
+	{
+		RouteTable* fresh = new RouteTable();
+		fresh->modules = modules;
+		for (T* oscModule : modules)
+			collectRoutes(oscModule, fresh->routes);
+		for (Route& route : fresh->routes)
+			route.addressId = fresh->addresses.intern(route.address);
+		std::stable_sort(fresh->routes.begin(), fresh->routes.end(), [](const Route& a, const Route& b) {
+			return a.addressId < b.addressId;
+		});
+		fresh->firstRoute.assign(fresh->addresses.size() + 1, (int) fresh->routes.size());
+		for (int i = (int) fresh->routes.size() - 1; i >= 0; i--)
+			fresh->firstRoute[fresh->routes[i].addressId] = i;
+		RouteTable* old = routeTable.exchange(fresh);
+		uint32_t seq = readerSeq.load();
+		if (seq & 1)
+		{
+			// Reader is inside a table, possibly the old one. Wait for it to leave.
+			while (readerSeq.load() == seq)
+				std::this_thread::yield();
+		}
+		delete old;
+	}
+
+	// Receiving thread only. Pair with endRead().
+	const RouteTable* beginRead()
+	{
+		readerSeq.fetch_add(1);
+		return routeTable.load();
+	}
+	void endRead()
+	{
+		readerSeq.fetch_add(1);
+	}
+
 protected:
 	// Mutex for adjust modules
 	std::mutex mutModule;
@@ -143,19 +284,28 @@ protected:
 
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 // Information about the port, the socket, and the modules that are subscribed to receive messages.
+// UDP sockets are serviced by the connector's shared reactor thread, a TCP listener has its own thread
+// since it has to accept and track connections.
 // Type <T> should be oscCV or TSSequencerBase if we allow sequencers to share the same ports...
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 template<class T>
 struct OscRxDetails
 {
 	// Receiving OSC socket.
-	UdpListeningReceiveSocket* oscRxSocket = NULL;
+	UdpReceiveSocket* oscRxSocket = NULL;
+	// Receiving OSC stream listener (TCP transports).
+	TcpListeningReceiveSocket* oscTcpSocket = NULL;
+	// The TCP listener thread
+	std::thread oscTcpThread;
+	std::atomic<bool> oscTcpExited{false};
 	// The port.
 	uint16_t port;
 	// The message router.
 	OSCBaseMsgRouter<T>* router = NULL;
-	// The OSC listener thread
-	std::thread oscListenerThread;	
+	// Multicast group joined for each module, and how many modules joined each group.
+	// Groups are keyed by their address string.
+	std::map<T*, IpEndpointName> moduleGroups;
+	std::map<std::string, int> groupRefs;
 	OscRxDetails(uint16_t port)
 	{
 		//static_assert(std::is_base_of<Module, T>::value, "Must be a Module.");		
@@ -166,21 +316,97 @@ struct OscRxDetails
 		cleanUp();
 		return;
 	}
+	void startTcp()
+	{
+		oscTcpExited = false;
+		oscTcpThread = std::thread([this]() {
+			TRACE_THREAD_NAME("OSC TCP");
+			try
+			{
+				oscTcpSocket->Run();
+			}
+			catch (const std::exception& ex)
+			{
+				DEBUG("OscRxDetails::startTcp(port %d) - Exception caught:\n%s", port, ex.what());
+			}
+			oscTcpExited = true;
+		});
+	}
+	// The socket is shared, so each group is joined once and left with its last module.
+	static std::string groupKey(const IpEndpointName& group)
+	{
+		char text[IpEndpointName::ADDRESS_STRING_LENGTH];
+		group.AddressAsString(text);
+		return text;
+	}
+	void joinGroup(T* module, const IpEndpointName& group)
+	{
+		if (oscRxSocket == NULL || !group.IsMulticastAddress() || moduleGroups.count(module))
+			return;
+		std::string key = groupKey(group);
+		if (groupRefs[key]++ == 0)
+		{
+			try
+			{
+				oscRxSocket->JoinMulticastEndpoint(group);
+				INFO("OscRxDetails::joinGroup(port %d) - Joined multicast group %s.", port, key.c_str());
+			}
+			catch (const std::exception& ex)
+			{
+				WARN("OscRxDetails::joinGroup(port %d) - Could not join multicast group %s: %s", port, key.c_str(), ex.what());
+				groupRefs.erase(key);
+				return;
+			}
+		}
+		moduleGroups[module] = group;
+	}
+	void leaveGroup(T* module)
+	{
+		typename std::map<T*, IpEndpointName>::iterator it = moduleGroups.find(module);
+		if (it == moduleGroups.end())
+			return;
+		IpEndpointName group = it->second;
+		moduleGroups.erase(it);
+		std::string key = groupKey(group);
+		if (--groupRefs[key] == 0)
+		{
+			groupRefs.erase(key);
+			if (oscRxSocket != NULL)
+				oscRxSocket->LeaveMulticastEndpoint(group);
+		}
+	}
+	// UDP socket must already be detached from the reactor.
 	void cleanUp()
 	{
-		if (oscRxSocket != NULL) // No more modules
+		if (oscRxSocket != NULL)
 		{
-			oscRxSocket->AsynchronousBreak();
-			oscListenerThread.join(); // Wait for him to finish
-			delete oscRxSocket;			
+			delete oscRxSocket;
 			oscRxSocket = NULL;
-			
+		}
+		if (oscTcpSocket != NULL)
+		{
+			// Repeat the break, one sent just before Run() starts is lost.
+			while (oscTcpThread.joinable() && !oscTcpExited)
+			{
+				oscTcpSocket->AsynchronousBreak();
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+			if (oscTcpThread.joinable())
+				oscTcpThread.join();
+			delete oscTcpSocket;
+			oscTcpSocket = NULL;
+		}
+		if (router != NULL)
+		{
 			delete router;
-		}					
+			router = NULL;
+		}
 	}
 };
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 // OSC Rx Connector.
+// All Rx ports share one SocketReceiveMultiplexer driven by a single reactor thread. Ports are attached
+// and detached by parking the reactor between two Run() calls, so the thread lives as long as any port is open.
 // Type <T> should be oscCV or TSSequencerBase if we allow sequencers to share the same ports...
 // Type <R> should be derived from TOSCBaseMsgRouter.
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
@@ -196,12 +422,134 @@ private:
 		return;
 	}
 	static TSOSCRxConnector<T, R>* _instance;
-	// The ports that are receiving messages.
-	std::map<uint16_t, OscRxDetails<T>*> _portMap;
+	// The ports that are receiving messages, keyed by portKey().
+	std::map<uint32_t, OscRxDetails<T>*> _portMap;
 	// Clean up thread and everything.
 	//void cleanUpListener(OscRxDetails<T>* details);
-	// Port mutex.
+	// Port mutex. Also guards the reactor state below.
 	std::mutex _mutex;
+
+	// Multiplexer shared by every port.
+	SocketReceiveMultiplexer* _mux = NULL;
+	// The OSC reactor thread
+	std::thread _reactorThread;
+	// CPU the reactor thread is pinned to, -1 for none.
+	int _reactorCpu = -1;
+	bool _reactorQuit = false;
+	bool _reactorExited = false;
+	bool _pauseRequested = false;
+	bool _reactorParked = false;
+	std::condition_variable _reactorCv;
+
+	void reactorLoop()
+	{
+		pinReactor();
+		TRACE_THREAD_NAME("OSC reactor");
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (!_reactorQuit)
+		{
+			if (_pauseRequested)
+			{
+				// Out of Run(), so the socket list may be changed.
+				_reactorParked = true;
+				_reactorCv.notify_all();
+				_reactorCv.wait(lock, [this] { return !_pauseRequested || _reactorQuit; });
+				_reactorParked = false;
+				continue;
+			}
+			lock.unlock();
+			try
+			{
+				_mux->Run();
+			}
+			catch (const std::exception& ex)
+			{
+				DEBUG("TSOSCRxConnector::reactorLoop() - Exception caught:\n%s", ex.what());
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			lock.lock();
+		}
+		_reactorExited = true;
+		_reactorCv.notify_all();
+	}
+
+	void pinReactor()
+	{
+#if defined(__linux__)
+		if (_reactorCpu < 0)
+			return;
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(_reactorCpu, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+	}
+
+	// Get the reactor out of Run() and hold it there. Must hold _mutex.
+	// AsynchronousBreak() is repeated since a break sent just before Run() starts is lost.
+	void pauseReactor(std::unique_lock<std::mutex>& lock)
+	{
+		if (!_reactorThread.joinable())
+			return;
+		_pauseRequested = true;
+		while (!_reactorParked)
+		{
+			_mux->AsynchronousBreak();
+			_reactorCv.wait_for(lock, std::chrono::milliseconds(5));
+		}
+	}
+
+	// The same port number may be open on UDP and on TCP.
+	static uint32_t portKey(uint16_t rxPort, int transport)
+	{
+		return ((uint32_t)transport << 16) | rxPort;
+	}
+
+	int udpPortCount()
+	{
+		int count = 0;
+		for (typename std::map<uint32_t, OscRxDetails<T>*>::iterator it = _portMap.begin(); it != _portMap.end(); ++it)
+		{
+			if (it->second->oscRxSocket != NULL)
+				count++;
+		}
+		return count;
+	}
+
+	void resumeReactor()
+	{
+		_pauseRequested = false;
+		_reactorCv.notify_all();
+	}
+
+	void startReactor()
+	{
+		if (_reactorThread.joinable())
+			return;
+		DEBUG("TSOSCRxConnector::startReactor() - Starting OSC reactor thread.");
+		_reactorQuit = false;
+		_reactorExited = false;
+		_reactorThread = std::thread(&TSOSCRxConnector<T, R>::reactorLoop, this);
+	}
+
+	void stopReactor(std::unique_lock<std::mutex>& lock)
+	{
+		if (!_reactorThread.joinable())
+			return;
+		DEBUG("TSOSCRxConnector::stopReactor() - No more ports, stopping OSC reactor thread.");
+		_reactorQuit = true;
+		_reactorCv.notify_all();
+		while (!_reactorExited)
+		{
+			_mux->AsynchronousBreak();
+			_reactorCv.wait_for(lock, std::chrono::milliseconds(5));
+		}
+		lock.unlock();
+		_reactorThread.join();
+		lock.lock();
+		_pauseRequested = false;
+	}
+
 public:
 	static TSOSCRxConnector<T, R>* Connector()
 	{
@@ -210,12 +558,14 @@ public:
 		return _instance;	
 	}
 
-	bool startListener(uint16_t rxPort, T* module)
+	// @transport : one of OSCTransport.
+	// @options : UDP socket options, see OscRxOptions.
+	bool startListener(uint16_t rxPort, T* module, int transport, const OscRxOptions& options)
 	{
-		std::lock_guard<std::mutex> lock(_mutex);
+		std::unique_lock<std::mutex> lock(_mutex);
 		DEBUG("TSOSCRxConnector::startListener(port %d) - Starting for module id %d.", rxPort,  module->id);
-		bool success = false;
-		OscRxDetails<T>* item = (_portMap.count(rxPort) < 1) ? NULL : _portMap[rxPort];
+		uint32_t key = portKey(rxPort, transport);
+		OscRxDetails<T>* item = (_portMap.count(key) < 1) ? NULL : _portMap[key];
 		if (item == NULL)
 		{
 			item = new OscRxDetails<T>(rxPort);
@@ -223,29 +573,58 @@ public:
 		if (item->router == NULL)
 		{
 			item->router = new R();// OSCBaseMsgRouter<T>();
-			item->router->module = module;
 			DEBUG("TSOSCRxConnector::startListener(port %d) - Create router/listener object.", rxPort);
 		}
 		item->router->addModule(module);
 		DEBUG("TSOSCRxConnector::startListener(port %d) - Add module to router module list. Now it has %d items.", rxPort, item->router->modules.size());
-		if (item->oscRxSocket == NULL)
+		if (item->oscRxSocket == NULL && item->oscTcpSocket == NULL)
 		{
-			DEBUG("TSOSCRxConnector::startListener(port %d) - Creating Rx socket and starting listener thread.", rxPort);
-			item->oscRxSocket = new UdpListeningReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, rxPort), item->router);
-			// Start the thread
-			item->oscListenerThread = std::thread(&UdpListeningReceiveSocket::Run, item->oscRxSocket);
+			try
+			{
+				if (transport == OSC_TRANSPORT_UDP)
+				{
+					DEBUG("TSOSCRxConnector::startListener(port %d) - Creating Rx socket and attaching it to the reactor.", rxPort);
+					item->oscRxSocket = new UdpReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, rxPort), options.sharePort, options.family());
+				}
+				else
+				{
+					DEBUG("TSOSCRxConnector::startListener(port %d) - Creating TCP listener and starting its thread.", rxPort);
+					StreamFraming framing = (transport == OSC_TRANSPORT_TCP_SLIP) ? SLIP_FRAMING : LENGTH_PREFIX_FRAMING;
+					item->oscTcpSocket = new TcpListeningReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, rxPort), item->router, framing);
+				}
+			}
+			catch (const std::exception& ex)
+			{
+				DEBUG("TSOSCRxConnector::startListener(port %d) - Exception caught:\n%s", rxPort, ex.what());
+				if (_portMap.count(key) < 1)
+					delete item;
+				return false;
+			}
+			if (item->oscRxSocket != NULL)
+			{
+				if (_mux == NULL)
+					_mux = new SocketReceiveMultiplexer();
+				pauseReactor(lock);
+				_mux->AttachSocketListener(item->oscRxSocket, item->router);
+				resumeReactor();
+				startReactor();
+			}
+			else
+			{
+				item->startTcp();
+			}
 		}
-		_portMap[rxPort] = item;
-		success = true;
-		return success;		
+		item->joinGroup(module, options.multicastGroup);
+		_portMap[key] = item;
+		return true;
 	} // end startListener()
 
-	bool stopListener(uint16_t rxPort, T* module)
+	bool stopListener(uint16_t rxPort, T* module, int transport)
 	{
 		DEBUG("TSOSCRxConnector::stopListener(port %d, id=%d) - Stopping listener for module id %d.", rxPort, module->id, module->id);
-		std::lock_guard<std::mutex> lock(_mutex);	
+		std::unique_lock<std::mutex> lock(_mutex);
 		bool success = false;
-		typename std::map<uint16_t, OscRxDetails<T>*>::iterator it = _portMap.find(rxPort);
+		typename std::map<uint32_t, OscRxDetails<T>*>::iterator it = _portMap.find(portKey(rxPort, transport));
 		OscRxDetails<T>* item = (it == _portMap.end()) ? NULL : it->second;
 		if (item != NULL)
 		{
@@ -253,12 +632,22 @@ public:
 			{
 				DEBUG("TSOSCRxConnector::stopListener(port %d, id=%d) - Removing module from list.", rxPort, module->id);
 				item->router->removeModule(module); // Remove this module from the list.
+				item->leaveGroup(module);
 			}		
 			if (item->router == NULL || item->router->modules.size() < 1)
 			{
 				DEBUG("TSOSCRxConnector::stopListener(port %d, id=%d) - NO MORE modules listening to this port. Deleting...", rxPort, module->id);
 				// No more modules are listening to this
 				// No more registered, remove.
+				if (item->oscRxSocket != NULL)
+				{
+					pauseReactor(lock);
+					_mux->DetachSocketListener(item->oscRxSocket, item->router);
+					if (udpPortCount() > 1)
+						resumeReactor();
+					else
+						stopReactor(lock);
+				}
 				item->cleanUp();
 				delete it->second;			
 				_portMap.erase(it);
@@ -272,13 +661,30 @@ public:
 		return success;			
 	} // end stopListener()
 	
-	static bool StartListener(uint16_t rxPort, T* module)
+	static bool StartListener(uint16_t rxPort, T* module, int transport = OSC_TRANSPORT_UDP, const OscRxOptions& options = OscRxOptions())
+	{
+		return Connector()->startListener(rxPort, module, transport, options);
+	}
+	static bool StopListener(uint16_t rxPort, T* module, int transport = OSC_TRANSPORT_UDP)
+	{
+		return Connector()->stopListener(rxPort, module, transport);
+	}
+	// Rebuild the routes of the port after the module changed its mappings.
+	// UI thread: waits on _mutex, which StartListener() and StopListener() hold while the reactor parks.
+	static void RefreshRoutes(uint16_t rxPort, T* module, int transport = OSC_TRANSPORT_UDP)
 	{
-		return Connector()->startListener(rxPort, module);
+		TSOSCRxConnector<T, R>* connector = Connector();
+		std::lock_guard<std::mutex> lock(connector->_mutex);
+		typename std::map<uint32_t, OscRxDetails<T>*>::iterator it = connector->_portMap.find(portKey(rxPort, transport));
+		if (it != connector->_portMap.end() && it->second->router != NULL)
+			it->second->router->refreshRoutes();
 	}
-	static bool StopListener(uint16_t rxPort, T* module)
+	// Pin the reactor thread to a CPU (Linux only). Takes effect the next time the thread starts.
+	static void SetReactorAffinity(int cpu)
 	{
-		return Connector()->stopListener(rxPort, module);
+		TSOSCRxConnector<T, R>* connector = Connector();
+		std::lock_guard<std::mutex> lock(connector->_mutex);
+		connector->_reactorCpu = cpu;
 	}
 
 
@@ -344,54 +750,91 @@ TSOSCRxConnector<T, R>* TSOSCRxConnector<T, R>::_instance = NULL;
 class OSCRxMsgRouter : public OSCBaseMsgRouter<OSControlMap> {
 public:
 
+	// Hands the raw datagram to the modules capturing their traffic, then parses it.
+	void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override
+	{
+		TRACE_SCOPE("OSC receive");
+		const RouteTable* table = beginRead();
+		if (table != NULL)
+		{
+			uint64_t receivedNs = PacketReceiveTime();
+			for (OSControlMap* oscModule : table->modules)
+				oscModule->oscCapture.tee(data, size, remoteEndpoint, receivedNs);
+		}
+		endRead();
+		OSCBaseMsgRouter<OSControlMap>::ProcessPacket(data, size, remoteEndpoint);
+	}
+
 
 	//--------------------------------------------------------------------------------------------------------------------------------------------
 	// ProcessMessage()
-	// @rxMsg : (IN) The received message from the OSC library.
+	// @rxMsg : (IN) The received message, already validated by the OSC library. Its spans point into the receive buffer.
 	// @remoteEndPoint: (IN) The remove end point (sender).
 	// Handler for receiving messages from the OSC library. Taken from their example listener.
-	// Should create a generic TSExternalControlMessage for our trowaSoft sequencers and dump it in the module instance's queue.
+	// The message is parsed once and its value handed to every module slot subscribed to the address.
+	// Unknown addresses are offered to modules in OSC learn mode.
 	//--------------------------------------------------------------------------------------------------------------------------------------------
-	void ProcessMessage(const osc::ReceivedMessage& rxMsg, const IpEndpointName& remoteEndpoint) override
+	void ProcessMessage(const osc::MessageView& rxMsg, const IpEndpointName& remoteEndpoint) override
 	{
 		(void)remoteEndpoint; // suppress unused parameter warning
+		TRACE_SCOPE("OSC dispatch");
 
-		float stepVal = 0.0;
-		/*osc::int32 step = -1;
-		osc::int32 intVal = -1;*/
-		try {
-			std::string incompingPath = rxMsg.AddressPattern();
-			//DEBUG("incompingPath: %s", incompingPath.c_str());
-
-			for (int id = 0; id < module->mapLen; id++) {
-				int cc = module->ccs[id];
-				if (cc < 0)
-					continue;
-
-				std::string mappedPath = "/" + std::to_string(cc);
-				if (!module->spaceName.empty()) {
-					mappedPath = "/" + module->spaceName + mappedPath;
-				}
-				DEBUG("mappedPath: %s", mappedPath.c_str());
-
-				if ( mappedPath == incompingPath){
-
-					osc::ReceivedMessageArgumentStream args = rxMsg.ArgumentStream();
-					args >> stepVal >> osc::EndMessage;
-
-					DEBUG("stepVal: %f", stepVal);
-					module->values[cc] =  (int) (stepVal * 127.f);
-				}
+		const RouteTable* table = beginRead();
+		if (table == NULL)
+		{
+			endRead();
+			return;
+		}
 
+		const osc::Span& incomingPath = rxMsg.addressPattern;
+		int addressId = table->addresses.find(incomingPath.data, incomingPath.size);
+		if (addressId < 0)
+		{
+			for (OSControlMap* oscModule : table->modules)
+				oscModule->oscAddressLearn.offer(incomingPath.data, incomingPath.size);
+		}
+		else
+		{
+			const Route* route = table->routes.data() + table->firstRoute[addressId];
+			const Route* routesEnd = table->routes.data() + table->firstRoute[addressId + 1];
+			// Raw value, the engine applies each slot's range and curve
+			double stepVal = 0.0;
+			osc::ArgumentCursor args(rxMsg);
+			osc::ArgumentView arg;
+			osc::ParseStatus status = osc::PARSE_MISSING_ARGUMENT;
+			if (rxMsg.ArgumentCount() == 1 && args.Next(arg))
+				status = arg.AsDouble(stepVal);
+			if (status != osc::PARSE_OK)
+			{
+				DEBUG("Error parsing OSC message %s: %s", route->address.c_str(), osc::ParseStatusString(status));
+				endRead();
+				return;
 			}
 
-		} // end try
-		catch (osc::Exception& e) {
-			DEBUG("Error parsing OSC message %s: %s", rxMsg.AddressPattern(), e.what());
-		} // end catch
+			uint64_t receivedNs = PacketReceiveTime();
+			uint64_t dispatchedNs = PacketClockNow();
+			for (; route != routesEnd; ++route)
+			{
+				if (receivedNs)
+					route->module->latency.receiveToDispatch.record(dispatchedNs - receivedNs);
+				route->module->rxCoalescer.post(route->slot, stepVal, receivedNs, dispatchedNs);
+			}
+		}
+		endRead();
 		return;
 	} // end ProcessMessage()
-	
+
+protected:
+	// One route per mapped channel of the module, to the channel's slot.
+	void collectRoutes(OSControlMap* oscModule, std::vector<Route>& routes) override
+	{
+		for (int id = 0; id < oscModule->mapLen; id++) {
+			std::string mappedPath = oscModule->oscAddress(id);
+			if (mappedPath.empty())
+				continue;
+			routes.push_back(Route { mappedPath, oscModule, id, -1 });
+		}
+	}
 	
 };
 
@@ -0,0 +1,653 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../lib/oscpack/ip/IpEndpointName.h"
+#include "../lib/oscpack/ip/PacketListener.h"
+#include "../lib/oscpack/ip/UdpSocket.h"
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bytes of datagrams the receiving thread can queue before the writer catches up.
+#define OSC_CAPTURE_RING_BYTES		(4 << 20)
+// Largest payload that still fits a synthesized IP/UDP packet.
+#define OSC_CAPTURE_MAX_PAYLOAD		65507
+// How often the writer thread flushes the ring to the file.
+#define OSC_CAPTURE_FLUSH_MS		20
+// pcap link types. Captures are written as LINKTYPE_RAW, replays read the usual link layers.
+#define PCAP_LINKTYPE_NULL			0
+#define PCAP_LINKTYPE_ETHERNET		1
+#define PCAP_LINKTYPE_RAW			101
+#define PCAP_LINKTYPE_LOOP			108
+#define PCAP_LINKTYPE_LINUX_SLL		113
+#define PCAP_LINKTYPE_IPV4			228
+#define PCAP_LINKTYPE_IPV6			229
+#define PCAP_LINKTYPE_LINUX_SLL2	276
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Captures the raw OSC datagrams a module receives to a pcap file.
+// The receiving thread copies each datagram with its arrival time into a ring allocated up front, so the tee never
+// allocates, locks or touches a file. A writer thread flushes the ring to the file. Packets are written as IPv4 or
+// IPv6 with a UDP header from the sender to the loopback address on the Rx port, which Wireshark and tcpdump open
+// as is. Datagrams that don't fit the ring are dropped and counted.
+// Only one thread may tee at a time, which holds since a module listens on one port.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCCapture {
+	// Datagrams queued and written, and lost because the ring was full or the payload too large.
+	std::atomic<uint64_t> capturedCount;
+	std::atomic<uint64_t> writtenCount;
+	std::atomic<uint64_t> droppedCount;
+
+	OSCCapture()
+	{
+		capturing = false;
+		writing = false;
+		running = false;
+		head = 0;
+		tail = 0;
+		capturedCount = 0;
+		writtenCount = 0;
+		droppedCount = 0;
+	}
+
+	~OSCCapture()
+	{
+		stop();
+	}
+
+	// UI thread. @port is the Rx port, the destination of the packets in the file.
+	bool start(const std::string& path, uint16_t port)
+	{
+		if (capturing || writerThread.joinable())
+			return false;
+		file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		if (ring.empty())
+			ring.resize(OSC_CAPTURE_RING_BYTES);
+		rxPort = port;
+		// Arrival times are on the packet clock, the file wants wall clock time.
+		wallStartUs = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		clockStartNs = PacketClockNow();
+		writeFileHeader();
+		head = 0;
+		tail = 0;
+		capturedCount = 0;
+		writtenCount = 0;
+		droppedCount = 0;
+		running = true;
+		writerThread = std::thread(&OSCCapture::writerLoop, this);
+		capturing.store(true, std::memory_order_release);
+		return true;
+	}
+
+	// UI thread. Writes out what is queued and closes the file.
+	void stop()
+	{
+		capturing = false;
+		// A tee that saw the capture on must be over before the writer's last flush
+		while (writing)
+			std::this_thread::yield();
+		running = false;
+		if (writerThread.joinable())
+			writerThread.join();
+		if (file)
+		{
+			fclose(file);
+			file = NULL;
+		}
+	}
+
+	bool isCapturing() const
+	{
+		return capturing.load(std::memory_order_relaxed);
+	}
+
+	// Receiving thread. @receivedNs is the arrival time on the packet clock, 0 if unknown.
+	void tee(const char* data, int size, const IpEndpointName& remoteEndpoint, uint64_t receivedNs)
+	{
+		if (!capturing.load(std::memory_order_relaxed))
+			return;
+		writing = true;
+		if (capturing)
+			push(data, size, remoteEndpoint, receivedNs ? receivedNs : PacketClockNow());
+		writing = false;
+	}
+
+private:
+	// Ring record, followed by the payload padded to 8 bytes.
+	struct Record {
+		uint32_t size;
+		uint16_t port;
+		uint8_t family;
+		uint8_t reserved;
+		uint64_t ns;
+		uint8_t address[16];
+	};
+	// Record size of the marker that sends the reader back to the start of the ring.
+	static const uint32_t WRAP = 0xFFFFFFFFu;
+
+	std::atomic<bool> capturing;
+	// Receiving thread is inside tee(). Sequentially consistent with @capturing, see stop().
+	std::atomic<bool> writing;
+	std::atomic<bool> running;
+	// Bytes ever written to and read from the ring. Written by the receiving and the writer thread respectively.
+	std::atomic<uint64_t> head;
+	std::atomic<uint64_t> tail;
+	std::vector<uint8_t> ring;
+	std::thread writerThread;
+	FILE* file = NULL;
+	uint16_t rxPort = 0;
+	uint64_t wallStartUs = 0;
+	uint64_t clockStartNs = 0;
+
+	static size_t padded(size_t size)
+	{
+		return (size + 7) & ~(size_t) 7;
+	}
+
+	void push(const char* data, int size, const IpEndpointName& remoteEndpoint, uint64_t ns)
+	{
+		if (size < 0 || size > OSC_CAPTURE_MAX_PAYLOAD)
+		{
+			droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		size_t need = sizeof(Record) + padded(size);
+		uint64_t h = head.load(std::memory_order_relaxed);
+		size_t pos = (size_t) (h % ring.size());
+		size_t contiguous = ring.size() - pos;
+		// Records never straddle the end of the ring
+		size_t skip = (contiguous < need) ? contiguous : 0;
+		if (ring.size() - (h - tail.load(std::memory_order_acquire)) < skip + need)
+		{
+			droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (skip >= sizeof(Record))
+		{
+			Record wrap = {};
+			wrap.size = WRAP;
+			std::memcpy(&ring[pos], &wrap, sizeof(wrap));
+		}
+		if (skip)
+			pos = 0;
+		Record record = {};
+		record.size = (uint32_t) size;
+		record.port = (remoteEndpoint.port == IpEndpointName::ANY_PORT) ? 0 : (uint16_t) remoteEndpoint.port;
+		record.family = (uint8_t) remoteEndpoint.family;
+		record.ns = ns;
+		if (remoteEndpoint.family == IpEndpointName::IPV6)
+		{
+			std::memcpy(record.address, remoteEndpoint.address6, 16);
+		}
+		else
+		{
+			for (int i = 0; i < 4; i++)
+				record.address[i] = (uint8_t) (remoteEndpoint.address >> (24 - 8 * i));
+		}
+		std::memcpy(&ring[pos], &record, sizeof(record));
+		std::memcpy(&ring[pos + sizeof(record)], data, size);
+		head.store(h + skip + need, std::memory_order_release);
+		capturedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void writerLoop()
+	{
+		std::vector<uint8_t> packet(40 + 8 + OSC_CAPTURE_MAX_PAYLOAD);
+		while (running)
+		{
+			flush(packet);
+			std::this_thread::sleep_for(std::chrono::milliseconds(OSC_CAPTURE_FLUSH_MS));
+		}
+		flush(packet);
+		fflush(file);
+	}
+
+	// Writer thread. Writes every queued record to the file.
+	void flush(std::vector<uint8_t>& packet)
+	{
+		uint64_t h = head.load(std::memory_order_acquire);
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		while (t < h)
+		{
+			size_t pos = (size_t) (t % ring.size());
+			size_t contiguous = ring.size() - pos;
+			Record record;
+			if (contiguous >= sizeof(Record))
+				std::memcpy(&record, &ring[pos], sizeof(record));
+			if (contiguous < sizeof(Record) || record.size == WRAP)
+			{
+				t += contiguous;
+				continue;
+			}
+			size_t length = buildPacket(record, &ring[pos + sizeof(record)], packet.data());
+			uint64_t us = wallStartUs + (record.ns > clockStartNs ? (record.ns - clockStartNs) / 1000 : 0);
+			uint8_t header[16];
+			put32(header, (uint32_t) (us / 1000000));
+			put32(header + 4, (uint32_t) (us % 1000000));
+			put32(header + 8, (uint32_t) length);
+			put32(header + 12, (uint32_t) length);
+			fwrite(header, 1, sizeof(header), file);
+			fwrite(packet.data(), 1, length, file);
+			t += sizeof(Record) + padded(record.size);
+			writtenCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		tail.store(t, std::memory_order_release);
+	}
+
+	// pcap file header, little-endian, microsecond timestamps.
+	void writeFileHeader()
+	{
+		uint8_t header[24];
+		put32(header, 0xA1B2C3D4u);
+		header[4] = 2;
+		header[5] = 0;
+		header[6] = 4;
+		header[7] = 0;
+		put32(header + 8, 0);
+		put32(header + 12, 0);
+		put32(header + 16, 65535);
+		put32(header + 20, PCAP_LINKTYPE_RAW);
+		fwrite(header, 1, sizeof(header), file);
+	}
+
+	// IP and UDP header from the sender to the loopback address on the Rx port, then the payload.
+	size_t buildPacket(const Record& record, const uint8_t* payload, uint8_t* out) const
+	{
+		bool v6 = record.family == IpEndpointName::IPV6;
+		size_t ipLength = v6 ? 40 : 20;
+		uint16_t udpLength = (uint16_t) (8 + record.size);
+		uint8_t* ip = out;
+		uint8_t* udp = out + ipLength;
+		std::memset(out, 0, ipLength + 8);
+		if (v6)
+		{
+			ip[0] = 0x60;
+			putBE16(ip + 4, udpLength);
+			ip[6] = 17;
+			ip[7] = 64;
+			std::memcpy(ip + 8, record.address, 16);
+			ip[39] = 1;
+		}
+		else
+		{
+			ip[0] = 0x45;
+			putBE16(ip + 2, (uint16_t) (20 + udpLength));
+			ip[8] = 64;
+			ip[9] = 17;
+			std::memcpy(ip + 12, record.address, 4);
+			ip[16] = 127;
+			ip[19] = 1;
+			putBE16(ip + 10, (uint16_t) ~sum16(ip, 20, 0));
+		}
+		putBE16(udp, record.port);
+		putBE16(udp + 2, rxPort);
+		putBE16(udp + 4, udpLength);
+		std::memcpy(udp + 8, payload, record.size);
+		// Checksum over the pseudo header: addresses, protocol and UDP length
+		size_t addressLength = v6 ? 16 : 4;
+		uint32_t sum = sum16(ip + (v6 ? 8 : 12), 2 * addressLength, 17 + (uint32_t) udpLength);
+		uint16_t checksum = (uint16_t) ~sum16(udp, udpLength, sum);
+		putBE16(udp + 6, checksum ? checksum : 0xFFFF);
+		return ipLength + udpLength;
+	}
+
+	// Ones' complement sum, folded to 16 bits.
+	static uint32_t sum16(const uint8_t* p, size_t size, uint32_t sum)
+	{
+		for (size_t i = 0; i + 1 < size; i += 2)
+			sum += (uint32_t) (p[i] << 8 | p[i + 1]);
+		if (size & 1)
+			sum += (uint32_t) p[size - 1] << 8;
+		while (sum >> 16)
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		return sum;
+	}
+
+	static void put32(uint8_t* p, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			p[i] = (uint8_t) (value >> (8 * i));
+	}
+
+	static void putBE16(uint8_t* p, uint16_t value)
+	{
+		p[0] = (uint8_t) (value >> 8);
+		p[1] = (uint8_t) value;
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// A capture file, read only. Mapped on POSIX so a replay sends straight from the page cache, without copying the
+// file first. Read into memory on Windows.
+// The file must not be truncated while it is open: a capture to the same path stops the replay first.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCCaptureFile {
+	OSCCaptureFile() {}
+	OSCCaptureFile(const OSCCaptureFile&) = delete;
+	OSCCaptureFile& operator=(const OSCCaptureFile&) = delete;
+
+	~OSCCaptureFile()
+	{
+		close();
+	}
+
+	bool open(const std::string& path)
+	{
+		close();
+#if defined(_WIN32)
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+		uint8_t chunk[65536];
+		size_t n;
+		while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+			buffer.insert(buffer.end(), chunk, chunk + n);
+		fclose(file);
+		bytes = buffer.data();
+		length = buffer.size();
+		return true;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0)
+		{
+			::close(fd);
+			return false;
+		}
+		length = (size_t) info.st_size;
+		// mmap() refuses empty files, an empty capture is simply not a pcap file
+		if (length > 0)
+		{
+			void* mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped == MAP_FAILED)
+			{
+				::close(fd);
+				length = 0;
+				return false;
+			}
+			// Replays read the file once, front to back
+			madvise(mapped, length, MADV_SEQUENTIAL);
+			bytes = (const uint8_t*) mapped;
+		}
+		// The mapping keeps the file open
+		::close(fd);
+		return true;
+#endif
+	}
+
+	void close()
+	{
+#if defined(_WIN32)
+		std::vector<uint8_t>().swap(buffer);
+#else
+		if (bytes)
+			munmap((void*) bytes, length);
+#endif
+		bytes = NULL;
+		length = 0;
+	}
+
+	const uint8_t* data() const
+	{
+		return bytes;
+	}
+
+	size_t size() const
+	{
+		return length;
+	}
+
+private:
+	const uint8_t* bytes = NULL;
+	size_t length = 0;
+#if defined(_WIN32)
+	std::vector<uint8_t> buffer;
+#endif
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Sends the UDP payloads of a pcap file to a local port from its own thread.
+// Reads our own captures and those of tcpdump or Wireshark (Ethernet, loopback, Linux cooked or raw IP, either
+// byte order, micro or nanosecond timestamps). Every UDP datagram in the file is sent, whatever its ports.
+// At a rate of 1 the original spacing is kept, at N it is divided by N, at 0 packets are sent back to back.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCCaptureReplay {
+	// Datagrams in the file and sent so far, and the time sending took.
+	std::atomic<uint64_t> totalCount;
+	std::atomic<uint64_t> sentCount;
+	std::atomic<uint64_t> elapsedNs;
+
+	OSCCaptureReplay()
+	{
+		playing = false;
+		totalCount = 0;
+		sentCount = 0;
+		elapsedNs = 0;
+	}
+
+	~OSCCaptureReplay()
+	{
+		stop();
+	}
+
+	// UI thread. Sends @path to 127.0.0.1:@port at @rate times the original speed, 0 for as fast as possible.
+	void start(const std::string& path, uint16_t port, float rate)
+	{
+		stop();
+		totalCount = 0;
+		sentCount = 0;
+		elapsedNs = 0;
+		playing = true;
+		thread = std::thread(&OSCCaptureReplay::run, this, path, port, rate);
+	}
+
+	// UI thread.
+	void stop()
+	{
+		playing = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	bool isPlaying() const
+	{
+		return playing.load(std::memory_order_relaxed);
+	}
+
+	double packetsPerSecond() const
+	{
+		uint64_t ns = elapsedNs.load(std::memory_order_relaxed);
+		return ns > 0 ? sentCount.load(std::memory_order_relaxed) * 1e9 / ns : 0.0;
+	}
+
+	// A UDP payload in the file, with its capture time.
+	struct Datagram {
+		uint64_t ns;
+		size_t offset;
+		size_t size;
+	};
+
+	// Collects the UDP payloads of the pcap file in @data, their offsets are into it. False if it isn't a pcap file.
+	static bool parse(const uint8_t* data, size_t size, std::vector<Datagram>& datagrams)
+	{
+		if (size < 24)
+			return false;
+		uint32_t magic = get32(&data[0], false);
+		bool swapped;
+		bool nanoseconds;
+		if (magic == 0xA1B2C3D4u || magic == 0xA1B23C4Du)
+			swapped = false;
+		else if (magic == 0xD4C3B2A1u || magic == 0x4D3CB2A1u)
+			swapped = true;
+		else
+			return false;
+		magic = get32(&data[0], swapped);
+		nanoseconds = magic == 0xA1B23C4Du;
+		uint32_t linkType = get32(&data[20], swapped) & 0xFFFF;
+
+		size_t p = 24;
+		while (p + 16 <= size)
+		{
+			uint64_t seconds = get32(&data[p], swapped);
+			uint64_t fraction = get32(&data[p + 4], swapped);
+			size_t length = get32(&data[p + 8], swapped);
+			p += 16;
+			if (length > size - p)
+				break;
+			Datagram datagram;
+			datagram.ns = seconds * 1000000000ull + (nanoseconds ? fraction : fraction * 1000);
+			if (udpPayload(&data[p], length, linkType, datagram.offset, datagram.size))
+			{
+				datagram.offset += p;
+				datagrams.push_back(datagram);
+			}
+			p += length;
+		}
+		return true;
+	}
+
+private:
+	std::atomic<bool> playing;
+	std::thread thread;
+
+	void run(std::string path, uint16_t port, float rate)
+	{
+		OSCCaptureFile file;
+		std::vector<Datagram> datagrams;
+		if (!file.open(path) || !parse(file.data(), file.size(), datagrams))
+		{
+			WARN("OSCCaptureReplay - Could not read pcap file %s", path.c_str());
+			playing = false;
+			return;
+		}
+		totalCount = datagrams.size();
+		try
+		{
+			UdpTransmitSocket socket(IpEndpointName("127.0.0.1", port));
+			uint64_t startNs = PacketClockNow();
+			for (size_t i = 0; i < datagrams.size() && playing; i++)
+			{
+				if (rate > 0.f && i > 0)
+				{
+					uint64_t offsetNs = (uint64_t) ((datagrams[i].ns - std::min(datagrams[i].ns, datagrams[0].ns)) / rate);
+					// Sleep in short steps so stop() doesn't wait out a long gap
+					uint64_t now;
+					while (playing && (now = PacketClockNow()) < startNs + offsetNs)
+						std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<uint64_t>(startNs + offsetNs - now, 10000000)));
+				}
+				socket.Send((const char*) file.data() + datagrams[i].offset, datagrams[i].size);
+				sentCount.store(i + 1, std::memory_order_relaxed);
+				elapsedNs.store(PacketClockNow() - startNs, std::memory_order_relaxed);
+			}
+		}
+		catch (const std::exception& ex)
+		{
+			WARN("OSCCaptureReplay - Replay to port %d failed: %s", port, ex.what());
+		}
+		INFO("OSCCaptureReplay - Sent %llu of %llu datagrams to port %d, %.0f packets/s", (unsigned long long) sentCount.load(),
+			(unsigned long long) totalCount.load(), port, packetsPerSecond());
+		playing = false;
+	}
+
+	// Offset and size of the UDP payload in a captured frame. False for anything but unfragmented UDP over IP.
+	static bool udpPayload(const uint8_t* frame, size_t length, uint32_t linkType, size_t& offset, size_t& size)
+	{
+		size_t ip;
+		switch (linkType)
+		{
+			case PCAP_LINKTYPE_ETHERNET:
+			{
+				ip = 14;
+				if (length < ip)
+					return false;
+				uint16_t etherType = getBE16(frame + 12);
+				// 802.1Q tag
+				if (etherType == 0x8100 && length >= 18)
+				{
+					etherType = getBE16(frame + 16);
+					ip = 18;
+				}
+				if (etherType != 0x0800 && etherType != 0x86DD)
+					return false;
+				break;
+			}
+			case PCAP_LINKTYPE_NULL:
+			case PCAP_LINKTYPE_LOOP:
+				ip = 4;
+				break;
+			case PCAP_LINKTYPE_LINUX_SLL:
+				ip = 16;
+				break;
+			case PCAP_LINKTYPE_LINUX_SLL2:
+				ip = 20;
+				break;
+			case PCAP_LINKTYPE_RAW:
+			case PCAP_LINKTYPE_IPV4:
+			case PCAP_LINKTYPE_IPV6:
+				ip = 0;
+				break;
+			default:
+				return false;
+		}
+		if (length < ip + 1)
+			return false;
+		const uint8_t* p = frame + ip;
+		size_t remaining = length - ip;
+		size_t udp;
+		if ((p[0] >> 4) == 4)
+		{
+			udp = (p[0] & 0x0F) * 4;
+			// Not UDP, or a fragment: only the first one has the UDP header and the rest of the payload is elsewhere
+			if (remaining < 20 || udp < 20 || p[9] != 17 || (getBE16(p + 6) & 0x3FFF) != 0)
+				return false;
+		}
+		else if ((p[0] >> 4) == 6)
+		{
+			udp = 40;
+			if (remaining < 40 || p[6] != 17)
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+		if (remaining < udp + 8)
+			return false;
+		size_t udpLength = getBE16(p + udp + 4);
+		if (udpLength < 8)
+			return false;
+		offset = ip + udp + 8;
+		size = std::min(udpLength - 8, remaining - udp - 8);
+		return true;
+	}
+
+	static uint32_t get32(const uint8_t* p, bool swapped)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (uint32_t) p[i] << (swapped ? 24 - 8 * i : 8 * i);
+		return value;
+	}
+
+	static uint16_t getBE16(const uint8_t* p)
+	{
+		return (uint16_t) (p[0] << 8 | p[1]);
+	}
+};
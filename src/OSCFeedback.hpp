@@ -0,0 +1,325 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include "../lib/oscpack/osc/OscPacketBuilder.h"
+#include "../lib/oscpack/ip/UdpSocket.h"
+
+// Largest UDP payload that fits a 1500 byte Ethernet MTU without fragmenting.
+#define OSC_FEEDBACK_MTU			1472
+// Slots one feedback source can report.
+#define OSC_FEEDBACK_SLOTS			256
+// How often the sender thread looks for dirty sources (ms).
+#define OSC_FEEDBACK_TICK_MS		5
+// Upper bound of datagrams one source may send per flush. Anything left waits for the next flush.
+#define OSC_FEEDBACK_MAX_PACKETS	4
+// Default feedback rate (Hz). 0 disables feedback.
+#define OSC_FEEDBACK_RATE_DEF		30
+// Packet buffers shared by all sources.
+#define OSC_FEEDBACK_POOL_SIZE		(OSC_FEEDBACK_MAX_PACKETS + 1)
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Feedback source owned by one module.
+// The engine thread only stores values and sets dirty bits. The sender thread picks them up,
+// packs them into MTU sized bundles from the sender's packet pool and sends them. The UI thread changes the
+// addresses and the target, the sender only holds the lock to pack and to copy the target, never to resolve or send.
+// Message headers are encoded once per address, a flush only writes the float of each message.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCFeedbackSource : osc::PacketSink {
+	// Latest value of each slot, in the range of its controller.
+	std::atomic<float> values[OSC_FEEDBACK_SLOTS];
+	// One bit per slot with a value that has not been sent yet.
+	std::atomic<uint64_t> dirty[OSC_FEEDBACK_SLOTS / 64];
+	// Minimum time between two flushes (ms). 0 disables sending.
+	std::atomic<int> periodMs;
+
+	OSCFeedbackSource()
+	{
+		for (int i = 0; i < OSC_FEEDBACK_SLOTS; i++)
+			values[i] = 0.f;
+		for (int i = 0; i < OSC_FEEDBACK_SLOTS / 64; i++)
+			dirty[i] = 0;
+		periodMs = 0;
+	}
+	~OSCFeedbackSource()
+	{
+		delete txSocket;
+	}
+
+	// Engine thread. Lock-free.
+	void markChanged(int slot, float value)
+	{
+		values[slot].store(value, std::memory_order_relaxed);
+		dirty[slot / 64].fetch_or((uint64_t)1 << (slot % 64), std::memory_order_release);
+	}
+
+	void setRate(int rateHz)
+	{
+		periodMs = (rateHz > 0) ? std::max(1, 1000 / rateHz) : 0;
+	}
+
+	// Address sent for each slot. Empty addresses, and addresses too long for one packet, are skipped.
+	void setAddresses(const std::vector<std::string>& slotAddresses)
+	{
+		std::vector<osc::MessageHeader> fresh(OSC_FEEDBACK_SLOTS);
+		for (int slot = 0; slot < OSC_FEEDBACK_SLOTS && slot < (int)slotAddresses.size(); slot++)
+		{
+			if (slotAddresses[slot].empty())
+				continue;
+			fresh[slot].Set(slotAddresses[slot].c_str(), "f");
+			// Bundle header and element size.
+			if (16 + 4 + fresh[slot].MessageSize() > OSC_FEEDBACK_MTU)
+				fresh[slot].Clear();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		headers.swap(fresh);
+	}
+
+	// The socket is (re)created lazily by the sender thread, so name lookups never run on the engine thread.
+	void setTarget(const std::string& ipAddress, uint16_t port)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (ipAddress != txIpAddress || port != txPort)
+		{
+			txIpAddress = ipAddress;
+			txPort = port;
+			targetChanged = true;
+		}
+	}
+
+	// Sender thread.
+	void flush(double nowMs, osc::PacketPool& pool)
+	{
+		int period = periodMs.load();
+		if (period <= 0 || nowMs < nextFlushMs)
+			return;
+
+		uint64_t pending[OSC_FEEDBACK_SLOTS / 64];
+		bool any = false;
+		for (int i = 0; i < OSC_FEEDBACK_SLOTS / 64; i++)
+		{
+			pending[i] = dirty[i].exchange(0, std::memory_order_acquire);
+			any |= (pending[i] != 0);
+		}
+		if (!any)
+			return;
+		nextFlushMs = nowMs + period;
+
+		std::string ipAddress;
+		uint16_t port = 0;
+		bool retarget = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (targetChanged)
+			{
+				ipAddress = txIpAddress;
+				port = txPort;
+				targetChanged = false;
+				retarget = true;
+			}
+			pack(pending, pool);
+		}
+
+		if (retarget)
+			openSocket(ipAddress, port);
+		for (int i = 0; i < packedCount; i++)
+		{
+			if (txSocket != NULL)
+				send(packed[i], packedSizes[i]);
+			pool.Release(packed[i]);
+		}
+		packedCount = 0;
+
+		// Rate limited: hand unsent slots back for the next flush.
+		for (int i = 0; i < OSC_FEEDBACK_SLOTS / 64; i++)
+		{
+			if (pending[i])
+				dirty[i].fetch_or(pending[i], std::memory_order_relaxed);
+		}
+	}
+
+private:
+	// Guards the addresses and the target.
+	std::mutex mutex;
+	std::vector<osc::MessageHeader> headers = std::vector<osc::MessageHeader>(OSC_FEEDBACK_SLOTS);
+	std::string txIpAddress;
+	uint16_t txPort = 0;
+	bool targetChanged = false;
+
+	// Sender thread only.
+	UdpTransmitSocket* txSocket = NULL;
+	double nextFlushMs = 0;
+	// Bundles packed under the lock, sent after it is released.
+	char* packed[OSC_FEEDBACK_MAX_PACKETS];
+	std::size_t packedSizes[OSC_FEEDBACK_MAX_PACKETS];
+	int packedCount = 0;
+
+	// Packs the values of @pending slots and clears their bits. Must hold mutex.
+	void pack(uint64_t* pending, osc::PacketPool& pool)
+	{
+		osc::BundleBuilder bundle(pool, *this);
+		for (int slot = 0; slot < OSC_FEEDBACK_SLOTS; slot++)
+		{
+			uint64_t bit = (uint64_t)1 << (slot % 64);
+			if (!(pending[slot / 64] & bit))
+				continue;
+			const osc::MessageHeader& header = headers[slot];
+			if (header.IsEmpty())
+			{
+				pending[slot / 64] &= ~bit;
+				continue;
+			}
+			if (bundle.AddWouldSplit(header) && bundle.PacketsSent() + 1 >= OSC_FEEDBACK_MAX_PACKETS)
+				break;
+			char* args = bundle.AddMessage(header);
+			if (args == NULL)
+				break; // Pool exhausted
+			osc::WriteFloat(args, values[slot].load(std::memory_order_relaxed));
+			pending[slot / 64] &= ~bit;
+		}
+		bundle.Flush();
+	}
+
+	// Resolves the address, which may hit DNS.
+	void openSocket(const std::string& ipAddress, uint16_t port)
+	{
+		delete txSocket;
+		txSocket = NULL;
+		try
+		{
+			txSocket = new UdpTransmitSocket(IpEndpointName(ipAddress.c_str(), port));
+		}
+		catch (const std::exception& ex)
+		{
+			DEBUG("OSCFeedbackSource::openSocket(%s:%d) - Exception caught:\n%s", ipAddress.c_str(), port, ex.what());
+		}
+	}
+
+	void send(const char* data, std::size_t size)
+	{
+		try
+		{
+			txSocket->Send(data, size);
+		}
+		catch (const std::exception& ex)
+		{
+			DEBUG("OSCFeedbackSource::send() - Exception caught:\n%s", ex.what());
+		}
+	}
+
+	// Called by the bundle builder with mutex held. Keeps the buffer, flush() sends and releases it.
+	bool SendPacket(char* data, std::size_t size) override
+	{
+		packed[packedCount] = data;
+		packedSizes[packedCount] = size;
+		packedCount++;
+		return true;
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// OSC feedback sender.
+// One thread flushes every registered source. It runs while at least one source is registered, sources are
+// added and removed by the UI thread. The list is copied under _mutex and flushed without it.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+class OSCFeedbackSender
+{
+private:
+	OSCFeedbackSender()
+	{
+		return;
+	}
+	static OSCFeedbackSender* _instance;
+	std::vector<OSCFeedbackSource*> _sources;
+	// Serializes starting and stopping the thread.
+	std::mutex _lifecycleMutex;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _senderThread;
+	bool _quit = false;
+	// True while the sender thread flushes the sources copied to _flushing, without _mutex.
+	bool _flushBusy = false;
+	std::condition_variable _flushDone;
+	// Only used by the sender thread.
+	std::vector<OSCFeedbackSource*> _flushing;
+	osc::PacketPool _pool{OSC_FEEDBACK_POOL_SIZE, OSC_FEEDBACK_MTU};
+
+	void senderLoop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while (!_quit)
+		{
+			double nowMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			_flushing.assign(_sources.begin(), _sources.end());
+			_flushBusy = true;
+			lock.unlock();
+			for (OSCFeedbackSource* source : _flushing)
+				source->flush(nowMs, _pool);
+			lock.lock();
+			_flushBusy = false;
+			_flushDone.notify_all();
+			_cv.wait_for(lock, std::chrono::milliseconds(OSC_FEEDBACK_TICK_MS));
+		}
+	}
+
+public:
+	static OSCFeedbackSender* Sender()
+	{
+		if (!OSCFeedbackSender::_instance)
+			OSCFeedbackSender::_instance = new OSCFeedbackSender();
+		return _instance;
+	}
+
+	void addSource(OSCFeedbackSource* source)
+	{
+		std::lock_guard<std::mutex> lifecycle(_lifecycleMutex);
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (std::find(_sources.begin(), _sources.end(), source) != _sources.end())
+			return;
+		_sources.push_back(source);
+		if (!_senderThread.joinable())
+		{
+			DEBUG("OSCFeedbackSender::addSource() - Starting OSC feedback thread.");
+			_quit = false;
+			_senderThread = std::thread(&OSCFeedbackSender::senderLoop, this);
+		}
+	}
+
+	// Once this returns the sender thread no longer touches the source.
+	void removeSource(OSCFeedbackSource* source)
+	{
+		std::lock_guard<std::mutex> lifecycle(_lifecycleMutex);
+		std::unique_lock<std::mutex> lock(_mutex);
+		std::vector<OSCFeedbackSource*>::iterator it = std::find(_sources.begin(), _sources.end(), source);
+		if (it == _sources.end())
+			return;
+		_sources.erase(it);
+		// The flush in progress may still hold the source
+		_flushDone.wait(lock, [this] { return !_flushBusy; });
+		if (_sources.empty() && _senderThread.joinable())
+		{
+			DEBUG("OSCFeedbackSender::removeSource() - No more sources, stopping OSC feedback thread.");
+			_quit = true;
+			_cv.notify_all();
+			lock.unlock();
+			_senderThread.join();
+		}
+	}
+
+	static void AddSource(OSCFeedbackSource* source)
+	{
+		Sender()->addSource(source);
+	}
+	static void RemoveSource(OSCFeedbackSource* source)
+	{
+		Sender()->removeSource(source);
+	}
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include "../lib/oscpack/ip/PacketListener.h"
+
+// Linear sub buckets per power of two (2^n), about 6% resolution.
+#define OSC_LATENCY_SUB_BITS		4
+// Latencies of 2^OSC_LATENCY_MAX_BITS ns (~17 s) and more land in the last bucket.
+#define OSC_LATENCY_MAX_BITS		34
+#define OSC_LATENCY_BUCKETS			((OSC_LATENCY_MAX_BITS - OSC_LATENCY_SUB_BITS + 1) << OSC_LATENCY_SUB_BITS)
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Log-linear (HDR style) latency histogram in nanoseconds.
+// Recording is a couple of relaxed atomic adds, so any thread may record while another reads percentiles.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCLatencyHistogram {
+	OSCLatencyHistogram()
+	{
+		reset();
+	}
+
+	void record(uint64_t ns)
+	{
+		counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+		uint64_t max = maxNs.load(std::memory_order_relaxed);
+		while (ns > max && !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+			;
+	}
+
+	void reset()
+	{
+		for (int i = 0; i < OSC_LATENCY_BUCKETS; i++)
+			counts[i] = 0;
+		count = 0;
+		maxNs = 0;
+	}
+
+	uint64_t samples() const
+	{
+		return count.load(std::memory_order_relaxed);
+	}
+
+	// Upper bound (ns) of the bucket holding quantile @q (0-1). 0 when empty.
+	uint64_t percentile(double q) const
+	{
+		uint64_t total = 0;
+		for (int i = 0; i < OSC_LATENCY_BUCKETS; i++)
+			total += counts[i].load(std::memory_order_relaxed);
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t) (q * total);
+		if (rank >= total)
+			rank = total - 1;
+		uint64_t seen = 0;
+		for (int i = 0; i < OSC_LATENCY_BUCKETS; i++)
+		{
+			seen += counts[i].load(std::memory_order_relaxed);
+			if (seen > rank)
+				return std::min(upperBoundOf(i), maxNs.load(std::memory_order_relaxed));
+		}
+		return maxNs.load(std::memory_order_relaxed);
+	}
+
+	// Sample count, p50, p99, p99.9 and max in microseconds.
+	json_t* toJson() const
+	{
+		json_t* histJ = json_object();
+		json_object_set_new(histJ, "count", json_integer(samples()));
+		json_object_set_new(histJ, "p50Us", json_real(percentile(0.5) / 1000.0));
+		json_object_set_new(histJ, "p99Us", json_real(percentile(0.99) / 1000.0));
+		json_object_set_new(histJ, "p999Us", json_real(percentile(0.999) / 1000.0));
+		json_object_set_new(histJ, "maxUs", json_real(maxNs.load() / 1000.0));
+		return histJ;
+	}
+
+private:
+	std::atomic<uint32_t> counts[OSC_LATENCY_BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> maxNs;
+
+	static int bucketOf(uint64_t ns)
+	{
+		if (ns < (1 << OSC_LATENCY_SUB_BITS))
+			return (int) ns;
+		if (ns >> OSC_LATENCY_MAX_BITS)
+			return OSC_LATENCY_BUCKETS - 1;
+		int msb = 63 - __builtin_clzll(ns);
+		return ((msb - OSC_LATENCY_SUB_BITS + 1) << OSC_LATENCY_SUB_BITS)
+			| (int) ((ns >> (msb - OSC_LATENCY_SUB_BITS)) & ((1 << OSC_LATENCY_SUB_BITS) - 1));
+	}
+
+	static uint64_t upperBoundOf(int bucket)
+	{
+		if (bucket < (1 << OSC_LATENCY_SUB_BITS))
+			return (uint64_t) bucket;
+		int shift = (bucket >> OSC_LATENCY_SUB_BITS) - 1;
+		uint64_t lower = (uint64_t) ((1 << OSC_LATENCY_SUB_BITS) | (bucket & ((1 << OSC_LATENCY_SUB_BITS) - 1))) << shift;
+		return lower + ((uint64_t) 1 << shift) - 1;
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Latency of the OSC -> param path of one module, i.e. of the port it listens on.
+// receive: datagram read from the socket, dispatch: message routed to the module, apply: param written.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCLatencyStats {
+	OSCLatencyHistogram receiveToDispatch;
+	OSCLatencyHistogram dispatchToApply;
+	OSCLatencyHistogram receiveToApply;
+
+	void reset()
+	{
+		receiveToDispatch.reset();
+		dispatchToApply.reset();
+		receiveToApply.reset();
+	}
+
+	json_t* toJson(int port) const
+	{
+		json_t* statsJ = json_object();
+		json_object_set_new(statsJ, "port", json_integer(port));
+		json_object_set_new(statsJ, "receiveToDispatch", receiveToDispatch.toJson());
+		json_object_set_new(statsJ, "dispatchToApply", dispatchToApply.toJson());
+		json_object_set_new(statsJ, "receiveToApply", receiveToApply.toJson());
+		return statsJ;
+	}
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Slots one coalescer holds.
+#define OSC_RX_SLOTS			256
+// Events queued in all events mode. Must be a power of two.
+#define OSC_RX_EVENT_QUEUE		256
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Receive side coalescing for one module.
+// The receiving thread posts every incoming value, the engine thread drains them once per block.
+// By default only the newest value of each slot survives until the engine reads it, so a burst costs the
+// listener constant work per message and never builds a backlog.
+// In all events mode values are queued and the engine takes the whole queue each block, in order, so short events
+// such as a press and release in the same packet are both seen. When the queue is full it falls back to coalescing.
+// One receiving thread and one engine thread per coalescer.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCRxCoalescer {
+	// Queue every event instead of keeping only the newest value per slot.
+	std::atomic<bool> allEvents;
+	// Values posted by the receiving thread.
+	std::atomic<uint64_t> receivedCount;
+	// Values handed to the engine.
+	std::atomic<uint64_t> appliedCount;
+	// Events coalesced in all events mode because the queue was full.
+	std::atomic<uint64_t> overflowCount;
+
+	OSCRxCoalescer()
+	{
+		allEvents = false;
+		receivedCount = 0;
+		appliedCount = 0;
+		overflowCount = 0;
+		for (int i = 0; i < OSC_RX_SLOTS; i++)
+		{
+			latest[i] = 0;
+			latestReceivedNs[i] = 0;
+			latestDispatchedNs[i] = 0;
+		}
+		for (int i = 0; i < OSC_RX_SLOTS / 64; i++)
+			dirty[i] = 0;
+		queueHead = 0;
+		queueTail = 0;
+	}
+
+	// Receiving thread. Lock-free.
+	// @receivedNs and @dispatchedNs are PacketClockNow() times, carried along for latency stats.
+	void post(int slot, double value, uint64_t receivedNs, uint64_t dispatchedNs)
+	{
+		receivedCount.fetch_add(1, std::memory_order_relaxed);
+		if (allEvents.load(std::memory_order_relaxed))
+		{
+			uint32_t head = queueHead.load(std::memory_order_relaxed);
+			uint32_t tail = queueTail.load(std::memory_order_acquire);
+			// After spilling, keep coalescing until the engine has taken the queue and the coalesced values,
+			// otherwise an older spilled value could be applied after a newer queued event.
+			if (spilled && head == tail && !anyDirty())
+				spilled = false;
+			if (!spilled && head - tail < OSC_RX_EVENT_QUEUE)
+			{
+				events[head & (OSC_RX_EVENT_QUEUE - 1)] = Event { (uint16_t) slot, value, receivedNs, dispatchedNs };
+				queueHead.store(head + 1, std::memory_order_release);
+				return;
+			}
+			overflowCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		spilled = true;
+		latest[slot].store(value, std::memory_order_relaxed);
+		latestReceivedNs[slot].store(receivedNs, std::memory_order_relaxed);
+		latestDispatchedNs[slot].store(dispatchedNs, std::memory_order_relaxed);
+		dirty[slot / 64].fetch_or((uint64_t)1 << (slot % 64), std::memory_order_release);
+	}
+
+	// Engine thread. Calls @apply(slot, value, receivedNs, dispatchedNs) for each value received since the last call.
+	// Queued events go first, all of them in order, so coalesced values (always newer) land last.
+	template <typename F>
+	void drain(F apply)
+	{
+		uint32_t tail = queueTail.load(std::memory_order_relaxed);
+		uint32_t head = queueHead.load(std::memory_order_acquire);
+		for (; tail != head; tail++)
+		{
+			const Event& event = events[tail & (OSC_RX_EVENT_QUEUE - 1)];
+			appliedCount.fetch_add(1, std::memory_order_relaxed);
+			apply(event.slot, event.value, event.receivedNs, event.dispatchedNs);
+		}
+		// Only now the receiving thread may reuse the entries
+		queueTail.store(tail, std::memory_order_release);
+		for (int i = 0; i < OSC_RX_SLOTS / 64; i++)
+		{
+			// Plain load first, the exchange is only paid when something arrived.
+			if (dirty[i].load(std::memory_order_relaxed) == 0)
+				continue;
+			uint64_t pending = dirty[i].exchange(0, std::memory_order_acquire);
+			while (pending)
+			{
+				int bit = 0;
+				while (!(pending & ((uint64_t)1 << bit)))
+					bit++;
+				pending &= ~((uint64_t)1 << bit);
+				int slot = i * 64 + bit;
+				appliedCount.fetch_add(1, std::memory_order_relaxed);
+				apply(slot, latest[slot].load(std::memory_order_relaxed),
+					latestReceivedNs[slot].load(std::memory_order_relaxed), latestDispatchedNs[slot].load(std::memory_order_relaxed));
+			}
+		}
+	}
+
+	// Messages received per value applied. 1 when nothing was coalesced.
+	float coalesceRatio() const
+	{
+		uint64_t applied = appliedCount.load();
+		return (applied > 0) ? (float) receivedCount.load() / applied : 1.f;
+	}
+
+private:
+	struct Event {
+		uint16_t slot;
+		double value;
+		uint64_t receivedNs;
+		uint64_t dispatchedNs;
+	};
+
+	std::atomic<double> latest[OSC_RX_SLOTS];
+	std::atomic<uint64_t> latestReceivedNs[OSC_RX_SLOTS];
+	std::atomic<uint64_t> latestDispatchedNs[OSC_RX_SLOTS];
+	std::atomic<uint64_t> dirty[OSC_RX_SLOTS / 64];
+	Event events[OSC_RX_EVENT_QUEUE];
+	// Written by the receiving thread only.
+	std::atomic<uint32_t> queueHead;
+	// Written by the engine thread only.
+	std::atomic<uint32_t> queueTail;
+	// Receiving thread only. Set once a value went to the coalesced slots (queue full or coalescing mode).
+	bool spilled = false;
+
+	bool anyDirty() const
+	{
+		for (int i = 0; i < OSC_RX_SLOTS / 64; i++)
+		{
+			if (dirty[i].load(std::memory_order_acquire))
+				return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// State of type <S> that one writer thread rebuilds and one reader thread uses, the way the router publishes its
+// route table: the writer swaps in a fresh snapshot and frees the old one once the reader has left it, the reader
+// never waits and never sees a snapshot being written.
+// One writer (not real-time, publish() allocates and yields) and one reader thread.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+template <typename S>
+struct OSCSnapshot {
+	OSCSnapshot()
+	{
+		current = new S();
+		readerSeq = 0;
+	}
+
+	~OSCSnapshot()
+	{
+		delete current.load();
+	}
+
+	// Writer thread. Takes ownership of @fresh.
+	void publish(S* fresh)
+	{
+		S* old = current.exchange(fresh);
+		uint32_t seq = readerSeq.load();
+		if (seq & 1)
+		{
+			// Reader is inside a snapshot, possibly the old one. Wait for it to leave.
+			while (readerSeq.load() == seq)
+				std::this_thread::yield();
+		}
+		delete old;
+	}
+
+	// Reader thread only. Pair with endRead().
+	const S* beginRead()
+	{
+		readerSeq.fetch_add(1);
+		return current.load();
+	}
+
+	void endRead()
+	{
+		readerSeq.fetch_add(1);
+	}
+
+private:
+	std::atomic<S*> current;
+	// Odd while the reader is inside a snapshot.
+	std::atomic<uint32_t> readerSeq;
+};
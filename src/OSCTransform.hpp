@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Response curve of a mapped slot.
+enum OSCCurve {
+	OSC_CURVE_LINEAR,
+	// Finer control at the bottom of the range
+	OSC_CURVE_EXP,
+	// Finer control at the top of the range
+	OSC_CURVE_LOG,
+	// Finer control at both ends
+	OSC_CURVE_S,
+	NUM_OSC_CURVES
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Range and curve of one mapped slot.
+// apply() turns the raw value a controller sends into the normalized (0-1) param value,
+// invert() turns a param value back into the controller's range for feedback.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct OSCSlotTransform {
+	// Raw values for the bottom and the top of the param. min > max inverts the mapping.
+	double min = 0.0;
+	double max = 1.0;
+	int curve = OSC_CURVE_LINEAR;
+
+	double apply(double raw) const
+	{
+		double n = (max != min) ? (raw - min) / (max - min) : 0.0;
+		// Also catches NaN
+		if (!(n > 0.0))
+			n = 0.0;
+		else if (n > 1.0)
+			n = 1.0;
+		switch (curve)
+		{
+		case OSC_CURVE_EXP:
+			return n * n;
+		case OSC_CURVE_LOG:
+			return std::sqrt(n);
+		case OSC_CURVE_S:
+			return n * n * (3.0 - 2.0 * n);
+		default:
+			return n;
+		}
+	}
+
+	double invert(double value) const
+	{
+		double n = std::min(std::max(value, 0.0), 1.0);
+		switch (curve)
+		{
+		case OSC_CURVE_EXP:
+			n = std::sqrt(n);
+			break;
+		case OSC_CURVE_LOG:
+			n = n * n;
+			break;
+		case OSC_CURVE_S:
+			n = 0.5 - std::sin(std::asin(1.0 - 2.0 * n) / 3.0);
+			break;
+		default:
+			break;
+		}
+		return min + n * (max - min);
+	}
+};
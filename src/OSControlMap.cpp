@@ -3,6 +3,8 @@
 #include "OSCBaseListener.hpp"
 #include <ui/TextField.hpp>
 
+OSCFeedbackSender* OSCFeedbackSender::_instance = NULL;
+
 OSControlMap::OSControlMap() {
 	config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 	configParam(ACTIVE_PARAM, 0.f, 1.f, 0.f, "");
@@ -12,12 +14,15 @@ OSControlMap::OSControlMap() {
 		paramHandles[id].color = nvgRGB(0xff, 0xff, 0x40);
 		APP->engine->addParamHandle(&paramHandles[id]);
 	}
+	divider.setDivision(OSC_SLEW_DIVISION);
 	onReset();
 	oscStarted = false;
+	setFeedbackRate(feedbackRate);
 
 }
 
 OSControlMap::~OSControlMap() {
+	cleanupOSC();
 	for (int id = 0; id < MAX_CHANNELS; id++) {
 		APP->engine->removeParamHandle(&paramHandles[id]);
 	}
@@ -29,41 +34,223 @@ void OSControlMap::onReset() {
 	learnedParam = false;
 	clearMaps();
 	mapLen = 1;
-	for (int i = 0; i < 128; i++) {
-		values[i] = -1;
+	for (int id = 0; id < MAX_CHANNELS; id++) {
+		values[id] = -1.0;
+		transforms[id] = OSCSlotTransform();
+		lastWritten[id] = -1.f;
+		lastReported[id] = -1.f;
+		slewValues[id] = slewTargets[id] = -1.f;
 	}
 	cleanupOSC(); // Try to clean up OSC if we already have something		
 }
 
 void OSControlMap::UpdateValuesFromMap(const ProcessArgs& args){
+	// Params are only updated at block rate
+	if (!divider.process())
+		return;
+	float deltaTime = args.sampleTime * divider.getDivision();
+	TRACE_SCOPE("OSC apply");
+	const OSCSlotState* state = slotState.beginRead();
+
+	// Take what the OSC thread received since the last block
+	bool allEvents = rxCoalescer.allEvents.load(std::memory_order_relaxed);
+	rxCoalescer.drain([this, allEvents, state](int id, double raw, uint64_t receivedNs, uint64_t dispatchedNs) {
+		values[id] = state->transforms[id].apply(raw);
+		if (receivedNs) {
+			pendingReceivedNs[id] = receivedNs;
+			pendingDispatchedNs[id] = dispatchedNs;
+			latencyPending = true;
+		}
+		// Events skip the slew and are written as they come, so every one of them reaches the param
+		if (allEvents && id < state->mapLen && state->mapped[id]) {
+			slewTargets[id] = slewValues[id] = (float) values[id];
+			writeParam(id, slewValues[id]);
+			pendingReceivedNs[id] = 0;
+		}
+	});
 
-	// Step channels
-	for (int id = 0; id < mapLen; id++) {
-		int cc = ccs[id];
-		if (cc < 0)
+	// Pack the target of each channel. Channels without a value keep target == value == last write, so they never write.
+	for (int id = 0; id < state->mapLen; id++) {
+		if (!state->mapped[id] || values[id] < 0.0) {
+			slewTargets[id] = slewValues[id] = lastWritten[id];
 			continue;
-		// Check if CC value has been set
-		if (values[cc] < 0)
+		}
+		slewTargets[id] = (float) values[id];
+		// Jump on the first value
+		if (slewValues[id] < 0.f)
+			slewValues[id] = slewTargets[id];
+	}
+
+	// Slew 4 channels at a time, then write only the ones that moved
+	simd::float_4 k = clamp(OSC_SLEW_LAMBDA * deltaTime, 0.f, 1.f);
+	simd::float_4 snap = OSC_SLEW_SNAP;
+	for (int id = 0; id < state->mapLen; id += 4) {
+		simd::float_4 target = simd::float_4::load(&slewTargets[id]);
+		simd::float_4 value = simd::float_4::load(&slewValues[id]);
+		simd::float_4 delta = target - value;
+		value = simd::ifelse(simd::fabs(delta) < snap, target, value + delta * k);
+		value.store(&slewValues[id]);
+		int moved = simd::movemask(value != simd::float_4::load(&lastWritten[id]));
+		for (int lane = 0; moved; lane++, moved >>= 1) {
+			if ((moved & 1) && id + lane < state->mapLen)
+				writeParam(id + lane, slewValues[id + lane]);
+		}
+	}
+
+	slotState.endRead();
+
+	// Values that didn't move a param have nothing to measure
+	if (latencyPending) {
+		for (int id = 0; id < MAX_CHANNELS; id++)
+			pendingReceivedNs[id] = 0;
+		latencyPending = false;
+	}
+}
+
+void OSControlMap::writeParam(int id, float v) {
+	// Remember the write even when there is no param so it isn't retried every block
+	lastWritten[id] = v;
+	// Get Module
+	Module* module = paramHandles[id].module;
+	if (!module)
+		return;
+	// Get ParamQuantity
+	int paramId = paramHandles[id].paramId;
+	ParamQuantity* paramQuantity = module->paramQuantities[paramId];
+	if (!paramQuantity)
+		return;
+	if (!paramQuantity->isBounded())
+		return;
+	paramQuantity->setScaledValue(v);
+	// Don't echo our own writes back to the controller
+	lastReported[id] = paramQuantity->getScaledValue();
+	// First write after a value arrived closes its latency measurement
+	if (pendingReceivedNs[id]) {
+		uint64_t appliedNs = PacketClockNow();
+		latency.dispatchToApply.record(appliedNs - pendingDispatchedNs[id]);
+		latency.receiveToApply.record(appliedNs - pendingReceivedNs[id]);
+	}
+}
+
+void OSControlMap::ScanFeedback() {
+	const OSCSlotState* state = slotState.beginRead();
+	for (int id = 0; id < state->mapLen; id++) {
+		if (!state->mapped[id])
 			continue;
-		// Get Module
 		Module* module = paramHandles[id].module;
 		if (!module)
 			continue;
-		// Get ParamQuantity
-		int paramId = paramHandles[id].paramId;
-		ParamQuantity* paramQuantity = module->paramQuantities[paramId];
+		ParamQuantity* paramQuantity = module->paramQuantities[paramHandles[id].paramId];
 		if (!paramQuantity)
 			continue;
 		if (!paramQuantity->isBounded())
 			continue;
-		// Set ParamQuantity
-		float v = rescale(values[cc], 0, 127, 0.f, 1.f);
-		v = valueFilters[id].process(args.sampleTime, v);
-		paramQuantity->setScaledValue(v);
+		float v = paramQuantity->getScaledValue();
+		if (v == lastReported[id])
+			continue;
+		lastReported[id] = v;
+		feedback.markChanged(id, (float) state->transforms[id].invert(v));
+	}
+	slotState.endRead();
+}
+
+void OSControlMap::setFeedbackRate(int rateHz) {
+	feedbackRate = rateHz;
+	feedback.setRate(rateHz);
+	onSampleRateChange();
+}
+
+void OSControlMap::setOscTransport(int transport) {
+	oscTransport = transport;
+	// Reopen the listener on the new transport
+	if (oscInitialized)
+		oscCurrentAction = OSCAction::Enable;
+}
+
+void OSControlMap::setOscSharePort(bool sharePort) {
+	oscSharePort = sharePort;
+	if (oscInitialized)
+		oscCurrentAction = OSCAction::Enable;
+}
+
+void OSControlMap::setOscMulticastGroup(const std::string& group) {
+	oscMulticastGroup = group;
+	if (oscInitialized)
+		oscCurrentAction = OSCAction::Enable;
+}
+
+void OSControlMap::setAllEvents(bool allEvents) {
+	rxCoalescer.allEvents = allEvents;
+}
+
+void OSControlMap::setTransform(int id, const OSCSlotTransform& transform) {
+	transforms[id] = transform;
+	// process() takes the new range with the next published slot state
+	oscRoutesDirty = true;
+	// Resend the param in the new range
+	lastReported[id] = -1.f;
+}
+
+void OSControlMap::saveLatencyReport() {
+	json_t* rootJ = latency.toJson(currentOSCSettings.oscRxPort);
+	json_object_set_new(rootJ, "coalesceRatio", json_real(rxCoalescer.coalesceRatio()));
+	std::string path = asset::user("PushMapVCV-OSCLatency.json");
+	if (json_dump_file(rootJ, path.c_str(), JSON_INDENT(2)) == 0)
+		INFO("OSControlMap - Saved OSC latency report to %s", path.c_str());
+	else
+		WARN("OSControlMap - Could not write OSC latency report to %s", path.c_str());
+	json_decref(rootJ);
+}
+
+std::string OSControlMap::oscCapturePath() {
+	return asset::user("PushMapVCV-OSCCapture.pcap");
+}
+
+void OSControlMap::startOscCapture() {
+	// The replay maps the file the capture is about to truncate
+	oscReplay.stop();
+	std::string path = oscCapturePath();
+	if (oscCapture.start(path, currentOSCSettings.oscRxPort))
+		INFO("OSControlMap - Capturing OSC on port %d to %s", currentOSCSettings.oscRxPort, path.c_str());
+	else
+		WARN("OSControlMap - Could not start OSC capture to %s", path.c_str());
+}
+
+void OSControlMap::stopOscCapture() {
+	oscCapture.stop();
+	INFO("OSControlMap - Captured %llu OSC datagrams (%llu dropped)", (unsigned long long) oscCapture.writtenCount.load(),
+		(unsigned long long) oscCapture.droppedCount.load());
+}
+
+// @rate : times the captured speed, 0 for as fast as possible.
+void OSControlMap::replayOscCapture(float rate) {
+	// The replay is sent over UDP
+	if (currentOscTransport != OSC_TRANSPORT_UDP) {
+		WARN("OSControlMap - OSC replay needs the UDP transport");
+		return;
 	}
+	// Replaying into a running capture would record the replay
+	if (oscCapture.isCapturing())
+		stopOscCapture();
+	oscReplay.start(oscCapturePath(), currentOSCSettings.oscRxPort, rate);
+}
+
+void OSControlMap::onSampleRateChange() {
+	if (feedbackRate > 0)
+		feedbackDivider.setDivision(std::max(1, (int) (APP->engine->getSampleRate() / feedbackRate)));
 }
 
+// UI thread. Opening and closing sockets and threads blocks, and so does publishing the routes, so none of it
+// runs from process().
 void OSControlMap::ProcessOscActions() {
+	if ((int)params[ACTIVE_PARAM].getValue() == 1) {
+		if (!oscStarted) {
+			oscCurrentAction = OSCAction::Enable;
+		}
+	}else{
+		oscStarted = false;
+	}
+
 	switch (oscCurrentAction)
 	{
 	case OSCAction::Enable:
@@ -76,24 +263,30 @@ void OSControlMap::ProcessOscActions() {
 		break;
 	}
 	oscCurrentAction = OSCAction::None;
+
+	ProcessOscLearn();
+	// One rebuild for every mapping change since the last frame
+	if (oscRoutesDirty.exchange(false))
+		refreshOscRoutes();
 }
 
 void OSControlMap::process(const ProcessArgs& args) {
-
-	if ((int)params[ACTIVE_PARAM].getValue() == 1) {
-		if (!oscStarted) {
-			oscCurrentAction = OSCAction::Enable;
-		}
-	}else{
-		oscStarted = false;
-	}
+	uint64_t profileStart = profile.begin();
+	uint64_t appliedBefore = profileStart ? rxCoalescer.appliedCount.load(std::memory_order_relaxed) : 0;
 
 	//show config screen
 	oscShowConfigurationScreen = (int) params[CONFIG_PARAM].getValue() == 1;
 	
-	ProcessOscActions();
 	UpdateValuesFromMap(args);
 
+	if (oscInitialized && feedbackRate > 0 && feedbackDivider.process()) {
+		ScanFeedback();
+	}
+
+	if (profileStart) {
+		int applied = (int) (rxCoalescer.appliedCount.load(std::memory_order_relaxed) - appliedBefore);
+		profile.end(profileStart, args.sampleRate, mapLen, applied);
+	}
 }
 
 /*void processMessage(midi::Message msg) {
@@ -124,8 +317,12 @@ void processCC(midi::Message msg) {
 void OSControlMap::clearMap(int id) {
 	learningId = -1;
 	ccs[id] = -1;
+	addresses[id].clear();
+	transforms[id] = OSCSlotTransform();
 	APP->engine->updateParamHandle(&paramHandles[id], -1, 0, true);
-	valueFilters[id].reset();
+	slewValues[id] = slewTargets[id] = -1.f;
+	lastWritten[id] = -1.f;
+	lastReported[id] = -1.f;
 	updateMapLen();
 	refreshParamHandleText(id);
 }
@@ -134,32 +331,59 @@ void OSControlMap::clearMaps() {
 	learningId = -1;
 	for (int id = 0; id < MAX_CHANNELS; id++) {
 		ccs[id] = -1;
+		addresses[id].clear();
+		transforms[id] = OSCSlotTransform();
 		APP->engine->updateParamHandle(&paramHandles[id], -1, 0, true);
-		valueFilters[id].reset();
+		slewValues[id] = slewTargets[id] = -1.f;
+		lastWritten[id] = -1.f;
 		refreshParamHandleText(id);
 	}
 	mapLen = 0;
+	oscRoutesDirty = true;
 }
 
 void OSControlMap::updateMapLen() {
 	// Find last nonempty map
 	int id;
 	for (id = MAX_CHANNELS - 1; id >= 0; id--) {
-		if (ccs[id] >= 0 || paramHandles[id].moduleId >= 0)
+		if (hasAddress(id) || paramHandles[id].moduleId >= 0)
 			break;
 	}
 	mapLen = id + 1;
 	// Add an empty "Mapping..." slot
 	if (mapLen < MAX_CHANNELS)
 		mapLen++;
+	oscRoutesDirty = true;
+}
+
+void OSControlMap::refreshOscRoutes() {
+	std::vector<std::string> feedbackAddresses(MAX_CHANNELS);
+	for (int id = 0; id < mapLen; id++)
+		feedbackAddresses[id] = oscAddress(id);
+	feedback.setAddresses(feedbackAddresses);
+
+	OSCSlotState* state = new OSCSlotState();
+	state->mapLen = mapLen;
+	for (int id = 0; id < mapLen; id++) {
+		state->mapped[id] = hasAddress(id);
+		state->transforms[id] = transforms[id];
+	}
+	slotState.publish(state);
+
+	if (oscInitialized)
+		OSCRxConnector::RefreshRoutes(currentOSCSettings.oscRxPort, this, currentOscTransport);
 }
 
 
 void OSControlMap::setOscMap() {
 	// Learn
 	if (0 <= learningId) {
-		ccs[learningId] = learningId;
-		valueFilters[learningId].reset();
+		// Number the channel unless OSC learn gave it an address
+		if (!hasAddress(learningId))
+			ccs[learningId] = learningId;
+		slewValues[learningId] = slewTargets[learningId] = -1.f;
+		lastWritten[learningId] = -1.f;
+		lastReported[learningId] = -1.f;
 		refreshParamHandleText(learningId);
 	}
 }
@@ -167,8 +391,9 @@ void OSControlMap::setOscMap() {
 void OSControlMap::commitLearn() {
 	if (learningId < 0)
 		return;
-	/*if (!learnedCc)
-		return;*/
+	// OSC learn waits for the address as well
+	if (oscLearn && !learnedCc)
+		return;
 	if (!learnedParam)
 		return;
 
@@ -179,7 +404,7 @@ void OSControlMap::commitLearn() {
 	learnedParam = false;
 	// Find next incomplete map
 	while (++learningId < MAX_CHANNELS) {
-		if (ccs[learningId] < 0 || paramHandles[learningId].moduleId < 0)
+		if (!hasAddress(learningId) || paramHandles[learningId].moduleId < 0)
 			return;
 	}
 
@@ -211,13 +436,67 @@ void OSControlMap::learnParam(int id, int moduleId, int paramId) {
 
 void OSControlMap::refreshParamHandleText(int id) {
 	std::string text;
-	if (ccs[id] >= 0)
-		text = string::f("/%d", ccs[id]);
+	if (hasAddress(id))
+		text = oscAddress(id);
 	else
 		text = "OSC-Map";
 	paramHandles[id].text = text;
 }
 
+bool OSControlMap::hasAddress(int id) {
+	return ccs[id] >= 0 || !addresses[id].empty();
+}
+
+std::string OSControlMap::oscAddress(int id) {
+	if (!addresses[id].empty())
+		return addresses[id];
+	if (ccs[id] < 0)
+		return "";
+	std::string address = "/" + std::to_string(ccs[id]);
+	if (!spaceName.empty())
+		address = "/" + spaceName + address;
+	return address;
+}
+
+void OSControlMap::setAddress(int id, const std::string& address) {
+	if (address.empty()) {
+		// Back to the numbered address
+		addresses[id].clear();
+		ccs[id] = id;
+	}
+	else {
+		addresses[id] = (address[0] == '/') ? address : "/" + address;
+		ccs[id] = -1;
+	}
+	values[id] = -1.0;
+	slewValues[id] = slewTargets[id] = -1.f;
+	lastReported[id] = -1.f;
+	updateMapLen();
+	refreshParamHandleText(id);
+}
+
+void OSControlMap::setOscLearn(bool enabled) {
+	oscLearn = enabled;
+}
+
+void OSControlMap::ProcessOscLearn() {
+	oscAddressLearn.arm(oscLearn && learningId >= 0);
+	std::string address;
+	if (!oscAddressLearn.take(address))
+		return;
+	if (learningId < 0)
+		return;
+	int id = learningId;
+	INFO("OSControlMap - Learned OSC address %s for channel %d", address.c_str(), id);
+	addresses[id] = address;
+	ccs[id] = -1;
+	values[id] = -1.0;
+	learnedCc = true;
+	commitLearn();
+	updateMapLen();
+	refreshParamHandleText(id);
+}
+
 json_t* OSControlMap::dataToJson() {
 	json_t* rootJ = json_object();
 
@@ -225,11 +504,22 @@ json_t* OSControlMap::dataToJson() {
 	for (int id = 0; id < mapLen; id++) {
 		json_t* mapJ = json_object();
 		json_object_set_new(mapJ, "cc", json_integer(ccs[id]));
+		if (!addresses[id].empty())
+			json_object_set_new(mapJ, "address", json_string(addresses[id].c_str()));
 		json_object_set_new(mapJ, "moduleId", json_integer(paramHandles[id].moduleId));
 		json_object_set_new(mapJ, "paramId", json_integer(paramHandles[id].paramId));
+		json_object_set_new(mapJ, "min", json_real(transforms[id].min));
+		json_object_set_new(mapJ, "max", json_real(transforms[id].max));
+		json_object_set_new(mapJ, "curve", json_integer(transforms[id].curve));
 		json_array_append_new(mapsJ, mapJ);
 	}
 	json_object_set_new(rootJ, "maps", mapsJ);
+	json_object_set_new(rootJ, "feedbackRate", json_integer(feedbackRate));
+	json_object_set_new(rootJ, "transport", json_integer(oscTransport));
+	json_object_set_new(rootJ, "allEvents", json_boolean(rxCoalescer.allEvents));
+	json_object_set_new(rootJ, "oscLearn", json_boolean(oscLearn));
+	json_object_set_new(rootJ, "sharePort", json_boolean(oscSharePort));
+	json_object_set_new(rootJ, "multicastGroup", json_string(oscMulticastGroup.c_str()));
 
 	//json_object_set_new(rootJ, "midi", midiInput.toJson());
 	return rootJ;
@@ -251,13 +541,50 @@ void OSControlMap::dataFromJson(json_t* rootJ) {
 			if (mapIndex >= MAX_CHANNELS)
 				continue;
 			ccs[mapIndex] = json_integer_value(ccJ);
+			json_t* addressJ = json_object_get(mapJ, "address");
+			if (addressJ)
+				addresses[mapIndex] = json_string_value(addressJ);
 			APP->engine->updateParamHandle(&paramHandles[mapIndex], json_integer_value(moduleIdJ), json_integer_value(paramIdJ), false);
+			// Patches from before ranges existed map 0-1 linearly
+			json_t* minJ = json_object_get(mapJ, "min");
+			json_t* maxJ = json_object_get(mapJ, "max");
+			json_t* curveJ = json_object_get(mapJ, "curve");
+			if (minJ && maxJ) {
+				transforms[mapIndex].min = json_number_value(minJ);
+				transforms[mapIndex].max = json_number_value(maxJ);
+			}
+			if (curveJ)
+				transforms[mapIndex].curve = clamp((int) json_integer_value(curveJ), 0, NUM_OSC_CURVES - 1);
 			refreshParamHandleText(mapIndex);
 		}
 	}
 
 	updateMapLen();
 
+	json_t* feedbackRateJ = json_object_get(rootJ, "feedbackRate");
+	if (feedbackRateJ)
+		setFeedbackRate(json_integer_value(feedbackRateJ));
+
+	json_t* transportJ = json_object_get(rootJ, "transport");
+	if (transportJ)
+		setOscTransport(clamp((int) json_integer_value(transportJ), 0, NUM_OSC_TRANSPORTS - 1));
+
+	json_t* allEventsJ = json_object_get(rootJ, "allEvents");
+	if (allEventsJ)
+		setAllEvents(json_is_true(allEventsJ));
+
+	json_t* oscLearnJ = json_object_get(rootJ, "oscLearn");
+	if (oscLearnJ)
+		setOscLearn(json_is_true(oscLearnJ));
+
+	json_t* sharePortJ = json_object_get(rootJ, "sharePort");
+	if (sharePortJ)
+		setOscSharePort(json_is_true(sharePortJ));
+
+	json_t* multicastGroupJ = json_object_get(rootJ, "multicastGroup");
+	if (multicastGroupJ)
+		setOscMulticastGroup(json_string_value(multicastGroupJ));
+
 	/*json_t* midiJ = json_object_get(rootJ, "midi");
 	if (midiJ)
 		midiInput.fromJson(midiJ);*/
@@ -272,7 +599,23 @@ void OSControlMap::initOSC()
 		portNumber = std::stoi(customInputPort);
 	}
 
-	oscInitialized = OSCRxConnector::StartListener(portNumber, this);
+	OscRxOptions options;
+	options.sharePort = oscSharePort;
+	if (!oscMulticastGroup.empty() && !OscRxOptions::parseMulticastGroup(oscMulticastGroup, options.multicastGroup))
+		WARN("OSControlMap - %s is not a multicast address, receiving unicast only", oscMulticastGroup.c_str());
+
+	oscInitialized = OSCRxConnector::StartListener(portNumber, this, oscTransport, options);
+	if (!oscInitialized)
+		return;
+	currentOSCSettings.oscRxPort = portNumber;
+	currentOscTransport = oscTransport;
+
+	// Resend every mapped value so the controller starts in sync
+	for (int id = 0; id < MAX_CHANNELS; id++) {
+		lastReported[id] = -1.f;
+	}
+	feedback.setTarget(currentOSCSettings.oscTxIpAddress, currentOSCSettings.oscTxPort);
+	OSCFeedbackSender::AddSource(&feedback);
 }
 
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
@@ -290,8 +633,9 @@ void OSControlMap::cleanupOSC()
 		DEBUG("oscCV::cleanupOSC() - Cleaning up RECV socket.");
 		if (doOSC2CVPort)
 		{
-			OSCRxConnector::StopListener(currentOSCSettings.oscRxPort, this);
+			OSCRxConnector::StopListener(currentOSCSettings.oscRxPort, this, currentOscTransport);
 		}
+		OSCFeedbackSender::RemoveSource(&feedback);
 
 		/*if (oscTxSocket != NULL)
 		{
@@ -384,16 +728,13 @@ struct MapChoice : LedDisplayChoice {
 
 		// Set text
 		text = "";
-		if (!module->spaceName.empty()) {
-			text += "/" + module->spaceName;
-		}
-		if (module->ccs[id] > -1) {
-			text += string::f("/%d - ", module->ccs[id]);
+		if (module->hasAddress(id)) {
+			text += module->oscAddress(id) + " - ";
 		}
 		if (module->paramHandles[id].moduleId >= 0) {
 			text += getParamName();
 		}
-		if (module->ccs[id] < 0 && module->paramHandles[id].moduleId < 0) {
+		if (!module->hasAddress(id) && module->paramHandles[id].moduleId < 0) {
 			if (module->learningId == id) {
 				text = "Mapping...";
 			}
@@ -403,7 +744,7 @@ struct MapChoice : LedDisplayChoice {
 		}
 
 		// Set text color
-		if ((module->ccs[id] >= 0 && module->paramHandles[id].moduleId >= 0) || module->learningId == id) {
+		if ((module->hasAddress(id) && module->paramHandles[id].moduleId >= 0) || module->learningId == id) {
 			color.a = 1.0;
 		}
 		else {
@@ -648,6 +989,7 @@ struct CustomOSControlTextField : TextField{
 
 		if (text.compare(oldText) != 0 && placeholder.compare("spaceName") == 0){
 			module->spaceName = text;
+			module->oscRoutesDirty = true;
 		}
 
 		oldText = text;
@@ -703,6 +1045,344 @@ struct OSControlMapWidget : ModuleWidget {
 
 
 	}
+
+	void step() override {
+		OSControlMap* module = dynamic_cast<OSControlMap*>(this->module);
+		if (module)
+			module->ProcessOscActions();
+		ModuleWidget::step();
+	}
+
+	void appendContextMenu(Menu* menu) override {
+		OSControlMap* module = dynamic_cast<OSControlMap*>(this->module);
+		if (!module)
+			return;
+
+		struct FeedbackRateItem : MenuItem {
+			OSControlMap* module;
+			int rate;
+			void onAction(const event::Action& e) override {
+				module->setFeedbackRate(rate);
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* label = new MenuLabel;
+		label->text = "OSC feedback rate";
+		menu->addChild(label);
+
+		const int rates[] = {0, 10, 30, 60};
+		for (int rate : rates) {
+			FeedbackRateItem* item = new FeedbackRateItem;
+			item->text = rate > 0 ? string::f("%d Hz", rate) : "Off";
+			item->rightText = CHECKMARK(module->feedbackRate == rate);
+			item->module = module;
+			item->rate = rate;
+			menu->addChild(item);
+		}
+
+		struct TransportItem : MenuItem {
+			OSControlMap* module;
+			int transport;
+			void onAction(const event::Action& e) override {
+				module->setOscTransport(transport);
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* transportLabel = new MenuLabel;
+		transportLabel->text = "OSC transport";
+		menu->addChild(transportLabel);
+
+		const char* transportNames[NUM_OSC_TRANSPORTS] = {"UDP", "TCP (SLIP)", "TCP (length prefixed)"};
+		for (int transport = 0; transport < NUM_OSC_TRANSPORTS; transport++) {
+			TransportItem* item = new TransportItem;
+			item->text = transportNames[transport];
+			item->rightText = CHECKMARK(module->oscTransport == transport);
+			item->module = module;
+			item->transport = transport;
+			menu->addChild(item);
+		}
+
+		struct SharePortItem : MenuItem {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				module->setOscSharePort(!module->oscSharePort);
+			}
+		};
+		struct MulticastField : ui::TextField {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				module->setOscMulticastGroup(text);
+				MenuOverlay* overlay = getAncestorOfType<MenuOverlay>();
+				if (overlay)
+					overlay->requestDelete();
+			}
+		};
+
+		SharePortItem* sharePortItem = new SharePortItem;
+		sharePortItem->text = "Share UDP port with other Rack instances";
+		sharePortItem->rightText = CHECKMARK(module->oscSharePort);
+		sharePortItem->module = module;
+		menu->addChild(sharePortItem);
+
+		MenuLabel* multicastLabel = new MenuLabel;
+		multicastLabel->text = "UDP multicast group (Enter to apply, empty for none)";
+		menu->addChild(multicastLabel);
+		MulticastField* multicastField = new MulticastField;
+		multicastField->box.size.x = 220;
+		multicastField->text = module->oscMulticastGroup;
+		multicastField->placeholder = "239.0.0.1";
+		multicastField->module = module;
+		menu->addChild(multicastField);
+
+		struct AllEventsItem : MenuItem {
+			OSControlMap* module;
+			bool allEvents;
+			void onAction(const event::Action& e) override {
+				module->setAllEvents(allEvents);
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* eventsLabel = new MenuLabel;
+		eventsLabel->text = "OSC events";
+		menu->addChild(eventsLabel);
+
+		AllEventsItem* newestItem = new AllEventsItem;
+		newestItem->text = "Newest value wins";
+		newestItem->rightText = CHECKMARK(!module->rxCoalescer.allEvents);
+		newestItem->module = module;
+		newestItem->allEvents = false;
+		menu->addChild(newestItem);
+
+		AllEventsItem* everyItem = new AllEventsItem;
+		everyItem->text = "Every event";
+		everyItem->rightText = CHECKMARK(module->rxCoalescer.allEvents);
+		everyItem->module = module;
+		everyItem->allEvents = true;
+		menu->addChild(everyItem);
+
+		MenuLabel* ratioLabel = new MenuLabel;
+		ratioLabel->text = string::f("Coalesce ratio %.1f:1 (%llu received)", module->rxCoalescer.coalesceRatio(),
+			(unsigned long long) module->rxCoalescer.receivedCount.load());
+		menu->addChild(ratioLabel);
+
+		struct AddressField : ui::TextField {
+			OSControlMap* module;
+			int id;
+			void onAction(const event::Action& e) override {
+				module->setAddress(id, text);
+				MenuOverlay* overlay = getAncestorOfType<MenuOverlay>();
+				if (overlay)
+					overlay->requestDelete();
+			}
+		};
+		struct RangeItem : MenuItem {
+			OSControlMap* module;
+			int id;
+			double min, max;
+			void onAction(const event::Action& e) override {
+				OSCSlotTransform transform = module->transforms[id];
+				transform.min = min;
+				transform.max = max;
+				module->setTransform(id, transform);
+			}
+		};
+		struct CurveItem : MenuItem {
+			OSControlMap* module;
+			int id;
+			int curve;
+			void onAction(const event::Action& e) override {
+				OSCSlotTransform transform = module->transforms[id];
+				transform.curve = curve;
+				module->setTransform(id, transform);
+			}
+		};
+		struct SlotItem : MenuItem {
+			OSControlMap* module;
+			int id;
+			Menu* createChildMenu() override {
+				Menu* menu = new Menu;
+				const OSCSlotTransform& current = module->transforms[id];
+
+				MenuLabel* addressLabel = new MenuLabel;
+				addressLabel->text = "OSC address (Enter to apply, empty for numbered)";
+				menu->addChild(addressLabel);
+				AddressField* addressField = new AddressField;
+				addressField->box.size.x = 220;
+				addressField->text = module->addresses[id];
+				addressField->placeholder = module->oscAddress(id);
+				addressField->module = module;
+				addressField->id = id;
+				menu->addChild(addressField);
+
+				menu->addChild(new MenuSeparator);
+				MenuLabel* rangeLabel = new MenuLabel;
+				rangeLabel->text = "Value range";
+				menu->addChild(rangeLabel);
+				struct Range {
+					double min, max;
+					const char* name;
+				};
+				const Range ranges[] = {{0.0, 1.0, "0 to 1"}, {-1.0, 1.0, "-1 to 1"}, {0.0, 127.0, "0 to 127"},
+					{0.0, 16383.0, "0 to 16383 (14 bit)"}, {1.0, 0.0, "1 to 0 (inverted)"}};
+				for (const Range& range : ranges) {
+					RangeItem* item = new RangeItem;
+					item->text = range.name;
+					item->rightText = CHECKMARK(current.min == range.min && current.max == range.max);
+					item->module = module;
+					item->id = id;
+					item->min = range.min;
+					item->max = range.max;
+					menu->addChild(item);
+				}
+
+				menu->addChild(new MenuSeparator);
+				MenuLabel* curveLabel = new MenuLabel;
+				curveLabel->text = "Curve";
+				menu->addChild(curveLabel);
+				const char* curveNames[NUM_OSC_CURVES] = {"Linear", "Exponential", "Logarithmic", "S-curve"};
+				for (int curve = 0; curve < NUM_OSC_CURVES; curve++) {
+					CurveItem* item = new CurveItem;
+					item->text = curveNames[curve];
+					item->rightText = CHECKMARK(current.curve == curve);
+					item->module = module;
+					item->id = id;
+					item->curve = curve;
+					menu->addChild(item);
+				}
+				return menu;
+			}
+		};
+
+		struct OscLearnItem : MenuItem {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				module->setOscLearn(!module->oscLearn);
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* slotsLabel = new MenuLabel;
+		slotsLabel->text = "OSC addresses";
+		menu->addChild(slotsLabel);
+
+		OscLearnItem* oscLearnItem = new OscLearnItem;
+		oscLearnItem->text = "OSC learn (map the next unknown address)";
+		oscLearnItem->rightText = CHECKMARK(module->oscLearn);
+		oscLearnItem->module = module;
+		menu->addChild(oscLearnItem);
+
+		for (int id = 0; id < module->mapLen; id++) {
+			if (!module->hasAddress(id) && module->paramHandles[id].moduleId < 0)
+				continue;
+			SlotItem* item = new SlotItem;
+			item->text = module->hasAddress(id) ? module->oscAddress(id) : string::f("Channel %d", id + 1);
+			item->rightText = RIGHT_ARROW;
+			item->module = module;
+			item->id = id;
+			menu->addChild(item);
+		}
+
+		struct SaveLatencyItem : MenuItem {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				module->saveLatencyReport();
+			}
+		};
+		struct ResetLatencyItem : MenuItem {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				module->latency.reset();
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* latencyLabel = new MenuLabel;
+		latencyLabel->text = string::f("OSC latency, port %d (p50 / p99 / p99.9)", module->currentOSCSettings.oscRxPort);
+		menu->addChild(latencyLabel);
+
+		const char* stageNames[3] = {"Receive > dispatch", "Dispatch > apply", "Receive > apply"};
+		const OSCLatencyHistogram* stages[3] = {&module->latency.receiveToDispatch, &module->latency.dispatchToApply, &module->latency.receiveToApply};
+		for (int i = 0; i < 3; i++) {
+			MenuLabel* stageLabel = new MenuLabel;
+			stageLabel->text = string::f("%s: %.0f / %.0f / %.0f us", stageNames[i],
+				stages[i]->percentile(0.5) / 1000.0, stages[i]->percentile(0.99) / 1000.0, stages[i]->percentile(0.999) / 1000.0);
+			menu->addChild(stageLabel);
+		}
+
+		SaveLatencyItem* saveItem = new SaveLatencyItem;
+		saveItem->text = "Save latency report (JSON)";
+		saveItem->module = module;
+		menu->addChild(saveItem);
+
+		ResetLatencyItem* resetItem = new ResetLatencyItem;
+		resetItem->text = "Reset latency stats";
+		resetItem->module = module;
+		menu->addChild(resetItem);
+
+		struct CaptureItem : MenuItem {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				if (module->oscCapture.isCapturing())
+					module->stopOscCapture();
+				else
+					module->startOscCapture();
+			}
+		};
+		struct ReplayItem : MenuItem {
+			OSControlMap* module;
+			float rate;
+			void onAction(const event::Action& e) override {
+				module->replayOscCapture(rate);
+			}
+		};
+		struct StopReplayItem : MenuItem {
+			OSControlMap* module;
+			void onAction(const event::Action& e) override {
+				module->oscReplay.stop();
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* captureLabel = new MenuLabel;
+		if (module->oscCapture.isCapturing())
+			captureLabel->text = string::f("OSC capture: %llu datagrams, %llu dropped", (unsigned long long) module->oscCapture.capturedCount.load(),
+				(unsigned long long) module->oscCapture.droppedCount.load());
+		else if (module->oscReplay.isPlaying() || module->oscReplay.totalCount > 0)
+			captureLabel->text = string::f("OSC replay: %llu / %llu sent, %.0f packets/s", (unsigned long long) module->oscReplay.sentCount.load(),
+				(unsigned long long) module->oscReplay.totalCount.load(), module->oscReplay.packetsPerSecond());
+		else
+			captureLabel->text = "OSC capture (pcap)";
+		menu->addChild(captureLabel);
+
+		CaptureItem* captureItem = new CaptureItem;
+		captureItem->text = module->oscCapture.isCapturing() ? "Stop capture" : "Capture received OSC";
+		captureItem->module = module;
+		menu->addChild(captureItem);
+
+		if (module->oscReplay.isPlaying()) {
+			StopReplayItem* stopReplayItem = new StopReplayItem;
+			stopReplayItem->text = "Stop replay";
+			stopReplayItem->module = module;
+			menu->addChild(stopReplayItem);
+		}
+		else {
+			const char* rateNames[4] = {"1x", "4x", "16x", "max"};
+			const float rates[4] = {1.f, 4.f, 16.f, 0.f};
+			for (int i = 0; i < 4; i++) {
+				ReplayItem* replayItem = new ReplayItem;
+				replayItem->text = string::f("Replay capture (%s)", rateNames[i]);
+				replayItem->module = module;
+				replayItem->rate = rates[i];
+				menu->addChild(replayItem);
+			}
+		}
+
+		appendProfileMenu(menu, &module->profile, "OSControlMap");
+		appendTraceMenu(menu);
+	}
 };
 
 
@@ -1,10 +1,21 @@
 #include <mutex>
+#include <atomic>
 
 #include "../lib/oscpack/osc/OscReceivedElements.h"
 #include "../lib/oscpack/osc/OscPacketListener.h"
 #include "../lib/oscpack/ip/UdpSocket.h"
-
-static const int MAX_CHANNELS = 128;
+#include "OSCFeedback.hpp"
+#include "OSCRxCoalescer.hpp"
+#include "OSCLatency.hpp"
+#include "OSCTransform.hpp"
+#include "OSCAddressTable.hpp"
+#include "ProcessProfile.hpp"
+#include "OSCCapture.hpp"
+#include "OSCSnapshot.hpp"
+#include "Trace.hpp"
+
+static const int MAX_CHANNELS = 256;
+static_assert(MAX_CHANNELS <= OSC_RX_SLOTS && MAX_CHANNELS <= OSC_FEEDBACK_SLOTS, "Every channel needs an Rx and a feedback slot");
 //--- OSC defines --
 // Default OSC outgoing address (Tx). 127.0.0.1.
 #define OSC_ADDRESS_DEF		"127.0.0.1"
@@ -12,14 +23,40 @@ static const int MAX_CHANNELS = 128;
 #define OSC_OUTPORT_DEF		7000
 // Default OSC incoming port (Rx). 7001.
 #define OSC_INPORT_DEF		7001
+// Mapped params are updated once every this many samples.
+#define OSC_SLEW_DIVISION	32
+// Slew speed towards a new OSC value (1/s).
+#define OSC_SLEW_LAMBDA		60.f
+// Distance at which the slew snaps to its target.
+#define OSC_SLEW_SNAP		1e-4f
 
 
+// Mappings as the engine thread sees them, rebuilt and published by the UI thread with the routes.
+struct OSCSlotState {
+	// Number of maps
+	int mapLen = 0;
+	// Whether each channel has an address
+	bool mapped[MAX_CHANNELS] = {};
+	// Range and curve of each channel
+	OSCSlotTransform transforms[MAX_CHANNELS];
+};
+
 enum OSCAction {
 	None,
 	Disable,
 	Enable
 };
 
+// OSC Rx transport
+enum OSCTransport {
+	OSC_TRANSPORT_UDP,
+	// OSC 1.1 stream, SLIP framed
+	OSC_TRANSPORT_TCP_SLIP,
+	// OSC 1.0 stream, int32 size prefixed
+	OSC_TRANSPORT_TCP_LENGTH,
+	NUM_OSC_TRANSPORTS
+};
+
 // OSC connection information
 typedef struct TSOSCInfo {	
 	// OSC output IP address.
@@ -57,11 +94,23 @@ struct OSControlMap : Module {
 
 	bool oscStarted = false;
 
-	/** The smoothing processor (normalized between 0 and 1) of each channel */
-	dsp::ExponentialFilter valueFilters[MAX_CHANNELS];
-	bool filterInitialized[MAX_CHANNELS] = {};
+	/** Smoothed value (normalized between 0 and 1) of each channel, -1 while unset. Packed for the SIMD slew */
+	alignas(16) float slewValues[MAX_CHANNELS];
+	/** Value each channel slews towards, -1 while unset */
+	alignas(16) float slewTargets[MAX_CHANNELS];
+	/** Block rate of the slew */
 	dsp::ClockDivider divider;
 
+	/** Feedback of mapped param changes to the controller */
+	OSCFeedbackSource feedback;
+	/** Feedback rate in Hz, 0 when disabled */
+	int feedbackRate = OSC_FEEDBACK_RATE_DEF;
+	dsp::ClockDivider feedbackDivider;
+	/** Last value written to each param from OSC, -1 if none */
+	alignas(16) float lastWritten[MAX_CHANNELS];
+	/** Last value of each param seen by the feedback scan, -1 if none */
+	float lastReported[MAX_CHANNELS];
+
 	/** Number of maps */
 	int mapLen = 0;
 	/** The mapped param handle of each channel */
@@ -71,17 +120,43 @@ struct OSControlMap : Module {
 	/** Whether the param has been set during the learning session */
 	bool learnedParam;
 	int len = 0; // the number of bytes read from the socket
-	/** The mapped CC number of each channel */
+	/** The OSC address number (/<n>) of each channel, -1 if none. Independent of the channel ID */
 	int ccs[MAX_CHANNELS];
+	/** Custom OSC address of each channel, used as is instead of /<spaceName>/<n> when set */
+	std::string addresses[MAX_CHANNELS];
+	/** Map the learning channel to the next unknown address received instead of numbering it */
+	bool oscLearn = false;
+	/** Unknown addresses captured by the OSC thread while learning */
+	OSCAddressLearn oscAddressLearn;
+	/** Mappings changed since the routes, feedback addresses and slot state were last published by the UI thread */
+	std::atomic<bool> oscRoutesDirty{false};
+	/** What process() knows of the mappings, it never reads the addresses the UI thread edits */
+	OSCSnapshot<OSCSlotState> slotState;
 	std::map<int, std::string> portNames;
 
-	/** Whether the CC has been set during the learning session */
+	/** Whether the OSC address has been learned during the learning session */
 	bool learnedCc;
-	/** The value of each CC number */
-	int8_t values[128];
-
-	// Flag if OSC objects have been initialized
-	bool oscInitialized = false;
+	/** Normalized value (0-1) last received by each channel, -1 if none */
+	double values[MAX_CHANNELS];
+	/** Range and curve from the controller's values to each channel's param. UI thread, process() uses slotState */
+	OSCSlotTransform transforms[MAX_CHANNELS];
+	/** Values posted by the OSC receiving thread, taken by the engine once per block */
+	OSCRxCoalescer rxCoalescer;
+	/** Receive, dispatch and apply latency of the OSC -> param path */
+	OSCLatencyStats latency;
+	/** Receive and dispatch time of values not yet written to their param, 0 if none */
+	uint64_t pendingReceivedNs[MAX_CHANNELS] = {};
+	uint64_t pendingDispatchedNs[MAX_CHANNELS] = {};
+	bool latencyPending = false;
+	/** Cost of process() per sample rate and number of mappings, off unless enabled from the menu */
+	ProcessProfile profile;
+	/** Raw datagrams received, teed to a pcap file by the OSC thread while capturing */
+	OSCCapture oscCapture;
+	/** Sends a capture back to the Rx port */
+	OSCCaptureReplay oscReplay;
+
+	// Flag if OSC objects have been initialized. Set by the UI thread, read by process().
+	std::atomic<bool> oscInitialized{false};
 
 	// OSC message listener
 	//OSCRxConnector* oscListener = NULL;
@@ -92,8 +167,15 @@ struct OSControlMap : Module {
 	char oscBuffer[1024]; // declare a buffer into which to read the socket contents
 	TSOSCConnectionInfo currentOSCSettings = { OSC_ADDRESS_DEF,  OSC_OUTPORT_DEF , OSC_INPORT_DEF };
 	TSOSCInfo oscNewSettings = { OSC_ADDRESS_DEF,  OSC_OUTPORT_DEF , OSC_INPORT_DEF };
-
-	// Flag for our module to either enable or disable osc.
+	// Transport selected by the user and the one the listener was started with.
+	int oscTransport = OSC_TRANSPORT_UDP;
+	int currentOscTransport = OSC_TRANSPORT_UDP;
+	// Share the UDP port with other Rack instances on this host.
+	bool oscSharePort = false;
+	// IPv4 or IPv6 multicast group to receive on (e.g. 239.0.0.1 or ff15::1), empty for unicast and broadcast only.
+	std::string oscMulticastGroup;
+
+	// Flag for our module to either enable or disable osc. UI thread only.
 	OSCAction oscCurrentAction = OSCAction::None;
 
 	// Show the OSC configuration screen or not.
@@ -107,20 +189,42 @@ struct OSControlMap : Module {
 	~OSControlMap();
 
 	void onReset() override;
+	void onSampleRateChange() override;
 	void process(const ProcessArgs& args) override;
 	void clearMap(int id);
 	void clearMaps();
 	void updateMapLen();
+	void refreshOscRoutes();
 	void commitLearn();
 	void enableLearn(int id);
 	void disableLearn(int id);
 	void learnParam(int id, int moduleId, int paramId);
 	void refreshParamHandleText(int id);
-
+	// UI thread
+	bool hasAddress(int id);
+	std::string oscAddress(int id);
+	void setAddress(int id, const std::string& address);
+	void setOscLearn(bool enabled);
+	void ProcessOscLearn();
+
+	// UI thread only, both block on sockets and threads.
 	void initOSC();
 	void cleanupOSC();
 	void setOscMap();
 	void UpdateValuesFromMap(const ProcessArgs& args);
+	void writeParam(int id, float v);
+	void ScanFeedback();
+	void setFeedbackRate(int rateHz);
+	void setOscTransport(int transport);
+	void setOscSharePort(bool sharePort);
+	void setOscMulticastGroup(const std::string& group);
+	void setAllEvents(bool allEvents);
+	void setTransform(int id, const OSCSlotTransform& transform);
+	void saveLatencyReport();
+	std::string oscCapturePath();
+	void startOscCapture();
+	void stopOscCapture();
+	void replayOscCapture(float rate);
 	void ProcessOscActions();
 
 	void dataFromJson(json_t* rootJ) override;
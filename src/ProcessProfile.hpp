@@ -0,0 +1,221 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "OSCLatency.hpp"
+
+// Configurations (sample rate, mapped slots) one profile keeps apart.
+#define PROCESS_PROFILE_RUNS	16
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Cost of a module's process() in the running engine.
+// Calls are grouped into runs by sample rate and number of mapped slots, with the rate of incoming events
+// (MIDI messages, OSC values) recorded alongside, so reports from different builds can be compared
+// configuration by configuration.
+// Off by default: when disabled begin() and end() are a single load each.
+// The engine thread records, any thread may read or ask for a reset.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct ProcessProfile {
+	struct Run {
+		float sampleRate;
+		int mappedSlots;
+		std::atomic<uint64_t> calls;
+		std::atomic<uint64_t> events;
+		std::atomic<uint64_t> totalNs;
+		// Duration of each call
+		OSCLatencyHistogram process;
+	};
+
+	std::atomic<bool> enabled;
+
+	ProcessProfile()
+	{
+		enabled = false;
+		resetRequested = false;
+		runCount = 0;
+	}
+
+	// Engine thread. Start time of the call, 0 when disabled.
+	uint64_t begin()
+	{
+		if (!enabled.load(std::memory_order_relaxed))
+			return 0;
+		if (resetRequested.exchange(false, std::memory_order_acquire))
+		{
+			runCount.store(0, std::memory_order_release);
+			current = -1;
+		}
+		return PacketClockNow();
+	}
+
+	// Engine thread. @events is the number of events the call handled.
+	void end(uint64_t startNs, float sampleRate, int mappedSlots, int events)
+	{
+		if (startNs == 0)
+			return;
+		uint64_t ns = PacketClockNow() - startNs;
+		Run* run = find(sampleRate, mappedSlots);
+		if (run == NULL)
+			return;
+		run->calls.fetch_add(1, std::memory_order_relaxed);
+		run->events.fetch_add(events, std::memory_order_relaxed);
+		run->totalNs.fetch_add(ns, std::memory_order_relaxed);
+		run->process.record(ns);
+	}
+
+	// Cleared by the engine thread on its next call.
+	void reset()
+	{
+		resetRequested = true;
+	}
+
+	int size() const
+	{
+		return runCount.load(std::memory_order_acquire);
+	}
+
+	const Run& run(int i) const
+	{
+		return runs[i];
+	}
+
+	// Engine rate events were handled at, per second.
+	static double eventsPerSecond(const Run& run)
+	{
+		uint64_t calls = run.calls.load(std::memory_order_relaxed);
+		return (calls > 0) ? (double) run.events.load(std::memory_order_relaxed) * run.sampleRate / calls : 0.0;
+	}
+
+	static double meanNs(const Run& run)
+	{
+		uint64_t calls = run.calls.load(std::memory_order_relaxed);
+		return (calls > 0) ? (double) run.totalNs.load(std::memory_order_relaxed) / calls : 0.0;
+	}
+
+	// One entry per run, in the order the configurations were first seen.
+	json_t* toJson(const char* moduleName) const
+	{
+		json_t* rootJ = json_object();
+		json_object_set_new(rootJ, "module", json_string(moduleName));
+		json_object_set_new(rootJ, "version", json_string(pluginInstance->version.c_str()));
+		json_t* runsJ = json_array();
+		for (int i = 0; i < size(); i++)
+		{
+			const Run& r = runs[i];
+			json_t* runJ = json_object();
+			json_object_set_new(runJ, "sampleRate", json_real(r.sampleRate));
+			json_object_set_new(runJ, "mappedSlots", json_integer(r.mappedSlots));
+			json_object_set_new(runJ, "eventsPerSecond", json_real(eventsPerSecond(r)));
+			json_object_set_new(runJ, "meanNs", json_real(meanNs(r)));
+			// Share of the sample period spent in process()
+			json_object_set_new(runJ, "load", json_real(meanNs(r) * r.sampleRate / 1e9));
+			json_object_set_new(runJ, "process", r.process.toJson());
+			json_array_append_new(runsJ, runJ);
+		}
+		json_object_set_new(rootJ, "runs", runsJ);
+		return rootJ;
+	}
+
+	// Writes the report to PushMapVCV-<module>-Profile.json in the user folder.
+	void save(const char* moduleName) const
+	{
+		json_t* rootJ = toJson(moduleName);
+		std::string path = asset::user(string::f("PushMapVCV-%s-Profile.json", moduleName));
+		if (json_dump_file(rootJ, path.c_str(), JSON_INDENT(2)) == 0)
+			INFO("%s - Saved process profile to %s", moduleName, path.c_str());
+		else
+			WARN("%s - Could not write process profile to %s", moduleName, path.c_str());
+		json_decref(rootJ);
+	}
+
+private:
+	Run runs[PROCESS_PROFILE_RUNS];
+	std::atomic<int> runCount;
+	std::atomic<bool> resetRequested;
+	// Engine thread only. Run of the previous call.
+	int current = -1;
+
+	Run* find(float sampleRate, int mappedSlots)
+	{
+		if (current >= 0 && runs[current].sampleRate == sampleRate && runs[current].mappedSlots == mappedSlots)
+			return &runs[current];
+		int count = runCount.load(std::memory_order_relaxed);
+		for (int i = 0; i < count; i++)
+		{
+			if (runs[i].sampleRate == sampleRate && runs[i].mappedSlots == mappedSlots)
+			{
+				current = i;
+				return &runs[i];
+			}
+		}
+		// Full, further configurations are not recorded
+		if (count == PROCESS_PROFILE_RUNS)
+			return NULL;
+		Run& run = runs[count];
+		run.sampleRate = sampleRate;
+		run.mappedSlots = mappedSlots;
+		run.calls = 0;
+		run.events = 0;
+		run.totalNs = 0;
+		run.process.reset();
+		runCount.store(count + 1, std::memory_order_release);
+		current = count;
+		return &run;
+	}
+};
+
+
+// Context menu section of a profile: enable toggle, one line per run, save and reset.
+inline void appendProfileMenu(Menu* menu, ProcessProfile* profile, const char* moduleName)
+{
+	struct EnableItem : MenuItem {
+		ProcessProfile* profile;
+		void onAction(const event::Action& e) override {
+			profile->enabled = !profile->enabled;
+		}
+	};
+	struct SaveItem : MenuItem {
+		ProcessProfile* profile;
+		const char* moduleName;
+		void onAction(const event::Action& e) override {
+			profile->save(moduleName);
+		}
+	};
+	struct ResetItem : MenuItem {
+		ProcessProfile* profile;
+		void onAction(const event::Action& e) override {
+			profile->reset();
+		}
+	};
+
+	menu->addChild(new MenuSeparator);
+	MenuLabel* profileLabel = new MenuLabel;
+	profileLabel->text = "process() profile (mean / p99, load)";
+	menu->addChild(profileLabel);
+
+	EnableItem* enableItem = new EnableItem;
+	enableItem->text = "Profile process()";
+	enableItem->rightText = CHECKMARK(profile->enabled);
+	enableItem->profile = profile;
+	menu->addChild(enableItem);
+
+	for (int i = 0; i < profile->size(); i++) {
+		const ProcessProfile::Run& run = profile->run(i);
+		double mean = ProcessProfile::meanNs(run);
+		MenuLabel* runLabel = new MenuLabel;
+		runLabel->text = string::f("%.0f Hz, %d slots, %.0f ev/s: %.0f / %.0f ns, %.1f%%", run.sampleRate, run.mappedSlots,
+			ProcessProfile::eventsPerSecond(run), mean, (double) run.process.percentile(0.99), mean * run.sampleRate / 1e7);
+		menu->addChild(runLabel);
+	}
+
+	SaveItem* saveItem = new SaveItem;
+	saveItem->text = "Save profile (JSON)";
+	saveItem->profile = profile;
+	saveItem->moduleName = moduleName;
+	menu->addChild(saveItem);
+
+	ResetItem* resetItem = new ResetItem;
+	resetItem->text = "Reset profile";
+	resetItem->profile = profile;
+	menu->addChild(resetItem);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+// Commands the engine thread can post before the worker catches up, a power of two.
+#define PUSH_WORKER_QUEUE		16
+// How often the worker looks for commands.
+#define PUSH_WORKER_POLL_MS		10
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Runs device work that may block, opening and closing MIDI ports or turning the lights off, away from the engine
+// thread. The engine thread posts commands to a single producer, single consumer ring and never waits, the worker
+// hands them in order to the handler given to start().
+// The ports are shared through a handshake: the handler switches them between beginSwitch() and endSwitch(), and the
+// engine thread only uses them between a successful tryUse() and endUse(). beginSwitch() waits for the engine thread
+// to leave the ports, tryUse() fails instead of waiting while they are being switched. Both flags are sequentially
+// consistent, so either the engine thread sees the switch or the worker sees the engine thread using the ports.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushDeviceWorker {
+	typedef std::function<void(int command)> Handler;
+
+	PushDeviceWorker()
+	{
+		head = 0;
+		tail = 0;
+		running = false;
+		switching = false;
+		inUse = false;
+	}
+
+	~PushDeviceWorker()
+	{
+		stop();
+	}
+
+	// UI thread.
+	void start(Handler handler_)
+	{
+		if (running)
+			return;
+		handler = handler_;
+		running = true;
+		thread = std::thread(&PushDeviceWorker::run, this);
+	}
+
+	// UI thread. Commands still queued are dropped.
+	void stop()
+	{
+		running = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	// Engine thread only. False if the queue is full, the command should be posted again later.
+	bool post(int command)
+	{
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= PUSH_WORKER_QUEUE)
+			return false;
+		commands[h & (PUSH_WORKER_QUEUE - 1)] = command;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Engine thread only. True if the ports may be used until endUse(), false while the handler switches them.
+	bool tryUse()
+	{
+		inUse = true;
+		if (switching)
+		{
+			inUse = false;
+			return false;
+		}
+		return true;
+	}
+
+	// Engine thread only, after a successful tryUse().
+	void endUse()
+	{
+		inUse = false;
+	}
+
+	// Handler only. Waits until the engine thread is done with the ports, it leaves them alone until endSwitch().
+	void beginSwitch()
+	{
+		switching = true;
+		while (inUse)
+			std::this_thread::yield();
+	}
+
+	// Handler only.
+	void endSwitch()
+	{
+		switching = false;
+	}
+
+private:
+	Handler handler;
+	std::thread thread;
+	std::atomic<bool> running;
+	int commands[PUSH_WORKER_QUEUE];
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	// Set by the handler while it switches the ports
+	std::atomic<bool> switching;
+	// Set by the engine thread while it uses the ports
+	std::atomic<bool> inUse;
+
+	void run()
+	{
+		while (running)
+		{
+			uint32_t t = tail.load(std::memory_order_relaxed);
+			while (t != head.load(std::memory_order_acquire))
+			{
+				handler(commands[t & (PUSH_WORKER_QUEUE - 1)]);
+				tail.store(++t, std::memory_order_release);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(PUSH_WORKER_POLL_MS));
+		}
+	}
+};
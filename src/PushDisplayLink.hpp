@@ -0,0 +1,232 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "PushTransport.hpp"
+
+// Wait before the first retry of a failed open, doubled on every failure up to PUSH_LINK_BACKOFF_MAX_MS.
+#define PUSH_LINK_BACKOFF_MIN_MS	250
+#define PUSH_LINK_BACKOFF_MAX_MS	4000
+// Longest the link thread waits for USB events before looking at its state again.
+#define PUSH_LINK_POLL_MS			50
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Keeps the Push 2 display open while it is wanted.
+// A thread of its own opens and claims the device, with backoff while that fails, and reopens it after it was
+// unplugged or stopped answering. Arrivals and removals come from libusb hotplug where the platform has it,
+// elsewhere the link polls. setWanted() and isOpen() are lock-free, so the engine thread can use them.
+// The frame scheduler sends between beginTransfer() and endTransfer(), which never wait: while the link
+// thread is opening or closing the device the frame is skipped.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushDisplayLink {
+	enum State {
+		CLOSED,
+		CONNECTING,
+		OPEN
+	};
+
+	// Successful opens, and failed attempts.
+	std::atomic<uint32_t> opens;
+	std::atomic<uint32_t> failures;
+
+	// Takes ownership of @transport.
+	PushDisplayLink(PushTransport* transport) : transport(transport)
+	{
+		state = CLOSED;
+		wanted = false;
+		running = false;
+		hotplug = false;
+		arrived = false;
+		lost = false;
+		opens = 0;
+		failures = 0;
+	}
+
+	~PushDisplayLink()
+	{
+		stop();
+		delete transport;
+	}
+
+	// UI thread.
+	void start()
+	{
+		if (running)
+			return;
+		running = true;
+		thread = std::thread(&PushDisplayLink::run, this);
+	}
+
+	// UI thread. Closes the device.
+	void stop()
+	{
+		running = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	// UI thread. Takes ownership of @transport_, the old one is closed and deleted.
+	void setTransport(PushTransport* transport_)
+	{
+		bool wasRunning = running;
+		stop();
+		delete transport;
+		transport = transport_;
+		hotplug = false;
+		opens = 0;
+		failures = 0;
+		if (wasRunning)
+			start();
+	}
+
+	PushTransport* getTransport() const
+	{
+		return transport;
+	}
+
+	// Any thread.
+	void setWanted(bool wanted_)
+	{
+		if (wanted.load(std::memory_order_relaxed) != wanted_)
+			wanted.store(wanted_, std::memory_order_release);
+	}
+
+	int getState() const
+	{
+		return state.load(std::memory_order_acquire);
+	}
+
+	bool isOpen() const
+	{
+		return getState() == OPEN;
+	}
+
+	// Whether arrivals and removals are reported by the system rather than polled for.
+	bool hasHotplug() const
+	{
+		return hotplug.load(std::memory_order_relaxed);
+	}
+
+	// Frame scheduler thread. True if transfers may be made now, then endTransfer() must follow.
+	bool beginTransfer()
+	{
+		if (!isOpen() || lost.load(std::memory_order_relaxed))
+			return false;
+		if (!deviceMutex.try_lock())
+			return false;
+		if (!isOpen())
+		{
+			deviceMutex.unlock();
+			return false;
+		}
+		return true;
+	}
+
+	void endTransfer()
+	{
+		deviceMutex.unlock();
+	}
+
+	// Frame scheduler thread. @result of a failed transfer: a device that is gone is reopened.
+	void transferFailed(int result)
+	{
+		if (result == LIBUSB_ERROR_NO_DEVICE || result == LIBUSB_ERROR_IO)
+			lost = true;
+	}
+
+private:
+	PushTransport* transport;
+	std::thread thread;
+	// Held by the link thread while it opens or closes the device, and by the frame scheduler while it sends.
+	std::mutex deviceMutex;
+	std::atomic<int> state;
+	std::atomic<bool> wanted;
+	std::atomic<bool> running;
+	std::atomic<bool> hotplug;
+	// Set by hotplug callbacks and failed transfers, taken by the link thread.
+	std::atomic<bool> arrived;
+	std::atomic<bool> lost;
+
+	void run()
+	{
+		typedef std::chrono::steady_clock Clock;
+		hotplug = transport->watchHotplug([this](bool plugged) {
+			if (plugged)
+				arrived = true;
+			else
+				lost = true;
+		});
+		DEBUG("PushDisplayLink - %s", hotplug ? "Watching USB hotplug." : "No USB hotplug, polling.");
+
+		Clock::time_point nextAttempt = Clock::now();
+		int backoffMs = PUSH_LINK_BACKOFF_MIN_MS;
+		bool failing = false;
+		while (running)
+		{
+			bool want = wanted.load(std::memory_order_acquire);
+			if (isOpen())
+			{
+				bool gone = lost.exchange(false);
+				if (!want || gone)
+				{
+					close();
+					if (gone)
+						INFO("PushDisplayLink - Push 2 display lost, reconnecting.");
+					nextAttempt = Clock::now();
+					backoffMs = PUSH_LINK_BACKOFF_MIN_MS;
+				}
+			}
+			else if (want)
+			{
+				if (arrived.exchange(false) || Clock::now() >= nextAttempt)
+				{
+					state = CONNECTING;
+					lost = false;
+					bool ok;
+					{
+						std::lock_guard<std::mutex> lock(deviceMutex);
+						ok = transport->open();
+					}
+					if (ok)
+					{
+						state = OPEN;
+						opens++;
+						backoffMs = PUSH_LINK_BACKOFF_MIN_MS;
+						failing = false;
+						INFO("PushDisplayLink - Push 2 display connected.");
+					}
+					else
+					{
+						state = CLOSED;
+						failures++;
+						// Log the first failure only, the device may stay away for a long time
+						if (!failing)
+							INFO("PushDisplayLink - No Push 2 display, retrying.");
+						failing = true;
+						nextAttempt = Clock::now() + std::chrono::milliseconds(backoffMs);
+						backoffMs = std::min(2 * backoffMs, PUSH_LINK_BACKOFF_MAX_MS);
+					}
+				}
+			}
+			else
+			{
+				// The next request tries right away
+				nextAttempt = Clock::now();
+				backoffMs = PUSH_LINK_BACKOFF_MIN_MS;
+				arrived = false;
+			}
+			transport->handleEvents(PUSH_LINK_POLL_MS);
+		}
+		close();
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(deviceMutex);
+		transport->close();
+		state = CLOSED;
+	}
+};
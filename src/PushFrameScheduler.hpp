@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PushMap.hpp"
+#include "PushDisplayLink.hpp"
+#include "PushStats.hpp"
+#include "Trace.hpp"
+
+// Lines a display sends in one turn, before the next display gets the bus.
+#define PUSH_SCHEDULER_LINES_PER_TURN	16
+// Longest the scheduler sleeps while no frame waits, a frame submitted just as it goes to sleep waits this long.
+#define PUSH_SCHEDULER_IDLE_MS			10
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Frames of one Push 2 display on their way to the device.
+// The UI thread submits rendered frames, the scheduler thread sends them, the header then a few lines per turn.
+// A frame submitted before the previous one was taken replaces it and counts as dropped: the display always
+// gets the latest frame. A failed transfer drops the rest of the frame, the next one starts with a new header.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushFrameQueue {
+	// Counters of the module, NULL without one. Set before the queue is added to the scheduler.
+	PushStats * stats = NULL;
+
+	PushFrameQueue(PushDisplayLink * link) : link(link)
+	{
+		pending.resize(PUSH2_DISPLAY_IMAGE_BUFFER_SIZE);
+		sending.resize(PUSH2_DISPLAY_IMAGE_BUFFER_SIZE);
+	}
+
+	// UI thread. Copies @image, PUSH2_DISPLAY_IMAGE_BUFFER_SIZE bytes of XORed lines.
+	void submit(const unsigned char * image)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::memcpy(pending.data(), image, pending.size());
+		submitted++;
+	}
+
+private:
+	friend struct PushFrameScheduler;
+
+	unsigned char header[16] = {
+		0xFF, 0xCC, 0xAA, 0x88,
+		0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00 };
+
+	PushDisplayLink * link;
+	// Guards @pending and @submitted
+	std::mutex mutex;
+	std::vector<unsigned char> pending;
+	uint64_t submitted = 0;
+
+	// Scheduler thread
+	std::vector<unsigned char> sending;
+	uint64_t taken = 0;
+	// Next transfer of the frame being sent: 0 for the header, 1 + n for line n, -1 between frames
+	int position = -1;
+	uint64_t startNs = 0;
+
+	// Sends the next part of a frame. False if there was nothing to send.
+	bool step()
+	{
+		if (position < 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (submitted == taken)
+					return false;
+				if (submitted - taken > 1)
+					dropped(submitted - taken - 1);
+				taken = submitted;
+				pending.swap(sending);
+			}
+			position = 0;
+			startNs = PacketClockNow();
+		}
+
+		TRACE_SCOPE("USB send");
+		// The link is opening or closing the device
+		if (!link->beginTransfer())
+		{
+			abort();
+			return true;
+		}
+		PushTransport * transport = link->getTransport();
+		int end = std::min(position + PUSH_SCHEDULER_LINES_PER_TURN, PUSH2_DISPLAY_HEIGHT + 1);
+		for (; position < end; position++)
+		{
+			int actual_length;
+			int result;
+			if (position == 0)
+				result = transport->bulkTransfer(PUSH2_BULK_EP_OUT, header, sizeof(header), &actual_length, PUSH2_TRANSFER_TIMEOUT);
+			else
+				result = transport->bulkTransfer(PUSH2_BULK_EP_OUT, &sending[(PUSH2_DISPLAY_HEIGHT - position) * 1920], PUSH2_DISPLAY_LINE_BUFFER_SIZE, &actual_length, PUSH2_TRANSFER_TIMEOUT);
+			countTransfer(result);
+			if (result != 0)
+			{
+				link->endTransfer();
+				abort();
+				return true;
+			}
+		}
+		link->endTransfer();
+
+		if (position > PUSH2_DISPLAY_HEIGHT)
+		{
+			position = -1;
+			if (stats)
+				stats->frameSent(PacketClockNow() - startNs);
+		}
+		return true;
+	}
+
+	void abort()
+	{
+		position = -1;
+		dropped(1);
+	}
+
+	void countTransfer(int result)
+	{
+		if (result != 0)
+			link->transferFailed(result);
+		if (!stats)
+			return;
+		PushStats::add(stats->display.transfers, 1);
+		if (result != 0)
+			stats->usbError(result);
+	}
+
+	void dropped(uint64_t frames)
+	{
+		if (stats)
+			PushStats::add(stats->display.framesDropped, frames);
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// The one thread sending the frames of every Push 2 display in the Rack.
+// Displays take turns of PUSH_SCHEDULER_LINES_PER_TURN lines, round robin, so one busy or slow unit can't starve
+// the others of the bus and the UI thread never waits on USB. The thread runs while at least one queue is added.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushFrameScheduler {
+	static PushFrameScheduler& instance()
+	{
+		static PushFrameScheduler scheduler;
+		return scheduler;
+	}
+
+	// UI thread.
+	void add(PushFrameQueue * queue)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (std::find(queues.begin(), queues.end(), queue) != queues.end())
+			return;
+		queues.push_back(queue);
+		if (!thread.joinable())
+		{
+			running = true;
+			thread = std::thread(&PushFrameScheduler::run, this, ++generation);
+		}
+	}
+
+	// UI thread. Returns once the scheduler is done with @queue, a frame half sent is dropped. False if @queue
+	// wasn't added.
+	bool remove(PushFrameQueue * queue)
+	{
+		std::thread stopped;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = std::find(queues.begin(), queues.end(), queue);
+			if (it == queues.end())
+				return false;
+			queues.erase(it);
+			if (queue->position >= 0)
+				queue->abort();
+			if (queues.empty())
+			{
+				running = false;
+				stopped = std::move(thread);
+			}
+		}
+		wake.notify_one();
+		if (stopped.joinable())
+			stopped.join();
+		return true;
+	}
+
+	// Any thread. A frame was submitted.
+	void notify()
+	{
+		wake.notify_one();
+	}
+
+private:
+	// Held by the scheduler thread except while it sleeps
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<PushFrameQueue*> queues;
+	std::thread thread;
+	bool running = false;
+	// A thread being stopped can still be waking up when the next one starts, only the latest one runs
+	uint64_t generation = 0;
+
+	void run(uint64_t threadGeneration)
+	{
+		TRACE_THREAD_NAME("Push frames");
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t first = 0;
+		while (running && generation == threadGeneration)
+		{
+			bool busy = false;
+			size_t n = queues.size();
+			for (size_t i = 0; i < n; i++)
+				busy |= queues[(first + i) % n]->step();
+			// Nobody always goes first
+			first++;
+			if (!busy)
+			{
+				wake.wait_for(lock, std::chrono::milliseconds(PUSH_SCHEDULER_IDLE_MS));
+			}
+			else
+			{
+				// Let add() and remove() in between turns
+				lock.unlock();
+				std::this_thread::yield();
+				lock.lock();
+			}
+		}
+	}
+};
@@ -2,6 +2,12 @@
 #include "Controls.hpp"
 #include "PushMap.hpp"
 #include "Display.hpp"
+#include "ProcessProfile.hpp"
+#include "MidiSession.hpp"
+#include "PushStats.hpp"
+#include "Trace.hpp"
+#include "PushDeviceWorker.hpp"
+#include "PushMonitor.hpp"
 
 struct PushMap : Module {
 
@@ -11,6 +17,8 @@ struct PushMap : Module {
 		NUM_PARAMS
 	};
 	enum InputIds {
+		MONITOR_L_INPUT,
+		MONITOR_R_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -23,6 +31,10 @@ struct PushMap : Module {
 	enum LightIds {
 		NUM_LIGHTS
 	};
+	enum DeviceCommands {
+		LIGHTS_ON,
+		LIGHTS_OFF
+	};
 
 	const float updateFrequency = 400;
 	int sampleCounter = 0;
@@ -44,7 +56,28 @@ struct PushMap : Module {
 	midi::Output midiOutput;
 	midi::InputQueue midiInput;
 
-	bool connected;
+	/** MIDI output set and the lights driven, set by the device worker */
+	std::atomic<bool> connected;
+	/** Connects and disconnects the Push MIDI ports off the engine thread, which uses them only between
+	 * deviceWorker.tryUse() and endUse() */
+	PushDeviceWorker deviceWorker;
+	/** LIGHTS_PARAM value last posted to the device worker, -1 before the first */
+	int postedLights = -1;
+
+	/** Drive an in-memory Push 2 display instead of the USB one */
+	bool simulateDisplay = false;
+	/** Serial number or USB path of the Push 2 unit driven, empty for the first one free */
+	std::string pushDevice;
+
+	/** Cost of process() per sample rate and number of maps, off unless enabled from the menu */
+	ProcessProfile profile;
+	/** Records the MIDI processed, and plays recordings back in its place */
+	MidiSessionRecorder midiRecorder;
+	MidiSessionReplay midiReplay;
+	/** Counters of the performance HUD, toggled on the Push with Shift + Setup */
+	PushStats stats;
+	/** Scope, spectrum and meters of the inputs on the Push display, toggled with Shift + Mix */
+	PushMonitor monitor;
 
 	/** Number of maps */
 	int mapLen[NUM_GROUPS];
@@ -74,50 +107,150 @@ struct PushMap : Module {
 		msg.setChannel(1);
 		msg.setStatus(cmd);
 		midiOutput.sendMessage(msg);
+		PushStats::add(stats.engine.midiOut, 1);
         //DEBUG("%s %u %u", "sendMidi ", note, val);
 	}
 
 	void attachDisplay(Push2Display * display_) {
 		display = display_;
+		display->stats = &stats;
+		display->monitor = &monitor;
+		display->start();
+		monitor.start(&display->frames, &display->link, &stats);
+		if (simulateDisplay || !pushDevice.empty())
+			setSimulateDisplay(simulateDisplay);
+	}
+
+	void setSimulateDisplay(bool simulate) {
+		simulateDisplay = simulate;
+		if (display)
+			display->setTransport(simulate ? (PushTransport*) new FakePushTransport() : new LibusbPushTransport(pushDevice));
+	}
+
+	void setPushDevice(const std::string& selector) {
+		pushDevice = selector;
+		if (!simulateDisplay)
+			setSimulateDisplay(false);
+	}
+
+	/** The simulated display, NULL when the USB one is used */
+	FakePushTransport* fakeDisplay() {
+		return (display && simulateDisplay) ? static_cast<FakePushTransport*>(display->transport()) : NULL;
+	}
+
+	std::string midiSessionPath() {
+		return asset::user("PushMapVCV-MidiSession.pmmidi");
+	}
+
+	void startMidiRecording() {
+		midiRecorder.start(APP->engine->getSampleRate());
+	}
+
+	void stopMidiRecording() {
+		MidiSession session;
+		midiRecorder.stop(session);
+		std::string path = midiSessionPath();
+		if (session.save(path))
+			INFO("PushMap - Saved %d MIDI events to %s", (int) session.events.size(), path.c_str());
+		else
+			WARN("PushMap - Could not write MIDI session to %s", path.c_str());
+	}
+
+	void replayMidiSession(bool fast) {
+		MidiSession session;
+		std::string path = midiSessionPath();
+		if (!session.load(path)) {
+			WARN("PushMap - Could not read MIDI session from %s", path.c_str());
+			return;
+		}
+		if (!fast && session.sampleRate != APP->engine->getSampleRate())
+			INFO("PushMap - MIDI session recorded at %.0f Hz, replaying at %.0f Hz", session.sampleRate, APP->engine->getSampleRate());
+		midiReplay.load(session);
+		midiReplay.start(fast);
+	}
+
+	void saveDisplayReport() {
+		FakePushTransport* fake = fakeDisplay();
+		if (!fake)
+			return;
+		json_t* rootJ = fake->toJson();
+		std::string path = asset::user("PushMapVCV-DisplayTransport.json");
+		if (json_dump_file(rootJ, path.c_str(), JSON_INDENT(2)) == 0)
+			INFO("PushMap - Saved display transport report to %s", path.c_str());
+		else
+			WARN("PushMap - Could not write display transport report to %s", path.c_str());
+		json_decref(rootJ);
+	}
+
+	/** Device worker thread */
+	void handleDeviceCommand(int command) {
+		// The engine thread leaves the ports alone until the switch is over
+		deviceWorker.beginSwitch();
+		if (command == LIGHTS_ON)
+			connectPush();
+		else if (command == LIGHTS_OFF)
+			disconnectPush();
+		deviceWorker.endSwitch();
 	}
 
+	/** Device worker thread, while it holds the ports */
 	void disconnectPush() {
 		if (!connected) {
 			return;
 		}
 
+		connected = false;
 		for(int i = 0; i < 128; i ++) {
-			keyboard[i]->lightOff();
-			knobs[i]->lightOff();
+			keyboard[i]->lightOff(false);
+			knobs[i]->lightOff(false);
 		}
 
 		midiInput.setDeviceId(-1);
 		midiOutput.setDeviceId(-1);
-
-		connected = false;
 	}
 	
-	void connectPush() {
-		if (connected) {
-			return;
+	/** Device worker thread. Output port of the Push input port @inputId belongs to, -1 if none.
+	 * Units share port names, so the input that is the Nth of its name gets the Nth output of that name. Drivers naming
+	 * outputs differently from inputs get the Nth output containing the first three characters of the input name. */
+	int findPushOutput(int inputId) {
+		std::string inName = midiInput.getDeviceName(inputId);
+		if (inName.empty())
+			return -1;
+
+		int rank = 0;
+		for (int id : midiInput.getDeviceIds()) {
+			if (id == inputId)
+				break;
+			if (midiInput.getDeviceName(id) == inName)
+				rank++;
 		}
 
-		connected = true;
-    	auto findName = midiInput.getDeviceName(midiInput.deviceId).substr (0,3);
+		std::string findName = inName.substr(0, 3);
+		std::vector<int> sameName, similarName;
+		for (int id : midiOutput.getDeviceIds()) {
+			std::string outName = midiOutput.getDeviceName(id);
+			if (outName == inName)
+				sameName.push_back(id);
+			else if (outName.find(findName) != std::string::npos)
+				similarName.push_back(id);
+		}
+		std::vector<int>& candidates = sameName.empty() ? similarName : sameName;
+		if (candidates.empty())
+			return -1;
+		return candidates[std::min(rank, (int) candidates.size() - 1)];
+	}
 
-		if(findName.length()<1){
+	/** Device worker thread, while it holds the ports */
+	void connectPush() {
+		if (connected) {
 			return;
 		}
 
-		auto out_devs = midiOutput.getDeviceIds();
-		for (int i = 0; i < out_devs.size(); i++){
-
-			if (midiOutput.getDeviceName(out_devs[i]).find(findName) != std::string::npos) {
-				midiOutput.setDeviceId(out_devs[i]);
-				break;
-			}
-		}
+		int outputId = findPushOutput(midiInput.deviceId);
+		if (outputId >= 0)
+			midiOutput.setDeviceId(outputId);
 
+		connected = true;
 	}
 
 	PushMap() {
@@ -130,6 +263,8 @@ struct PushMap : Module {
 		for(int i = 0; i < 128; i ++) {
 			keyboard[i] = new PushKey(&midiOutput, i);
 			knobs[i] = new PushKnob(&midiOutput, i);
+			keyboard[i]->stats = &stats;
+			knobs[i]->stats = &stats;
 		}
 
 		for(int i = 0; i < NUM_GROUPS; i ++) {
@@ -145,9 +280,17 @@ struct PushMap : Module {
 		}
 
 		onReset();
+		deviceWorker.start([this](int command) { handleDeviceCommand(command); });
 	}
 
 	~PushMap() {
+		deviceWorker.stop();
+		monitor.stop();
+		// The display widget outlives the module by a little, its frames must stop using the counters first
+		if (display) {
+			display->monitor = nullptr;
+			display->stop();
+		}
 		for(int i = 0; i < 128; i ++) {
 			keyboard[i]->lightOff();
 			knobs[i]->lightOff();
@@ -178,6 +321,7 @@ struct PushMap : Module {
 	}
 
 	void lightUp() {
+		TRACE_SCOPE("lightUp");
 		for (int i = BASE_NOTE; i < BASE_NOTE + NOTES; i++) {
 			if (i == focusNote && focusPressed) {
 				keyboard[focusNote]->lightOn(126);
@@ -228,7 +372,9 @@ struct PushMap : Module {
 				values[focusGroup][ccs[focusGroup][i]] = paramQuantity->getScaledValue() * 127.f;
 		}
 
-		display->setLabelsAndValues(&mapLen[focusGroup], paramHandles[focusGroup], values[focusGroup], ccs[focusGroup]);
+		// No display without a widget, e.g. in the headless benchmark
+		if (display)
+			display->setLabelsAndValues(&mapLen[focusGroup], paramHandles[focusGroup], values[focusGroup], ccs[focusGroup]);
 	}
 
 	void processKnob(midi::Message msg) {
@@ -242,6 +388,16 @@ struct PushMap : Module {
 			return;
 		}
 
+		if (shiftMode && knobNum == SETUP && value) {
+			stats.hudVisible = !stats.hudVisible;
+			return;
+		}
+
+		if (shiftMode && knobNum == MIX && value) {
+			monitor.setEnabled(!monitor.isEnabled());
+			return;
+		}
+
 		if (knobNum == PLAY) {
 			if (value) {
 				outputs[GR_OUTPUT].setVoltage(10.f);
@@ -273,7 +429,8 @@ struct PushMap : Module {
 		if(values[focusGroup][knobNum] > 127) values[focusGroup][knobNum] = 127;
 		if(values[focusGroup][knobNum] < 0) values[focusGroup][knobNum] = 0;
 
-		display->setLabelsAndValues(&mapLen[focusGroup], paramHandles[focusGroup], values[focusGroup], ccs[focusGroup]);
+		if (display)
+			display->setLabelsAndValues(&mapLen[focusGroup], paramHandles[focusGroup], values[focusGroup], ccs[focusGroup]);
 	}
 
 	void processMidi(midi::Message msg) {
@@ -291,36 +448,56 @@ struct PushMap : Module {
 	}
 
 	void process(const ProcessArgs &args) override {
-
-		if ((int)params[DISPLAY_PARAM].getValue() == 1) {
-			if (display && !display->display_connected){
-				display->open();
-			}
+		uint64_t profileStart = profile.begin();
+		uint64_t hudStart = stats.beginProcess();
+		int midiEvents = 0;
+
+		if (display)
+			display->setEnabled((int)params[DISPLAY_PARAM].getValue() == 1);
+
+		if (monitor.isDrawing()) {
+			// Right follows left when only left is patched
+			float left = inputs[MONITOR_L_INPUT].getVoltage();
+			float right = inputs[MONITOR_R_INPUT].isConnected() ? inputs[MONITOR_R_INPUT].getVoltage() : left;
+			monitor.push(left, right, args.sampleRate);
 		}
 
-		if (params[DISPLAY_PARAM].getValue() == 0.f) {
-			if (display && display->display_connected){
-				display->close();
-			}
-		}
-
-
-		if ((int)params[LIGHTS_PARAM].getValue() == 1) {
-			connectPush();
-		}else{
-			disconnectPush();
-		}
+		// Opening and closing the MIDI ports may block, the device worker does it
+		int lights = (int)params[LIGHTS_PARAM].getValue();
+		if (lights != postedLights && deviceWorker.post(lights == 1 ? LIGHTS_ON : LIGHTS_OFF))
+			postedLights = lights;
 
 		if (sampleCounter > args.sampleRate / updateFrequency) {
 
-			midi::Message msg;
-			while (midiInput.shift(&msg)) {
-				processMidi(msg);
+			// While the worker switches the ports, incoming MIDI waits in the queue and the lights for the next update
+			bool ports = deviceWorker.tryUse();
+			{
+				TRACE_SCOPE("MIDI drain");
+				midi::Message msg;
+				while (ports && midiInput.shift(&msg)) {
+					// Live input would make a replay diverge from the recording
+					if (midiReplay.isPlaying())
+						continue;
+					midiRecorder.record(msg);
+					processMidi(msg);
+					midiEvents++;
+				}
+				midiReplay.play([&](const midi::Message& replayed) {
+					processMidi(replayed);
+					midiEvents++;
+				});
+				midiRecorder.advance();
+				midiReplay.advance();
 			}
 
-			lightUp();
+			if (ports) {
+				if (connected)
+					lightUp();
+				deviceWorker.endUse();
+			}
 
 			// Step channels
+			TRACE_SCOPE("smoothing");
 			for (int id = 0; id < mapLen[focusGroup]; id++) {
 				int cc = ccs[focusGroup][id];
 				if (cc < 0)
@@ -361,6 +538,12 @@ struct PushMap : Module {
 			sampleCounter = 0;
 		}
 		sampleCounter ++;
+
+		if (profileStart)
+			profile.end(profileStart, args.sampleRate, mapLen[focusGroup], midiEvents);
+		if (midiEvents)
+			PushStats::add(stats.engine.midiIn, midiEvents);
+		stats.endProcess(hudStart);
 	}
 
 	void clearMap(int id) {
@@ -489,6 +672,9 @@ struct PushMap : Module {
 		}
 
 		json_object_set_new(rootJ, "midi", midiInput.toJson());
+		json_object_set_new(rootJ, "simulateDisplay", json_boolean(simulateDisplay));
+		json_object_set_new(rootJ, "pushDevice", json_string(pushDevice.c_str()));
+		json_object_set_new(rootJ, "monitor", json_boolean(monitor.isEnabled()));
 
 		json_t* midiJ = json_object_get(rootJ, "midi");
 		if (midiJ)
@@ -566,6 +752,22 @@ struct PushMap : Module {
 		if (midiJ)
 			midiInput.fromJson(midiJ);
 
+		json_t* monitorJ = json_object_get(rootJ, "monitor");
+		if (monitorJ)
+			monitor.setEnabled(json_is_true(monitorJ));
+
+		std::string device = pushDevice;
+		json_t* pushDeviceJ = json_object_get(rootJ, "pushDevice");
+		if (pushDeviceJ && json_is_string(pushDeviceJ))
+			device = json_string_value(pushDeviceJ);
+		bool simulate = simulateDisplay;
+		json_t* simulateDisplayJ = json_object_get(rootJ, "simulateDisplay");
+		if (simulateDisplayJ)
+			simulate = json_is_true(simulateDisplayJ);
+		if (device != pushDevice || simulate != simulateDisplay) {
+			pushDevice = device;
+			setSimulateDisplay(simulate);
+		}
 	}
 
 };
@@ -776,6 +978,9 @@ struct PushMapWidget : ModuleWidget {
 		addParam(createParam<CKSS>(mm2px(Vec(23.151, 97.794)), module, PushMap::DISPLAY_PARAM));
 		addParam(createParam<CKSS>(mm2px(Vec(23.204, 111.178)), module, PushMap::LIGHTS_PARAM));
 
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(6.554, 96.5)), module, PushMap::MONITOR_L_INPUT));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(16.416, 96.5)), module, PushMap::MONITOR_R_INPUT));
+
 		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(6.554, 106.694)), module, PushMap::CVOUT_OUTPUT));
 		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(16.416, 106.694)), module, PushMap::GATEOUT_OUTPUT));
 		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(34.745, 106.694)), module, PushMap::GR_OUTPUT));
@@ -796,6 +1001,245 @@ struct PushMapWidget : ModuleWidget {
 
 	}
 
+	void appendContextMenu(Menu* menu) override {
+		PushMap* module = dynamic_cast<PushMap*>(this->module);
+		if (!module)
+			return;
+
+		struct SimulateDisplayItem : MenuItem {
+			PushMap* module;
+			void onAction(const event::Action& e) override {
+				module->setSimulateDisplay(!module->simulateDisplay);
+			}
+		};
+		struct PushDeviceItem : MenuItem {
+			PushMap* module;
+			std::string selector;
+			void onAction(const event::Action& e) override {
+				module->setPushDevice(selector);
+			}
+		};
+		struct CaptureItem : MenuItem {
+			FakePushTransport* fake;
+			void onAction(const event::Action& e) override {
+				if (fake->getCaptureDir().empty()) {
+					std::string dir = asset::user("PushMapVCV-Display");
+					system::createDirectory(dir);
+					fake->setCaptureDir(dir);
+				}
+				else {
+					fake->setCaptureDir("");
+				}
+			}
+		};
+		struct UnplugItem : MenuItem {
+			FakePushTransport* fake;
+			void onAction(const event::Action& e) override {
+				fake->plugged = !fake->plugged;
+			}
+		};
+		struct LatencyItem : MenuItem {
+			FakePushTransport* fake;
+			void onAction(const event::Action& e) override {
+				fake->latencyUs = fake->latencyUs ? 0 : 1000;
+			}
+		};
+		struct StallItem : MenuItem {
+			FakePushTransport* fake;
+			void onAction(const event::Action& e) override {
+				fake->stallEvery = fake->stallEvery ? 0 : 100;
+			}
+		};
+		struct SaveDisplayReportItem : MenuItem {
+			PushMap* module;
+			void onAction(const event::Action& e) override {
+				module->saveDisplayReport();
+			}
+		};
+
+		struct HudItem : MenuItem {
+			PushMap* module;
+			void onAction(const event::Action& e) override {
+				module->stats.hudVisible = !module->stats.hudVisible;
+			}
+		};
+		struct MonitorItem : MenuItem {
+			PushMap* module;
+			void onAction(const event::Action& e) override {
+				module->monitor.setEnabled(!module->monitor.isEnabled());
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		HudItem* hudItem = new HudItem;
+		hudItem->text = "Performance HUD on the Push display (Shift+Setup)";
+		hudItem->rightText = CHECKMARK(module->stats.hudVisible);
+		hudItem->module = module;
+		menu->addChild(hudItem);
+
+		MonitorItem* monitorItem = new MonitorItem;
+		monitorItem->text = "Scope, spectrum and meters of the inputs (Shift+Mix)";
+		monitorItem->rightText = CHECKMARK(module->monitor.isEnabled());
+		monitorItem->module = module;
+		menu->addChild(monitorItem);
+
+		SimulateDisplayItem* simulateItem = new SimulateDisplayItem;
+		simulateItem->text = "Simulate Push 2 display (no USB)";
+		simulateItem->rightText = CHECKMARK(module->simulateDisplay);
+		simulateItem->module = module;
+		menu->addChild(simulateItem);
+
+		if (module->display) {
+			MenuLabel* linkLabel = new MenuLabel;
+			PushDisplayLink& link = module->display->link;
+			const char* linkStates[3] = {"closed", "connecting", "open"};
+			linkLabel->text = string::f("Display %s, %d opens, %d failed (%s)", linkStates[link.getState()], (int) link.opens,
+				(int) link.failures, link.hasHotplug() ? "hotplug" : "polling");
+			LibusbPushTransport* usb = dynamic_cast<LibusbPushTransport*>(module->display->transport());
+			if (usb) {
+				PushDeviceInfo opened = usb->openedDevice();
+				if (!opened.path.empty())
+					linkLabel->text += string::f(", USB %s", opened.path.c_str());
+			}
+			menu->addChild(linkLabel);
+		}
+
+		if (!module->simulateDisplay) {
+			MenuLabel* unitLabel = new MenuLabel;
+			unitLabel->text = "Push 2 unit";
+			menu->addChild(unitLabel);
+
+			PushDeviceItem* anyItem = new PushDeviceItem;
+			anyItem->text = "First one free";
+			anyItem->rightText = CHECKMARK(module->pushDevice.empty());
+			anyItem->module = module;
+			menu->addChild(anyItem);
+
+			bool listed = false;
+			for (const PushDeviceInfo& device : LibusbPushTransport::enumerate()) {
+				bool selected = !module->pushDevice.empty() && (module->pushDevice == device.serial || module->pushDevice == device.path);
+				listed |= selected;
+				PushDeviceItem* deviceItem = new PushDeviceItem;
+				// The serial follows the unit to another port, the path is all there is without one
+				deviceItem->selector = device.serial.empty() ? device.path : device.serial;
+				deviceItem->text = device.serial.empty() ? "USB " + device.path : string::f("%s (USB %s)", device.serial.c_str(), device.path.c_str());
+				deviceItem->rightText = CHECKMARK(selected);
+				deviceItem->module = module;
+				menu->addChild(deviceItem);
+			}
+			if (!module->pushDevice.empty() && !listed) {
+				PushDeviceItem* missingItem = new PushDeviceItem;
+				missingItem->selector = module->pushDevice;
+				missingItem->text = module->pushDevice + " (not plugged in)";
+				missingItem->rightText = CHECKMARK(true);
+				missingItem->module = module;
+				menu->addChild(missingItem);
+			}
+		}
+
+		FakePushTransport* fake = module->fakeDisplay();
+		if (fake) {
+			FakePushTransport::Counters counters = fake->counters();
+			MenuLabel* statsLabel = new MenuLabel;
+			statsLabel->text = string::f("%.1f fps, %.1f MB/s, %d stalls, %d dropped frames",
+				counters.framesPerSecond(), counters.megabytesPerSecond(), (int) counters.stalls, (int) counters.droppedFrames);
+			menu->addChild(statsLabel);
+
+			UnplugItem* unplugItem = new UnplugItem;
+			unplugItem->text = "Unplug simulated display";
+			unplugItem->rightText = CHECKMARK(!fake->plugged);
+			unplugItem->fake = fake;
+			menu->addChild(unplugItem);
+
+			CaptureItem* captureItem = new CaptureItem;
+			captureItem->text = "Capture frames to PNG";
+			captureItem->rightText = CHECKMARK(!fake->getCaptureDir().empty());
+			captureItem->fake = fake;
+			menu->addChild(captureItem);
+
+			LatencyItem* latencyItem = new LatencyItem;
+			latencyItem->text = "Add 1 ms to every transfer";
+			latencyItem->rightText = CHECKMARK(fake->latencyUs);
+			latencyItem->fake = fake;
+			menu->addChild(latencyItem);
+
+			StallItem* stallItem = new StallItem;
+			stallItem->text = "Stall every 100th transfer";
+			stallItem->rightText = CHECKMARK(fake->stallEvery);
+			stallItem->fake = fake;
+			menu->addChild(stallItem);
+
+			SaveDisplayReportItem* saveItem = new SaveDisplayReportItem;
+			saveItem->text = "Save display transport report (JSON)";
+			saveItem->module = module;
+			menu->addChild(saveItem);
+		}
+
+		struct RecordMidiItem : MenuItem {
+			PushMap* module;
+			void onAction(const event::Action& e) override {
+				if (module->midiRecorder.isRecording())
+					module->stopMidiRecording();
+				else
+					module->startMidiRecording();
+			}
+		};
+		struct ReplayMidiItem : MenuItem {
+			PushMap* module;
+			bool fast;
+			void onAction(const event::Action& e) override {
+				if (module->midiReplay.isPlaying())
+					module->midiReplay.stop();
+				else
+					module->replayMidiSession(fast);
+			}
+		};
+
+		menu->addChild(new MenuSeparator);
+		MenuLabel* sessionLabel = new MenuLabel;
+		if (module->midiRecorder.isRecording())
+			sessionLabel->text = string::f("MIDI session: recording, %d events", (int) module->midiRecorder.size());
+		else if (module->midiReplay.isPlaying())
+			sessionLabel->text = string::f("MIDI session: replaying %d events%s", (int) module->midiReplay.size(), module->midiReplay.isFast() ? " (fast)" : "");
+		else if (module->midiReplay.eventsPerSecond() > 0)
+			sessionLabel->text = string::f("MIDI session: last fast replay %.0f events/s", module->midiReplay.eventsPerSecond());
+		else
+			sessionLabel->text = "MIDI session";
+		menu->addChild(sessionLabel);
+
+		if (!module->midiReplay.isPlaying()) {
+			RecordMidiItem* recordItem = new RecordMidiItem;
+			recordItem->text = module->midiRecorder.isRecording() ? "Stop recording and save" : "Record MIDI session";
+			recordItem->module = module;
+			menu->addChild(recordItem);
+		}
+
+		if (!module->midiRecorder.isRecording()) {
+			if (module->midiReplay.isPlaying()) {
+				ReplayMidiItem* stopItem = new ReplayMidiItem;
+				stopItem->text = "Stop replay";
+				stopItem->module = module;
+				menu->addChild(stopItem);
+			}
+			else {
+				ReplayMidiItem* replayItem = new ReplayMidiItem;
+				replayItem->text = "Replay MIDI session";
+				replayItem->module = module;
+				replayItem->fast = false;
+				menu->addChild(replayItem);
+
+				ReplayMidiItem* fastItem = new ReplayMidiItem;
+				fastItem->text = "Replay MIDI session as fast as possible";
+				fastItem->module = module;
+				fastItem->fast = true;
+				menu->addChild(fastItem);
+			}
+		}
+
+		appendProfileMenu(menu, &module->profile, "PushMap");
+		appendTraceMenu(menu);
+	}
+
 };
 
 
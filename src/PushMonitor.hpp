@@ -0,0 +1,416 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "PushMap.hpp"
+#include "PushDisplayLink.hpp"
+#include "PushFrameScheduler.hpp"
+#include "PushStats.hpp"
+#include "Trace.hpp"
+
+// Stereo samples the engine thread can be ahead of the monitor thread, a power of two.
+#define PUSH_MONITOR_RING_FRAMES	(1 << 16)
+#define PUSH_MONITOR_FPS			60
+// Samples per spectrum, a power of two.
+#define PUSH_MONITOR_FFT_SIZE		2048
+// Time across the scope.
+#define PUSH_MONITOR_SCOPE_MS		100
+// Voltage read as 0 dBFS, Rack's audio level.
+#define PUSH_MONITOR_FULL_SCALE		5.f
+
+// Layout, left to right: scope, spectrum from 20 Hz to 20 kHz, then the left and right meters.
+#define PUSH_MONITOR_SCOPE_WIDTH	480
+#define PUSH_MONITOR_SPECTRUM_X		488
+#define PUSH_MONITOR_SPECTRUM_WIDTH	336
+#define PUSH_MONITOR_METERS_X		856
+#define PUSH_MONITOR_METER_WIDTH	40
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Scope, spectrum and level meters of two inputs on the Push 2 display.
+// The engine thread only stores samples in a single producer, single consumer ring. The monitor thread takes them
+// PUSH_MONITOR_FPS times a second: min/max per scope column, an FFT of the last PUSH_MONITOR_FFT_SIZE samples and
+// peak and RMS levels. It draws the frame itself, in the Push's pixel format, and hands it to the frame scheduler,
+// so neither the engine thread nor the UI thread's GL context do any of the work.
+// The HUD takes precedence: the monitor pauses while it is shown.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushMonitor {
+	PushMonitor() : fft(PUSH_MONITOR_FFT_SIZE)
+	{
+		head = 0;
+		tail = 0;
+		enabled = false;
+		running = false;
+		sampleRate = 44100.f;
+		ring.resize(PUSH_MONITOR_RING_FRAMES);
+		history.resize(PUSH_MONITOR_FFT_SIZE);
+		// The FFT wants 16 byte aligned buffers, which is what the allocator gives on the platforms Rack runs on
+		fftIn.resize(PUSH_MONITOR_FFT_SIZE);
+		fftOut.resize(PUSH_MONITOR_FFT_SIZE);
+		spectrumDb.resize(PUSH_MONITOR_SPECTRUM_WIDTH);
+		pixels.resize(PUSH2_DISPLAY_WIDTH * PUSH2_DISPLAY_HEIGHT);
+		image.resize(PUSH2_DISPLAY_IMAGE_BUFFER_SIZE);
+		for (int c = 0; c < 2; c++)
+		{
+			columnMin[c].resize(PUSH_MONITOR_SCOPE_WIDTH);
+			columnMax[c].resize(PUSH_MONITOR_SCOPE_WIDTH);
+		}
+		reset();
+	}
+
+	~PushMonitor()
+	{
+		stop();
+	}
+
+	// UI thread. Frames go to @queue while @link is open.
+	void start(PushFrameQueue * queue_, PushDisplayLink * link_, PushStats * stats_)
+	{
+		if (running)
+			return;
+		queue = queue_;
+		link = link_;
+		stats = stats_;
+		running = true;
+		thread = std::thread(&PushMonitor::run, this);
+	}
+
+	// UI thread.
+	void stop()
+	{
+		running = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	// Any thread.
+	void setEnabled(bool enabled_)
+	{
+		enabled = enabled_;
+	}
+
+	bool isEnabled() const
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	// Whether the monitor has the display, rather than the param page or the HUD.
+	bool isDrawing() const
+	{
+		return isEnabled() && !(stats && stats->hudVisible.load(std::memory_order_relaxed));
+	}
+
+	// Engine thread only. Dropped if the monitor thread fell a whole ring behind.
+	void push(float left, float right, float sampleRate_)
+	{
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= PUSH_MONITOR_RING_FRAMES)
+			return;
+		Frame& frame = ring[h & (PUSH_MONITOR_RING_FRAMES - 1)];
+		frame.v[0] = left;
+		frame.v[1] = right;
+		head.store(h + 1, std::memory_order_release);
+		if (sampleRate.load(std::memory_order_relaxed) != sampleRate_)
+			sampleRate.store(sampleRate_, std::memory_order_relaxed);
+	}
+
+private:
+	struct Frame {
+		float v[2];
+	};
+
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> enabled;
+	PushFrameQueue * queue = NULL;
+	PushDisplayLink * link = NULL;
+	PushStats * stats = NULL;
+
+	std::vector<Frame> ring;
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	std::atomic<float> sampleRate;
+
+	// Monitor thread from here on
+	// Scope: min and max of each column, the next one is written at @column
+	std::vector<float> columnMin[2];
+	std::vector<float> columnMax[2];
+	int column;
+	int columnFill;
+	float nextMin[2];
+	float nextMax[2];
+
+	// Spectrum: the last samples, mid of both inputs, oldest at @historyPos
+	std::vector<float> history;
+	int historyPos;
+	dsp::RealFFT fft;
+	std::vector<float> fftIn;
+	std::vector<float> fftOut;
+	std::vector<float> spectrumDb;
+
+	// Meters: held peak and smoothed mean square, linear, full scale is 1
+	float peak[2];
+	float meanSquare[2];
+
+	std::vector<uint16_t> pixels;
+	std::vector<unsigned char> image;
+
+	void reset()
+	{
+		for (int c = 0; c < 2; c++)
+		{
+			std::fill(columnMin[c].begin(), columnMin[c].end(), 0.f);
+			std::fill(columnMax[c].begin(), columnMax[c].end(), 0.f);
+			nextMin[c] = INFINITY;
+			nextMax[c] = -INFINITY;
+			peak[c] = 0.f;
+			meanSquare[c] = 0.f;
+		}
+		column = 0;
+		columnFill = 0;
+		std::fill(history.begin(), history.end(), 0.f);
+		historyPos = 0;
+		std::fill(spectrumDb.begin(), spectrumDb.end(), -120.f);
+	}
+
+	void run()
+	{
+		TRACE_THREAD_NAME("Push monitor");
+		typedef std::chrono::steady_clock Clock;
+		const Clock::duration period = std::chrono::microseconds(1000000 / PUSH_MONITOR_FPS);
+		Clock::time_point next = Clock::now();
+		bool wasDrawing = false;
+		while (running)
+		{
+			bool drawing = isDrawing();
+			if (drawing)
+			{
+				// Samples left from the last time are stale
+				if (!wasDrawing)
+				{
+					tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+					reset();
+				}
+				analyse();
+				if (link->isOpen())
+				{
+					render();
+					queue->submit(image.data());
+					PushFrameScheduler::instance().notify();
+				}
+			}
+			wasDrawing = drawing;
+
+			next += period;
+			Clock::time_point now = Clock::now();
+			// Late, start again from now rather than catch up
+			if (next < now)
+				next = now;
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+	void analyse()
+	{
+		TRACE_SCOPE("monitor analyse");
+		float rate = sampleRate.load(std::memory_order_relaxed);
+		int perColumn = std::max(1, (int) std::round(rate * PUSH_MONITOR_SCOPE_MS / 1000.f / PUSH_MONITOR_SCOPE_WIDTH));
+		float tickPeak[2] = {0.f, 0.f};
+		float tickSum[2] = {0.f, 0.f};
+
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		uint32_t h = head.load(std::memory_order_acquire);
+		uint32_t count = h - t;
+		for (; t != h; t++)
+		{
+			const Frame& frame = ring[t & (PUSH_MONITOR_RING_FRAMES - 1)];
+			for (int c = 0; c < 2; c++)
+			{
+				float v = frame.v[c] / PUSH_MONITOR_FULL_SCALE;
+				nextMin[c] = std::min(nextMin[c], v);
+				nextMax[c] = std::max(nextMax[c], v);
+				tickPeak[c] = std::max(tickPeak[c], std::fabs(v));
+				tickSum[c] += v * v;
+			}
+			if (++columnFill >= perColumn)
+			{
+				for (int c = 0; c < 2; c++)
+				{
+					columnMin[c][column] = nextMin[c];
+					columnMax[c][column] = nextMax[c];
+					nextMin[c] = INFINITY;
+					nextMax[c] = -INFINITY;
+				}
+				column = (column + 1) % PUSH_MONITOR_SCOPE_WIDTH;
+				columnFill = 0;
+			}
+			history[historyPos] = 0.5f * (frame.v[0] + frame.v[1]);
+			historyPos = (historyPos + 1) & (PUSH_MONITOR_FFT_SIZE - 1);
+		}
+		tail.store(t, std::memory_order_release);
+
+		// Peaks fall 20 dB a second, RMS is averaged over about 300 ms
+		const float peakFall = std::pow(10.f, -20.f / 20.f / PUSH_MONITOR_FPS);
+		const float rmsLambda = 1.f - std::exp(-1.f / (0.3f * PUSH_MONITOR_FPS));
+		for (int c = 0; c < 2; c++)
+		{
+			peak[c] = std::max(tickPeak[c], peak[c] * peakFall);
+			if (count)
+				meanSquare[c] += (tickSum[c] / count - meanSquare[c]) * rmsLambda;
+		}
+
+		spectrum(rate);
+	}
+
+	void spectrum(float rate)
+	{
+		const int n = PUSH_MONITOR_FFT_SIZE;
+		for (int i = 0; i < n; i++)
+		{
+			float hann = 0.5f * (1.f - std::cos(2.f * M_PI * i / (n - 1)));
+			fftIn[i] = history[(historyPos + i) & (n - 1)] * hann;
+		}
+		fft.rfft(fftIn.data(), fftOut.data());
+
+		// A sine of amplitude A peaks at A * n / 4 through the Hann window
+		const float scaleDb = 20.f * std::log10(4.f / n / PUSH_MONITOR_FULL_SCALE);
+		// Bands fall 60 dB a second
+		const float fall = 60.f / PUSH_MONITOR_FPS;
+		for (int x = 0; x < PUSH_MONITOR_SPECTRUM_WIDTH; x++)
+		{
+			float f0 = spectrumFrequency(x);
+			float f1 = spectrumFrequency(x + 1);
+			int bin0 = std::max(1, (int) (f0 * n / rate));
+			int bin1 = std::max(bin0, (int) (f1 * n / rate));
+			float power = 0.f;
+			for (int bin = bin0; bin <= bin1 && bin < n / 2; bin++)
+			{
+				float re = fftOut[2 * bin];
+				float im = fftOut[2 * bin + 1];
+				power = std::max(power, re * re + im * im);
+			}
+			float db = (power > 0.f) ? 10.f * std::log10(power) + scaleDb : -120.f;
+			spectrumDb[x] = std::max(db, spectrumDb[x] - fall);
+		}
+	}
+
+	// BGR565, red in the low bits, as the Push 2 takes it.
+	static uint16_t rgb(int r, int g, int b)
+	{
+		return (uint16_t) ((r >> 3) | ((g >> 2) << 5) | ((b >> 3) << 11));
+	}
+
+	void vline(int x, int y0, int y1, uint16_t color)
+	{
+		if (y0 > y1)
+			std::swap(y0, y1);
+		y0 = std::max(y0, 0);
+		y1 = std::min(y1, PUSH2_DISPLAY_HEIGHT - 1);
+		for (int y = y0; y <= y1; y++)
+			pixels[y * PUSH2_DISPLAY_WIDTH + x] = color;
+	}
+
+	void hline(int x0, int x1, int y, uint16_t color)
+	{
+		if (y < 0 || y >= PUSH2_DISPLAY_HEIGHT)
+			return;
+		std::fill(&pixels[y * PUSH2_DISPLAY_WIDTH + x0], &pixels[y * PUSH2_DISPLAY_WIDTH + x1], color);
+	}
+
+	// @v in full scales, +-1 spans the height.
+	static int scopeY(float v)
+	{
+		return (int) std::round(PUSH2_DISPLAY_HEIGHT / 2 - v * (PUSH2_DISPLAY_HEIGHT / 2 - 4));
+	}
+
+	// Log scale, 20 Hz to 20 kHz.
+	static float spectrumFrequency(int x)
+	{
+		return 20.f * std::pow(1000.f, (float) x / PUSH_MONITOR_SPECTRUM_WIDTH);
+	}
+
+	static int spectrumX(float frequency)
+	{
+		return (int) std::round(std::log10(frequency / 20.f) / 3.f * PUSH_MONITOR_SPECTRUM_WIDTH);
+	}
+
+	// -90 to 0 dBFS.
+	static int spectrumY(float db)
+	{
+		db = std::min(std::max(db, -90.f), 0.f);
+		return (int) std::round(PUSH2_DISPLAY_HEIGHT - 1 - (db + 90.f) / 90.f * (PUSH2_DISPLAY_HEIGHT - 8));
+	}
+
+	// -60 to +6 dBFS.
+	static int meterY(float db)
+	{
+		db = std::min(std::max(db, -60.f), 6.f);
+		return (int) std::round(PUSH2_DISPLAY_HEIGHT - 1 - (db + 60.f) / 66.f * (PUSH2_DISPLAY_HEIGHT - 8));
+	}
+
+	static float toDb(float level)
+	{
+		return (level > 0.f) ? 20.f * std::log10(level) : -120.f;
+	}
+
+	void render()
+	{
+		TRACE_SCOPE("monitor render");
+		const uint16_t grid = rgb(48, 48, 48);
+		std::fill(pixels.begin(), pixels.end(), 0);
+
+		// Scope, oldest column on the left
+		hline(0, PUSH_MONITOR_SCOPE_WIDTH, scopeY(0.f), grid);
+		const uint16_t channelColors[2] = {rgb(230, 230, 230), rgb(64, 190, 255)};
+		for (int c = 1; c >= 0; c--)
+		{
+			for (int x = 0; x < PUSH_MONITOR_SCOPE_WIDTH; x++)
+			{
+				int i = (column + x) % PUSH_MONITOR_SCOPE_WIDTH;
+				vline(x, scopeY(columnMax[c][i]), scopeY(columnMin[c][i]), channelColors[c]);
+			}
+		}
+
+		// Spectrum, grid every 20 dB and at 100 Hz, 1 kHz and 10 kHz
+		for (int db = -20; db >= -80; db -= 20)
+			hline(PUSH_MONITOR_SPECTRUM_X, PUSH_MONITOR_SPECTRUM_X + PUSH_MONITOR_SPECTRUM_WIDTH, spectrumY(db), grid);
+		for (float f = 100.f; f < 20000.f; f *= 10.f)
+			vline(PUSH_MONITOR_SPECTRUM_X + spectrumX(f), 0, PUSH2_DISPLAY_HEIGHT - 1, grid);
+		for (int x = 0; x < PUSH_MONITOR_SPECTRUM_WIDTH; x++)
+			vline(PUSH_MONITOR_SPECTRUM_X + x, spectrumY(spectrumDb[x]), PUSH2_DISPLAY_HEIGHT - 1, rgb(255, 140, 0));
+
+		// Meters: RMS bar, green up to -6 dB, yellow to 0 dB, red above, and the held peak
+		for (int db = 0; db >= -48; db -= 12)
+			hline(PUSH_MONITOR_METERS_X - 8, PUSH2_DISPLAY_WIDTH - 4, meterY(db), db == 0 ? rgb(120, 0, 0) : grid);
+		for (int c = 0; c < 2; c++)
+		{
+			int x0 = PUSH_MONITOR_METERS_X + c * (PUSH_MONITOR_METER_WIDTH + 8);
+			int top = meterY(toDb(std::sqrt(meanSquare[c])));
+			for (int y = top; y < PUSH2_DISPLAY_HEIGHT; y++)
+			{
+				uint16_t color = (y < meterY(0.f)) ? rgb(255, 40, 40) : (y < meterY(-6.f)) ? rgb(255, 220, 0) : rgb(0, 200, 80);
+				hline(x0, x0 + PUSH_MONITOR_METER_WIDTH, y, color);
+			}
+			int peakY = meterY(toDb(peak[c]));
+			hline(x0, x0 + PUSH_MONITOR_METER_WIDTH, peakY, rgb(255, 255, 255));
+			hline(x0, x0 + PUSH_MONITOR_METER_WIDTH, peakY + 1, rgb(255, 255, 255));
+		}
+
+		// Bottom line first, as glReadPixels leaves it, and XORed like the rendered frames
+		static const unsigned char pattern[4] = {0xE7, 0xF3, 0xE7, 0xFF};
+		for (int y = 0; y < PUSH2_DISPLAY_HEIGHT; y++)
+		{
+			const uint16_t * src = &pixels[y * PUSH2_DISPLAY_WIDTH];
+			unsigned char * dst = &image[(PUSH2_DISPLAY_HEIGHT - 1 - y) * PUSH2_DISPLAY_WIDTH * 2];
+			for (int x = 0; x < PUSH2_DISPLAY_WIDTH; x++)
+			{
+				dst[2 * x] = (unsigned char) (src[x] & 0xff) ^ pattern[(2 * x) & 3];
+				dst[2 * x + 1] = (unsigned char) (src[x] >> 8) ^ pattern[(2 * x + 1) & 3];
+			}
+		}
+	}
+};
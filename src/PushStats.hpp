@@ -0,0 +1,183 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "../lib/oscpack/ip/PacketListener.h"
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Running totals behind the Push 2 performance HUD.
+// Each counter has a single writer, the engine, UI or frame scheduler thread, and only ever grows, so writers
+// never wait and readers take rates from the difference of two reads. Peaks are the exception: the reader takes
+// and clears them, a peak that races with the clear may land in the next second.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushStats {
+	// Engine thread.
+	struct Engine {
+		// process() calls timed and the time they took, only while the HUD is shown
+		std::atomic<uint64_t> processCalls;
+		std::atomic<uint64_t> processNs;
+		std::atomic<uint64_t> processPeakNs;
+		std::atomic<uint64_t> midiIn;
+		// Every message sent, and the ones that set a pad or button light
+		std::atomic<uint64_t> midiOut;
+		std::atomic<uint64_t> ledOut;
+	};
+	// Display. @framesRendered is the UI thread's, drawing the framebuffer, the rest the frame scheduler's.
+	struct Display {
+		std::atomic<uint64_t> framesRendered;
+		std::atomic<uint64_t> framesSent;
+		// Rendered but not sent: replaced by a newer frame before its turn, or a transfer failed
+		std::atomic<uint64_t> framesDropped;
+		// Time to send a whole frame, header and lines
+		std::atomic<uint64_t> sendNs;
+		std::atomic<uint64_t> sendPeakNs;
+		std::atomic<uint64_t> transfers;
+		std::atomic<uint64_t> usbErrors;
+		// libusb code of the last failed transfer
+		std::atomic<int> lastUsbError;
+	};
+
+	Engine engine;
+	Display display;
+	std::atomic<bool> hudVisible;
+
+	PushStats()
+	{
+		hudVisible = false;
+		engine.processCalls = 0;
+		engine.processNs = 0;
+		engine.processPeakNs = 0;
+		engine.midiIn = 0;
+		engine.midiOut = 0;
+		engine.ledOut = 0;
+		display.framesRendered = 0;
+		display.framesSent = 0;
+		display.framesDropped = 0;
+		display.sendNs = 0;
+		display.sendPeakNs = 0;
+		display.transfers = 0;
+		display.usbErrors = 0;
+		display.lastUsbError = 0;
+	}
+
+	// Engine thread. Start time of the call, 0 unless the HUD is shown.
+	uint64_t beginProcess() const
+	{
+		return hudVisible.load(std::memory_order_relaxed) ? PacketClockNow() : 0;
+	}
+
+	void endProcess(uint64_t startNs)
+	{
+		if (startNs == 0)
+			return;
+		uint64_t ns = PacketClockNow() - startNs;
+		add(engine.processCalls, 1);
+		add(engine.processNs, ns);
+		peak(engine.processPeakNs, ns);
+	}
+
+	// Frame scheduler thread. @ns is the time from the frame's first transfer to its last.
+	void frameSent(uint64_t ns)
+	{
+		add(display.framesSent, 1);
+		add(display.sendNs, ns);
+		peak(display.sendPeakNs, ns);
+	}
+
+	void usbError(int code)
+	{
+		add(display.usbErrors, 1);
+		display.lastUsbError.store(code, std::memory_order_relaxed);
+	}
+
+	// Owner thread of @counter only: a plain load and store, no read-modify-write.
+	static void add(std::atomic<uint64_t>& counter, uint64_t n)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	static void peak(std::atomic<uint64_t>& counter, uint64_t ns)
+	{
+		if (ns > counter.load(std::memory_order_relaxed))
+			counter.store(ns, std::memory_order_relaxed);
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Per second rates of a PushStats, refreshed once a second by the thread drawing the HUD.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushStatsRates {
+	double processMeanNs = 0.0;
+	double processPeakNs = 0.0;
+	// Share of the engine thread spent in process()
+	double processLoad = 0.0;
+	double midiIn = 0.0;
+	double midiOut = 0.0;
+	double ledOut = 0.0;
+	double framesRendered = 0.0;
+	double framesSent = 0.0;
+	double framesDropped = 0.0;
+	double sendMeanNs = 0.0;
+	double sendPeakNs = 0.0;
+	double transferMeanNs = 0.0;
+	uint64_t usbErrors = 0;
+	int lastUsbError = 0;
+
+	// True when the rates were refreshed.
+	bool update(PushStats& stats)
+	{
+		uint64_t now = PacketClockNow();
+		if (lastNs != 0 && now - lastNs < 1000000000ull)
+			return false;
+		Totals t;
+		t.read(stats);
+		if (lastNs != 0)
+		{
+			double seconds = (now - lastNs) / 1e9;
+			uint64_t calls = t.processCalls - last.processCalls;
+			uint64_t sent = t.framesSent - last.framesSent;
+			uint64_t transfers = t.transfers - last.transfers;
+			processMeanNs = calls ? (double) (t.processNs - last.processNs) / calls : 0.0;
+			processLoad = (t.processNs - last.processNs) / 1e9 / seconds;
+			midiIn = (t.midiIn - last.midiIn) / seconds;
+			midiOut = (t.midiOut - last.midiOut) / seconds;
+			ledOut = (t.ledOut - last.ledOut) / seconds;
+			framesRendered = (t.framesRendered - last.framesRendered) / seconds;
+			framesSent = sent / seconds;
+			framesDropped = (t.framesDropped - last.framesDropped) / seconds;
+			sendMeanNs = sent ? (double) (t.sendNs - last.sendNs) / sent : 0.0;
+			transferMeanNs = transfers ? (double) (t.sendNs - last.sendNs) / transfers : 0.0;
+		}
+		processPeakNs = (double) stats.engine.processPeakNs.exchange(0, std::memory_order_relaxed);
+		sendPeakNs = (double) stats.display.sendPeakNs.exchange(0, std::memory_order_relaxed);
+		usbErrors = t.usbErrors;
+		lastUsbError = stats.display.lastUsbError.load(std::memory_order_relaxed);
+		last = t;
+		lastNs = now;
+		return true;
+	}
+
+private:
+	struct Totals {
+		uint64_t processCalls = 0, processNs = 0, midiIn = 0, midiOut = 0, ledOut = 0;
+		uint64_t framesRendered = 0, framesSent = 0, framesDropped = 0, sendNs = 0, transfers = 0, usbErrors = 0;
+
+		void read(const PushStats& stats)
+		{
+			processCalls = stats.engine.processCalls.load(std::memory_order_relaxed);
+			processNs = stats.engine.processNs.load(std::memory_order_relaxed);
+			midiIn = stats.engine.midiIn.load(std::memory_order_relaxed);
+			midiOut = stats.engine.midiOut.load(std::memory_order_relaxed);
+			ledOut = stats.engine.ledOut.load(std::memory_order_relaxed);
+			framesRendered = stats.display.framesRendered.load(std::memory_order_relaxed);
+			framesSent = stats.display.framesSent.load(std::memory_order_relaxed);
+			framesDropped = stats.display.framesDropped.load(std::memory_order_relaxed);
+			sendNs = stats.display.sendNs.load(std::memory_order_relaxed);
+			transfers = stats.display.transfers.load(std::memory_order_relaxed);
+			usbErrors = stats.display.usbErrors.load(std::memory_order_relaxed);
+		}
+	};
+	Totals last;
+	uint64_t lastNs = 0;
+};
@@ -0,0 +1,627 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PushMap.hpp"
+#include "OSCLatency.hpp"
+
+// Transfers the fake transport keeps in its log.
+#define PUSH_TRANSPORT_LOG_SIZE		4096
+// Bytes of pixel data in a display line, the rest of the line buffer is gutter.
+#define PUSH2_DISPLAY_LINE_PIXEL_BYTES	(PUSH2_DISPLAY_WIDTH * 2)
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// USB link to the Push 2 display.
+// bulkTransfer() follows libusb_bulk_transfer(): 0 on success, a LIBUSB_ERROR_* code otherwise.
+// Hotplug is optional: a transport that can't report arrivals and removals leaves the caller to poll open().
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct PushTransport {
+	virtual ~PushTransport() {}
+	virtual bool open() = 0;
+	virtual void close() = 0;
+	virtual bool isOpen() const = 0;
+	virtual int bulkTransfer(unsigned char endpoint, unsigned char* data, int length, int* transferred, unsigned int timeoutMs) = 0;
+	// Calls @callback(true) when a Push 2 is plugged in and @callback(false) when one is removed, from within
+	// handleEvents(). False if the transport can't tell.
+	virtual bool watchHotplug(std::function<void(bool)> callback)
+	{
+		return false;
+	}
+	// Waits up to @timeoutMs for USB events.
+	virtual void handleEvents(int timeoutMs)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+	}
+};
+
+
+// A Push 2 on the bus. @path is the bus and port chain, "3-1.4", stable while the unit stays on the same port.
+struct PushDeviceInfo {
+	std::string serial;
+	std::string path;
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// The Push 2 over libusb.
+// The transport has its own libusb context, created on first use and kept until it is deleted.
+// It opens the unit whose serial number or USB path is @selector, or the first one not claimed yet when that is
+// empty, so several transports in one Rack each get a unit of their own.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct LibusbPushTransport : PushTransport {
+	const std::string selector;
+
+	LibusbPushTransport(const std::string& selector = "") : selector(selector) {}
+
+	~LibusbPushTransport()
+	{
+		close();
+		if (hotplugRegistered)
+			libusb_hotplug_deregister_callback(context, hotplugHandle);
+		if (context)
+			libusb_exit(context);
+	}
+
+	bool open() override
+	{
+		if (handle)
+			return true;
+		if (!init())
+			return false;
+		forEachPush2(context, [this](libusb_device_handle* h, const PushDeviceInfo& info) {
+			if (!selector.empty() && selector != info.serial && selector != info.path)
+				return false;
+			// Claimed by another transport: try the next unit
+			if (libusb_claim_interface(h, 0) < 0)
+				return false;
+			handle = h;
+			std::lock_guard<std::mutex> lock(openedMutex);
+			opened = info;
+			return true;
+		});
+		return handle != NULL;
+	}
+
+	void close() override
+	{
+		if (!handle)
+			return;
+		libusb_release_interface(handle, 0);
+		libusb_close(handle);
+		handle = NULL;
+		std::lock_guard<std::mutex> lock(openedMutex);
+		opened = PushDeviceInfo();
+	}
+
+	// Any thread. The unit open, empty strings when none is.
+	PushDeviceInfo openedDevice()
+	{
+		std::lock_guard<std::mutex> lock(openedMutex);
+		return opened;
+	}
+
+	// Push 2 units plugged in, for picking one. Opens each briefly to read its serial number.
+	static std::vector<PushDeviceInfo> enumerate()
+	{
+		std::vector<PushDeviceInfo> devices;
+		libusb_context* context = NULL;
+		if (libusb_init(&context) != 0)
+			return devices;
+		forEachPush2(context, [&devices](libusb_device_handle* h, const PushDeviceInfo& info) {
+			devices.push_back(info);
+			return false;
+		});
+		libusb_exit(context);
+		return devices;
+	}
+
+	// Not every platform has hotplug (Windows doesn't).
+	bool watchHotplug(std::function<void(bool)> callback) override
+	{
+		if (!init() || !libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+			return false;
+		hotplugCallback = callback;
+		int result = libusb_hotplug_register_callback(context,
+			LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_NO_FLAGS,
+			ABLETON_VENDOR_ID, PUSH2_PRODUCT_ID, LIBUSB_HOTPLUG_MATCH_ANY, onHotplug, this, &hotplugHandle);
+		hotplugRegistered = (result == LIBUSB_SUCCESS);
+		return hotplugRegistered;
+	}
+
+	void handleEvents(int timeoutMs) override
+	{
+		if (!hotplugRegistered)
+		{
+			PushTransport::handleEvents(timeoutMs);
+			return;
+		}
+		struct timeval tv;
+		tv.tv_sec = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		libusb_handle_events_timeout_completed(context, &tv, NULL);
+	}
+
+	bool isOpen() const override
+	{
+		return handle != NULL;
+	}
+
+	int bulkTransfer(unsigned char endpoint, unsigned char* data, int length, int* transferred, unsigned int timeoutMs) override
+	{
+		return libusb_bulk_transfer(handle, endpoint, data, length, transferred, timeoutMs);
+	}
+
+private:
+	libusb_context* context = NULL;
+	libusb_device_handle* handle = NULL;
+	bool hotplugRegistered = false;
+	libusb_hotplug_callback_handle hotplugHandle;
+	std::function<void(bool)> hotplugCallback;
+
+	bool init()
+	{
+		return context != NULL || libusb_init(&context) == 0;
+	}
+
+	PushDeviceInfo opened;
+	std::mutex openedMutex;
+
+	// Opens every Push 2 in turn and calls @found(handle, info) until it returns true, it then owns the handle.
+	static void forEachPush2(libusb_context* context, std::function<bool(libusb_device_handle*, const PushDeviceInfo&)> found)
+	{
+		libusb_device** devices;
+		ssize_t n = libusb_get_device_list(context, &devices);
+		if (n < 0)
+			return;
+		for (ssize_t i = 0; i < n; i++)
+		{
+			libusb_device_descriptor descriptor;
+			if (libusb_get_device_descriptor(devices[i], &descriptor) != 0)
+				continue;
+			if (descriptor.idVendor != ABLETON_VENDOR_ID || descriptor.idProduct != PUSH2_PRODUCT_ID)
+				continue;
+			libusb_device_handle* h;
+			if (libusb_open(devices[i], &h) != 0)
+				continue;
+			PushDeviceInfo info;
+			info.path = devicePath(devices[i]);
+			unsigned char serial[64];
+			if (descriptor.iSerialNumber && libusb_get_string_descriptor_ascii(h, descriptor.iSerialNumber, serial, sizeof(serial)) > 0)
+				info.serial = (const char*) serial;
+			if (found(h, info))
+				break;
+			libusb_close(h);
+		}
+		libusb_free_device_list(devices, 1);
+	}
+
+	static std::string devicePath(libusb_device* device)
+	{
+		uint8_t ports[8];
+		int n = libusb_get_port_numbers(device, ports, sizeof(ports));
+		std::string path = std::to_string(libusb_get_bus_number(device));
+		for (int i = 0; i < n; i++)
+			path += (i == 0 ? "-" : ".") + std::to_string(ports[i]);
+		return path;
+	}
+
+	static int LIBUSB_CALL onHotplug(libusb_context* context, libusb_device* device, libusb_hotplug_event event, void* user)
+	{
+		LibusbPushTransport* transport = (LibusbPushTransport*) user;
+		bool arrived = (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED);
+		// Another unit leaving doesn't concern this one
+		if (!arrived && (!transport->handle || libusb_get_device(transport->handle) != device))
+			return 0;
+		transport->hotplugCallback(arrived);
+		// Stay registered
+		return 0;
+	}
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// In-memory Push 2 display, so the display pipeline runs without the hardware.
+// Every transfer is logged with its time. Latency and stalls can be injected to see how the pipeline copes.
+// Frames (a header followed by one transfer per line) are reassembled, decoded the way the Push 2 does and
+// can be written to PNG files. It can be unplugged: open() then fails and transfers fail with LIBUSB_ERROR_NO_DEVICE.
+// bulkTransfer() runs on the frame scheduler thread, open() and close() on the display link thread, and the menu
+// sets the knobs from the UI thread: the knobs are atomic, the capture folder is handed over under a lock, and what
+// the transfers record is read through counters(), toJson() and lastFrame(), which copy it under @mutex.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct FakePushTransport : PushTransport {
+	struct Transfer {
+		// Since the transport was opened
+		uint64_t timeNs;
+		int length;
+		int result;
+	};
+
+	// Counters since the transport was opened.
+	struct Counters {
+		uint64_t transfers = 0;
+		uint64_t bytes = 0;
+		uint64_t stalls = 0;
+		uint64_t frames = 0;
+		// Frames cut short by a failed transfer or a new header.
+		uint64_t droppedFrames = 0;
+		uint64_t captured = 0;
+		double seconds = 0.0;
+
+		double framesPerSecond() const
+		{
+			return seconds > 0 ? frames / seconds : 0.0;
+		}
+
+		double megabytesPerSecond() const
+		{
+			return seconds > 0 ? bytes / seconds / 1e6 : 0.0;
+		}
+	};
+
+	// Delay added to every transfer.
+	std::atomic<int> latencyUs{0};
+	// Every Nth transfer stalls, 0 for never. A stalled transfer waits @stallMs and fails with LIBUSB_ERROR_TIMEOUT.
+	std::atomic<int> stallEvery{0};
+	std::atomic<int> stallMs{50};
+	std::atomic<bool> plugged{true};
+	// Write every Nth complete frame.
+	std::atomic<int> captureEvery{1};
+
+	FakePushTransport()
+	{
+		log.resize(PUSH_TRANSPORT_LOG_SIZE);
+		frame.resize(PUSH2_DISPLAY_LINE_PIXEL_BYTES * PUSH2_DISPLAY_HEIGHT);
+	}
+
+	bool open() override
+	{
+		if (!plugged)
+			return false;
+		if (!opened)
+			reset();
+		opened = true;
+		return true;
+	}
+
+	void close() override
+	{
+		opened = false;
+	}
+
+	bool isOpen() const override
+	{
+		return opened;
+	}
+
+	int bulkTransfer(unsigned char endpoint, unsigned char* data, int length, int* transferred, unsigned int timeoutMs) override
+	{
+		*transferred = 0;
+		if (!opened || !plugged)
+			return LIBUSB_ERROR_NO_DEVICE;
+		int latency = latencyUs;
+		if (latency > 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(latency));
+
+		int result = 0;
+		int every = stallEvery;
+		if (every > 0 && (sent + 1) % every == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(std::min((int) stallMs, (int) timeoutMs)));
+			result = LIBUSB_ERROR_TIMEOUT;
+		}
+		else if (endpoint != PUSH2_BULK_EP_OUT)
+		{
+			result = LIBUSB_ERROR_PIPE;
+		}
+		sent++;
+
+		uint64_t now = nowNs();
+		std::unique_lock<std::mutex> lock(mutex);
+		counts.transfers++;
+		if (result == LIBUSB_ERROR_TIMEOUT)
+			counts.stalls++;
+		Transfer& t = log[logCount % PUSH_TRANSPORT_LOG_SIZE];
+		t.timeNs = now - openedNs;
+		t.length = length;
+		t.result = result;
+		logCount++;
+
+		if (result != 0)
+		{
+			dropFrame();
+			return result;
+		}
+		*transferred = length;
+		counts.bytes += length;
+		if (!receive(data, length, now))
+			return 0;
+		// A complete frame: write it out without holding up the readers, only this thread changes @rgb
+		uint64_t frameNumber = counts.frames;
+		uint64_t captureNumber = counts.captured;
+		lock.unlock();
+		capture(frameNumber, captureNumber);
+		return 0;
+	}
+
+	// Any thread. Folder complete frames are written to as frame-NNNNN.png, empty to keep none.
+	void setCaptureDir(const std::string& dir)
+	{
+		std::lock_guard<std::mutex> lock(captureMutex);
+		captureDir = dir;
+	}
+
+	std::string getCaptureDir()
+	{
+		std::lock_guard<std::mutex> lock(captureMutex);
+		return captureDir;
+	}
+
+	// Any thread.
+	Counters counters() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Counters c = counts;
+		c.seconds = (nowNs() - openedNs) / 1e9;
+		return c;
+	}
+
+	// Any thread. Counters, rates, frame pacing and the transfer log.
+	json_t* toJson() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Counters c = counts;
+		c.seconds = (nowNs() - openedNs) / 1e9;
+		json_t* rootJ = json_object();
+		json_object_set_new(rootJ, "seconds", json_real(c.seconds));
+		json_object_set_new(rootJ, "transfers", json_integer(c.transfers));
+		json_object_set_new(rootJ, "bytes", json_integer(c.bytes));
+		json_object_set_new(rootJ, "stalls", json_integer(c.stalls));
+		json_object_set_new(rootJ, "frames", json_integer(c.frames));
+		json_object_set_new(rootJ, "droppedFrames", json_integer(c.droppedFrames));
+		json_object_set_new(rootJ, "framesPerSecond", json_real(c.framesPerSecond()));
+		json_object_set_new(rootJ, "megabytesPerSecond", json_real(c.megabytesPerSecond()));
+		json_object_set_new(rootJ, "latencyUs", json_integer(latencyUs));
+		json_object_set_new(rootJ, "stallEvery", json_integer(stallEvery));
+		json_object_set_new(rootJ, "frameInterval", frameInterval.toJson());
+		json_object_set_new(rootJ, "frameSendTime", frameSendTime.toJson());
+		// [time us, length, result] per transfer, oldest first
+		json_t* logJ = json_array();
+		uint64_t first = (logCount > PUSH_TRANSPORT_LOG_SIZE) ? logCount - PUSH_TRANSPORT_LOG_SIZE : 0;
+		for (uint64_t i = first; i < logCount; i++)
+		{
+			const Transfer& t = log[i % PUSH_TRANSPORT_LOG_SIZE];
+			json_t* transferJ = json_array();
+			json_array_append_new(transferJ, json_real(t.timeNs / 1000.0));
+			json_array_append_new(transferJ, json_integer(t.length));
+			json_array_append_new(transferJ, json_integer(t.result));
+			json_array_append_new(logJ, transferJ);
+		}
+		json_object_set_new(rootJ, "log", logJ);
+		return rootJ;
+	}
+
+	// Any thread. Decoded pixels of the last complete frame, RGB, 3 bytes per pixel. Empty before the first.
+	std::vector<unsigned char> lastFrame() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return rgb;
+	}
+
+private:
+	std::atomic<bool> opened{false};
+	// Sending thread only. Transfers since the transport was created, paces the stalls.
+	uint64_t sent = 0;
+	// Guards what the sending thread records: @counts, @openedNs, the log, the histograms and @rgb.
+	mutable std::mutex mutex;
+	Counters counts;
+	uint64_t openedNs = 0;
+	std::vector<Transfer> log;
+	uint64_t logCount = 0;
+	// Time from one complete frame to the next, and from a frame's header to its last line.
+	OSCLatencyHistogram frameInterval;
+	OSCLatencyHistogram frameSendTime;
+	std::vector<unsigned char> rgb;
+	// Sending thread only. Line buffers of the frame being received, @line is -1 when waiting for a header.
+	std::vector<unsigned char> frame;
+	int line = -1;
+	uint64_t frameStartNs = 0;
+	uint64_t lastFrameNs = 0;
+	std::mutex captureMutex;
+	std::string captureDir;
+
+	static uint64_t nowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Display link thread, while nothing is sent.
+	void reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		openedNs = nowNs();
+		counts = Counters();
+		logCount = 0;
+		line = -1;
+		lastFrameNs = 0;
+		frameInterval.reset();
+		frameSendTime.reset();
+	}
+
+	// Holding @mutex.
+	void dropFrame()
+	{
+		if (line >= 0)
+			counts.droppedFrames++;
+		line = -1;
+	}
+
+	// Holding @mutex. True once the transfer completed a frame.
+	bool receive(const unsigned char* data, int length, uint64_t now)
+	{
+		static const unsigned char header[4] = {0xFF, 0xCC, 0xAA, 0x88};
+		if (length == 16 && std::memcmp(data, header, 4) == 0)
+		{
+			dropFrame();
+			line = 0;
+			frameStartNs = now;
+			return false;
+		}
+		// Lines outside a frame are ignored, as the Push 2 does
+		if (line < 0)
+			return false;
+		std::memcpy(&frame[line * PUSH2_DISPLAY_LINE_PIXEL_BYTES], data, std::min(length, PUSH2_DISPLAY_LINE_PIXEL_BYTES));
+		if (++line < PUSH2_DISPLAY_HEIGHT)
+			return false;
+
+		line = -1;
+		counts.frames++;
+		frameSendTime.record(now - frameStartNs);
+		if (lastFrameNs)
+			frameInterval.record(now - lastFrameNs);
+		lastFrameNs = now;
+		decode();
+		return true;
+	}
+
+	// Sending thread, without @mutex. Writes complete frame number @frameNumber if the capture wants it.
+	void capture(uint64_t frameNumber, uint64_t captureNumber)
+	{
+		std::string dir = getCaptureDir();
+		int every = captureEvery;
+		if (dir.empty() || every <= 0 || frameNumber % every != 0)
+			return;
+		std::string path = dir + string::f("/frame-%05d.png", (int) captureNumber);
+		if (writePng(path, rgb.data(), PUSH2_DISPLAY_WIDTH, PUSH2_DISPLAY_HEIGHT))
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			counts.captured++;
+		}
+		else
+		{
+			WARN("FakePushTransport - Could not write %s", path.c_str());
+		}
+	}
+
+	// Undo the line XOR pattern and expand BGR565 (red in the low bits) to RGB.
+	void decode()
+	{
+		static const unsigned char pattern[4] = {0xE7, 0xF3, 0xE7, 0xFF};
+		rgb.resize(PUSH2_DISPLAY_WIDTH * PUSH2_DISPLAY_HEIGHT * 3);
+		for (int y = 0; y < PUSH2_DISPLAY_HEIGHT; y++)
+		{
+			const unsigned char* src = &frame[y * PUSH2_DISPLAY_LINE_PIXEL_BYTES];
+			unsigned char* dst = &rgb[y * PUSH2_DISPLAY_WIDTH * 3];
+			for (int x = 0; x < PUSH2_DISPLAY_WIDTH; x++)
+			{
+				int i = x * 2;
+				uint16_t pixel = (src[i] ^ pattern[i & 3]) | ((src[i + 1] ^ pattern[(i + 1) & 3]) << 8);
+				int r = pixel & 0x1f;
+				int g = (pixel >> 5) & 0x3f;
+				int b = pixel >> 11;
+				dst[x * 3] = (unsigned char) ((r << 3) | (r >> 2));
+				dst[x * 3 + 1] = (unsigned char) ((g << 2) | (g >> 4));
+				dst[x * 3 + 2] = (unsigned char) ((b << 3) | (b >> 2));
+			}
+		}
+	}
+
+	static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+	{
+		static uint32_t table[256];
+		if (table[1] == 0)
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[n] = c;
+			}
+		}
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static void put32(std::vector<unsigned char>& out, uint32_t v)
+	{
+		out.push_back(v >> 24);
+		out.push_back(v >> 16);
+		out.push_back(v >> 8);
+		out.push_back(v);
+	}
+
+	static void chunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		put32(out, (uint32_t) data.size());
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		put32(out, crc32(0, &out[start], out.size() - start));
+	}
+
+	// 8 bit RGB PNG with stored (uncompressed) deflate blocks, so no zlib is needed.
+	static bool writePng(const std::string& path, const unsigned char* pixels, int width, int height)
+	{
+		std::vector<unsigned char> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+		std::vector<unsigned char> ihdr;
+		put32(ihdr, width);
+		put32(ihdr, height);
+		ihdr.push_back(8);	// bit depth
+		ihdr.push_back(2);	// RGB
+		ihdr.push_back(0);
+		ihdr.push_back(0);
+		ihdr.push_back(0);
+		chunk(out, "IHDR", ihdr);
+
+		// Each row starts with filter type 0
+		std::vector<unsigned char> raw;
+		size_t stride = (size_t) width * 3;
+		raw.reserve((stride + 1) * height);
+		for (int y = 0; y < height; y++)
+		{
+			raw.push_back(0);
+			raw.insert(raw.end(), pixels + y * stride, pixels + (y + 1) * stride);
+		}
+
+		std::vector<unsigned char> idat = {0x78, 0x01};
+		uint32_t a = 1, b = 0;
+		for (size_t pos = 0; pos < raw.size(); )
+		{
+			size_t n = std::min<size_t>(raw.size() - pos, 65535);
+			idat.push_back(pos + n == raw.size() ? 1 : 0);
+			idat.push_back(n & 0xff);
+			idat.push_back(n >> 8);
+			idat.push_back(~n & 0xff);
+			idat.push_back((~n >> 8) & 0xff);
+			idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + n);
+			for (size_t i = pos; i < pos + n; i++)
+			{
+				a = (a + raw[i]) % 65521;
+				b = (b + a) % 65521;
+			}
+			pos += n;
+		}
+		put32(idat, (b << 16) | a);
+		chunk(out, "IDAT", idat);
+		chunk(out, "IEND", std::vector<unsigned char>());
+
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+		fclose(file);
+		return ok;
+	}
+};
@@ -0,0 +1,288 @@
+#pragma once
+// Scoped trace points for the hot sections of the modules, dumped to a Chrome trace (chrome://tracing, Perfetto).
+// Built in with `make TRACE=1`, otherwise TRACE_SCOPE() and TRACE_THREAD_NAME() compile to nothing.
+#ifndef PUSHMAP_TRACE
+#define PUSHMAP_TRACE 0
+#endif
+
+#if PUSHMAP_TRACE
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../lib/oscpack/ip/PacketListener.h"
+
+// Events each thread keeps, the oldest are overwritten. 24 bytes each.
+#define TRACE_BUFFER_EVENTS		(1 << 16)
+// Threads that can trace, trace points on further threads are dropped.
+#define TRACE_MAX_THREADS		64
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// Ring of the trace events of one thread. Only the owning thread writes, a dump reads it while it is written and
+// drops the events that may have been overwritten under it.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct TraceBuffer {
+	struct Event {
+		// Trace point names are string literals
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> startNs;
+		std::atomic<uint64_t> durationNs;
+	};
+	struct Copy {
+		const char* name;
+		uint64_t startNs;
+		uint64_t durationNs;
+	};
+
+	int tid;
+	std::string name;
+	// Events ever written. Dumps start at @clearedAt.
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> clearedAt;
+
+	TraceBuffer(int tid) : tid(tid), name("Thread " + std::to_string(tid))
+	{
+		count = 0;
+		clearedAt = 0;
+		events = new Event[TRACE_BUFFER_EVENTS];
+	}
+
+	// Owning thread.
+	void push(const char* eventName, uint64_t startNs, uint64_t durationNs)
+	{
+		uint64_t n = count.load(std::memory_order_relaxed);
+		// The slot is reused: a reader that sees any of the new fields also sees count >= n
+		std::atomic_thread_fence(std::memory_order_release);
+		Event& e = events[n & (TRACE_BUFFER_EVENTS - 1)];
+		e.name.store(eventName, std::memory_order_relaxed);
+		e.startNs.store(startNs, std::memory_order_relaxed);
+		e.durationNs.store(durationNs, std::memory_order_relaxed);
+		count.store(n + 1, std::memory_order_release);
+	}
+
+	// Any thread. Appends the events still in the ring to @out.
+	void copy(std::vector<Copy>& out) const
+	{
+		uint64_t end = count.load(std::memory_order_acquire);
+		uint64_t begin = std::max(clearedAt.load(std::memory_order_relaxed), end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0);
+		size_t first = out.size();
+		for (uint64_t i = begin; i < end; i++)
+		{
+			const Event& e = events[i & (TRACE_BUFFER_EVENTS - 1)];
+			out.push_back(Copy { e.name.load(std::memory_order_relaxed), e.startNs.load(std::memory_order_relaxed),
+				e.durationNs.load(std::memory_order_relaxed) });
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// Event @now may be half written over the slot of now - TRACE_BUFFER_EVENTS
+		uint64_t now = count.load(std::memory_order_relaxed);
+		uint64_t valid = (now + 1 > TRACE_BUFFER_EVENTS) ? now + 1 - TRACE_BUFFER_EVENTS : 0;
+		if (valid > begin)
+			out.erase(out.begin() + first, out.begin() + first + (size_t) std::min(valid - begin, end - begin));
+	}
+
+private:
+	// Never freed, threads may exit while a dump reads their events.
+	Event* events;
+};
+
+
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+// The trace: a buffer per thread that traced something, created on its first event, and the switch that turns
+// recording on and off at run time.
+//-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
+struct Trace {
+	std::atomic<bool> enabled;
+
+	static Trace& instance()
+	{
+		static Trace trace;
+		return trace;
+	}
+
+	static bool isEnabled()
+	{
+		return instance().enabled.load(std::memory_order_relaxed);
+	}
+
+	// Buffer of the calling thread, NULL once TRACE_MAX_THREADS threads have one.
+	static TraceBuffer* threadBuffer()
+	{
+		static thread_local TraceBuffer* buffer = NULL;
+		static thread_local bool registered = false;
+		if (!registered)
+		{
+			registered = true;
+			buffer = instance().add();
+		}
+		return buffer;
+	}
+
+	static void setThreadName(const char* name)
+	{
+		TraceBuffer* buffer = threadBuffer();
+		if (buffer)
+		{
+			std::lock_guard<std::mutex> lock(instance().mutex);
+			buffer->name = name;
+		}
+	}
+
+	// Dumps start after the events recorded so far.
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (TraceBuffer* buffer : buffers)
+			buffer->clearedAt = buffer->count.load(std::memory_order_acquire);
+	}
+
+	// Complete ("X") events in microseconds from the first one, and the name of each thread.
+	json_t* toJson()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<std::vector<TraceBuffer::Copy>> copies(buffers.size());
+		uint64_t originNs = UINT64_MAX;
+		for (size_t t = 0; t < buffers.size(); t++)
+		{
+			buffers[t]->copy(copies[t]);
+			for (const TraceBuffer::Copy& e : copies[t])
+				originNs = std::min(originNs, e.startNs);
+		}
+
+		json_t* eventsJ = json_array();
+		for (size_t t = 0; t < buffers.size(); t++)
+		{
+			json_t* metaJ = json_object();
+			json_object_set_new(metaJ, "name", json_string("thread_name"));
+			json_object_set_new(metaJ, "ph", json_string("M"));
+			json_object_set_new(metaJ, "pid", json_integer(1));
+			json_object_set_new(metaJ, "tid", json_integer(buffers[t]->tid));
+			json_t* argsJ = json_object();
+			json_object_set_new(argsJ, "name", json_string(buffers[t]->name.c_str()));
+			json_object_set_new(metaJ, "args", argsJ);
+			json_array_append_new(eventsJ, metaJ);
+
+			for (const TraceBuffer::Copy& e : copies[t])
+			{
+				json_t* eventJ = json_object();
+				json_object_set_new(eventJ, "name", json_string(e.name));
+				json_object_set_new(eventJ, "ph", json_string("X"));
+				json_object_set_new(eventJ, "pid", json_integer(1));
+				json_object_set_new(eventJ, "tid", json_integer(buffers[t]->tid));
+				json_object_set_new(eventJ, "ts", json_real((e.startNs - originNs) / 1e3));
+				json_object_set_new(eventJ, "dur", json_real(e.durationNs / 1e3));
+				json_array_append_new(eventsJ, eventJ);
+			}
+		}
+		json_t* rootJ = json_object();
+		json_object_set_new(rootJ, "traceEvents", eventsJ);
+		json_object_set_new(rootJ, "displayTimeUnit", json_string("ns"));
+		return rootJ;
+	}
+
+	// Writes PushMapVCV-Trace.json in the user folder.
+	void save()
+	{
+		json_t* rootJ = toJson();
+		std::string path = asset::user("PushMapVCV-Trace.json");
+		if (json_dump_file(rootJ, path.c_str(), JSON_COMPACT) == 0)
+			INFO("Trace - Saved trace to %s", path.c_str());
+		else
+			WARN("Trace - Could not write trace to %s", path.c_str());
+		json_decref(rootJ);
+	}
+
+private:
+	std::mutex mutex;
+	std::vector<TraceBuffer*> buffers;
+
+	Trace()
+	{
+		enabled = false;
+	}
+
+	TraceBuffer* add()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (buffers.size() >= TRACE_MAX_THREADS)
+			return NULL;
+		buffers.push_back(new TraceBuffer((int) buffers.size() + 1));
+		return buffers.back();
+	}
+};
+
+
+// Records the time from its construction to the end of the scope, while the trace is enabled.
+struct TraceScope {
+	const char* name;
+	uint64_t startNs;
+
+	TraceScope(const char* name) : name(name)
+	{
+		startNs = Trace::isEnabled() ? PacketClockNow() : 0;
+	}
+
+	~TraceScope()
+	{
+		if (startNs == 0)
+			return;
+		TraceBuffer* buffer = Trace::threadBuffer();
+		if (buffer)
+			buffer->push(name, startNs, PacketClockNow() - startNs);
+	}
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// @name must be a string literal.
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+
+#endif
+
+
+// Context menu section: record toggle, save and clear. Empty unless built with TRACE=1.
+inline void appendTraceMenu(Menu* menu)
+{
+#if PUSHMAP_TRACE
+	struct EnableItem : MenuItem {
+		void onAction(const event::Action& e) override {
+			Trace::instance().enabled = !Trace::isEnabled();
+		}
+	};
+	struct SaveItem : MenuItem {
+		void onAction(const event::Action& e) override {
+			Trace::instance().save();
+		}
+	};
+	struct ClearItem : MenuItem {
+		void onAction(const event::Action& e) override {
+			Trace::instance().clear();
+		}
+	};
+
+	menu->addChild(new MenuSeparator);
+	EnableItem* enableItem = new EnableItem;
+	enableItem->text = "Trace hot sections";
+	enableItem->rightText = CHECKMARK(Trace::isEnabled());
+	menu->addChild(enableItem);
+
+	SaveItem* saveItem = new SaveItem;
+	saveItem->text = "Save trace (Chrome JSON)";
+	menu->addChild(saveItem);
+
+	ClearItem* clearItem = new ClearItem;
+	clearItem->text = "Clear trace";
+	menu->addChild(clearItem);
+#else
+	(void) menu;
+#endif
+}
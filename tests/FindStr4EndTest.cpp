@@ -0,0 +1,75 @@
+// FindStr4End(): the SIMD scan against the scalar one, for every start alignment, every string length and every tail
+// left after the 16 and 32 byte blocks. Strings end exactly at the end of their allocation so the sanitizers catch
+// a load past it. Built once for the default SIMD path and once for AVX2, see the Makefile.
+#include "TestCheck.hpp"
+#include <cstdlib>
+#include "osc/OscStr4.h"
+
+// Start offsets, relative to a 16 byte aligned allocation
+#define STR4_TEST_ALIGNMENTS	64
+// Longest scanned range, in words: 4 blocks of 32 bytes and every tail
+#define STR4_TEST_WORDS			40
+#define STR4_TEST_FILLS			8
+
+static const char* simdPath()
+{
+#if defined(OSC_USE_AVX2)
+	return "avx2";
+#elif defined(OSC_USE_SSE2)
+	return "sse2";
+#else
+	return "none";
+#endif
+}
+
+// Random word contents, NULs anywhere but in the last byte of the words before @terminator, which ends with one.
+// @terminator -1 for an unterminated string.
+static void fill(char* p, int words, int terminator)
+{
+	static const char bytes[] = { '\0', '\0', 'a', '/', '\x80', '\xFF' };
+	for (int i = 0; i < words * 4; i++)
+		p[i] = bytes[std::rand() % sizeof(bytes)];
+	for (int w = 0; w < words; w++)
+	{
+		char& last = p[w * 4 + 3];
+		if (w < terminator || terminator < 0)
+			last = last ? last : 'z';
+		else if (w == terminator)
+			last = '\0';
+	}
+}
+
+int main()
+{
+	std::srand(1);
+	long compared = 0;
+	for (int offset = 0; offset < STR4_TEST_ALIGNMENTS; offset++)
+	{
+		for (int words = 0; words <= STR4_TEST_WORDS; words++)
+		{
+			for (int terminator = -1; terminator < words; terminator++)
+			{
+				for (int f = 0; f < STR4_TEST_FILLS; f++)
+				{
+					char* buffer = (char*) std::malloc(offset + words * 4);
+					char* p = buffer + offset;
+					char* end = p + words * 4;
+					fill(p, words, terminator);
+					const char* simd = osc::FindStr4End(p, end);
+					const char* scalar = osc::FindStr4EndScalar(p, end);
+					CHECK(simd == scalar);
+					// Without the integer address special case the terminator decides alone
+					if (words > 0 && p[0] != '\0')
+						CHECK(scalar == (terminator < 0 ? NULL : p + terminator * 4 + 4));
+					if (simd != scalar)
+						std::fprintf(stderr, "offset %d, %d words, terminator %d: %ld != %ld\n", offset, words, terminator,
+							simd ? (long) (simd - p) : -1L, scalar ? (long) (scalar - p) : -1L);
+					std::free(buffer);
+					compared++;
+				}
+			}
+		}
+	}
+	std::printf("FindStr4End %s: %ld strings compared\n", simdPath(), compared);
+	return checkFailures ? 1 : 0;
+}
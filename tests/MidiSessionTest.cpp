@@ -0,0 +1,262 @@
+// MIDI sessions: a stream of encoder turns, key presses and buttons recorded through a headless PushMap, saved and
+// loaded, and replayed into a fresh PushMap, as fast as possible and in real time, leaves the CC values, the mapped
+// params and the rest of the module's state exactly as the recording did. Built against the stub Rack SDK of the
+// benchmarks.
+// PushMap is only defined in its translation unit. It comes first, TestCheck.hpp keeps Rack's logger.
+#include "../src/PushMap.cpp"
+#include "TestCheck.hpp"
+#include <cstdlib>
+#include <vector>
+
+#define SESSION_TEST_PATH			"build/MidiSessionTest.pmmidi"
+#define SESSION_TEST_SAMPLE_RATE	48000
+// Samples between two bursts of messages, about one MIDI block
+#define SESSION_TEST_STEP_SAMPLES	120
+// Bursts recorded, several fast replay chunks worth of messages
+#define SESSION_TEST_STEPS			2000
+// Encoders of the Push, CC 71 to 78
+#define SESSION_TEST_FIRST_KNOB		71
+// Groups the knobs are mapped in
+#define SESSION_TEST_GROUPS			2
+
+// The module whose params are mapped, one per knob and group. The range is 0 to 1, where scaling a value there and
+// back leaves it unchanged: PushMap rewrites a mapped param each update its group has the focus, which must not
+// change it when a replay gives the focus at other times than the recording.
+struct SessionTarget : Module {
+	SessionTarget()
+	{
+		config(SESSION_TEST_GROUPS * MAX_CHANNELS, 0, 0, 0);
+		for (int i = 0; i < SESSION_TEST_GROUPS * MAX_CHANNELS; i++)
+		{
+			configParam(i, 0.f, 1.f, 0.f);
+			params[i].setValue(0.05f + 0.06f * i);
+		}
+	}
+};
+
+// What the MIDI stream changes in the module
+struct SessionState {
+	std::vector<float> values;
+	std::vector<float> params;
+	std::vector<float> outputs;
+	std::vector<int> keyGroups;
+	int focusGroup;
+	int focusNote;
+	bool shiftMode;
+	bool isplaying;
+
+	bool operator==(const SessionState& other) const
+	{
+		return values == other.values && params == other.params && outputs == other.outputs && keyGroups == other.keyGroups
+			&& focusGroup == other.focusGroup && focusNote == other.focusNote && shiftMode == other.shiftMode && isplaying == other.isplaying;
+	}
+};
+
+// A PushMap with the knobs of the first groups mapped to the params of a target
+struct SessionRig {
+	SessionTarget* target;
+	PushMap* module;
+	Module::ProcessArgs args;
+
+	SessionRig()
+	{
+		target = new SessionTarget;
+		module = new PushMap;
+		APP->engine->addModule(target);
+		APP->engine->addModule(module);
+		for (int g = 0; g < SESSION_TEST_GROUPS; g++)
+		{
+			module->focusGroup = g;
+			for (int id = 0; id < MAX_CHANNELS; id++)
+			{
+				module->ccs[g][id] = SESSION_TEST_FIRST_KNOB + id;
+				module->learnParam(id, target->id, g * MAX_CHANNELS + id);
+			}
+		}
+		module->focusGroup = 0;
+		args.sampleRate = SESSION_TEST_SAMPLE_RATE;
+		args.sampleTime = 1.f / SESSION_TEST_SAMPLE_RATE;
+	}
+
+	~SessionRig()
+	{
+		APP->engine->removeModule(module);
+		APP->engine->removeModule(target);
+		delete module;
+		delete target;
+	}
+
+	void process(int samples)
+	{
+		for (int i = 0; i < samples; i++)
+			module->process(args);
+	}
+
+	SessionState state()
+	{
+		SessionState s;
+		for (int g = 0; g < NUM_GROUPS; g++)
+			s.values.insert(s.values.end(), module->values[g], module->values[g] + 128);
+		for (engine::Param& param : target->params)
+			s.params.push_back(param.getValue());
+		for (engine::Output& output : module->outputs)
+			s.outputs.push_back(output.getVoltage());
+		for (int i = 0; i < 128; i++)
+			s.keyGroups.push_back(module->keyboard[i]->group);
+		s.focusGroup = module->focusGroup;
+		s.focusNote = module->focusNote;
+		s.shiftMode = module->shiftMode;
+		s.isplaying = module->isplaying;
+		return s;
+	}
+};
+
+static midi::Message message(int status, int note, int value)
+{
+	midi::Message msg;
+	msg.setStatus(status);
+	msg.setNote(note);
+	msg.setValue(value);
+	return msg;
+}
+
+// A burst of what a player does in one MIDI block: mostly encoder turns, sometimes shift, a key of the pads with
+// shift held, the group encoder or play
+static std::vector<midi::Message> randomBurst()
+{
+	std::vector<midi::Message> burst;
+	int count = 1 + std::rand() % 6;
+	for (int i = 0; i < count; i++)
+	{
+		int kind = std::rand() % 100;
+		if (kind < 80)
+		{
+			// Relative encoder, up to 3 steps either way
+			int steps = 1 + std::rand() % 3;
+			burst.push_back(message(0xb, SESSION_TEST_FIRST_KNOB + std::rand() % MAX_CHANNELS, (std::rand() & 1) ? steps : 128 - steps));
+		}
+		else if (kind < 86)
+		{
+			burst.push_back(message(0xb, SHIFT, 127));
+		}
+		else if (kind < 94)
+		{
+			int note = BASE_NOTE + std::rand() % NOTES;
+			burst.push_back(message(0x9, note, 1 + std::rand() % 127));
+			burst.push_back(message(0x8, note, 0));
+		}
+		else if (kind < 98)
+		{
+			burst.push_back(message(0xb, TAPTEMPO_ENCODER, (std::rand() & 1) ? 1 : 127));
+		}
+		else
+		{
+			burst.push_back(message(0xb, PLAY, 127));
+			burst.push_back(message(0xb, PLAY, 0));
+		}
+	}
+	return burst;
+}
+
+// Plays a random session into a PushMap while recording it, saves the recording. State after the session.
+static SessionState record(MidiSession& session)
+{
+	SessionRig rig;
+	rig.process(SESSION_TEST_STEP_SAMPLES);
+	rig.module->midiRecorder.start(SESSION_TEST_SAMPLE_RATE);
+	size_t sent = 0;
+	for (int step = 0; step < SESSION_TEST_STEPS; step++)
+	{
+		// Queued between samples the way Rack's MIDI driver queues them
+		for (const midi::Message& msg : randomBurst())
+		{
+			rig.module->midiInput.onMessage(msg);
+			sent++;
+		}
+		rig.process(SESSION_TEST_STEP_SAMPLES);
+	}
+	rig.process(4 * SESSION_TEST_STEP_SAMPLES);
+	rig.module->midiRecorder.stop(session);
+	CHECK(rig.module->midiRecorder.overflowCount == 0);
+	CHECK(session.events.size() == sent);
+	CHECK(session.sampleRate == SESSION_TEST_SAMPLE_RATE);
+	CHECK(session.save(SESSION_TEST_PATH));
+	return rig.state();
+}
+
+// Replays the saved session into a fresh PushMap. State after the replay.
+static SessionState replay(bool fast, double& eventsPerSecond)
+{
+	MidiSession session;
+	CHECK(session.load(SESSION_TEST_PATH));
+	size_t events = session.events.size();
+	SessionRig rig;
+	rig.process(SESSION_TEST_STEP_SAMPLES);
+	rig.module->midiReplay.load(session);
+	CHECK(rig.module->midiReplay.size() == events);
+	rig.module->midiReplay.start(fast);
+	CHECK(rig.module->midiReplay.isPlaying());
+	long samples = 0;
+	while (rig.module->midiReplay.isPlaying() && samples < 2L * SESSION_TEST_STEPS * SESSION_TEST_STEP_SAMPLES)
+	{
+		rig.process(SESSION_TEST_STEP_SAMPLES);
+		samples += SESSION_TEST_STEP_SAMPLES;
+	}
+	CHECK(!rig.module->midiReplay.isPlaying());
+	rig.process(4 * SESSION_TEST_STEP_SAMPLES);
+	if (fast)
+	{
+		CHECK(rig.module->midiReplay.fastEvents == events);
+		// Fast mode takes several chunks per MIDI block's worth of samples, far fewer blocks than the recording
+		CHECK(samples < (long) SESSION_TEST_STEPS * SESSION_TEST_STEP_SAMPLES / 10);
+	}
+	eventsPerSecond = rig.module->midiReplay.eventsPerSecond();
+	return rig.state();
+}
+
+static void testFileFormat(const MidiSession& recorded)
+{
+	MidiSession loaded;
+	CHECK(loaded.load(SESSION_TEST_PATH));
+	CHECK(loaded.sampleRate == recorded.sampleRate);
+	CHECK(loaded.events.size() == recorded.events.size());
+	bool same = true;
+	for (size_t i = 0; i < loaded.events.size() && i < recorded.events.size(); i++)
+		same = same && loaded.events[i].block == recorded.events[i].block && std::memcmp(loaded.events[i].bytes, recorded.events[i].bytes, 3) == 0;
+	CHECK(same);
+	// Blocks never go back, and the session spans the recording
+	for (size_t i = 1; i < loaded.events.size(); i++)
+		same = same && loaded.events[i].block >= loaded.events[i - 1].block;
+	CHECK(same);
+	CHECK(!loaded.events.empty() && loaded.events.back().block >= SESSION_TEST_STEPS / 2);
+
+	CHECK(!loaded.load("build/no-such-session.pmmidi"));
+	FILE* file = fopen("build/MidiSessionTest-bad.pmmidi", "wb");
+	fputs("not a MIDI session, but long enough for a header", file);
+	fclose(file);
+	CHECK(!loaded.load("build/MidiSessionTest-bad.pmmidi"));
+}
+
+int main()
+{
+	std::srand(1);
+	MidiSession session;
+	SessionState recorded = record(session);
+	testFileFormat(session);
+	// The session did something: knobs moved, groups changed
+	CHECK(recorded.focusGroup != 0 || recorded.keyGroups != std::vector<int>(128, 0));
+
+	double eventsPerSecond;
+	SessionState fast = replay(true, eventsPerSecond);
+	CHECK(fast.values == recorded.values);
+	CHECK(fast.params == recorded.params);
+	CHECK(fast == recorded);
+	CHECK(eventsPerSecond > 0);
+
+	double unused;
+	SessionState realTime = replay(false, unused);
+	CHECK(realTime == recorded);
+
+	std::printf("MidiSession: %d events, fast replay %.0f events/s\n", (int) session.events.size(), eventsPerSecond);
+	return checkFailures ? 1 : 0;
+}
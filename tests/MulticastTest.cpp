@@ -0,0 +1,149 @@
+// Multicast receive: a UdpReceiveSocket of the family the listener picks for the group joins an IPv4 and an IPv6
+// group and receives datagrams looped back from a local sender. Skipped for a family the host has no multicast
+// route for.
+#include "TestCheck.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "ip/UdpSocket.h"
+#include "ip/PacketListener.h"
+#include "ip/TimerListener.h"
+
+#define MULTICAST_TEST_DATAGRAMS	8
+#define MULTICAST_TEST_TIMEOUT_MS	2000
+
+// Counts the datagrams of this test, stops the multiplexer once all came or on timeout
+struct Receiver : public PacketListener, public TimerListener {
+	SocketReceiveMultiplexer mux;
+	int received = 0;
+	int elapsedMs = 0;
+	bool ipv6Sender = false;
+
+	void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override
+	{
+		if (std::string(data, size) != "multicast")
+			return;
+		ipv6Sender = remoteEndpoint.IsIpv6();
+		if (++received == MULTICAST_TEST_DATAGRAMS)
+			mux.Break();
+	}
+
+	void TimerExpired() override
+	{
+		elapsedMs += 50;
+		if (elapsedMs >= MULTICAST_TEST_TIMEOUT_MS)
+			mux.Break();
+	}
+};
+
+// A port no socket of @family uses right now, 0 on failure
+static int freePort(int family)
+{
+	int fd = socket(family, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return 0;
+	struct sockaddr_storage address = {};
+	socklen_t length = (family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+	address.ss_family = family;
+	int port = 0;
+	if (bind(fd, (struct sockaddr*) &address, length) == 0 && getsockname(fd, (struct sockaddr*) &address, &length) == 0)
+		port = ntohs((family == AF_INET) ? ((struct sockaddr_in*) &address)->sin_port : ((struct sockaddr_in6*) &address)->sin6_port);
+	close(fd);
+	return port;
+}
+
+// Sends the test datagrams to @text:@port from a plain socket, loopback of multicast on (the default). False when the
+// host can't send to the group.
+static bool sendToGroup(const char* text, int port)
+{
+	bool ipv6 = std::strchr(text, ':') != nullptr;
+	int fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return false;
+	struct sockaddr_storage address = {};
+	socklen_t length;
+	if (ipv6)
+	{
+		struct sockaddr_in6* address6 = (struct sockaddr_in6*) &address;
+		address6->sin6_family = AF_INET6;
+		address6->sin6_port = htons(port);
+		inet_pton(AF_INET6, text, &address6->sin6_addr);
+		length = sizeof(*address6);
+	}
+	else
+	{
+		struct sockaddr_in* address4 = (struct sockaddr_in*) &address;
+		address4->sin_family = AF_INET;
+		address4->sin_port = htons(port);
+		inet_pton(AF_INET, text, &address4->sin_addr);
+		length = sizeof(*address4);
+	}
+	bool sent = true;
+	for (int i = 0; i < MULTICAST_TEST_DATAGRAMS && sent; i++)
+		sent = sendto(fd, "multicast", 9, 0, (struct sockaddr*) &address, length) == 9;
+	close(fd);
+	return sent;
+}
+
+// Joins @text on a socket of the family OscRxOptions::family() picks for it and receives what a local sender sends
+static void testGroup(const char* text)
+{
+	IpEndpointName group(text, 0);
+	CHECK(group.IsMulticastAddress());
+	UdpSocket::Family family = group.IsIpv6() ? UdpSocket::DUAL_STACK : UdpSocket::IPV4_ONLY;
+	int port = freePort(group.IsIpv6() ? AF_INET6 : AF_INET);
+	CHECK(port != 0);
+	UdpReceiveSocket socket(IpEndpointName(IpEndpointName::ANY_ADDRESS, port), true, family);
+	try
+	{
+		socket.JoinMulticastEndpoint(group);
+	}
+	catch (const std::runtime_error& e)
+	{
+		std::printf("Multicast %s: skipped, no multicast route (%s)\n", text, e.what());
+		return;
+	}
+	if (!sendToGroup(text, port))
+	{
+		std::printf("Multicast %s: skipped, can't send to the group\n", text);
+		return;
+	}
+	Receiver receiver;
+	receiver.mux.AttachSocketListener(&socket, &receiver);
+	receiver.mux.AttachPeriodicTimerListener(50, &receiver);
+	receiver.mux.Run();
+	receiver.mux.DetachPeriodicTimerListener(&receiver);
+	receiver.mux.DetachSocketListener(&socket, &receiver);
+	socket.LeaveMulticastEndpoint(group);
+	CHECK(receiver.received == MULTICAST_TEST_DATAGRAMS);
+	CHECK(receiver.ipv6Sender == group.IsIpv6());
+	std::printf("Multicast %s: %d of %d datagrams received\n", text, receiver.received, MULTICAST_TEST_DATAGRAMS);
+}
+
+// An IPv4 only socket can't take an IPv6 group, and says so instead of silently receiving nothing
+static void testWrongFamily()
+{
+	UdpReceiveSocket socket(IpEndpointName(IpEndpointName::ANY_ADDRESS, freePort(AF_INET)), true, UdpSocket::IPV4_ONLY);
+	bool thrown = false;
+	try
+	{
+		socket.JoinMulticastEndpoint(IpEndpointName("ff15::7a3e", 0));
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+int main()
+{
+	testGroup("239.255.122.62");
+	testGroup("ff15::7a3e");
+	testWrongFamily();
+	return checkFailures ? 1 : 0;
+}
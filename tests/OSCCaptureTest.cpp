@@ -0,0 +1,161 @@
+// Capture and replay: datagrams teed into OSCCapture come back, in order and unchanged, from the pcap file it writes,
+// both parsed in place and replayed by OSCCaptureReplay to a local UDP port.
+#include "TestCheck.hpp"
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "../src/OSCCapture.hpp"
+
+#define CAPTURE_TEST_PATH		"build/OSCCaptureTest.pcap"
+#define CAPTURE_TEST_DATAGRAMS	200
+// Spacing of the capture times, the replay at rate 1 keeps it
+#define CAPTURE_TEST_SPACING_NS	100000
+
+// A UDP socket on a free local port, reads give up after @timeoutMs. -1 on failure.
+static int openReceiver(uint16_t& port, int timeoutMs)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+	struct sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t length = sizeof(address);
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || getsockname(fd, (struct sockaddr*) &address, &length) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	port = ntohs(address.sin_port);
+	struct timeval timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	return fd;
+}
+
+// OSC sized payloads of every length class, including the largest one
+static std::vector<std::string> makeDatagrams()
+{
+	std::vector<std::string> datagrams;
+	for (int i = 0; i < CAPTURE_TEST_DATAGRAMS; i++)
+	{
+		size_t size = (i == 0) ? OSC_CAPTURE_MAX_PAYLOAD - 3 : 4 * (1 + std::rand() % 128);
+		std::string datagram(size, '\0');
+		for (char& c : datagram)
+			c = (char) std::rand();
+		datagrams.push_back(datagram);
+	}
+	return datagrams;
+}
+
+static void testCapture(const std::vector<std::string>& datagrams, uint16_t port)
+{
+	OSCCapture capture;
+	CHECK(capture.start(CAPTURE_TEST_PATH, port));
+	uint64_t startNs = PacketClockNow();
+	for (size_t i = 0; i < datagrams.size(); i++)
+	{
+		// Senders of both families
+		IpEndpointName remote = (i % 2) ? IpEndpointName("127.0.0.1", 9000 + (int) i) : IpEndpointName("::1", 9000 + (int) i);
+		capture.tee(datagrams[i].data(), (int) datagrams[i].size(), remote, startNs + i * CAPTURE_TEST_SPACING_NS);
+	}
+	// Too large for a UDP packet
+	std::string oversized(OSC_CAPTURE_MAX_PAYLOAD + 1, 'x');
+	capture.tee(oversized.data(), (int) oversized.size(), IpEndpointName("127.0.0.1", 9000), startNs);
+	capture.stop();
+	CHECK(capture.writtenCount == datagrams.size());
+	CHECK(capture.droppedCount == 1);
+
+	// Parsed in place from the mapped file
+	OSCCaptureFile file;
+	CHECK(file.open(CAPTURE_TEST_PATH));
+	std::vector<OSCCaptureReplay::Datagram> parsed;
+	CHECK(OSCCaptureReplay::parse(file.data(), file.size(), parsed));
+	CHECK(parsed.size() == datagrams.size());
+	for (size_t i = 0; i < parsed.size() && i < datagrams.size(); i++)
+	{
+		CHECK(std::string((const char*) file.data() + parsed[i].offset, parsed[i].size) == datagrams[i]);
+		if (i > 0)
+			CHECK(parsed[i].ns - parsed[i - 1].ns == CAPTURE_TEST_SPACING_NS);
+	}
+}
+
+// Replays the capture at @rate and receives it on @fd. Received datagrams in order.
+static std::vector<std::string> replay(int fd, uint16_t port, float rate, OSCCaptureReplay& replay)
+{
+	replay.start(CAPTURE_TEST_PATH, port, rate);
+	std::vector<std::string> received;
+	std::vector<char> buffer(OSC_CAPTURE_MAX_PAYLOAD + 1);
+	ssize_t n;
+	while ((int) received.size() < CAPTURE_TEST_DATAGRAMS && (n = recv(fd, buffer.data(), buffer.size(), 0)) >= 0)
+		received.push_back(std::string(buffer.data(), n));
+	replay.stop();
+	return received;
+}
+
+static void testReplay(const std::vector<std::string>& datagrams, int fd, uint16_t port)
+{
+	// The first datagram is the largest one, the receive buffer has room for it
+	int size = 4 << 20;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	// At the captured speed the receiver keeps up: everything arrives, unchanged and in order
+	OSCCaptureReplay paced;
+	std::vector<std::string> received = replay(fd, port, 1.f, paced);
+	CHECK(paced.totalCount == datagrams.size());
+	CHECK(paced.sentCount == datagrams.size());
+	CHECK(received == datagrams);
+	// The spacing was kept
+	CHECK(paced.elapsedNs >= (datagrams.size() - 1) * CAPTURE_TEST_SPACING_NS);
+
+	// As fast as possible: every datagram is sent, loopback may drop some
+	OSCCaptureReplay fast;
+	received = replay(fd, port, 0.f, fast);
+	CHECK(fast.sentCount == datagrams.size());
+	std::printf("OSCCaptureReplay: %d datagrams at rate 1 in %.1f ms, at max speed %.0f packets/s (%d received)\n",
+		(int) datagrams.size(), paced.elapsedNs / 1e6, fast.packetsPerSecond(), (int) received.size());
+}
+
+static void testBadFiles()
+{
+	std::vector<OSCCaptureReplay::Datagram> parsed;
+	OSCCaptureFile file;
+	CHECK(!file.open("build/no-such-capture.pcap"));
+
+	FILE* empty = fopen("build/OSCCaptureTest-empty.pcap", "wb");
+	fclose(empty);
+	CHECK(file.open("build/OSCCaptureTest-empty.pcap"));
+	CHECK(file.size() == 0);
+	CHECK(!OSCCaptureReplay::parse(file.data(), file.size(), parsed));
+
+	const char text[] = "not a capture, but long enough for a header";
+	CHECK(!OSCCaptureReplay::parse((const uint8_t*) text, sizeof(text), parsed));
+
+	// A capture cut in the middle of a record keeps the records before it
+	file.open(CAPTURE_TEST_PATH);
+	CHECK(OSCCaptureReplay::parse(file.data(), file.size() - 10, parsed));
+	CHECK(parsed.size() == CAPTURE_TEST_DATAGRAMS - 1);
+}
+
+int main()
+{
+	std::srand(1);
+	uint16_t port;
+	int fd = openReceiver(port, 2000);
+	CHECK(fd >= 0);
+	if (fd < 0)
+		return 1;
+	std::vector<std::string> datagrams = makeDatagrams();
+	testCapture(datagrams, port);
+	testReplay(datagrams, fd, port);
+	testBadFiles();
+	close(fd);
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+// Feedback loopback: param changes marked by the engine side reach a local UDP port as OSC bundles.
+#include "TestCheck.hpp"
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "../src/OSCFeedback.hpp"
+#include "osc/OscReceivedElements.h"
+
+OSCFeedbackSender* OSCFeedbackSender::_instance = NULL;
+
+// A UDP socket on a free local port, reads give up after @timeoutMs. -1 on failure.
+static int openReceiver(uint16_t& port, int timeoutMs)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+	struct sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t length = sizeof(address);
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || getsockname(fd, (struct sockaddr*) &address, &length) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	port = ntohs(address.sin_port);
+	struct timeval timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	return fd;
+}
+
+// Float value of every message of a feedback bundle, by address. False on a malformed datagram.
+static bool collect(const char* data, size_t size, std::map<std::string, float>& values)
+{
+	osc::BundleView bundle;
+	if (osc::ParseBundle(data, (osc::osc_bundle_element_size_t) size, bundle) != osc::PARSE_OK)
+		return false;
+	const char* p = bundle.elements;
+	osc::Span element;
+	while (osc::NextBundleElement(p, bundle.end, element))
+	{
+		osc::MessageView message;
+		if (osc::ParseMessage(element.data, (osc::osc_bundle_element_size_t) element.size, message) != osc::PARSE_OK)
+			return false;
+		osc::ArgumentCursor args(message);
+		osc::ArgumentView arg;
+		float value;
+		if (!args.Next(arg) || arg.AsFloat(value) != osc::PARSE_OK)
+			return false;
+		values[std::string(message.addressPattern.data, message.addressPattern.size)] = value;
+	}
+	return true;
+}
+
+// Reads datagrams until @address holds @value or a read times out.
+static bool receiveValue(int fd, const std::string& address, float value, std::map<std::string, float>& values)
+{
+	char buffer[OSC_FEEDBACK_MTU];
+	while (true)
+	{
+		ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+		if (size <= 0)
+			return false;
+		CHECK(collect(buffer, size, values));
+		std::map<std::string, float>::iterator it = values.find(address);
+		if (it != values.end() && it->second == value)
+			return true;
+	}
+}
+
+int main()
+{
+	uint16_t port;
+	int fd = openReceiver(port, 2000);
+	CHECK(fd >= 0);
+	if (fd < 0)
+		return 1;
+
+	OSCFeedbackSource source;
+	source.setAddresses({ "/pushmap/1", "", "/pushmap/3" });
+	source.setTarget("127.0.0.1", port);
+	source.setRate(1000);
+	OSCFeedbackSender::AddSource(&source);
+
+	// A param change is received on the local port, slots without an address are skipped
+	std::map<std::string, float> values;
+	source.markChanged(0, 0.25f);
+	source.markChanged(1, 0.5f);
+	source.markChanged(2, 0.75f);
+	CHECK(receiveValue(fd, "/pushmap/1", 0.25f, values));
+	if (values.count("/pushmap/3") == 0)
+		CHECK(receiveValue(fd, "/pushmap/3", 0.75f, values));
+	CHECK(values["/pushmap/3"] == 0.75f);
+	CHECK(values.size() == 2);
+
+	// The last value of a slot wins
+	source.markChanged(0, 0.1f);
+	source.markChanged(0, 0.9f);
+	CHECK(receiveValue(fd, "/pushmap/1", 0.9f, values));
+
+	// A new target is picked up by the next flush
+	uint16_t otherPort;
+	int otherFd = openReceiver(otherPort, 2000);
+	CHECK(otherFd >= 0);
+	source.setTarget("127.0.0.1", otherPort);
+	source.setAddresses({ "/other" });
+	source.markChanged(0, 0.5f);
+	std::map<std::string, float> otherValues;
+	CHECK(receiveValue(otherFd, "/other", 0.5f, otherValues));
+
+	// Nothing is sent once the source is removed
+	OSCFeedbackSender::RemoveSource(&source);
+	source.markChanged(0, 1.f);
+	char buffer[OSC_FEEDBACK_MTU];
+	struct timeval timeout = { 0, 100 * 1000 };
+	setsockopt(otherFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	CHECK(recv(otherFd, buffer, sizeof(buffer), 0) < 0);
+
+	close(fd);
+	close(otherFd);
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+// OSCRxCoalescer: a block drains every queued event in order in all events mode, a full queue falls back to
+// coalescing without reordering, and the default mode keeps the newest value per slot.
+#include "TestCheck.hpp"
+#include <vector>
+#include "../src/OSCRxCoalescer.hpp"
+
+struct Applied {
+	int slot;
+	double value;
+};
+
+static std::vector<Applied> drainAll(OSCRxCoalescer& coalescer)
+{
+	std::vector<Applied> applied;
+	coalescer.drain([&applied](int slot, double value, uint64_t receivedNs, uint64_t dispatchedNs) {
+		applied.push_back(Applied { slot, value });
+	});
+	return applied;
+}
+
+static void testAllEvents()
+{
+	OSCRxCoalescer coalescer;
+	coalescer.allEvents = true;
+	// A burst of presses and releases on a few slots, more than one per sample of a block
+	const int burst = OSC_RX_EVENT_QUEUE - 1;
+	for (int i = 0; i < burst; i++)
+		coalescer.post(i % 3, (double) i, 1, 2);
+	std::vector<Applied> applied = drainAll(coalescer);
+	CHECK((int) applied.size() == burst);
+	for (int i = 0; i < (int) applied.size(); i++)
+		CHECK(applied[i].slot == i % 3 && applied[i].value == (double) i);
+	CHECK(coalescer.overflowCount == 0);
+	CHECK(drainAll(coalescer).empty());
+
+	// The queue is reused once drained
+	for (int round = 0; round < 4; round++)
+	{
+		for (int i = 0; i < OSC_RX_EVENT_QUEUE; i++)
+			coalescer.post(7, (double) i, 1, 2);
+		CHECK((int) drainAll(coalescer).size() == OSC_RX_EVENT_QUEUE);
+	}
+	CHECK(coalescer.overflowCount == 0);
+
+	// Past the queue the newest value of each slot is kept, after the queued events
+	for (int i = 0; i < OSC_RX_EVENT_QUEUE + 10; i++)
+		coalescer.post(5, (double) i, 1, 2);
+	coalescer.post(6, -1.0, 1, 2);
+	applied = drainAll(coalescer);
+	CHECK((int) applied.size() == OSC_RX_EVENT_QUEUE + 2);
+	CHECK(applied[OSC_RX_EVENT_QUEUE].slot == 5 && applied[OSC_RX_EVENT_QUEUE].value == OSC_RX_EVENT_QUEUE + 9);
+	CHECK(applied[OSC_RX_EVENT_QUEUE + 1].slot == 6);
+	CHECK(coalescer.overflowCount == 11);
+
+	// Queuing resumes once the engine took everything
+	coalescer.post(1, 0.5, 1, 2);
+	coalescer.post(1, 0.25, 1, 2);
+	CHECK(drainAll(coalescer).size() == 2);
+	CHECK(coalescer.overflowCount == 11);
+}
+
+static void testNewest()
+{
+	OSCRxCoalescer coalescer;
+	for (int i = 0; i < 1000; i++)
+		coalescer.post(i % 4, (double) i, 1, 2);
+	std::vector<Applied> applied = drainAll(coalescer);
+	CHECK(applied.size() == 4);
+	for (int i = 0; i < (int) applied.size(); i++)
+		CHECK(applied[i].slot == i && applied[i].value == 996.0 + i);
+	CHECK(coalescer.coalesceRatio() == 250.f);
+}
+
+int main()
+{
+	testAllEvents();
+	testNewest();
+	std::printf("OSCRxCoalescer: %s\n", checkFailures ? "failed" : "ok");
+	return checkFailures ? 1 : 0;
+}
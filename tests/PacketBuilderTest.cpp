@@ -0,0 +1,247 @@
+// BundleBuilder and PacketPool: messages added past a buffer's size are split over several bundles, each of which
+// parses and holds whole messages, none lost, in order. An exhausted pool makes Acquire() and AddMessage() return 0,
+// and buffers released come back. Acquire() and Release() from several threads never hand a buffer out twice.
+#include "TestCheck.hpp"
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "osc/OscPacketBuilder.h"
+#include "osc/OscReceivedElements.h"
+
+#define BUILDER_TEST_BUFFER_SIZE	256
+#define BUILDER_TEST_MESSAGES		1000
+
+// Copies each packet and lets the builder release its buffer, or keeps the buffers
+struct Sink : public osc::PacketSink {
+	bool keep = false;
+	std::vector<std::string> packets;
+	std::vector<char*> kept;
+
+	bool SendPacket(char* buffer, std::size_t size) override
+	{
+		packets.push_back(std::string(buffer, size));
+		if (keep)
+			kept.push_back(buffer);
+		return keep;
+	}
+};
+
+// Headers of a few sizes and argument types, message @n uses headers[n % size]
+static std::vector<osc::MessageHeader> makeHeaders()
+{
+	const char* typeTags[] = { "i", "if", "id", "ihT", "iffff" };
+	std::vector<osc::MessageHeader> headers;
+	for (int i = 0; i < 5; i++)
+	{
+		std::string address = "/test/" + std::string(i * 7, 'x') + "/" + std::to_string(i);
+		osc::MessageHeader header;
+		CHECK(header.Set(address.c_str(), typeTags[i]));
+		headers.push_back(header);
+	}
+	return headers;
+}
+
+// Adds message @n: its number first, the other arguments are filler. False if the builder returned 0.
+static bool addMessage(osc::BundleBuilder& builder, const osc::MessageHeader& header, int n)
+{
+	char* p = builder.AddMessage(header);
+	if (!p)
+		return false;
+	p = osc::WriteInt32(p, n);
+	std::memset(p, 0x5a, header.ArgumentBytes() - 4);
+	return true;
+}
+
+// Parses @packet as a bundle of messages numbered from @next on, advancing @next. False if it doesn't parse.
+static bool checkBundle(const std::string& packet, int& next, const std::vector<osc::MessageHeader>& headers)
+{
+	try
+	{
+		osc::ReceivedPacket received(packet.data(), packet.size());
+		if (!received.IsBundle())
+			return false;
+		osc::ReceivedBundle bundle(received);
+		CHECK(bundle.TimeTag() == 1);
+		CHECK(bundle.ElementCount() > 0);
+		for (osc::ReceivedBundle::const_iterator e = bundle.ElementsBegin(); e != bundle.ElementsEnd(); ++e)
+		{
+			CHECK(e->IsMessage());
+			osc::ReceivedMessage message(*e);
+			const osc::MessageHeader& header = headers[next % headers.size()];
+			CHECK(std::string(message.AddressPattern()) == header.Data());
+			CHECK(e->Size() == (osc::osc_bundle_element_size_t) header.MessageSize());
+			CHECK(message.ArgumentsBegin()->AsInt32() == next);
+			next++;
+		}
+	}
+	catch (const osc::Exception& e)
+	{
+		std::fprintf(stderr, "bundle doesn't parse: %s\n", e.what());
+		return false;
+	}
+	return true;
+}
+
+// Fills many buffers' worth: each bundle is as full as the next message allows, and the messages come out whole
+static void testSplit()
+{
+	std::vector<osc::MessageHeader> headers = makeHeaders();
+	osc::PacketPool pool(4, BUILDER_TEST_BUFFER_SIZE);
+	Sink sink;
+	{
+		osc::BundleBuilder builder(pool, sink);
+		int splits = 0;
+		for (int n = 0; n < BUILDER_TEST_MESSAGES; n++)
+		{
+			const osc::MessageHeader& header = headers[n % headers.size()];
+			splits += builder.AddWouldSplit(header) ? 1 : 0;
+			CHECK(addMessage(builder, header, n));
+		}
+		CHECK((int) sink.packets.size() == splits);
+		builder.Flush();
+		CHECK(builder.PacketsSent() == sink.packets.size());
+		// Flushing an empty builder sends nothing
+		builder.Flush();
+		CHECK(builder.PacketsSent() == sink.packets.size());
+	}
+	CHECK(sink.packets.size() > (size_t) BUILDER_TEST_MESSAGES * 16 / BUILDER_TEST_BUFFER_SIZE);
+
+	int next = 0;
+	for (size_t i = 0; i < sink.packets.size(); i++)
+	{
+		const std::string& packet = sink.packets[i];
+		CHECK(packet.size() <= pool.BufferSize());
+		CHECK(packet.size() % 4 == 0);
+		CHECK(checkBundle(packet, next, headers));
+		// The next message didn't fit
+		if (i + 1 < sink.packets.size())
+			CHECK(packet.size() + 4 + headers[next % headers.size()].MessageSize() > pool.BufferSize());
+	}
+	CHECK(next == BUILDER_TEST_MESSAGES);
+
+	// Every buffer went back to the pool
+	std::vector<char*> buffers;
+	while (char* buffer = pool.Acquire())
+		buffers.push_back(buffer);
+	CHECK(buffers.size() == pool.BufferCount());
+	for (char* buffer : buffers)
+		pool.Release(buffer);
+
+	// A message that can never fit is refused without sending anything
+	osc::MessageHeader huge;
+	CHECK(huge.Set(std::string(BUILDER_TEST_BUFFER_SIZE, 'x').c_str(), "i"));
+	Sink hugeSink;
+	osc::BundleBuilder builder(pool, hugeSink);
+	CHECK(builder.AddMessage(huge) == 0);
+	builder.Flush();
+	CHECK(hugeSink.packets.empty());
+	// Nor are empty headers or unsupported type tags
+	osc::MessageHeader empty;
+	CHECK(builder.AddMessage(empty) == 0);
+	CHECK(!empty.Set("/blob", "b"));
+	CHECK(empty.IsEmpty());
+}
+
+// The sink keeps its buffers until the pool runs dry, then AddMessage() fails until one is released, whose buffer
+// is used next
+static void testExhaustion()
+{
+	std::vector<osc::MessageHeader> headers = makeHeaders();
+	osc::PacketPool pool(3, BUILDER_TEST_BUFFER_SIZE);
+	Sink sink;
+	sink.keep = true;
+	osc::BundleBuilder builder(pool, sink);
+	int n = 0;
+	while (addMessage(builder, headers[n % headers.size()], n))
+		n++;
+	// All three buffers were sent and kept, the message that needed a fourth was refused
+	CHECK(sink.kept.size() == 3);
+	CHECK(pool.Acquire() == 0);
+	CHECK(builder.AddMessage(headers[n % headers.size()]) == 0);
+	// The bundle closed for the failed message was sent whole
+	int next = 0;
+	for (const std::string& packet : sink.packets)
+		CHECK(checkBundle(packet, next, headers));
+	CHECK(next == n);
+
+	// A released buffer is acquired again, intact packets stay with the sink
+	std::set<char*> keptSet(sink.kept.begin(), sink.kept.end());
+	CHECK(keptSet.size() == 3);
+	char* released = sink.kept[0];
+	pool.Release(released);
+	std::string second(sink.kept[1], sink.packets[1].size());
+	CHECK(addMessage(builder, headers[n % headers.size()], n));
+	builder.Flush();
+	CHECK(sink.kept.size() == 4);
+	CHECK(sink.kept[3] == released);
+	CHECK(std::string(sink.kept[1], sink.packets[1].size()) == second);
+	next = n;
+	CHECK(checkBundle(sink.packets[3], next, headers));
+	for (size_t i = 1; i < sink.kept.size(); i++)
+		pool.Release(sink.kept[i]);
+
+	// All buffers back: the same set comes out again
+	std::set<char*> acquired;
+	while (char* buffer = pool.Acquire())
+		acquired.insert(buffer);
+	CHECK(acquired == keptSet);
+	for (char* buffer : acquired)
+		pool.Release(buffer);
+	// Releasing nothing is a no-op
+	pool.Release(0);
+	CHECK(pool.Acquire() != 0);
+}
+
+// Threads acquiring and releasing at once: no buffer is ever held by two of them
+static void testConcurrent()
+{
+	const int bufferCount = 8;
+	const int threadCount = 4;
+	osc::PacketPool pool(bufferCount, 64);
+	std::atomic<int> holders[bufferCount];
+	for (std::atomic<int>& holder : holders)
+		holder = 0;
+	// The first buffer handed out is the start of the pool's block
+	char* base = pool.Acquire();
+	pool.Release(base);
+	std::atomic<int> conflicts(0);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.push_back(std::thread([&]() {
+			for (int i = 0; i < 200000; i++)
+			{
+				char* buffer = pool.Acquire();
+				if (!buffer)
+					continue;
+				int index = (int) ((buffer - base) / (long) pool.BufferSize());
+				if (index < 0 || index >= bufferCount || holders[index].fetch_add(1) != 0)
+					conflicts++;
+				else
+					holders[index].fetch_sub(1);
+				pool.Release(buffer);
+			}
+		}));
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	CHECK(conflicts == 0);
+
+	std::set<char*> acquired;
+	while (char* buffer = pool.Acquire())
+		acquired.insert(buffer);
+	CHECK((int) acquired.size() == bufferCount);
+}
+
+int main()
+{
+	testSplit();
+	testExhaustion();
+	testConcurrent();
+	std::printf("PacketBuilder: %s\n", checkFailures ? "failed" : "ok");
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+// Fuzz target of the non-throwing OSC parser: ParseMessage(), ParseBundle() and the argument views, walked the way
+// OscPacketViewListener delivers a packet to the plugin.
+//
+// Built with -DPARSE_FUZZ_LIBFUZZER and clang's -fsanitize=fuzzer it is a libFuzzer target (`make -C tests fuzz`).
+// Otherwise it is a standalone driver that replays files and directories given on the command line, then runs
+// deterministic mutations of them: `ParseFuzz [-runs=N] corpus/parse`.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "osc/OscPacketListener.h"
+#include "osc/OscReceivedElements.h"
+#include "ip/IpEndpointName.h"
+
+struct FuzzListener : osc::OscPacketViewListener {
+	// Folds in everything read so the compiler can't skip it
+	uint64_t sink = 0;
+
+	void ProcessMessage(const osc::MessageView& message, const IpEndpointName& remoteEndpoint) override
+	{
+		sink += message.addressPattern.size;
+		osc::ArgumentCursor args(message);
+		osc::ArgumentView arg;
+		while (args.Next(arg))
+		{
+			float f;
+			osc::int32 i;
+			double d;
+			osc::Span s;
+			if (arg.AsFloat(f) == osc::PARSE_OK)
+				sink += (uint64_t) (f != f);
+			if (arg.AsInt32(i) == osc::PARSE_OK)
+				sink += (uint64_t) i;
+			if (arg.AsDouble(d) == osc::PARSE_OK)
+				sink += (uint64_t) (d != d);
+			if (arg.AsString(s) == osc::PARSE_OK)
+				sink += s.size;
+		}
+	}
+
+	void ProcessMalformed(osc::ParseStatus status, const IpEndpointName& remoteEndpoint) override
+	{
+		sink += std::strlen(osc::ParseStatusString(status));
+	}
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	// Exactly sized copy, so the sanitizers catch any read past the packet
+	char* packet = (char*) std::malloc(size ? size : 1);
+	std::memcpy(packet, data, size);
+	FuzzListener listener;
+	listener.ProcessPacket(packet, (int) size, IpEndpointName());
+	std::free(packet);
+	return 0;
+}
+
+
+#ifndef PARSE_FUZZ_LIBFUZZER
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static void load(const std::string& path, std::vector<std::string>& inputs)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return;
+	if (S_ISDIR(info.st_mode))
+	{
+		DIR* dir = opendir(path.c_str());
+		if (!dir)
+			return;
+		std::vector<std::string> names;
+		while (struct dirent* entry = readdir(dir))
+		{
+			if (entry->d_name[0] != '.')
+				names.push_back(entry->d_name);
+		}
+		closedir(dir);
+		std::sort(names.begin(), names.end());
+		for (const std::string& name : names)
+			load(path + "/" + name, inputs);
+		return;
+	}
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		return;
+	std::string input;
+	char buffer[4096];
+	size_t n;
+	while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		input.append(buffer, n);
+	std::fclose(file);
+	inputs.push_back(input);
+}
+
+static uint32_t random32(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// One of the mutations libFuzzer would try first, biased towards the bytes the parser branches on
+static void mutate(std::string& input, const std::vector<std::string>& inputs, uint32_t& state)
+{
+	static const char special[] = { '\0', ',', '#', '[', ']', 'b', 's', 'i', 'f', '\x7F', '\x80', '\xFF' };
+	size_t size = input.size();
+	switch (random32(state) % 6)
+	{
+	case 0:
+		if (size)
+			input[random32(state) % size] ^= (char) (1 << (random32(state) % 8));
+		break;
+	case 1:
+		if (size)
+			input[random32(state) % size] = special[random32(state) % sizeof(special)];
+		break;
+	case 2:
+		// Element sizes and blob lengths
+		if (size >= 4)
+		{
+			size_t at = (random32(state) % (size / 4)) * 4;
+			uint32_t value = random32(state) % 3 == 0 ? 0xFFFFFFFCu - (random32(state) % 8) : random32(state) % 64;
+			input[at] = (char) (value >> 24);
+			input[at + 1] = (char) (value >> 16);
+			input[at + 2] = (char) (value >> 8);
+			input[at + 3] = (char) value;
+		}
+		break;
+	case 3:
+		input.resize(size ? random32(state) % size : 0);
+		break;
+	case 4:
+		input.insert(size ? random32(state) % size : 0, std::string(1 + random32(state) % 8, special[random32(state) % sizeof(special)]));
+		break;
+	case 5:
+		{
+			const std::string& other = inputs[random32(state) % inputs.size()];
+			size_t from = other.empty() ? 0 : random32(state) % other.size();
+			input = input.substr(0, size ? random32(state) % size : 0) + other.substr(from);
+		}
+		break;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	long runs = 100000;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strncmp(argv[i], "-runs=", 6) == 0)
+			runs = std::atol(argv[i] + 6);
+		else
+			load(argv[i], inputs);
+	}
+	if (inputs.empty())
+	{
+		std::fprintf(stderr, "usage: %s [-runs=N] <corpus file or directory>...\n", argv[0]);
+		return 1;
+	}
+
+	for (const std::string& input : inputs)
+		LLVMFuzzerTestOneInput((const uint8_t*) input.data(), input.size());
+
+	uint32_t state = 0x9E3779B9u;
+	for (long run = 0; run < runs; run++)
+	{
+		std::string input = inputs[random32(state) % inputs.size()];
+		int mutations = 1 + random32(state) % 4;
+		for (int m = 0; m < mutations; m++)
+			mutate(input, inputs, state);
+		LLVMFuzzerTestOneInput((const uint8_t*) input.data(), input.size());
+	}
+	std::printf("%d inputs, %ld mutations\n", (int) inputs.size(), runs);
+	return 0;
+}
+#endif
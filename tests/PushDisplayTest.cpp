@@ -0,0 +1,209 @@
+// Display pipeline without the hardware: frames submitted to a PushFrameQueue go through the frame scheduler and a
+// PushDisplayLink to a FakePushTransport, which reassembles and decodes them into the expected pixels. Stalled
+// transfers drop frames and are counted on both ends, and an unplugged device is reopened once it comes back.
+// Built against the stub Rack SDK of the benchmarks.
+// The plugin headers come first, TestCheck.hpp keeps Rack's logger.
+#include "../src/plugin.hpp"
+#include "../src/PushFrameScheduler.hpp"
+#include "TestCheck.hpp"
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Longest a test waits for the threads, far more than they need
+#define DISPLAY_TEST_TIMEOUT_MS		10000
+
+// Polls @done until it holds or the timeout passes. Whether it held.
+static bool waitFor(std::function<bool()> done)
+{
+	for (int ms = 0; ms < DISPLAY_TEST_TIMEOUT_MS; ms++)
+	{
+		if (done())
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return done();
+}
+
+// Colour of pixel (@x, @y) of test frame @n, counted from the top left, RGB565 components
+static void patternPixel(int n, int x, int y, int& r, int& g, int& b)
+{
+	r = (x + n) % 32;
+	g = y % 64;
+	b = (x / 32 + n) % 32;
+}
+
+// Test frame @n the way Push2Display hands it over: read back from OpenGL bottom line first, 1920 bytes per line,
+// BGR565 with red in the low bits, XORed with the Push 2 pattern.
+static std::vector<unsigned char> patternImage(int n)
+{
+	static const unsigned char pattern[4] = {0xE7, 0xF3, 0xE7, 0xFF};
+	std::vector<unsigned char> image(PUSH2_DISPLAY_IMAGE_BUFFER_SIZE, 0);
+	for (int y = 0; y < PUSH2_DISPLAY_HEIGHT; y++)
+	{
+		unsigned char* line = &image[(PUSH2_DISPLAY_HEIGHT - 1 - y) * PUSH2_DISPLAY_LINE_PIXEL_BYTES];
+		for (int x = 0; x < PUSH2_DISPLAY_WIDTH; x++)
+		{
+			int r, g, b;
+			patternPixel(n, x, y, r, g, b);
+			uint16_t pixel = r | (g << 5) | (b << 11);
+			line[2 * x] = (pixel & 0xff) ^ pattern[(2 * x) & 3];
+			line[2 * x + 1] = (pixel >> 8) ^ pattern[(2 * x + 1) & 3];
+		}
+	}
+	return image;
+}
+
+// Frame @n decoded: 8 bit RGB, top line first
+static std::vector<unsigned char> patternRgb(int n)
+{
+	std::vector<unsigned char> rgb;
+	for (int y = 0; y < PUSH2_DISPLAY_HEIGHT; y++)
+	{
+		for (int x = 0; x < PUSH2_DISPLAY_WIDTH; x++)
+		{
+			int r, g, b;
+			patternPixel(n, x, y, r, g, b);
+			rgb.push_back((unsigned char) ((r << 3) | (r >> 2)));
+			rgb.push_back((unsigned char) ((g << 2) | (g >> 4)));
+			rgb.push_back((unsigned char) ((b << 3) | (b >> 2)));
+		}
+	}
+	return rgb;
+}
+
+// A display as Push2Display sets it up: link, queue and counters, on a fake transport
+struct DisplayRig {
+	FakePushTransport* fake;
+	PushDisplayLink link;
+	PushFrameQueue frames;
+	PushStats stats;
+
+	DisplayRig() : fake(new FakePushTransport), link(fake), frames(&link)
+	{
+		frames.stats = &stats;
+		link.setWanted(true);
+		link.start();
+	}
+
+	~DisplayRig()
+	{
+		PushFrameScheduler::instance().remove(&frames);
+		link.stop();
+	}
+
+	void schedule()
+	{
+		PushFrameScheduler::instance().add(&frames);
+	}
+
+	void submit(int n)
+	{
+		std::vector<unsigned char> image = patternImage(n);
+		frames.submit(image.data());
+		PushFrameScheduler::instance().notify();
+	}
+
+	uint64_t dropped()
+	{
+		return stats.display.framesDropped.load();
+	}
+};
+
+// Frames come out decoded as they went in, and only the latest of the frames submitted before the scheduler took
+// one is sent
+static void testFrames()
+{
+	DisplayRig rig;
+	CHECK(waitFor([&] { return rig.link.isOpen(); }));
+
+	// Not scheduled yet: the third frame replaces the first two
+	for (int n = 0; n < 3; n++)
+		rig.submit(n);
+	rig.schedule();
+	CHECK(waitFor([&] { return rig.fake->counters().frames == 1; }));
+	CHECK(rig.fake->lastFrame() == patternRgb(2));
+	CHECK(rig.dropped() == 2);
+
+	for (int n = 3; n < 8; n++)
+	{
+		rig.submit(n);
+		CHECK(waitFor([&] { return rig.fake->counters().frames == (uint64_t) n - 1; }));
+		CHECK(rig.fake->lastFrame() == patternRgb(n));
+	}
+	FakePushTransport::Counters counters = rig.fake->counters();
+	// A header and a transfer per line
+	CHECK(counters.transfers == counters.frames * (PUSH2_DISPLAY_HEIGHT + 1));
+	CHECK(counters.droppedFrames == 0 && counters.stalls == 0);
+	CHECK(rig.stats.display.transfers.load() == counters.transfers);
+	CHECK(rig.stats.display.framesSent.load() == counters.frames);
+	CHECK(rig.dropped() == 2);
+}
+
+// A stalled transfer fails and drops the frame it belongs to, the next frame goes through whole. A frame is 161
+// transfers, about one frame in three stalls.
+static void testStalls()
+{
+	DisplayRig rig;
+	rig.fake->stallEvery = 500;
+	rig.fake->stallMs = 1;
+	CHECK(waitFor([&] { return rig.link.isOpen(); }));
+	rig.schedule();
+
+	const int submitted = 30;
+	for (int n = 0; n < submitted; n++)
+	{
+		uint64_t before = rig.fake->counters().frames + rig.dropped();
+		rig.submit(n);
+		CHECK(waitFor([&] { return rig.fake->counters().frames + rig.dropped() > before; }));
+	}
+	FakePushTransport::Counters counters = rig.fake->counters();
+	CHECK(counters.stalls > 0);
+	CHECK(counters.stalls == counters.transfers / 500);
+	// Each stall cost the scheduler a frame, each frame was either shown or dropped
+	CHECK(rig.dropped() == counters.stalls);
+	CHECK(counters.frames + rig.dropped() == (uint64_t) submitted);
+	// The display saw the frames cut short, except where the stall hit a header
+	CHECK(counters.droppedFrames > 0 && counters.droppedFrames <= counters.stalls);
+	CHECK(rig.stats.display.usbErrors.load() == counters.stalls);
+	CHECK(rig.stats.display.lastUsbError.load() == LIBUSB_ERROR_TIMEOUT);
+	CHECK(rig.fake->lastFrame().size() == (size_t) PUSH2_DISPLAY_WIDTH * PUSH2_DISPLAY_HEIGHT * 3);
+}
+
+// Transfers to an unplugged device fail with LIBUSB_ERROR_NO_DEVICE, the link closes it, retries while it stays away
+// and reopens it once it is back, and frames flow again
+static void testUnplug()
+{
+	DisplayRig rig;
+	CHECK(waitFor([&] { return rig.link.isOpen(); }));
+	rig.schedule();
+	rig.submit(0);
+	CHECK(waitFor([&] { return rig.fake->counters().frames == 1; }));
+	CHECK(rig.link.opens == 1);
+
+	rig.fake->plugged = false;
+	rig.submit(1);
+	CHECK(waitFor([&] { return !rig.link.isOpen(); }));
+	// A failed open, then it backs off
+	CHECK(waitFor([&] { return rig.link.failures >= 1; }));
+	CHECK(rig.link.opens == 1);
+	CHECK(rig.dropped() >= 1);
+
+	rig.fake->plugged = true;
+	CHECK(waitFor([&] { return rig.link.isOpen(); }));
+	CHECK(rig.link.opens == 2);
+	rig.submit(2);
+	CHECK(waitFor([&] { return rig.fake->counters().frames >= 1; }));
+	CHECK(rig.fake->lastFrame() == patternRgb(2));
+	CHECK(rig.stats.display.lastUsbError.load() == LIBUSB_ERROR_NO_DEVICE);
+}
+
+int main()
+{
+	testFrames();
+	testStalls();
+	testUnplug();
+	std::printf("PushDisplay: %s\n", checkFailures ? "failed" : "ok");
+	return checkFailures ? 1 : 0;
+}
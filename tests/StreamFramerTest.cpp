@@ -0,0 +1,187 @@
+// StreamFramer: SLIP and length prefixed packets, fragmented and coalesced across reads, and corrupt streams.
+// No socket, reads are simulated by copying chunks into the ring.
+#include "TestCheck.hpp"
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "ip/StreamFramer.h"
+#include "ip/PacketListener.h"
+#include "ip/IpEndpointName.h"
+
+struct RecordingListener : PacketListener {
+	std::vector<std::string> packets;
+
+	void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override
+	{
+		packets.push_back(std::string(data, size));
+	}
+};
+
+// Feeds @stream in reads of the given sizes, cycling through @reads, like TcpSocket's receive loop: each read is
+// cut to the contiguous free space of the ring and followed by a dispatch. False once the stream is found corrupt.
+static bool feed(StreamFramer& framer, RecordingListener& listener, const std::string& stream, const std::vector<size_t>& reads)
+{
+	IpEndpointName remote;
+	size_t position = 0;
+	for (size_t n = 0; position < stream.size(); n++)
+	{
+		size_t read = std::min(reads[n % reads.size()], stream.size() - position);
+		while (read > 0)
+		{
+			size_t available;
+			char* p = framer.WritePointer(available);
+			if (available == 0)
+				return false;
+			size_t size = std::min(read, available);
+			std::memcpy(p, stream.data() + position, size);
+			framer.CommitWrite(size);
+			position += size;
+			read -= size;
+			if (!framer.Dispatch(&listener, remote))
+				return false;
+		}
+	}
+	return true;
+}
+
+static std::string lengthPrefixed(const std::string& packet)
+{
+	size_t size = packet.size();
+	std::string frame;
+	frame += (char) (size >> 24);
+	frame += (char) (size >> 16);
+	frame += (char) (size >> 8);
+	frame += (char) size;
+	return frame + packet;
+}
+
+// Double END encoding of OSC 1.1
+static std::string slip(const std::string& packet)
+{
+	std::string frame = "\xC0";
+	for (char c : packet)
+	{
+		if ((unsigned char) c == 0xC0)
+			frame += "\xDB\xDC";
+		else if ((unsigned char) c == 0xDB)
+			frame += "\xDB\xDD";
+		else
+			frame += c;
+	}
+	return frame + "\xC0";
+}
+
+// OSC sized packet full of the SLIP special bytes
+static std::string randomPacket(size_t maxWords)
+{
+	static const char bytes[] = { '\xC0', '\xDB', '\xDC', '\xDD', '/', 'a', '\0', ',' };
+	std::string packet(4 * (1 + std::rand() % maxWords), '\0');
+	for (char& c : packet)
+		c = bytes[std::rand() % sizeof(bytes)];
+	return packet;
+}
+
+static void testFraming(StreamFraming framing, size_t capacity)
+{
+	std::vector<std::string> packets;
+	std::string stream;
+	for (int i = 0; i < 200; i++)
+	{
+		packets.push_back(randomPacket(capacity / 32));
+		stream += (framing == SLIP_FRAMING) ? slip(packets.back()) : lengthPrefixed(packets.back());
+	}
+
+	std::vector<std::vector<size_t>> readPatterns = {
+		// Coalesced: as much as the ring takes
+		{ capacity },
+		// Fragmented: byte by byte, then splits landing inside prefixes and escapes
+		{ 1 },
+		{ 3 },
+		{ 2, 7, 1, 5 },
+		{ 13, 1, 29 },
+	};
+	for (const std::vector<size_t>& reads : readPatterns)
+	{
+		StreamFramer framer(framing, capacity);
+		RecordingListener listener;
+		CHECK(feed(framer, listener, stream, reads));
+		CHECK(listener.packets == packets);
+	}
+
+	// Random reads, packets wrap around the end of the small ring all the time
+	for (int round = 0; round < 20; round++)
+	{
+		std::vector<size_t> reads;
+		for (int i = 0; i < 64; i++)
+			reads.push_back(1 + std::rand() % capacity);
+		StreamFramer framer(framing, capacity);
+		RecordingListener listener;
+		CHECK(feed(framer, listener, stream, reads));
+		CHECK(listener.packets == packets);
+	}
+}
+
+static void testBadLengths()
+{
+	std::string good = lengthPrefixed(std::string("/ok\0,\0\0\0", 8));
+	std::vector<std::string> bad = {
+		// Zero
+		std::string("\0\0\0\0", 4),
+		// Not a multiple of 4
+		std::string("\0\0\0\x05" "abcde", 9),
+		// Larger than the ring
+		std::string("\0\0\x01\0", 4),
+		std::string("\xFF\xFF\xFF\xFC", 4),
+	};
+	for (const std::string& frame : bad)
+	{
+		for (size_t read : { (size_t) 1, (size_t) 64 })
+		{
+			StreamFramer framer(LENGTH_PREFIX_FRAMING, 64);
+			RecordingListener listener;
+			// The packet before the bad length is still delivered
+			CHECK(!feed(framer, listener, good + frame + good, { read }));
+			CHECK(listener.packets.size() == 1);
+			// The ring was cleared, the framer is good for a new connection
+			CHECK(feed(framer, listener, good, { read }));
+			CHECK(listener.packets.size() == 2);
+		}
+	}
+
+	// Largest packet that fits the ring along with its prefix
+	std::string largest(64 - 4, 'x');
+	StreamFramer framer(LENGTH_PREFIX_FRAMING, 64);
+	RecordingListener listener;
+	CHECK(feed(framer, listener, lengthPrefixed(largest), { 5 }));
+	CHECK(listener.packets.size() == 1 && listener.packets[0] == largest);
+}
+
+static void testBadSlip()
+{
+	StreamFramer framer(SLIP_FRAMING, 64);
+	RecordingListener listener;
+	// Bad escape and an escape right before END are dropped, the frames around them are not
+	std::string stream = slip("good") + "\xC0" "ab\xDB" "xcd\xC0" + "\xC0" "ab\xDB\xC0" + slip("next");
+	CHECK(feed(framer, listener, stream, { 3 }));
+	CHECK(listener.packets.size() == 2 && listener.packets[0] == "good" && listener.packets[1] == "next");
+
+	// A frame that fills the ring without an END can never complete
+	StreamFramer full(SLIP_FRAMING, 64);
+	RecordingListener fullListener;
+	CHECK(!feed(full, fullListener, "\xC0" + std::string(100, 'x'), { 16 }));
+	CHECK(fullListener.packets.empty());
+	CHECK(feed(full, fullListener, slip("after"), { 16 }));
+	CHECK(fullListener.packets.size() == 1);
+}
+
+int main()
+{
+	std::srand(1);
+	testFraming(LENGTH_PREFIX_FRAMING, 64);
+	testFraming(LENGTH_PREFIX_FRAMING, 4096);
+	testFraming(SLIP_FRAMING, 64);
+	testFraming(SLIP_FRAMING, 4096);
+	testBadLengths();
+	testBadSlip();
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdio>
+
+// Failed checks are reported and counted, a test exits non-zero if any failed.
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+// Rack's logger, for the plugin headers under test
+#ifndef DEBUG
+#define DEBUG(format, ...) std::fprintf(stderr, "[debug] " format "\n", ##__VA_ARGS__)
+#endif
+#ifndef INFO
+#define INFO(format, ...) std::fprintf(stderr, "[info] " format "\n", ##__VA_ARGS__)
+#endif
+#ifndef WARN
+#define WARN(format, ...) std::fprintf(stderr, "[warn] " format "\n", ##__VA_ARGS__)
+#endif